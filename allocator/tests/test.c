@@ -0,0 +1,438 @@
+/**
+ * @file test.c
+ * @brief Unit tests for the allocator.h file, the thread caching allocator ones only run when the build
+ *        defines ALLOCATOR_PTHREAD
+ */
+#ifdef ALLOCATOR_PTHREAD
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+
+static size_t count_chunks(const struct pool_allocator *pool) {
+    size_t chunks = 0;
+    for (struct pool_chunk *c = pool->chunks; c != NULL; c = c->next) {
+        chunks++;
+    }
+    return chunks;
+}
+
+void test_pool_allocator_init(void) {
+    struct pool_allocator pool = pool_allocator_init(allocator_get_default(), 1, 0);
+    assert(pool.block_size >= sizeof(void *));
+    assert(pool.block_size % ALLOCATOR_ALIGNMENT == 0);
+    assert(pool.blocks_per_chunk == POOL_ALLOCATOR_DEFAULT_BLOCKS);
+    assert(pool.chunks == NULL);
+    assert(pool.free_list == NULL);
+    pool_allocator_deinit(&pool);
+    printf("test pool allocator init passed\n");
+}
+
+void test_pool_allocator_malloc_free(void) {
+    struct pool_allocator pool = pool_allocator_init(allocator_get_default(), 24, 4);
+    struct Allocator alloc = allocator_get_pool(&pool);
+    void *blocks[8];
+
+    for (int i = 0; i < 8; ++i) {
+        blocks[i] = alloc.malloc(24, alloc.ctx);
+        assert(blocks[i] != NULL);
+        assert((uintptr_t)blocks[i] % ALLOCATOR_ALIGNMENT == 0);
+        memset(blocks[i], i, 24);
+    }
+    assert(count_chunks(&pool) == 2);
+    // Blocks of the same chunk are contiguous
+    assert((char *)blocks[1] == (char *)blocks[0] + pool.block_size);
+    for (int i = 0; i < 8; ++i) {
+        assert(((unsigned char *)blocks[i])[23] == (unsigned char)i);
+    }
+
+    // Freed blocks are handed back before carving new ones, last freed first
+    alloc.free(blocks[2], 24, alloc.ctx);
+    alloc.free(blocks[5], 24, alloc.ctx);
+    assert(alloc.malloc(24, alloc.ctx) == blocks[5]);
+    assert(alloc.malloc(24, alloc.ctx) == blocks[2]);
+    assert(count_chunks(&pool) == 2);
+
+    pool_allocator_deinit(&pool);
+    assert(pool.chunks == NULL);
+    printf("test pool allocator malloc free passed\n");
+}
+
+void test_pool_allocator_oversized(void) {
+    struct pool_allocator pool = pool_allocator_init(allocator_get_default(), 16, 4);
+    struct Allocator alloc = allocator_get_pool(&pool);
+
+    // Bigger than a block goes to the backing allocator and does not create chunks
+    char *big = alloc.malloc(1000, alloc.ctx);
+    assert(big != NULL);
+    assert(count_chunks(&pool) == 0);
+    memset(big, 'x', 1000);
+
+    // Shrinking below the block size moves it into the pool, keeping the contents
+    char *small = alloc.realloc(big, 1000, 8, alloc.ctx);
+    assert(small != NULL);
+    assert(count_chunks(&pool) == 1);
+    assert(small[0] == 'x' && small[7] == 'x');
+
+    // Growing inside the block size stays in place
+    assert(alloc.realloc(small, 8, 16, alloc.ctx) == small);
+
+    // Growing past it moves it out again
+    big = alloc.realloc(small, 16, 2000, alloc.ctx);
+    assert(big != NULL);
+    assert(big[0] == 'x');
+    alloc.free(big, 2000, alloc.ctx);
+
+    pool_allocator_deinit(&pool);
+    printf("test pool allocator oversized passed\n");
+}
+
+void test_pool_allocator_release(void) {
+    struct pool_allocator pool = pool_allocator_init(allocator_get_default(), 32, 16);
+    struct Allocator alloc = allocator_get_pool(&pool);
+
+    for (int i = 0; i < 100; ++i) {
+        assert(alloc.malloc(32, alloc.ctx) != NULL);
+    }
+    assert(count_chunks(&pool) == 7);
+
+    // Releasing frees every chunk without freeing each block, the pool stays usable
+    pool_allocator_release(&pool);
+    assert(count_chunks(&pool) == 0);
+    assert(pool.free_list == NULL);
+    assert(alloc.malloc(32, alloc.ctx) != NULL);
+    assert(count_chunks(&pool) == 1);
+
+    pool_allocator_deinit(&pool);
+    pool_allocator_release(NULL);
+    pool_allocator_deinit(NULL);
+    printf("test pool allocator release passed\n");
+}
+
+void test_arena_allocator_malloc(void) {
+    struct arena_allocator arena = arena_allocator_init(allocator_get_default(), 1024);
+    struct Allocator alloc = allocator_get_arena(&arena);
+
+    char *a = alloc.malloc(10, alloc.ctx);
+    char *b = alloc.malloc(10, alloc.ctx);
+    assert(a != NULL && b != NULL);
+    assert((uintptr_t)a % ALLOCATOR_ALIGNMENT == 0);
+    assert((uintptr_t)b % ALLOCATOR_ALIGNMENT == 0);
+    // Bump allocation, b comes right after a
+    assert(b == a + allocator_align_up(10));
+
+    // free is a no-op, the next allocation does not reuse a
+    alloc.free(a, 10, alloc.ctx);
+    char *c = alloc.malloc(10, alloc.ctx);
+    assert(c != a);
+
+    // Zero-size allocations take room too, they never alias each other or the next one
+    char *empty1 = alloc.malloc(0, alloc.ctx);
+    char *empty2 = alloc.malloc(0, alloc.ctx);
+    char *after = alloc.malloc(10, alloc.ctx);
+    assert(empty1 != NULL && empty2 != NULL && empty1 != empty2);
+    assert(after != empty1 && after != empty2);
+    // Shrinking the last allocation to 0 in place keeps it apart from the next one as well
+    assert(alloc.realloc(after, 10, 0, alloc.ctx) == after);
+    assert(alloc.malloc(1, alloc.ctx) != after);
+
+    // Bigger than a block gets its own block
+    char *big = alloc.malloc(4096, alloc.ctx);
+    assert(big != NULL);
+    assert(arena.current->capacity >= 4096);
+    assert(arena.current->prev != NULL);
+    memset(big, 0, 4096);
+
+    arena_allocator_deinit(&arena);
+    assert(arena.current == NULL);
+    printf("test arena allocator malloc passed\n");
+}
+
+void test_arena_allocator_realloc(void) {
+    struct arena_allocator arena = arena_allocator_init(allocator_get_default(), 1024);
+    struct Allocator alloc = allocator_get_arena(&arena);
+
+    // The last allocation grows in place while the block has room
+    int *data = alloc.malloc(sizeof(int), alloc.ctx);
+    data[0] = 7;
+    for (size_t cap = 2; cap <= 128; cap *= 2) {
+        int *grown = alloc.realloc(data, cap / 2 * sizeof(int), cap * sizeof(int), alloc.ctx);
+        assert(grown == data);
+        grown[cap - 1] = (int)cap;
+    }
+    assert(arena.current->prev == NULL);
+
+    // Past the block it moves, keeping the contents
+    int *moved = alloc.realloc(data, 128 * sizeof(int), 1024 * sizeof(int), alloc.ctx);
+    assert(moved != NULL && moved != data);
+    assert(moved[0] == 7);
+    assert(moved[127] == 128);
+
+    // Not the last allocation anymore, growing must copy
+    char *other = alloc.malloc(8, alloc.ctx);
+    other[0] = 'a';
+    char *tail = alloc.malloc(8, alloc.ctx);
+    (void)tail;
+    char *other_grown = alloc.realloc(other, 8, 16, alloc.ctx);
+    assert(other_grown != other);
+    assert(other_grown[0] == 'a');
+
+    // Shrinking never moves
+    assert(alloc.realloc(other_grown, 16, 4, alloc.ctx) == other_grown);
+
+    arena_allocator_deinit(&arena);
+    printf("test arena allocator realloc passed\n");
+}
+
+void test_arena_allocator_mark_reset(void) {
+    struct arena_allocator arena = arena_allocator_init(allocator_get_default(), 256);
+    struct Allocator alloc = allocator_get_arena(&arena);
+
+    char *keep = alloc.malloc(32, alloc.ctx);
+    memset(keep, 'k', 32);
+    struct arena_marker mark = arena_mark(&arena);
+    struct arena_block *marked_block = arena.current;
+    size_t marked_used = arena.current->used;
+
+    // Scoped allocations spanning several blocks
+    for (int i = 0; i < 20; ++i) {
+        assert(alloc.malloc(100, alloc.ctx) != NULL);
+    }
+    assert(arena.current != marked_block);
+
+    arena_reset_to(&arena, mark);
+    assert(arena.current == marked_block);
+    assert(arena.current->used == marked_used);
+    assert(keep[0] == 'k' && keep[31] == 'k');
+
+    // The memory after the mark is handed out again
+    char *again = alloc.malloc(32, alloc.ctx);
+    assert(again == keep + 32);
+
+    // A full reset keeps the oldest block for reuse
+    arena_reset(&arena);
+    assert(arena.current == marked_block);
+    assert(arena.current->used == 0);
+    assert(arena.current->prev == NULL);
+    assert(alloc.malloc(32, alloc.ctx) == keep);
+
+    arena_allocator_deinit(&arena);
+    arena_reset(NULL);
+    arena_allocator_deinit(NULL);
+    printf("test arena allocator mark reset passed\n");
+}
+
+void test_stats_allocator_counts(void) {
+    struct allocator_stats stats = allocator_stats_init(allocator_get_default());
+    struct Allocator alloc = allocator_get_stats(&stats);
+
+    char *a = alloc.malloc(10, alloc.ctx);
+    char *b = alloc.malloc(100, alloc.ctx);
+    assert(a != NULL && b != NULL);
+    assert(stats.malloc_calls == 2);
+    assert(stats.bytes_live == 110);
+    assert(stats.bytes_peak == 110);
+    assert(stats.histogram[0] == 1); // 10 <= 16
+    assert(stats.histogram[3] == 1); // 64 < 100 <= 128
+
+    b = alloc.realloc(b, 100, 1000, alloc.ctx);
+    assert(b != NULL);
+    assert(stats.realloc_calls == 1);
+    assert(stats.bytes_live == 1010);
+    assert(stats.bytes_peak == 1010);
+    assert(stats.histogram[allocator_stats_bucket(1000)] == 1);
+
+    alloc.free(b, 1000, alloc.ctx);
+    alloc.free(NULL, 0, alloc.ctx);
+    assert(stats.free_calls == 1);
+    assert(stats.bytes_live == 10);
+    assert(stats.bytes_peak == 1010);
+
+    // A realloc of NULL behaves as malloc
+    char *c = alloc.realloc(NULL, 0, 32, alloc.ctx);
+    assert(c != NULL);
+    assert(stats.bytes_live == 42);
+    alloc.free(c, 32, alloc.ctx);
+    alloc.free(a, 10, alloc.ctx);
+    assert(stats.bytes_live == 0);
+    assert(stats.failed_calls == 0);
+
+    assert(allocator_stats_bucket(0) == 0);
+    assert(allocator_stats_bucket(16) == 0);
+    assert(allocator_stats_bucket(17) == 1);
+    assert(allocator_stats_bucket((size_t)-1) == ALLOCATOR_STATS_BUCKETS - 1);
+
+    allocator_stats_reset(&stats);
+    assert(stats.malloc_calls == 0 && stats.bytes_peak == 0);
+    assert(stats.backing.malloc == default_malloc);
+    allocator_stats_reset(NULL);
+    printf("test stats allocator counts passed\n");
+}
+
+void test_stats_allocator_over_pool(void) {
+    struct pool_allocator pool = pool_allocator_init(allocator_get_default(), sizeof(int), 4);
+    struct allocator_stats stats = allocator_stats_init(allocator_get_pool(&pool));
+    struct Allocator alloc = allocator_get_stats(&stats);
+
+    int *blocks[8];
+    for (int i = 0; i < 8; ++i) {
+        blocks[i] = alloc.malloc(sizeof(int), alloc.ctx);
+        assert(blocks[i] != NULL);
+    }
+    assert(count_chunks(&pool) == 2);
+    assert(stats.bytes_peak == 8 * sizeof(int));
+    for (int i = 0; i < 8; ++i) {
+        alloc.free(blocks[i], sizeof(int), alloc.ctx);
+    }
+    assert(stats.free_calls == 8);
+    assert(stats.bytes_live == 0);
+    pool_allocator_deinit(&pool);
+    printf("test stats allocator over pool passed\n");
+}
+
+#ifdef ALLOCATOR_PTHREAD
+void test_tcache_allocator_single_thread(void) {
+    struct allocator_stats stats = allocator_stats_init(allocator_get_default());
+    struct tcache_allocator tcache;
+    assert(tcache_allocator_init(&tcache, allocator_get_stats(&stats)) == 0);
+    struct Allocator alloc = allocator_get_tcache(&tcache);
+
+    // A batch of blocks is carved at once, a freed block is the next one handed out
+    void *blocks[TCACHE_ALLOCATOR_BATCH];
+    for (size_t i = 0; i < TCACHE_ALLOCATOR_BATCH; ++i) {
+        blocks[i] = alloc.malloc(24, alloc.ctx);
+        assert(blocks[i] != NULL);
+        assert((uintptr_t)blocks[i] % ALLOCATOR_ALIGNMENT == 0);
+        memset(blocks[i], 0xAB, 24);
+    }
+    assert(stats.malloc_calls == 2); // the thread cache and one chunk
+    alloc.free(blocks[3], 24, alloc.ctx);
+    assert(alloc.malloc(20, alloc.ctx) == blocks[3]); // same size class
+    assert(stats.malloc_calls == 2);
+
+    // Within a size class realloc stays in place, crossing it moves and keeps the content
+    void *same = alloc.realloc(blocks[0], 24, 30, alloc.ctx);
+    assert(same == blocks[0]);
+    char *moved = alloc.realloc(blocks[0], 30, 100, alloc.ctx);
+    assert(moved != blocks[0]);
+    assert((unsigned char)moved[0] == 0xAB && (unsigned char)moved[23] == 0xAB);
+    blocks[0] = moved;
+
+    // Too big for the size classes, straight to the backing allocator
+    size_t big = TCACHE_ALLOCATOR_MAX_SIZE + 1;
+    size_t calls = stats.malloc_calls;
+    void *large = alloc.malloc(big, alloc.ctx);
+    assert(large != NULL && stats.malloc_calls == calls + 1);
+    large = alloc.realloc(large, big, 4 * big, alloc.ctx);
+    assert(large != NULL && stats.realloc_calls == 1);
+    alloc.free(large, 4 * big, alloc.ctx);
+    assert(stats.free_calls == 1);
+
+    // Past twice a batch of free blocks the thread gives one batch back, flush gives back the rest,
+    // the 2 * BATCH + 1 blocks took three chunks
+    alloc.free(blocks[0], 100, alloc.ctx);
+    for (size_t i = 1; i < TCACHE_ALLOCATOR_BATCH; ++i) {
+        alloc.free(blocks[i], 24, alloc.ctx);
+    }
+    void *more[2 * TCACHE_ALLOCATOR_BATCH + 1];
+    for (size_t i = 0; i < 2 * TCACHE_ALLOCATOR_BATCH + 1; ++i) {
+        more[i] = alloc.malloc(8, alloc.ctx);
+        assert(more[i] != NULL);
+    }
+    for (size_t i = 0; i < 2 * TCACHE_ALLOCATOR_BATCH + 1; ++i) {
+        alloc.free(more[i], 8, alloc.ctx);
+    }
+    assert(tcache.shared[tcache_class(8)].count == TCACHE_ALLOCATOR_BATCH);
+    tcache_allocator_flush(&tcache);
+    assert(tcache.shared[tcache_class(8)].count == 3 * TCACHE_ALLOCATOR_BATCH);
+    assert(tcache.shared[tcache_class(24)].count == TCACHE_ALLOCATOR_BATCH);
+
+    tcache_allocator_deinit(&tcache);
+    assert(stats.bytes_live == 0);
+    printf("test tcache allocator single thread passed\n");
+}
+
+#define TCACHE_TEST_THREADS 8
+#define TCACHE_TEST_ROUNDS 2000
+
+struct tcache_worker {
+    struct Allocator alloc;
+    unsigned int seed;
+};
+
+static void *tcache_worker_run(void *arg) {
+    struct tcache_worker *worker = arg;
+    struct Allocator alloc = worker->alloc;
+    enum { LIVE = 64 };
+    unsigned char *live[LIVE] = { 0 };
+    size_t sizes[LIVE] = { 0 };
+    unsigned int x = worker->seed;
+    for (int round = 0; round < TCACHE_TEST_ROUNDS; ++round) {
+        x = x * 1103515245u + 12345u;
+        size_t slot = (x >> 16) % LIVE;
+        if (live[slot] != NULL) {
+            // Nobody else wrote into the block while this thread held it
+            for (size_t i = 0; i < sizes[slot]; ++i) {
+                assert(live[slot][i] == (unsigned char)(slot + sizes[slot]));
+            }
+            alloc.free(live[slot], sizes[slot], alloc.ctx);
+        }
+        x = x * 1103515245u + 12345u;
+        sizes[slot] = 1 + (x >> 16) % (TCACHE_ALLOCATOR_MAX_SIZE + 64);
+        live[slot] = alloc.malloc(sizes[slot], alloc.ctx);
+        assert(live[slot] != NULL);
+        memset(live[slot], (int)(unsigned char)(slot + sizes[slot]), sizes[slot]);
+    }
+    for (size_t slot = 0; slot < LIVE; ++slot) {
+        alloc.free(live[slot], sizes[slot], alloc.ctx);
+    }
+    return NULL;
+}
+
+void test_tcache_allocator_threads(void) {
+    // The stats allocator is not thread safe, the tcache only calls it with its lock held
+    struct allocator_stats stats = allocator_stats_init(allocator_get_default());
+    struct tcache_allocator tcache;
+    assert(tcache_allocator_init(&tcache, allocator_get_stats(&stats)) == 0);
+    struct tcache_worker workers[TCACHE_TEST_THREADS];
+    pthread_t threads[TCACHE_TEST_THREADS];
+    for (int t = 0; t < TCACHE_TEST_THREADS; ++t) {
+        workers[t].alloc = allocator_get_tcache(&tcache);
+        workers[t].seed = (unsigned int)t * 7919u + 1u;
+        assert(pthread_create(&threads[t], NULL, tcache_worker_run, &workers[t]) == 0);
+    }
+    for (int t = 0; t < TCACHE_TEST_THREADS; ++t) {
+        assert(pthread_join(threads[t], NULL) == 0);
+    }
+    // Every thread cache went back to the shared lists on exit
+    assert(tcache.locals == NULL);
+    assert(stats.malloc_calls < (size_t)TCACHE_TEST_THREADS * TCACHE_TEST_ROUNDS / 4);
+    tcache_allocator_deinit(&tcache);
+    assert(stats.bytes_live == 0);
+    printf("test tcache allocator threads passed\n");
+}
+#endif // ALLOCATOR_PTHREAD
+
+int main(void) {
+    test_pool_allocator_init();
+    test_pool_allocator_malloc_free();
+    test_pool_allocator_oversized();
+    test_pool_allocator_release();
+    test_arena_allocator_malloc();
+    test_arena_allocator_realloc();
+    test_arena_allocator_mark_reset();
+    test_stats_allocator_counts();
+    test_stats_allocator_over_pool();
+#ifdef ALLOCATOR_PTHREAD
+    test_tcache_allocator_single_thread();
+    test_tcache_allocator_threads();
+#endif // ALLOCATOR_PTHREAD
+    return 0;
+}
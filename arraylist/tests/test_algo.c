@@ -0,0 +1,460 @@
+/**
+ * @file test_algo.c
+ * @brief Unit tests for the arraylist.h algorithms (ARRAYLIST_IMPL_ALGO) and their parallel versions,
+ *        on the serial executor and, when the build defines EXECUTOR_PTHREAD, on both pools of executor.h
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+#include "executor.h"
+
+struct record {
+    int key;
+    int payload;
+};
+
+ARRAYLIST(int, ints, arraylist_noop_deinit)
+ARRAYLIST_DECL_ALGO(int, ints)
+ARRAYLIST_IMPL_ALGO(int, ints)
+ARRAYLIST(struct record, records, arraylist_noop_deinit)
+ARRAYLIST_DECL_ALGO(struct record, records)
+ARRAYLIST_IMPL_ALGO(struct record, records)
+ARRAYLIST_DYN(int, ints)
+ARRAYLIST_DECL_DYN_ALGO(int, ints)
+ARRAYLIST_IMPL_DYN_ALGO(int, ints)
+
+size_t global_destructor_counter_arraylist = 0;
+
+static void int_ptr_deinit(int **elem, struct Allocator *alloc) {
+    alloc->free(*elem, sizeof(int), alloc->ctx);
+    global_destructor_counter_arraylist++;
+}
+
+ARRAYLIST(int *, int_ptrs, int_ptr_deinit)
+ARRAYLIST_DECL_ALGO(int *, int_ptrs)
+ARRAYLIST_IMPL_ALGO(int *, int_ptrs)
+
+// Executor whose queue is always full, every task ends up running on the caller
+static bool reject_submit(void (*task)(void *arg), void *arg, void *ctx) {
+    (void)task;
+    (void)arg;
+    (void)ctx;
+    return false;
+}
+static void reject_wait(void *ctx) {
+    (void)ctx;
+}
+
+static void *failing_malloc(size_t size, void *ctx) {
+    (void)size;
+    (void)ctx;
+    return NULL;
+}
+
+static unsigned int rng_state = 12345;
+static int next_random(int range) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (int)((rng_state >> 16) % (unsigned int)range);
+}
+
+static void fill_ints(struct arraylist_ints *list, size_t n, int range) {
+    ints_clear(list);
+    for (size_t i = 0; i < n; ++i) {
+        ints_push_back(list, next_random(range));
+    }
+}
+
+static void add_ctx(int *elem, void *ctx) {
+    *elem += *(int *)ctx;
+}
+
+static int square(int *elem, void *ctx) {
+    (void)ctx;
+    return *elem * *elem;
+}
+
+static int sum(int acc, int *elem, void *ctx) {
+    (void)ctx;
+    return acc + *elem;
+}
+
+static int max_of(int acc, int *elem, void *ctx) {
+    (void)ctx;
+    return *elem > acc ? *elem : acc;
+}
+
+static bool is_even(int *elem, void *ctx) {
+    (void)ctx;
+    return *elem % 2 == 0;
+}
+
+static bool below(int *elem, void *ctx) {
+    return *elem < *(int *)ctx;
+}
+
+static bool int_eq(int *a, int *b) {
+    return *a == *b;
+}
+
+static bool int_less(int *a, int *b) {
+    return *a < *b;
+}
+
+static bool ints_sorted(int *data, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        if (data[i - 1] > data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool ints_equal(const int *a, const int *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int int_cmp(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static void sort_ints(struct arraylist_ints *list) {
+    if (list->size > 0) {
+        qsort(list->data, list->size, sizeof(int), int_cmp);
+    }
+}
+
+// Every parallel_ function against its serial version for sizes around the chunk threshold
+static void check_sizes(struct Executor *executor, size_t nthreads) {
+    struct arraylist_ints list = ints_init(allocator_get_default());
+    struct arraylist_ints serial = ints_init(allocator_get_default());
+    struct arraylist_ints out = ints_init(allocator_get_default());
+    const size_t sizes[] = { 0, 1, 100, 2 * ARRAYLIST_PARALLEL_MIN_CHUNK - 1, 2 * ARRAYLIST_PARALLEL_MIN_CHUNK,
+                             3 * ARRAYLIST_PARALLEL_MIN_CHUNK + 7, 100003 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        const size_t n = sizes[s];
+        fill_ints(&list, n, 1000);
+        ints_deinit(&serial);
+        serial = ints_shallow_copy(&list);
+
+        int delta = 3;
+        assert(ints_parallel_for_each(&list, add_ctx, &delta, executor, nthreads) == ARRAYLIST_OK);
+        assert(ints_for_each(&serial, add_ctx, &delta) == ARRAYLIST_OK);
+        assert(list.size == n && ints_equal(list.data, serial.data, n));
+
+        assert(ints_parallel_transform(&list, &out, square, NULL, executor, nthreads) == ARRAYLIST_OK);
+        assert(out.size == n);
+        for (size_t i = 0; i < n; ++i) {
+            assert(out.data[i] == list.data[i] * list.data[i]);
+        }
+
+        assert(ints_parallel_reduce(&list, 7, sum, NULL, executor, nthreads) == ints_reduce(&list, 7, sum, NULL));
+        assert(ints_parallel_reduce(&list, -1, max_of, NULL, executor, nthreads) == ints_reduce(&list, -1, max_of, NULL));
+        assert(ints_parallel_count_if(&list, is_even, NULL, executor, nthreads) == ints_count_if(&list, is_even, NULL));
+
+        // the accepted ones keep their order, the others too once it runs in at least two chunks
+        size_t evens = ints_count_if(&list, is_even, NULL);
+        const bool stable = n / ARRAYLIST_PARALLEL_MIN_CHUNK >= 2 && nthreads >= 2;
+        assert(ints_parallel_partition(&list, is_even, NULL, executor, nthreads) == evens);
+        size_t e = 0;
+        size_t o = evens;
+        for (size_t i = 0; i < n; ++i) {
+            if (serial.data[i] % 2 == 0) {
+                assert(list.data[e++] == serial.data[i]);
+            } else if (stable) {
+                assert(list.data[o++] == serial.data[i]);
+            } else {
+                assert(list.data[o++] % 2 != 0);
+            }
+        }
+
+        // unique of sorted data leaves the distinct values
+        sort_ints(&list);
+        sort_ints(&serial);
+        size_t removed = ints_parallel_unique(&list, int_eq, executor, nthreads);
+        assert(ints_unique(&serial, int_eq) == removed);
+        assert(list.size == serial.size && list.size == n - removed);
+        assert(ints_equal(list.data, serial.data, list.size));
+        for (size_t i = 1; i < list.size; ++i) {
+            assert(list.data[i - 1] < list.data[i]);
+        }
+
+        // merge with a sorted run of the same size
+        fill_ints(&out, n, 1000);
+        sort_ints(&out);
+        fill_ints(&serial, n, 1000);
+        sort_ints(&serial);
+        struct arraylist_ints merged = ints_shallow_copy(&serial);
+        assert(ints_parallel_merge(&serial, &out, int_less, executor, nthreads) == ARRAYLIST_OK);
+        assert(ints_merge(&merged, &out, int_less) == ARRAYLIST_OK);
+        assert(serial.size == 2 * n && merged.size == 2 * n);
+        assert(ints_sorted(serial.data, serial.size));
+        assert(ints_equal(serial.data, merged.data, 2 * n));
+        ints_deinit(&merged);
+    }
+    ints_deinit(&out);
+    ints_deinit(&serial);
+    ints_deinit(&list);
+}
+
+void test_arraylist_algo_serial_scalar_type(void) {
+    struct arraylist_ints list = ints_init(allocator_get_default());
+    for (int i = 0; i < 10; ++i) {
+        assert(ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    int delta = 10;
+    assert(ints_for_each(&list, add_ctx, &delta) == ARRAYLIST_OK);
+    assert(list.data[0] == 10 && list.data[9] == 19);
+    assert(ints_reduce(&list, 0, sum, NULL) == 145);
+    assert(ints_count_if(&list, is_even, NULL) == 5);
+
+    // in place
+    assert(ints_transform(&list, &list, square, NULL) == ARRAYLIST_OK);
+    assert(list.size == 10 && list.data[1] == 121);
+
+    int limit = 200;
+    size_t accepted = ints_partition(&list, below, &limit);
+    assert(accepted == 5);
+    for (size_t i = 0; i < list.size; ++i) {
+        assert((list.data[i] < limit) == (i < accepted));
+    }
+    // the accepted ones keep their order
+    assert(list.data[0] == 100 && list.data[4] == 196);
+
+    ints_clear(&list);
+    const int runs[] = { 1, 1, 2, 3, 3, 3, 1, 4, 4 };
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); ++i) {
+        assert(ints_push_back(&list, runs[i]) == ARRAYLIST_OK);
+    }
+    assert(ints_unique(&list, int_eq) == 4);
+    assert(list.size == 5);
+    assert(list.data[0] == 1 && list.data[1] == 2 && list.data[2] == 3 && list.data[3] == 1 && list.data[4] == 4);
+    assert(ints_unique(&list, int_eq) == 0);
+
+    // merging a list with itself doubles every element in place
+    ints_clear(&list);
+    for (int i = 0; i < 4; ++i) {
+        assert(ints_push_back(&list, i * 2) == ARRAYLIST_OK);
+    }
+    assert(ints_merge(&list, &list, int_less) == ARRAYLIST_OK);
+    const int doubled[] = { 0, 0, 2, 2, 4, 4, 6, 6 };
+    assert(list.size == 8 && memcmp(list.data, doubled, sizeof(doubled)) == 0);
+
+    // null arguments
+    assert(ints_for_each(NULL, add_ctx, &delta) == ARRAYLIST_ERR_NULL);
+    assert(ints_for_each(&list, NULL, &delta) == ARRAYLIST_ERR_NULL);
+    assert(ints_transform(&list, NULL, square, NULL) == ARRAYLIST_ERR_NULL);
+    assert(ints_reduce(NULL, 42, sum, NULL) == 42);
+    assert(ints_count_if(&list, NULL, NULL) == 0);
+    assert(ints_partition(NULL, is_even, NULL) == 0);
+    assert(ints_unique(&list, NULL) == 0);
+    assert(ints_merge(&list, NULL, int_less) == ARRAYLIST_ERR_NULL);
+    ints_deinit(&list);
+    printf("test arraylist algo serial scalar-type passed\n");
+}
+
+static bool record_less(struct record *a, struct record *b) {
+    return a->key < b->key;
+}
+
+static bool record_same_key(struct record *a, struct record *b) {
+    return a->key == b->key;
+}
+
+static struct record record_total(struct record acc, struct record *elem, void *ctx) {
+    (void)ctx;
+    acc.key += elem->key;
+    acc.payload += elem->payload;
+    return acc;
+}
+
+void test_arraylist_algo_struct_type(void) {
+    struct Executor serial = executor_get_serial();
+    struct arraylist_records a = records_init(allocator_get_default());
+    struct arraylist_records b = records_init(allocator_get_default());
+    const size_t n = 3 * ARRAYLIST_PARALLEL_MIN_CHUNK;
+    for (size_t i = 0; i < n; ++i) {
+        struct record ra = { (int)(i / 4), (int)i };
+        struct record rb = { (int)(i / 4), -(int)i - 1 };
+        assert(records_push_back(&a, ra) == ARRAYLIST_OK);
+        assert(records_push_back(&b, rb) == ARRAYLIST_OK);
+    }
+    struct record zero = { 0, 0 };
+    struct record total = records_parallel_reduce(&a, zero, record_total, NULL, &serial, 4);
+    struct record expected = records_reduce(&a, zero, record_total, NULL);
+    assert(total.key == expected.key && total.payload == expected.payload);
+
+    // stable, for equal keys the records of a come first
+    assert(records_parallel_merge(&a, &b, record_less, &serial, 4) == ARRAYLIST_OK);
+    assert(a.size == 2 * n);
+    for (size_t i = 0; i < a.size; ++i) {
+        assert(a.data[i].key == (int)(i / 8));
+        assert((a.data[i].payload >= 0) == (i % 8 < 4));
+    }
+    assert(records_parallel_unique(&a, record_same_key, &serial, 4) == 2 * n - n / 4);
+    for (size_t i = 0; i < a.size; ++i) {
+        assert(a.data[i].key == (int)i && a.data[i].payload == (int)(4 * i));
+    }
+    records_deinit(&b);
+    records_deinit(&a);
+    printf("test arraylist algo struct-type passed\n");
+}
+
+static bool pointee_eq(int **a, int **b) {
+    return **a == **b;
+}
+
+void test_arraylist_algo_unique_destroys(void) {
+    struct Executor serial = executor_get_serial();
+    for (int parallel = 0; parallel < 2; ++parallel) {
+        global_destructor_counter_arraylist = 0;
+        struct arraylist_int_ptrs list = int_ptrs_init(allocator_get_default());
+        struct Allocator *alloc = int_ptrs_get_allocator(&list);
+        const size_t n = 4 * ARRAYLIST_PARALLEL_MIN_CHUNK;
+        for (size_t i = 0; i < n; ++i) {
+            int *value = (int *)alloc->malloc(sizeof(int), alloc->ctx);
+            *value = (int)(i / 2);
+            assert(int_ptrs_push_back(&list, value) == ARRAYLIST_OK);
+        }
+        size_t removed = parallel ? int_ptrs_parallel_unique(&list, pointee_eq, &serial, 4)
+                                  : int_ptrs_unique(&list, pointee_eq);
+        assert(removed == n / 2 && list.size == n / 2);
+        assert(global_destructor_counter_arraylist == n / 2);
+        for (size_t i = 0; i < list.size; ++i) {
+            assert(*list.data[i] == (int)i);
+        }
+        int_ptrs_deinit(&list);
+        assert(global_destructor_counter_arraylist == n);
+    }
+    printf("test arraylist algo unique destroys passed\n");
+}
+
+void test_arraylist_algo_fallbacks(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct Executor serial = executor_get_serial();
+    struct arraylist_ints list = ints_init(gpa);
+    fill_ints(&list, 5 * ARRAYLIST_PARALLEL_MIN_CHUNK, 100);
+    assert(ints_parallel_for_each(&list, add_ctx, NULL, NULL, 4) == ARRAYLIST_ERR_NULL);
+    assert(ints_parallel_reduce(&list, 5, sum, NULL, NULL, 4) == 5);
+    assert(ints_parallel_count_if(&list, is_even, NULL, NULL, 4) == 0);
+    assert(ints_parallel_merge(&list, &list, int_less, NULL, 4) == ARRAYLIST_ERR_NULL);
+
+    // A rejecting executor makes the caller run every task
+    struct Executor reject = { .submit = reject_submit, .wait = reject_wait, .ctx = NULL };
+    check_sizes(&reject, 4);
+
+    // Without the task array or the scratch buffer the serial versions run
+    int total = ints_reduce(&list, 0, sum, NULL);
+    size_t evens = ints_count_if(&list, is_even, NULL);
+    list.alloc.malloc = failing_malloc;
+    assert(ints_parallel_reduce(&list, 0, sum, NULL, &serial, 4) == total);
+    assert(ints_parallel_count_if(&list, is_even, NULL, &serial, 4) == evens);
+    assert(ints_parallel_partition(&list, is_even, NULL, &serial, 4) == evens);
+    list.alloc = gpa;
+
+    // The DYN version has the same functions
+    struct arraylist_dyn_ints dyn = dyn_ints_init(gpa, NULL);
+    for (int i = 0; i < 3 * ARRAYLIST_PARALLEL_MIN_CHUNK; ++i) {
+        assert(dyn_ints_push_back(&dyn, i % 10) == ARRAYLIST_OK);
+    }
+    assert(dyn_ints_parallel_count_if(&dyn, is_even, NULL, &serial, 3) == dyn_ints_count_if(&dyn, is_even, NULL));
+    assert(dyn_ints_parallel_reduce(&dyn, 0, sum, NULL, &serial, 3) == dyn_ints_reduce(&dyn, 0, sum, NULL));
+    dyn_ints_deinit(&dyn);
+    ints_deinit(&list);
+    printf("test arraylist algo fallbacks passed\n");
+}
+
+#ifdef EXECUTOR_PTHREAD
+void test_arraylist_algo_thread_pools(void) {
+    struct executor_thread_pool fifo;
+    assert(executor_thread_pool_init(&fifo, 3) == 0);
+    struct Executor executor = executor_get_thread_pool(&fifo);
+    check_sizes(&executor, 4);
+    executor_thread_pool_deinit(&fifo);
+
+    struct executor_steal_pool steal;
+    assert(executor_steal_pool_init(&steal, 3) == 0);
+    executor = executor_get_steal_pool(&steal);
+    check_sizes(&executor, 4);
+    check_sizes(&executor, 16);
+    executor_steal_pool_deinit(&steal);
+
+    // No workers, wait() runs everything
+    assert(executor_steal_pool_init(&steal, 0) == 0);
+    executor = executor_get_steal_pool(&steal);
+    check_sizes(&executor, 4);
+    executor_steal_pool_deinit(&steal);
+    printf("test arraylist algo thread pools passed\n");
+}
+
+#define SPAWN_NODES 4095
+
+struct spawn_node {
+    struct spawn_tree *tree;
+    size_t index;
+};
+
+struct spawn_tree {
+    struct Executor *executor;
+    unsigned char visited[SPAWN_NODES];
+    struct spawn_node nodes[SPAWN_NODES];
+};
+
+// Each node submits its two children from inside the task, they land on the deque of that worker
+static void spawn_task(void *arg) {
+    struct spawn_node *node = (struct spawn_node *)arg;
+    struct spawn_tree *tree = node->tree;
+    tree->visited[node->index]++;
+    for (size_t child = 2 * node->index + 1; child <= 2 * node->index + 2 && child < SPAWN_NODES; ++child) {
+        executor_submit_or_run(tree->executor, spawn_task, &tree->nodes[child]);
+    }
+}
+
+void test_executor_steal_pool_nested_submit(void) {
+    static struct spawn_tree tree;
+    struct executor_steal_pool steal;
+    assert(executor_steal_pool_init(&steal, 4) == 0);
+    struct Executor executor = executor_get_steal_pool(&steal);
+    for (int round = 0; round < 20; ++round) {
+        memset(tree.visited, 0, sizeof(tree.visited));
+        tree.executor = &executor;
+        for (size_t i = 0; i < SPAWN_NODES; ++i) {
+            tree.nodes[i].tree = &tree;
+            tree.nodes[i].index = i;
+        }
+        executor_submit_or_run(&executor, spawn_task, &tree.nodes[0]);
+        executor.wait(executor.ctx);
+        for (size_t i = 0; i < SPAWN_NODES; ++i) {
+            assert(tree.visited[i] == 1);
+        }
+    }
+    executor_steal_pool_deinit(&steal);
+    printf("test executor steal pool nested submit passed\n");
+}
+#endif // EXECUTOR_PTHREAD
+
+int main(void) {
+    struct Executor serial = executor_get_serial();
+    test_arraylist_algo_serial_scalar_type();
+    check_sizes(&serial, 1);
+    check_sizes(&serial, 4);
+    check_sizes(&serial, 7);
+    test_arraylist_algo_struct_type();
+    test_arraylist_algo_unique_destroys();
+    test_arraylist_algo_fallbacks();
+#ifdef EXECUTOR_PTHREAD
+    test_arraylist_algo_thread_pools();
+    test_executor_steal_pool_nested_submit();
+#endif
+    return 0;
+}
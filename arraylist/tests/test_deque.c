@@ -0,0 +1,314 @@
+/**
+ * @file test_deque.c
+ * @brief Unit tests for the arraylist.h file ARRAYLIST_DEQUE version
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+
+// Counts the calls reaching the heap, growing must never copy a block
+struct counting_ctx {
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+    size_t fail_after;
+};
+
+static void *counting_malloc(size_t size, void *ctx) {
+    struct counting_ctx *counts = (struct counting_ctx *)ctx;
+    if (counts->fail_after != 0 && counts->mallocs + counts->reallocs >= counts->fail_after) {
+        return NULL;
+    }
+    counts->mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    struct counting_ctx *counts = (struct counting_ctx *)ctx;
+    (void)old_size;
+    if (counts->fail_after != 0 && counts->mallocs + counts->reallocs >= counts->fail_after) {
+        return NULL;
+    }
+    counts->reallocs++;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ptr, size_t size, void *ctx) {
+    (void)size;
+    ((struct counting_ctx *)ctx)->frees++;
+    free(ptr);
+}
+
+static struct Allocator counting_allocator(struct counting_ctx *ctx) {
+    struct Allocator alloc = { counting_malloc, counting_realloc, counting_free, ctx };
+    return alloc;
+}
+
+// == SCALAR TYPE ==
+
+ARRAYLIST_DEQUE(int, ints, arraylist_noop_deinit)
+
+// == POINTER TYPE ==
+
+size_t global_destructor_counter_arraylist = 0;
+
+static void int_ptr_deinit(int **elem, struct Allocator *alloc) {
+    alloc->free(*elem, sizeof(int), alloc->ctx);
+    global_destructor_counter_arraylist++;
+}
+
+ARRAYLIST_DEQUE(int *, int_ptrs, int_ptr_deinit)
+
+static bool int_is(int *elem, void *target) {
+    return *elem == *(int *)target;
+}
+
+void test_arraylist_deque_push_back_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_deque_ints list = deque_ints_init(counting_allocator(&counts));
+    const size_t block_len = deque_ints_block_len();
+    assert(block_len * sizeof(int) == ARRAYLIST_DEQUE_BLOCK_BYTES);
+
+    assert(deque_ints_is_empty(&list));
+    assert(counts.mallocs == 0);
+    assert(deque_ints_at(&list, 0) == NULL);
+    assert(deque_ints_front(&list) == NULL);
+    assert(deque_ints_back(&list) == NULL);
+
+    assert(deque_ints_push_back(&list, 0) == ARRAYLIST_OK);
+    int *first = deque_ints_at(&list, 0);
+    for (int i = 1; i < 100000; ++i) {
+        assert(deque_ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    assert(deque_ints_size(&list) == 100000);
+    // the first element never moved and no block was ever reallocated
+    assert(first == deque_ints_at(&list, 0) && *first == 0);
+    assert(list.block_count == (100000 + block_len - 1) / block_len);
+    assert(counts.mallocs == 1 + list.block_count);
+    assert(counts.frees == 0);
+
+    for (int i = 0; i < 100000; ++i) {
+        assert(*deque_ints_at(&list, (size_t)i) == i);
+    }
+    assert(deque_ints_at(&list, 100000) == NULL);
+    assert(*deque_ints_front(&list) == 0);
+    assert(*deque_ints_back(&list) == 99999);
+
+    int target = 54321;
+    assert(deque_ints_find(&list, int_is, &target) == deque_ints_at(&list, 54321));
+    size_t index = 0;
+    assert(deque_ints_contains(&list, int_is, &target, &index) && index == 54321);
+    target = -1;
+    assert(deque_ints_find(&list, int_is, &target) == NULL);
+    assert(!deque_ints_contains(&list, int_is, &target, &index) && index == 54321);
+    assert(deque_ints_find(&list, NULL, &target) == NULL);
+
+    // emptied blocks go back to the allocator, except one kept as the spare
+    for (int i = 0; i < 100000 - 1; ++i) {
+        assert(deque_ints_pop_back(&list) == ARRAYLIST_OK);
+    }
+    assert(list.block_count == 1 && first == deque_ints_back(&list));
+    assert(deque_ints_pop_back(&list) == ARRAYLIST_OK);
+    assert(list.block_count == 0);
+    assert(deque_ints_pop_back(&list) == ARRAYLIST_ERR_OOB);
+    assert(list.spare != NULL);
+    assert(counts.frees == counts.mallocs - 2);
+
+    deque_ints_deinit(&list);
+    assert(counts.frees == counts.mallocs);
+    assert(list.blocks == NULL && list.size == 0);
+    deque_ints_deinit(&list);
+    deque_ints_deinit(NULL);
+}
+
+void test_arraylist_deque_both_ends_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_deque_ints list = deque_ints_init(counting_allocator(&counts));
+    const int n = (int)deque_ints_block_len() * 20 + 7;
+
+    // -n .. n built from the middle outwards
+    assert(deque_ints_push_back(&list, 0) == ARRAYLIST_OK);
+    int *middle = deque_ints_front(&list);
+    for (int i = 1; i <= n; ++i) {
+        assert(deque_ints_push_front(&list, -i) == ARRAYLIST_OK);
+        assert(deque_ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    assert(deque_ints_size(&list) == (size_t)(2 * n + 1));
+    assert(*deque_ints_front(&list) == -n && *deque_ints_back(&list) == n);
+    assert(deque_ints_at(&list, (size_t)n) == middle);
+    for (size_t i = 0; i < list.size; ++i) {
+        assert(*deque_ints_at(&list, i) == (int)i - n);
+    }
+
+    // emplace writes in place on either end
+    *deque_ints_emplace_front(&list) = -n - 1;
+    *deque_ints_emplace_back(&list) = n + 1;
+    assert(*deque_ints_front(&list) == -n - 1 && *deque_ints_back(&list) == n + 1);
+
+    // a queue: take from the front, give to the back, once the index is less than half full it only
+    // recenters, without growing
+    for (int i = 0; i < 2 * n + 3; ++i) {
+        int value = *deque_ints_front(&list);
+        assert(deque_ints_pop_front(&list) == ARRAYLIST_OK);
+        assert(deque_ints_push_back(&list, value) == ARRAYLIST_OK);
+    }
+    const size_t index_cap = list.index_cap;
+    for (int i = 0; i < 10 * n; ++i) {
+        int value = *deque_ints_front(&list);
+        assert(deque_ints_pop_front(&list) == ARRAYLIST_OK);
+        assert(deque_ints_push_back(&list, value) == ARRAYLIST_OK);
+    }
+    assert(list.index_cap == index_cap);
+    assert(deque_ints_size(&list) == (size_t)(2 * n + 3));
+    assert(*deque_ints_at(&list, 0) == (10 * n) % (2 * n + 3) - n - 1);
+
+    while (!deque_ints_is_empty(&list)) {
+        assert(deque_ints_pop_front(&list) == ARRAYLIST_OK);
+    }
+    assert(deque_ints_pop_front(&list) == ARRAYLIST_ERR_OOB);
+    assert(list.block_count == 0);
+
+    // clear keeps the index for reuse
+    for (int i = 0; i < 5; ++i) {
+        assert(deque_ints_push_front(&list, i) == ARRAYLIST_OK);
+    }
+    deque_ints_clear(&list);
+    assert(deque_ints_is_empty(&list) && list.blocks != NULL);
+    assert(counts.frees == counts.mallocs - 2);
+    assert(deque_ints_shrink_to_fit(&list) == ARRAYLIST_OK && list.spare == NULL);
+    assert(counts.frees == counts.mallocs - 1);
+    assert(deque_ints_shrink_to_fit(NULL) == ARRAYLIST_ERR_NULL);
+
+    assert(deque_ints_get_allocator(&list)->ctx == &counts);
+    assert(deque_ints_push_back(NULL, 1) == ARRAYLIST_ERR_NULL);
+    assert(deque_ints_push_front(NULL, 1) == ARRAYLIST_ERR_NULL);
+    assert(deque_ints_pop_front(NULL) == ARRAYLIST_ERR_NULL);
+    assert(deque_ints_size(NULL) == 0);
+
+    deque_ints_deinit(&list);
+    assert(counts.frees == counts.mallocs);
+}
+
+void test_arraylist_deque_block_boundary_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_deque_ints list = deque_ints_init(counting_allocator(&counts));
+    const size_t block_len = deque_ints_block_len();
+
+    // fill the first block exactly, the next push_back crosses into a second one
+    for (size_t i = 0; i < block_len; ++i) {
+        assert(deque_ints_push_back(&list, (int)i) == ARRAYLIST_OK);
+    }
+    assert(deque_ints_push_back(&list, -1) == ARRAYLIST_OK);
+    assert(deque_ints_pop_back(&list) == ARRAYLIST_OK);
+    assert(list.block_count == 1 && list.spare != NULL);
+    const size_t mallocs = counts.mallocs;
+    const size_t frees = counts.frees;
+
+    // alternating across the boundary reuses the spare block, the allocator is never called
+    for (int i = 0; i < 1000; ++i) {
+        assert(deque_ints_push_back(&list, i) == ARRAYLIST_OK);
+        assert(list.block_count == 2 && list.spare == NULL);
+        assert(deque_ints_pop_back(&list) == ARRAYLIST_OK);
+        assert(list.block_count == 1 && list.spare != NULL);
+    }
+    // the same at the front
+    for (int i = 0; i < 1000; ++i) {
+        assert(deque_ints_push_front(&list, i) == ARRAYLIST_OK);
+        assert(deque_ints_pop_front(&list) == ARRAYLIST_OK);
+    }
+    assert(counts.mallocs == mallocs && counts.frees == frees);
+    assert(deque_ints_size(&list) == block_len);
+    assert(*deque_ints_front(&list) == 0 && *deque_ints_back(&list) == (int)block_len - 1);
+
+    // only one block is cached, the second emptied one is freed
+    for (size_t i = 0; i < 2 * block_len; ++i) {
+        assert(deque_ints_push_back(&list, 7) == ARRAYLIST_OK);
+    }
+    assert(list.block_count == 3 && counts.mallocs == mallocs + 1);
+    for (size_t i = 0; i < 2 * block_len; ++i) {
+        assert(deque_ints_pop_back(&list) == ARRAYLIST_OK);
+    }
+    assert(list.block_count == 1 && list.spare != NULL && counts.frees == frees + 1);
+
+    deque_ints_deinit(&list);
+    assert(counts.frees == counts.mallocs);
+}
+
+void test_arraylist_deque_alloc_failure(void) {
+    const size_t block_len = deque_ints_block_len();
+    // index, then one block
+    struct counting_ctx counts = { 0, 0, 0, 2 };
+    struct arraylist_deque_ints list = deque_ints_init(counting_allocator(&counts));
+
+    for (size_t i = 0; i < block_len; ++i) {
+        assert(deque_ints_push_back(&list, (int)i) == ARRAYLIST_OK);
+    }
+    assert(deque_ints_push_back(&list, -1) == ARRAYLIST_ERR_ALLOC);
+    assert(deque_ints_push_front(&list, -1) == ARRAYLIST_ERR_ALLOC);
+    assert(deque_ints_emplace_back(&list) == NULL);
+    assert(deque_ints_emplace_front(&list) == NULL);
+    // nothing changed
+    assert(deque_ints_size(&list) == block_len);
+    assert(*deque_ints_front(&list) == 0 && *deque_ints_back(&list) == (int)block_len - 1);
+
+    // the index is full of blocks, its realloc fails and the blocks are untouched
+    counts.fail_after = 0;
+    while (list.block_count < ARRAYLIST_DEQUE_INDEX_INITIAL_CAP / 2) {
+        assert(deque_ints_push_back(&list, 7) == ARRAYLIST_OK);
+    }
+    while (list.head + list.size < list.block_count * block_len) {
+        assert(deque_ints_push_back(&list, 7) == ARRAYLIST_OK);
+    }
+    const size_t size = list.size;
+    int *front = deque_ints_front(&list);
+    counts.fail_after = counts.mallocs + counts.reallocs;
+    assert(deque_ints_push_back(&list, 8) == ARRAYLIST_ERR_ALLOC);
+    assert(list.size == size && deque_ints_front(&list) == front && *deque_ints_back(&list) == 7);
+
+    counts.fail_after = 0;
+    assert(deque_ints_push_back(&list, 8) == ARRAYLIST_OK);
+    assert(list.index_cap == 2 * ARRAYLIST_DEQUE_INDEX_INITIAL_CAP);
+    assert(deque_ints_front(&list) == front && *deque_ints_back(&list) == 8);
+
+    deque_ints_deinit(&list);
+    assert(counts.frees == counts.mallocs);
+}
+
+void test_arraylist_deque_ptr_type(void) {
+    global_destructor_counter_arraylist = 0;
+    struct arraylist_deque_int_ptrs list = deque_int_ptrs_init(allocator_get_default());
+    struct Allocator *alloc = deque_int_ptrs_get_allocator(&list);
+
+    for (int i = 0; i < 3000; ++i) {
+        int *value = alloc->malloc(sizeof(int), alloc->ctx);
+        *value = i;
+        if (i % 2 == 0) {
+            assert(deque_int_ptrs_push_back(&list, value) == ARRAYLIST_OK);
+        } else {
+            assert(deque_int_ptrs_push_front(&list, value) == ARRAYLIST_OK);
+        }
+    }
+    assert(**deque_int_ptrs_front(&list) == 2999);
+    assert(**deque_int_ptrs_back(&list) == 2998);
+
+    assert(deque_int_ptrs_pop_front(&list) == ARRAYLIST_OK);
+    assert(deque_int_ptrs_pop_back(&list) == ARRAYLIST_OK);
+    assert(global_destructor_counter_arraylist == 2);
+
+    deque_int_ptrs_deinit(&list);
+    assert(global_destructor_counter_arraylist == 3000);
+}
+
+int main(void) {
+    test_arraylist_deque_push_back_scalar_type();
+    test_arraylist_deque_both_ends_scalar_type();
+    test_arraylist_deque_block_boundary_scalar_type();
+    test_arraylist_deque_alloc_failure();
+    test_arraylist_deque_ptr_type();
+    return 0;
+}
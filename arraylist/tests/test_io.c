@@ -0,0 +1,256 @@
+/**
+ * @file test_io.c
+ * @brief Unit tests for the arraylist.h file save_to_fd, load_from_fd and ARRAYLIST_VIEW
+ */
+#if defined(__unix__) || defined(__APPLE__)
+    #define _POSIX_C_SOURCE 200809L
+    #define ARRAYLIST_POSIX
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+
+#ifdef ARRAYLIST_POSIX
+#include <fcntl.h>
+
+struct sample {
+    double value;
+    int32_t id;
+    char tag;
+};
+
+ARRAYLIST(int, ints, arraylist_noop_deinit)
+ARRAYLIST_DECL_IO(int, ints)
+ARRAYLIST_IMPL_IO(int, ints)
+ARRAYLIST(struct sample, samples, arraylist_noop_deinit)
+ARRAYLIST_DECL_IO(struct sample, samples)
+ARRAYLIST_IMPL_IO(struct sample, samples)
+ARRAYLIST_DYN(int, ints)
+ARRAYLIST_DECL_DYN_IO(int, ints)
+ARRAYLIST_IMPL_DYN_IO(int, ints)
+ARRAYLIST(long long, longs, arraylist_noop_deinit)
+ARRAYLIST_DECL_IO(long long, longs)
+ARRAYLIST_IMPL_IO(long long, longs)
+
+ARRAYLIST_VIEW(int, ints)
+ARRAYLIST_VIEW(struct sample, samples)
+ARRAYLIST_VIEW(long long, longs)
+
+static int open_snapshot(char *path) {
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    return fd;
+}
+
+static bool int_is(const int *elem, void *target) {
+    return *elem == *(int *)target;
+}
+
+static bool sample_has_id(const struct sample *elem, void *target) {
+    return elem->id == *(int32_t *)target;
+}
+
+void test_arraylist_io_roundtrip_scalar_type(void) {
+    char path[] = "/tmp/arraylist_io_XXXXXX";
+    int fd = open_snapshot(path);
+    struct arraylist_ints list = ints_init(allocator_get_default());
+    for (int i = 0; i < 10000; ++i) {
+        assert(ints_push_back(&list, i * 3) == ARRAYLIST_OK);
+    }
+    assert(ints_save_to_fd(&list, fd) == ARRAYLIST_OK);
+    assert(lseek(fd, 0, SEEK_END) == (off_t)(sizeof(struct arraylist_file_header) + 10000 * sizeof(int)));
+
+    // replaces what the list had
+    struct arraylist_ints loaded = ints_init(allocator_get_default());
+    assert(ints_push_back(&loaded, -1) == ARRAYLIST_OK);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(ints_load_from_fd(&loaded, fd) == ARRAYLIST_OK);
+    assert(loaded.size == 10000);
+    assert(memcmp(loaded.data, list.data, 10000 * sizeof(int)) == 0);
+
+    // the DYN version reads the same snapshot
+    struct arraylist_dyn_ints dyn = dyn_ints_init(allocator_get_default(), NULL);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(dyn_ints_load_from_fd(&dyn, fd) == ARRAYLIST_OK);
+    assert(dyn.size == 10000 && dyn.data[9999] == 9999 * 3);
+
+    // a snapshot for another type is refused and the list is kept
+    struct arraylist_longs longs = longs_init(allocator_get_default());
+    assert(longs_push_back(&longs, 5) == ARRAYLIST_OK);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(longs_load_from_fd(&longs, fd) == ARRAYLIST_ERR_FORMAT);
+    assert(longs.size == 1);
+
+    longs_deinit(&longs);
+    dyn_ints_deinit(&dyn);
+    ints_deinit(&loaded);
+    ints_deinit(&list);
+    close(fd);
+    unlink(path);
+}
+
+void test_arraylist_io_appended_snapshots_struct_type(void) {
+    char path[] = "/tmp/arraylist_io_XXXXXX";
+    int fd = open_snapshot(path);
+    struct arraylist_samples list = samples_init(allocator_get_default());
+    struct arraylist_samples empty = samples_init(allocator_get_default());
+    for (int i = 0; i < 100; ++i) {
+        struct sample s = { i * 0.5, i, (char)('a' + i % 26) };
+        assert(samples_push_back(&list, s) == ARRAYLIST_OK);
+    }
+    // written at the current offset, so snapshots can follow each other in one stream
+    assert(samples_save_to_fd(&list, fd) == ARRAYLIST_OK);
+    assert(samples_save_to_fd(&empty, fd) == ARRAYLIST_OK);
+    assert(samples_save_to_fd(&list, fd) == ARRAYLIST_OK);
+
+    struct arraylist_samples loaded = samples_init(allocator_get_default());
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(samples_load_from_fd(&loaded, fd) == ARRAYLIST_OK);
+    assert(loaded.size == 100 && loaded.data[42].id == 42 && loaded.data[42].value == 21.0);
+    assert(samples_load_from_fd(&loaded, fd) == ARRAYLIST_OK);
+    assert(loaded.size == 0);
+    assert(samples_load_from_fd(&loaded, fd) == ARRAYLIST_OK);
+    assert(loaded.size == 100 && loaded.data[99].tag == (char)('a' + 99 % 26));
+    // nothing left to read
+    assert(samples_load_from_fd(&loaded, fd) == ARRAYLIST_ERR_FORMAT);
+
+    assert(samples_save_to_fd(NULL, fd) == ARRAYLIST_ERR_NULL);
+    assert(samples_load_from_fd(NULL, fd) == ARRAYLIST_ERR_NULL);
+    assert(samples_save_to_fd(&list, -1) == ARRAYLIST_ERR_IO);
+
+    samples_deinit(&loaded);
+    samples_deinit(&empty);
+    samples_deinit(&list);
+    close(fd);
+    unlink(path);
+}
+
+void test_arraylist_io_truncated(void) {
+    char path[] = "/tmp/arraylist_io_XXXXXX";
+    int fd = open_snapshot(path);
+    struct arraylist_ints list = ints_init(allocator_get_default());
+    for (int i = 0; i < 100; ++i) {
+        assert(ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    assert(ints_save_to_fd(&list, fd) == ARRAYLIST_OK);
+    assert(ftruncate(fd, (off_t)(sizeof(struct arraylist_file_header) + 50 * sizeof(int))) == 0);
+
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(ints_load_from_fd(&list, fd) == ARRAYLIST_ERR_FORMAT);
+    assert(list.size == 0);
+
+    struct arraylist_view_ints view;
+    assert(view_ints_map_fd(&view, fd) == ARRAYLIST_ERR_FORMAT);
+    assert(view.map == NULL && view.size == 0);
+
+    // shorter than a header
+    assert(ftruncate(fd, 10) == 0);
+    assert(view_ints_map_fd(&view, fd) == ARRAYLIST_ERR_FORMAT);
+    assert(view_ints_map_fd(&view, -1) == ARRAYLIST_ERR_IO);
+
+    ints_deinit(&list);
+    close(fd);
+    unlink(path);
+}
+
+void test_arraylist_view_scalar_type(void) {
+    char path[] = "/tmp/arraylist_io_XXXXXX";
+    int fd = open_snapshot(path);
+    struct arraylist_ints list = ints_init(allocator_get_default());
+    for (int i = 0; i < 5000; ++i) {
+        assert(ints_push_back(&list, 5000 - i) == ARRAYLIST_OK);
+    }
+    assert(ints_save_to_fd(&list, fd) == ARRAYLIST_OK);
+    ints_deinit(&list);
+
+    struct arraylist_view_ints view;
+    assert(view_ints_map_fd(&view, fd) == ARRAYLIST_OK);
+    // the mapping outlives the descriptor
+    close(fd);
+
+    assert(view_ints_size(&view) == 5000);
+    assert(!view_ints_is_empty(&view));
+    assert(*view_ints_at(&view, 0) == 5000);
+    assert(*view_ints_at(&view, 4999) == 1);
+    assert(view_ints_at(&view, 5000) == NULL);
+    assert(view_ints_end(&view) - view_ints_begin(&view) == 5000);
+    assert((uintptr_t)view_ints_begin(&view) % sizeof(int) == 0);
+
+    long long sum = 0;
+    for (const int *it = view_ints_begin(&view); it != view_ints_end(&view); ++it) {
+        sum += *it;
+    }
+    assert(sum == 5000LL * 5001LL / 2);
+
+    int target = 1234;
+    assert(*view_ints_find(&view, int_is, &target) == 1234);
+    size_t index = 0;
+    assert(view_ints_contains(&view, int_is, &target, &index));
+    assert(index == 5000 - 1234);
+    target = 0;
+    assert(view_ints_find(&view, int_is, &target) == view_ints_end(&view));
+    assert(!view_ints_contains(&view, int_is, &target, NULL));
+
+    // the wrong element type is refused
+    fd = open(path, O_RDONLY);
+    assert(fd >= 0);
+    struct arraylist_view_longs longs;
+    assert(view_longs_map_fd(&longs, fd) == ARRAYLIST_ERR_FORMAT);
+    close(fd);
+
+    view_ints_deinit(&view);
+    assert(view.map == NULL && view.data == NULL && view.size == 0);
+    view_ints_deinit(&view);
+    unlink(path);
+}
+
+void test_arraylist_view_struct_type(void) {
+    char path[] = "/tmp/arraylist_io_XXXXXX";
+    int fd = open_snapshot(path);
+    struct arraylist_samples list = samples_init(allocator_get_default());
+    assert(samples_save_to_fd(&list, fd) == ARRAYLIST_OK);
+
+    struct arraylist_view_samples view;
+    assert(view_samples_map_fd(&view, fd) == ARRAYLIST_OK);
+    assert(view_samples_is_empty(&view));
+    assert(view_samples_begin(&view) == view_samples_end(&view));
+    view_samples_deinit(&view);
+
+    for (int i = 0; i < 300; ++i) {
+        struct sample s = { -i * 1.5, i * 7, 'q' };
+        assert(samples_push_back(&list, s) == ARRAYLIST_OK);
+    }
+    assert(ftruncate(fd, 0) == 0);
+    assert(lseek(fd, 0, SEEK_SET) == 0);
+    assert(samples_save_to_fd(&list, fd) == ARRAYLIST_OK);
+    assert(view_samples_map_fd(&view, fd) == ARRAYLIST_OK);
+    assert(view.size == 300);
+    assert((uintptr_t)view.data % sizeof(double) == 0);
+    int32_t id = 70;
+    const struct sample *found = view_samples_find(&view, sample_has_id, &id);
+    assert(found == view_samples_at(&view, 10) && found->value == -15.0 && found->tag == 'q');
+
+    view_samples_deinit(&view);
+    samples_deinit(&list);
+    close(fd);
+    unlink(path);
+}
+#endif // ARRAYLIST_POSIX
+
+int main(void) {
+#ifdef ARRAYLIST_POSIX
+    test_arraylist_io_roundtrip_scalar_type();
+    test_arraylist_io_appended_snapshots_struct_type();
+    test_arraylist_io_truncated();
+    test_arraylist_view_scalar_type();
+    test_arraylist_view_struct_type();
+#else
+    printf("test_io: no POSIX, skipped\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file test_parallel.c
+ * @brief Unit tests for the arraylist.h parallel_sort, on the serial executor and, when the build
+ *        defines EXECUTOR_PTHREAD, on the pthread pool of executor.h
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+#include "executor.h"
+
+struct record {
+    int key;
+    int payload;
+};
+
+ARRAYLIST(int, ints, arraylist_noop_deinit)
+ARRAYLIST(struct record, records, arraylist_noop_deinit)
+ARRAYLIST_DYN(int, ints)
+
+static bool int_less(int *a, int *b) {
+    return *a < *b;
+}
+
+static bool record_less(struct record *a, struct record *b) {
+    return a->key < b->key;
+}
+
+// Executor whose queue is always full, every task ends up running on the caller
+static bool reject_submit(void (*task)(void *arg), void *arg, void *ctx) {
+    (void)task;
+    (void)arg;
+    (void)ctx;
+    return false;
+}
+static void reject_wait(void *ctx) {
+    (void)ctx;
+}
+
+static void *failing_malloc(size_t size, void *ctx) {
+    (void)size;
+    (void)ctx;
+    return NULL;
+}
+
+static unsigned int rng_state = 12345;
+static int next_random(int range) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (int)((rng_state >> 16) % (unsigned int)range);
+}
+
+static void fill_ints(struct arraylist_ints *list, size_t n, int range) {
+    ints_clear(list);
+    for (size_t i = 0; i < n; ++i) {
+        ints_push_back(list, next_random(range));
+    }
+}
+
+static bool ints_sorted(int *data, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        if (data[i - 1] > data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sum of the elements, sorting must keep the same multiset
+static long long ints_sum(int *data, size_t n) {
+    long long sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static void check_sizes(struct Executor *executor, size_t nthreads) {
+    struct arraylist_ints list = ints_init(allocator_get_default());
+    // Below, at and above the chunk threshold, sizes that do not split evenly
+    const size_t sizes[] = { 0, 1, 100, 2 * ARRAYLIST_PARALLEL_SORT_MIN_CHUNK - 1, 2 * ARRAYLIST_PARALLEL_SORT_MIN_CHUNK,
+                             3 * ARRAYLIST_PARALLEL_SORT_MIN_CHUNK + 7, 100003 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        fill_ints(&list, sizes[s], 1000000);
+        long long sum = ints_sum(list.data, list.size);
+        assert(ints_parallel_sort(&list, int_less, executor, nthreads) == ARRAYLIST_OK);
+        assert(list.size == sizes[s]);
+        assert(ints_sorted(list.data, list.size));
+        assert(ints_sum(list.data, list.size) == sum);
+    }
+
+    // Duplicate heavy, already sorted and reversed input
+    fill_ints(&list, 50000, 4);
+    assert(ints_parallel_sort(&list, int_less, executor, nthreads) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+    assert(ints_parallel_sort(&list, int_less, executor, nthreads) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+    for (size_t i = 0; i < list.size; ++i) {
+        list.data[i] = (int)(list.size - i);
+    }
+    assert(ints_parallel_sort(&list, int_less, executor, nthreads) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+    assert(list.data[0] == 1);
+    ints_deinit(&list);
+}
+
+void test_arraylist_parallel_sort_serial_scalar_type(void) {
+    struct Executor serial = executor_get_serial();
+    check_sizes(&serial, 1);
+    check_sizes(&serial, 4);
+    check_sizes(&serial, 7);
+    printf("test arraylist parallel sort serial scalar-type passed\n");
+}
+
+void test_arraylist_parallel_sort_fallbacks(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct Executor serial = executor_get_serial();
+    struct arraylist_ints list = ints_init(gpa);
+    fill_ints(&list, 20000, 1000);
+    assert(ints_parallel_sort(NULL, int_less, &serial, 4) == ARRAYLIST_ERR_NULL);
+    assert(ints_parallel_sort(&list, NULL, &serial, 4) == ARRAYLIST_ERR_NULL);
+    assert(ints_parallel_sort(&list, int_less, NULL, 4) == ARRAYLIST_ERR_NULL);
+
+    // A rejecting executor makes the caller run every task
+    struct Executor reject = { .submit = reject_submit, .wait = reject_wait, .ctx = NULL };
+    assert(ints_parallel_sort(&list, int_less, &reject, 4) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+
+    // Without the merge buffer the serial sort still does the job
+    fill_ints(&list, 20000, 1000);
+    list.alloc.malloc = failing_malloc;
+    assert(ints_parallel_sort(&list, int_less, &serial, 4) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+    list.alloc = gpa;
+    ints_deinit(&list);
+    printf("test arraylist parallel sort fallbacks passed\n");
+}
+
+void test_arraylist_parallel_sort_struct_type(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct Executor serial = executor_get_serial();
+    struct arraylist_records list = records_init(allocator_get_stats(&astats));
+    for (int i = 0; i < 30000; ++i) {
+        records_push_back(&list, (struct record) { .key = next_random(500), .payload = i });
+    }
+    assert(records_parallel_sort(&list, record_less, &serial, 5) == ARRAYLIST_OK);
+    for (size_t i = 1; i < list.size; ++i) {
+        assert(list.data[i - 1].key <= list.data[i].key);
+    }
+    // Only the list buffer is left, the scratch and task buffers were given back
+    assert(astats.bytes_live == list.capacity * sizeof(struct record));
+    records_deinit(&list);
+    printf("test arraylist parallel sort struct type passed\n");
+}
+
+void test_arraylist_dyn_parallel_sort_scalar_type(void) {
+    struct Executor serial = executor_get_serial();
+    struct arraylist_dyn_ints list = dyn_ints_init(allocator_get_default(), NULL);
+    for (int i = 0; i < 40000; ++i) {
+        dyn_ints_push_back(&list, next_random(100000));
+    }
+    assert(dyn_ints_parallel_sort(&list, int_less, &serial, 3) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+    dyn_ints_deinit(&list);
+    printf("test arraylist dyn parallel sort scalar-type passed\n");
+}
+
+#ifdef EXECUTOR_PTHREAD
+void test_arraylist_parallel_sort_thread_pool(void) {
+    struct executor_thread_pool pool;
+    assert(executor_thread_pool_init(&pool, 3) == 0);
+    struct Executor executor = executor_get_thread_pool(&pool);
+    check_sizes(&executor, 4);
+    check_sizes(&executor, 16);
+
+    struct arraylist_dyn_ints list = dyn_ints_init(allocator_get_default(), NULL);
+    for (int i = 0; i < 200000; ++i) {
+        dyn_ints_push_back(&list, next_random(1000000));
+    }
+    assert(dyn_ints_parallel_sort(&list, int_less, &executor, 4) == ARRAYLIST_OK);
+    assert(ints_sorted(list.data, list.size));
+    dyn_ints_deinit(&list);
+    executor_thread_pool_deinit(&pool);
+
+    // No workers, the waiting thread runs everything
+    assert(executor_thread_pool_init(&pool, 0) == 0);
+    executor = executor_get_thread_pool(&pool);
+    check_sizes(&executor, 2);
+    executor_thread_pool_deinit(&pool);
+    printf("test arraylist parallel sort thread pool passed\n");
+}
+#endif // EXECUTOR_PTHREAD
+
+int main(void) {
+    test_arraylist_parallel_sort_serial_scalar_type();
+    test_arraylist_parallel_sort_fallbacks();
+    test_arraylist_parallel_sort_struct_type();
+    test_arraylist_dyn_parallel_sort_scalar_type();
+#ifdef EXECUTOR_PTHREAD
+    test_arraylist_parallel_sort_thread_pool();
+#endif // EXECUTOR_PTHREAD
+    return 0;
+}
@@ -0,0 +1,290 @@
+/**
+ * @file test_sbo.c
+ * @brief Unit tests for the arraylist.h file ARRAYLIST_SBO version
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+
+// Counts the calls reaching the heap, to check that inline storage never allocates
+struct counting_ctx {
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+};
+
+static void *counting_malloc(size_t size, void *ctx) {
+    ((struct counting_ctx *)ctx)->mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    (void)old_size;
+    ((struct counting_ctx *)ctx)->reallocs++;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ptr, size_t size, void *ctx) {
+    (void)size;
+    ((struct counting_ctx *)ctx)->frees++;
+    free(ptr);
+}
+
+static struct Allocator counting_allocator(struct counting_ctx *ctx) {
+    struct Allocator alloc = { counting_malloc, counting_realloc, counting_free, ctx };
+    return alloc;
+}
+
+// == SIMPLE TYPE ==
+
+ARRAYLIST_SBO(int, ints, 4, arraylist_noop_deinit)
+
+static bool int_less(int *a, int *b) {
+    return *a < *b;
+}
+
+static bool int_eq(int *elem, void *target) {
+    return *elem == *(int *)target;
+}
+
+// == POINTER TYPE ==
+
+size_t global_destructor_counter_arraylist = 0;
+
+static void intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+    global_destructor_counter_arraylist++;
+}
+
+ARRAYLIST_SBO(int *, intptrs, 2, intptr_deinit)
+
+static bool intptr_is_odd(int **elem, void *ctx) {
+    (void)ctx;
+    return **elem % 2 != 0;
+}
+
+void test_arraylist_sbo_inline_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_sbo_ints list = sbo_ints_init(counting_allocator(&counts));
+
+    assert(sbo_ints_is_inline(&list));
+    assert(sbo_ints_capacity(&list) == 4);
+    assert(sbo_ints_is_empty(&list));
+
+    for (int i = 0; i < 4; ++i) {
+        assert(sbo_ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    // Up to N elements nothing reaches the allocator
+    assert(counts.mallocs == 0 && counts.reallocs == 0);
+    assert(sbo_ints_is_inline(&list));
+    assert(sbo_ints_begin(&list) == list.inline_data);
+    assert(*sbo_ints_at(&list, 3) == 3);
+    assert(sbo_ints_at(&list, 4) == NULL);
+    assert(*sbo_ints_back(&list) == 3);
+    assert(sbo_ints_end(&list) - sbo_ints_begin(&list) == 4);
+
+    // Every operation works on the inline buffer
+    assert(sbo_ints_remove_at(&list, 0) == ARRAYLIST_OK);
+    assert(sbo_ints_insert_at(&list, 10, 1) == ARRAYLIST_OK);
+    assert(*sbo_ints_at(&list, 0) == 1);
+    assert(*sbo_ints_at(&list, 1) == 10);
+    assert(*sbo_ints_at(&list, 2) == 2);
+    int target = 2;
+    size_t index = 0;
+    assert(sbo_ints_contains(&list, int_eq, &target, &index) && index == 2);
+    assert(*sbo_ints_find(&list, int_eq, &target) == 2);
+    target = 42;
+    assert(sbo_ints_find(&list, int_eq, &target) == sbo_ints_end(&list));
+    assert(sbo_ints_pop_back(&list) == ARRAYLIST_OK);
+    assert(sbo_ints_size(&list) == 3);
+    assert(counts.mallocs == 0 && counts.reallocs == 0);
+
+    sbo_ints_deinit(&list);
+    assert(counts.frees == 0);
+    printf("test arraylist sbo inline scalar type passed\n");
+}
+
+void test_arraylist_sbo_spill_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_sbo_ints list = sbo_ints_init(counting_allocator(&counts));
+
+    for (int i = 0; i < 5; ++i) {
+        assert(sbo_ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    // The fifth element moves everything to the heap in one allocation
+    assert(!sbo_ints_is_inline(&list));
+    assert(counts.mallocs == 1);
+    assert(sbo_ints_capacity(&list) > 4);
+    for (int i = 0; i < 5; ++i) {
+        assert(*sbo_ints_at(&list, i) == i);
+    }
+
+    for (int i = 5; i < 100; ++i) {
+        assert(sbo_ints_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    assert(counts.mallocs == 1);
+    assert(counts.reallocs > 0);
+    for (int i = 0; i < 100; ++i) {
+        assert(*sbo_ints_at(&list, i) == i);
+    }
+
+    // Still too big to go back inline, only trims the heap buffer
+    assert(sbo_ints_shrink_to_fit(&list) == ARRAYLIST_OK);
+    assert(!sbo_ints_is_inline(&list));
+    assert(sbo_ints_capacity(&list) == 100);
+
+    // Back under N the elements move inline and the heap buffer is released
+    assert(sbo_ints_remove_from_to(&list, 3, 99) == ARRAYLIST_OK);
+    assert(sbo_ints_shrink_to_fit(&list) == ARRAYLIST_OK);
+    assert(sbo_ints_is_inline(&list));
+    assert(sbo_ints_capacity(&list) == 4);
+    assert(counts.frees == 1);
+    assert(*sbo_ints_at(&list, 0) == 0 && *sbo_ints_at(&list, 2) == 2);
+
+    // Bulk operations spill once
+    int src[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    assert(sbo_ints_push_back_n(&list, src, 10) == ARRAYLIST_OK);
+    assert(counts.mallocs == 2);
+    assert(sbo_ints_size(&list) == 13);
+    assert(*sbo_ints_at(&list, 12) == 9);
+    assert(sbo_ints_insert_range_at(&list, 0, src, 2) == ARRAYLIST_OK);
+    assert(*sbo_ints_at(&list, 1) == 1 && *sbo_ints_at(&list, 2) == 0);
+    assert(sbo_ints_resize(&list, 20) == ARRAYLIST_OK);
+    assert(*sbo_ints_at(&list, 19) == 0);
+
+    sbo_ints_deinit(&list);
+    assert(counts.frees == 2);
+    assert(sbo_ints_is_inline(&list));
+    printf("test arraylist sbo spill scalar type passed\n");
+}
+
+void test_arraylist_sbo_steal_swap_scalar_type(void) {
+    struct arraylist_sbo_ints small = sbo_ints_init(allocator_get_default());
+    struct arraylist_sbo_ints big = sbo_ints_init(allocator_get_default());
+
+    for (int i = 0; i < 3; ++i) {
+        assert(sbo_ints_push_back(&small, i) == ARRAYLIST_OK);
+    }
+    for (int i = 0; i < 10; ++i) {
+        assert(sbo_ints_push_back(&big, i * 10) == ARRAYLIST_OK);
+    }
+    int *big_heap = big.heap;
+
+    // Inline elements travel with the struct, heap buffers keep their address
+    assert(sbo_ints_swap(&small, &big) == ARRAYLIST_OK);
+    assert(small.heap == big_heap);
+    assert(sbo_ints_is_inline(&big));
+    assert(sbo_ints_size(&big) == 3 && *sbo_ints_at(&big, 2) == 2);
+    assert(sbo_ints_size(&small) == 10 && *sbo_ints_at(&small, 9) == 90);
+    assert(sbo_ints_swap(NULL, &big) == ARRAYLIST_ERR_NULL);
+
+    struct arraylist_sbo_ints stolen_inline = sbo_ints_steal(&big);
+    assert(sbo_ints_is_inline(&stolen_inline));
+    assert(sbo_ints_size(&stolen_inline) == 3);
+    assert(*sbo_ints_at(&stolen_inline, 1) == 1);
+    assert(sbo_ints_size(&big) == 0);
+    assert(sbo_ints_capacity(&big) == 4);
+    assert(big.alloc.malloc == NULL);
+
+    struct arraylist_sbo_ints stolen_heap = sbo_ints_steal(&small);
+    assert(stolen_heap.heap == big_heap);
+    assert(small.heap == NULL);
+    assert(*sbo_ints_at(&stolen_heap, 5) == 50);
+
+    // Copies get their own storage
+    struct arraylist_sbo_ints copy = sbo_ints_shallow_copy(&stolen_heap);
+    assert(copy.heap != NULL && copy.heap != stolen_heap.heap);
+    assert(sbo_ints_size(&copy) == 10 && *sbo_ints_at(&copy, 9) == 90);
+    assert(sbo_ints_qsort(&copy, NULL) == ARRAYLIST_ERR_NULL);
+
+    sbo_ints_deinit(&copy);
+    sbo_ints_deinit(&stolen_heap);
+    sbo_ints_deinit(&stolen_inline);
+    sbo_ints_deinit(&big);
+    sbo_ints_deinit(&small);
+    printf("test arraylist sbo steal swap scalar type passed\n");
+}
+
+void test_arraylist_sbo_qsort_scalar_type(void) {
+    struct arraylist_sbo_ints list = sbo_ints_init(allocator_get_default());
+
+    // Inline sort
+    int small[4] = { 3, 1, 4, 2 };
+    assert(sbo_ints_push_back_n(&list, small, 4) == ARRAYLIST_OK);
+    assert(sbo_ints_qsort(&list, int_less) == ARRAYLIST_OK);
+    assert(sbo_ints_is_inline(&list));
+    for (int i = 0; i < 4; ++i) {
+        assert(*sbo_ints_at(&list, i) == i + 1);
+    }
+
+    // Heap sort
+    sbo_ints_clear(&list);
+    for (int i = 0; i < 1000; ++i) {
+        assert(sbo_ints_push_back(&list, (i * 7919) % 1000) == ARRAYLIST_OK);
+    }
+    assert(sbo_ints_qsort(&list, int_less) == ARRAYLIST_OK);
+    for (int i = 0; i < 1000; ++i) {
+        assert(*sbo_ints_at(&list, i) == i);
+    }
+
+    sbo_ints_deinit(&list);
+    printf("test arraylist sbo qsort scalar type passed\n");
+}
+
+void test_arraylist_sbo_ptr(void) {
+    struct arraylist_sbo_intptrs list = sbo_intptrs_init(allocator_get_default());
+    struct Allocator *alloc = sbo_intptrs_get_allocator(&list);
+    global_destructor_counter_arraylist = 0;
+
+    for (int i = 0; i < 6; ++i) {
+        int **slot = sbo_intptrs_emplace_back(&list);
+        assert(slot != NULL);
+        *slot = alloc->malloc(sizeof(int), alloc->ctx);
+        **slot = i;
+    }
+    assert(!sbo_intptrs_is_inline(&list));
+    assert(**sbo_intptrs_at(&list, 5) == 5);
+
+    // Destructor runs on every element removed
+    assert(sbo_intptrs_remove_at(&list, 0) == ARRAYLIST_OK);
+    assert(global_destructor_counter_arraylist == 1);
+    assert(sbo_intptrs_shrink_size(&list, 2) == ARRAYLIST_OK);
+    assert(global_destructor_counter_arraylist == 4);
+    assert(sbo_intptrs_shrink_to_fit(&list) == ARRAYLIST_OK);
+    assert(sbo_intptrs_is_inline(&list));
+    assert(**sbo_intptrs_at(&list, 0) == 1 && **sbo_intptrs_at(&list, 1) == 2);
+
+    // Filtering destroys what it removes, inline or not
+    for (int i = 3; i < 8; ++i) {
+        int **slot = sbo_intptrs_emplace_back(&list);
+        *slot = alloc->malloc(sizeof(int), alloc->ctx);
+        **slot = i;
+    }
+    assert(sbo_intptrs_remove_if(&list, intptr_is_odd, NULL) == 4);
+    assert(global_destructor_counter_arraylist == 8);
+    assert(sbo_intptrs_size(&list) == 3);
+    assert(**sbo_intptrs_at(&list, 0) == 2 && **sbo_intptrs_at(&list, 2) == 6);
+    assert(sbo_intptrs_swap_remove_at(&list, 0) == ARRAYLIST_OK);
+    assert(**sbo_intptrs_at(&list, 0) == 6);
+    assert(sbo_intptrs_retain(&list, intptr_is_odd, NULL) == 2);
+    assert(global_destructor_counter_arraylist == 11);
+    assert(sbo_intptrs_is_empty(&list));
+
+    sbo_intptrs_deinit(&list);
+    assert(global_destructor_counter_arraylist == 11);
+    assert(sbo_intptrs_size(&list) == 0);
+    printf("test arraylist sbo ptr passed\n");
+}
+
+int main(void) {
+    test_arraylist_sbo_inline_scalar_type();
+    test_arraylist_sbo_spill_scalar_type();
+    test_arraylist_sbo_steal_swap_scalar_type();
+    test_arraylist_sbo_qsort_scalar_type();
+    test_arraylist_sbo_ptr();
+    return 0;
+}
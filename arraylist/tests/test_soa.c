@@ -0,0 +1,332 @@
+/**
+ * @file test_soa.c
+ * @brief Unit tests for the arraylist.h file ARRAYLIST_SOA version
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+
+// Counts the calls reaching the heap, the columns must grow as a single block
+struct counting_ctx {
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+    size_t fail_after;
+};
+
+static void *counting_malloc(size_t size, void *ctx) {
+    struct counting_ctx *counts = (struct counting_ctx *)ctx;
+    if (counts->fail_after != 0 && counts->mallocs >= counts->fail_after) {
+        return NULL;
+    }
+    counts->mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    struct counting_ctx *counts = (struct counting_ctx *)ctx;
+    (void)old_size;
+    if (counts->fail_after != 0 && counts->mallocs + counts->reallocs >= counts->fail_after) {
+        return NULL;
+    }
+    counts->reallocs++;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ptr, size_t size, void *ctx) {
+    (void)size;
+    ((struct counting_ctx *)ctx)->frees++;
+    free(ptr);
+}
+
+static struct Allocator counting_allocator(struct counting_ctx *ctx) {
+    struct Allocator alloc = { counting_malloc, counting_realloc, counting_free, ctx };
+    return alloc;
+}
+
+// Bump allocator handing out blocks at a different offset from a cache line each time, so realloc never
+// keeps the alignment of the previous block
+struct shifting_ctx {
+    unsigned char *buffer;
+    size_t used;
+    size_t calls;
+};
+
+static void *shifting_malloc(size_t size, void *ctx) {
+    struct shifting_ctx *arena = (struct shifting_ctx *)ctx;
+    size_t start = (arena->used + 63) / 64 * 64 + 8 * (++arena->calls % 8);
+    arena->used = start + size;
+    return arena->buffer + start;
+}
+
+static void *shifting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    void *moved = shifting_malloc(new_size, ctx);
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    return moved;
+}
+
+static void shifting_free(void *ptr, size_t size, void *ctx) {
+    (void)ptr;
+    (void)size;
+    (void)ctx;
+}
+
+// == SCALAR FIELDS ==
+
+#define POINT_FIELDS(X) X(float, x) X(double, y) X(char, tag) X(int, id)
+
+ARRAYLIST_SOA(POINT_FIELDS, points, arraylist_noop_deinit)
+
+// == POINTER FIELD ==
+
+#define NAMED_FIELDS(X) X(int *, name) X(int, weight)
+
+// the destructor gets a row view, so the type goes first
+ARRAYLIST_TYPE_SOA(NAMED_FIELDS, named)
+
+size_t global_destructor_counter_arraylist = 0;
+
+static void named_deinit(struct arraylist_soa_ref_named *row, struct Allocator *alloc) {
+    alloc->free(*row->name, sizeof(int), alloc->ctx);
+    global_destructor_counter_arraylist++;
+}
+
+ARRAYLIST_DECL_SOA(NAMED_FIELDS, named)
+ARRAYLIST_IMPL_SOA(NAMED_FIELDS, named, named_deinit)
+
+static struct arraylist_soa_row_points make_point(int i) {
+    struct arraylist_soa_row_points row;
+    row.x = (float)i;
+    row.y = (double)i * 2.0;
+    row.tag = (char)('a' + i % 26);
+    row.id = i;
+    return row;
+}
+
+void test_arraylist_soa_push_at_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_soa_points list = soa_points_init(counting_allocator(&counts));
+
+    assert(soa_points_is_empty(&list));
+    assert(soa_points_capacity(&list) == 0);
+    assert(counts.mallocs == 0);
+    assert(soa_points_at(&list, 0).x == NULL);
+
+    for (int i = 0; i < 1000; ++i) {
+        assert(soa_points_push_back(&list, make_point(i)) == ARRAYLIST_OK);
+    }
+    assert(soa_points_size(&list) == 1000);
+    assert(soa_points_capacity(&list) >= 1000);
+    // one block, grown in place by the allocator
+    assert(counts.mallocs == 1);
+    assert(counts.reallocs > 0);
+    assert(counts.frees == 0);
+
+    uintptr_t columns[] = {
+        (uintptr_t)list.columns.x, (uintptr_t)list.columns.y, (uintptr_t)list.columns.tag, (uintptr_t)list.columns.id
+    };
+    for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); ++c) {
+        assert(columns[c] % ARRAYLIST_SOA_ALIGN == 0);
+        assert(columns[c] >= (uintptr_t)list.block);
+        assert(columns[c] < (uintptr_t)list.block + list.block_bytes);
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        struct arraylist_soa_ref_points ref = soa_points_at(&list, (size_t)i);
+        assert(*ref.x == (float)i);
+        assert(*ref.y == (double)i * 2.0);
+        assert(*ref.tag == (char)('a' + i % 26));
+        assert(*ref.id == i);
+        assert(ref.id == list.columns.id + i);
+    }
+    assert(soa_points_at(&list, 1000).id == NULL);
+
+    // writes through the view land in the columns
+    *soa_points_at(&list, 10).x = -1.0f;
+    assert(list.columns.x[10] == -1.0f);
+
+    struct arraylist_soa_row_points row;
+    assert(soa_points_get(&list, 10, &row) == ARRAYLIST_OK);
+    assert(row.x == -1.0f && row.id == 10);
+    assert(soa_points_get(&list, 1000, &row) == ARRAYLIST_ERR_OOB);
+    assert(soa_points_get(&list, 0, NULL) == ARRAYLIST_ERR_NULL);
+
+    assert(soa_points_set(&list, 20, make_point(7)) == ARRAYLIST_OK);
+    assert(list.columns.id[20] == 7 && list.columns.y[20] == 14.0);
+    assert(soa_points_set(&list, 1000, make_point(7)) == ARRAYLIST_ERR_OOB);
+
+    soa_points_deinit(&list);
+    assert(counts.frees == 1);
+    assert(list.block == NULL && list.size == 0 && list.columns.x == NULL);
+}
+
+void test_arraylist_soa_emplace_reserve_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct arraylist_soa_points list = soa_points_init(counting_allocator(&counts));
+
+    assert(soa_points_reserve(&list, 256) == ARRAYLIST_OK);
+    assert(soa_points_capacity(&list) == 256);
+    assert(counts.mallocs == 1);
+
+    for (int i = 0; i < 256; ++i) {
+        struct arraylist_soa_ref_points ref = soa_points_emplace_back(&list);
+        assert(ref.x != NULL);
+        *ref.x = (float)i;
+        *ref.y = 0.0;
+        *ref.tag = 'z';
+        *ref.id = i;
+    }
+    assert(counts.mallocs == 1);
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < list.size; ++i) {
+        sum += list.columns.x[i];
+    }
+    assert(sum == 255.0f * 256.0f / 2.0f);
+
+    // smaller reserve is a no-op, bigger keeps every column intact
+    assert(soa_points_reserve(&list, 10) == ARRAYLIST_OK);
+    assert(counts.mallocs == 1);
+    assert(soa_points_reserve(&list, 1000) == ARRAYLIST_OK);
+    assert(counts.mallocs == 1 && counts.reallocs == 1);
+    for (int i = 0; i < 256; ++i) {
+        assert(list.columns.x[i] == (float)i && list.columns.id[i] == i && list.columns.tag[i] == 'z');
+    }
+
+    soa_points_clear(&list);
+    assert(soa_points_is_empty(&list));
+    assert(soa_points_capacity(&list) == 1000);
+    assert(soa_points_pop_back(&list) == ARRAYLIST_ERR_OOB);
+
+    soa_points_deinit(&list);
+    assert(counts.frees == 1);
+}
+
+void test_arraylist_soa_realloc_shift_scalar_type(void) {
+    struct shifting_ctx arena = { 0 };
+    arena.buffer = malloc((size_t)1 << 22);
+    struct Allocator alloc = { shifting_malloc, shifting_realloc, shifting_free, &arena };
+    struct arraylist_soa_points list = soa_points_init(alloc);
+
+    for (int i = 0; i < 3000; ++i) {
+        assert(soa_points_push_back(&list, make_point(i)) == ARRAYLIST_OK);
+        assert((uintptr_t)list.columns.y % ARRAYLIST_SOA_ALIGN == 0);
+    }
+    assert(arena.calls > 5);
+    for (int i = 0; i < 3000; ++i) {
+        assert(list.columns.x[i] == (float)i);
+        assert(list.columns.y[i] == (double)i * 2.0);
+        assert(list.columns.tag[i] == (char)('a' + i % 26));
+        assert(list.columns.id[i] == i);
+    }
+
+    soa_points_deinit(&list);
+    free(arena.buffer);
+}
+
+void test_arraylist_soa_remove_scalar_type(void) {
+    struct arraylist_soa_points list = soa_points_init(allocator_get_default());
+    for (int i = 0; i < 10; ++i) {
+        assert(soa_points_push_back(&list, make_point(i)) == ARRAYLIST_OK);
+    }
+
+    // 0 1 2 3 4 5 6 7 8 9 -> 0 1 3 4 5 6 7 8 9
+    assert(soa_points_remove_at(&list, 2) == ARRAYLIST_OK);
+    assert(list.size == 9);
+    for (size_t i = 0; i < list.size; ++i) {
+        int expected = i < 2 ? (int)i : (int)i + 1;
+        assert(list.columns.id[i] == expected);
+        assert(list.columns.x[i] == (float)expected);
+        assert(list.columns.tag[i] == (char)('a' + expected));
+    }
+
+    // 0 1 3 4 5 6 7 8 9 -> 9 1 3 4 5 6 7 8
+    assert(soa_points_swap_remove_at(&list, 0) == ARRAYLIST_OK);
+    assert(list.size == 8);
+    assert(list.columns.id[0] == 9 && list.columns.y[0] == 18.0);
+
+    // removing the last one has nothing to move
+    assert(soa_points_swap_remove_at(&list, 7) == ARRAYLIST_OK);
+    assert(list.size == 7 && list.columns.id[6] == 7);
+
+    assert(soa_points_pop_back(&list) == ARRAYLIST_OK);
+    assert(list.size == 6 && list.columns.id[5] == 6);
+
+    assert(soa_points_remove_at(&list, 6) == ARRAYLIST_ERR_OOB);
+    assert(soa_points_swap_remove_at(&list, 6) == ARRAYLIST_ERR_OOB);
+
+    soa_points_deinit(&list);
+}
+
+void test_arraylist_soa_alloc_failure_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    counts.fail_after = 1;
+    struct arraylist_soa_points list = soa_points_init(counting_allocator(&counts));
+
+    assert(soa_points_push_back(&list, make_point(1)) == ARRAYLIST_OK);
+    size_t cap = soa_points_capacity(&list);
+    for (size_t i = 1; i < cap; ++i) {
+        assert(soa_points_push_back(&list, make_point((int)i)) == ARRAYLIST_OK);
+    }
+    // the next growth fails and leaves the list as it was
+    assert(soa_points_push_back(&list, make_point(99)) == ARRAYLIST_ERR_ALLOC);
+    assert(soa_points_emplace_back(&list).x == NULL);
+    assert(soa_points_size(&list) == cap);
+    assert(list.columns.id[0] == 1);
+
+    assert(soa_points_reserve(&list, SIZE_MAX / 2) == ARRAYLIST_ERR_OVERFLOW);
+    assert(soa_points_push_back(NULL, make_point(1)) == ARRAYLIST_ERR_NULL);
+    assert(soa_points_size(NULL) == 0);
+
+    soa_points_deinit(&list);
+    assert(counts.frees == 1);
+}
+
+void test_arraylist_soa_ptr(void) {
+    struct Allocator alloc = allocator_get_default();
+    struct arraylist_soa_named list = soa_named_init(alloc);
+    global_destructor_counter_arraylist = 0;
+
+    for (int i = 0; i < 20; ++i) {
+        struct arraylist_soa_row_named row;
+        row.name = alloc.malloc(sizeof(int), alloc.ctx);
+        *row.name = i;
+        row.weight = i * 10;
+        assert(soa_named_push_back(&list, row) == ARRAYLIST_OK);
+    }
+    assert(*list.columns.name[19] == 19 && list.columns.weight[19] == 190);
+
+    assert(soa_named_pop_back(&list) == ARRAYLIST_OK);
+    assert(global_destructor_counter_arraylist == 1);
+    assert(soa_named_remove_at(&list, 0) == ARRAYLIST_OK);
+    assert(global_destructor_counter_arraylist == 2);
+    assert(*list.columns.name[0] == 1);
+    assert(soa_named_swap_remove_at(&list, 0) == ARRAYLIST_OK);
+    assert(global_destructor_counter_arraylist == 3);
+    assert(*list.columns.name[0] == 18 && list.columns.weight[0] == 180);
+
+    soa_named_clear(&list);
+    assert(global_destructor_counter_arraylist == 20);
+
+    struct arraylist_soa_ref_named ref = soa_named_emplace_back(&list);
+    *ref.name = alloc.malloc(sizeof(int), alloc.ctx);
+    **ref.name = 5;
+    *ref.weight = 50;
+    soa_named_deinit(&list);
+    assert(global_destructor_counter_arraylist == 21);
+}
+
+int main(void) {
+    test_arraylist_soa_push_at_scalar_type();
+    test_arraylist_soa_emplace_reserve_scalar_type();
+    test_arraylist_soa_realloc_shift_scalar_type();
+    test_arraylist_soa_remove_scalar_type();
+    test_arraylist_soa_alloc_failure_scalar_type();
+    test_arraylist_soa_ptr();
+    return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file test_stats.c
+ * @brief Unit tests for the arraylist.h ARRAYLIST_STATS counters, checked against the stats allocator
+ */
+#define ARRAYLIST_STATS
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+
+static size_t global_comparator_calls = 0;
+
+static bool int_less_counted(int *a, int *b) {
+    global_comparator_calls++;
+    return *a < *b;
+}
+
+#define int_cmp_macro(a, b) ((*(a) > *(b)) - (*(a) < *(b)))
+
+ARRAYLIST(int, ints, arraylist_noop_deinit)
+ARRAYLIST_CMP(int, intcmp, arraylist_noop_deinit, int_cmp_macro)
+ARRAYLIST_DYN(int, ints)
+ARRAYLIST_SBO(int, ints, 4, arraylist_noop_deinit)
+
+void test_arraylist_stats_growth_scalar_type(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct arraylist_ints list = ints_init(allocator_get_stats(&astats));
+    assert(list.stats.grows == 0 && list.stats.reallocs == 0);
+
+    // Doubling from 1: capacities 1, 2, 4, 8
+    for (int i = 0; i < 8; ++i) {
+        ints_push_back(&list, i);
+    }
+    assert(list.stats.grows == 4);
+    assert(list.stats.reallocs == 3);
+    assert(astats.malloc_calls == 1);
+    assert(astats.realloc_calls == list.stats.reallocs);
+    assert(astats.bytes_live == 8 * sizeof(int));
+
+    // reserve() counts as a grow, a smaller reserve does nothing
+    ints_reserve(&list, 100);
+    ints_reserve(&list, 10);
+    assert(list.stats.grows == 5);
+    assert(list.stats.reallocs == 4);
+    assert(astats.bytes_peak == 100 * sizeof(int));
+
+    ints_shrink_to_fit(&list);
+    assert(list.stats.reallocs == 5);
+    assert(list.stats.bytes_reclaimed == 92 * sizeof(int));
+    assert(astats.bytes_live == 8 * sizeof(int));
+
+    // With nothing left the whole buffer is given back
+    ints_clear(&list);
+    ints_shrink_to_fit(&list);
+    assert(list.stats.bytes_reclaimed == 100 * sizeof(int));
+    assert(astats.bytes_live == 0);
+    assert(list.stats.reallocs == astats.realloc_calls);
+
+    ints_deinit(&list);
+    assert(astats.free_calls == 1);
+    printf("test arraylist stats growth scalar-type passed\n");
+}
+
+void test_arraylist_stats_comparisons_scalar_type(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct arraylist_ints list = ints_init(gpa);
+    for (int i = 0; i < 100; ++i) {
+        ints_push_back(&list, (i * 37) % 101);
+    }
+
+    global_comparator_calls = 0;
+    ints_qsort(&list, int_less_counted);
+    assert(global_comparator_calls > 0);
+    assert(list.stats.comparisons == global_comparator_calls);
+    for (int i = 1; i < 100; ++i) {
+        assert(*ints_at(&list, (size_t)i - 1) <= *ints_at(&list, (size_t)i));
+    }
+
+    // A second sort adds to the count
+    ints_qsort(&list, int_less_counted);
+    assert(list.stats.comparisons == global_comparator_calls);
+    ints_deinit(&list);
+
+    struct arraylist_intcmp cmp_list = intcmp_init(gpa);
+    for (int i = 0; i < 10; ++i) {
+        intcmp_push_back(&cmp_list, 9 - i);
+    }
+    intcmp_sort(&cmp_list);
+    size_t after_sort = cmp_list.stats.comparisons;
+    assert(after_sort > 0);
+
+    int value = 3;
+    assert(*intcmp_find_value(&cmp_list, &value) == 3);
+    assert(cmp_list.stats.comparisons == after_sort + 4);
+    value = 42;
+    assert(!intcmp_contains_value(&cmp_list, &value, NULL));
+    assert(cmp_list.stats.comparisons == after_sort + 4 + 10);
+    intcmp_deinit(&cmp_list);
+    printf("test arraylist stats comparisons scalar-type passed\n");
+}
+
+// Default allocator whose malloc can be switched off, for the fallback of parallel_sort
+static bool global_malloc_fails = false;
+
+static void *switchable_malloc(size_t size, void *ctx) {
+    return global_malloc_fails ? NULL : default_malloc(size, ctx);
+}
+
+void test_arraylist_stats_parallel_sort_scalar_type(void) {
+    struct Allocator switchable = allocator_get_default();
+    switchable.malloc = switchable_malloc;
+    struct arraylist_ints list = ints_init(switchable);
+    struct Executor serial = executor_get_serial();
+    const int N = 4 * ARRAYLIST_PARALLEL_SORT_MIN_CHUNK;
+
+    // Split in tasks, merged, every comparison of every task is counted
+    for (int i = 0; i < N; ++i) {
+        ints_push_back(&list, (int)(((unsigned)i * 2654435761u) % (unsigned)N));
+    }
+    global_comparator_calls = 0;
+    assert(ints_parallel_sort(&list, int_less_counted, &serial, 4) == ARRAYLIST_OK);
+    assert(global_comparator_calls > 0 && list.stats.comparisons == global_comparator_calls);
+    for (int i = 1; i < N; ++i) {
+        assert(*ints_at(&list, (size_t)i - 1) <= *ints_at(&list, (size_t)i));
+    }
+
+    // The serial fallback, when the merge buffer can not be allocated, counts as well
+    for (int i = 0; i < N; ++i) {
+        *ints_at(&list, (size_t)i) = N - i;
+    }
+    global_malloc_fails = true;
+    assert(ints_parallel_sort(&list, int_less_counted, &serial, 4) == ARRAYLIST_OK);
+    global_malloc_fails = false;
+    assert(list.stats.comparisons == global_comparator_calls);
+    assert(*ints_at(&list, 0) == 1 && *ints_at(&list, (size_t)N - 1) == N);
+    ints_deinit(&list);
+    printf("test arraylist stats parallel sort scalar-type passed\n");
+}
+
+void test_arraylist_dyn_stats_scalar_type(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct arraylist_dyn_ints list = dyn_ints_init(allocator_get_stats(&astats), NULL);
+    for (int i = 0; i < 5; ++i) {
+        dyn_ints_push_back(&list, 4 - i);
+    }
+    assert(list.stats.grows == 4);
+    assert(list.stats.reallocs == astats.realloc_calls);
+
+    global_comparator_calls = 0;
+    dyn_ints_qsort(&list, int_less_counted);
+    assert(list.stats.comparisons == global_comparator_calls);
+
+    dyn_ints_shrink_to_fit(&list);
+    assert(list.stats.bytes_reclaimed == 3 * sizeof(int));
+    assert(list.stats.reallocs == astats.realloc_calls);
+    dyn_ints_deinit(&list);
+    assert(astats.bytes_live == 0);
+    printf("test arraylist dyn stats scalar-type passed\n");
+}
+
+void test_arraylist_sbo_stats_scalar_type(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct arraylist_sbo_ints list = sbo_ints_init(allocator_get_stats(&astats));
+    for (int i = 0; i < 4; ++i) {
+        sbo_ints_push_back(&list, i);
+    }
+    assert(list.stats.grows == 0);
+    assert(astats.malloc_calls == 0);
+
+    // Spilling is a malloc, not a realloc
+    sbo_ints_push_back(&list, 4);
+    assert(list.stats.grows == 1);
+    assert(list.stats.reallocs == 0);
+    assert(astats.malloc_calls == 1);
+    for (int i = 5; i < 9; ++i) {
+        sbo_ints_push_back(&list, i);
+    }
+    assert(list.stats.grows == 2);
+    assert(list.stats.reallocs == 1);
+    size_t heap_capacity = sbo_ints_capacity(&list);
+
+    // Back inline, the whole heap buffer is reclaimed
+    sbo_ints_shrink_size(&list, 2);
+    sbo_ints_shrink_to_fit(&list);
+    assert(sbo_ints_is_inline(&list));
+    assert(list.stats.bytes_reclaimed == heap_capacity * sizeof(int));
+    assert(astats.bytes_live == 0);
+    sbo_ints_deinit(&list);
+    printf("test arraylist sbo stats scalar-type passed\n");
+}
+
+int main(void) {
+    test_arraylist_stats_growth_scalar_type();
+    test_arraylist_stats_comparisons_scalar_type();
+    test_arraylist_stats_parallel_sort_scalar_type();
+    test_arraylist_dyn_stats_scalar_type();
+    test_arraylist_sbo_stats_scalar_type();
+    return 0;
+}
@@ -0,0 +1,949 @@
+/**
+ * @file test.c
+ * @brief Unit tests for the avltree.h file
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "arraylist.h"
+#include "avltree.h"
+#include "pair.h"
+
+// == SIMPLE TYPE ==
+
+AVLTREE_TYPE(int, ints)
+AVLTREE_DECL(int, ints)
+AVLTREE_IMPL(int, ints, avltree_noop_deinit)
+
+static int int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+// == POINTER TYPE ==
+
+static void intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+}
+
+AVLTREE_TYPE(int *, intptrs)
+AVLTREE_DECL(int *, intptrs)
+AVLTREE_IMPL(int *, intptrs, intptr_deinit)
+
+static int intptr_cmp(int **a, int **b) {
+    return (**a > **b) - (**a < **b);
+}
+
+// == COMPILE-TIME COMPARATOR ==
+
+#define int_cmp_macro(a, b) ((*(a) > *(b)) - (*(a) < *(b)))
+
+AVLTREE_TYPE_CMP(int, intcmp)
+AVLTREE_DECL_CMP(int, intcmp)
+AVLTREE_IMPL_CMP(int, intcmp, avltree_noop_deinit, int_cmp_macro)
+
+// == BULK MOVES TO AND FROM AN ARRAYLIST ==
+
+ARRAYLIST(int, intlist, arraylist_noop_deinit)
+AVLTREE_DECL_ARRAYLIST(int, ints, intlist)
+AVLTREE_IMPL_ARRAYLIST(int, ints, intlist)
+
+// Pairs owning heap memory, a double free or a leak shows under the sanitizers
+PAIR(int, int *, owned, pair_noop_deinit, intptr_deinit)
+ARRAYLIST(struct pair_owned, ownedlist, owned_deinit)
+AVLTREE_TYPE(struct pair_owned, owneds)
+AVLTREE_DECL(struct pair_owned, owneds)
+AVLTREE_IMPL(struct pair_owned, owneds, owned_deinit)
+AVLTREE_DECL_ARRAYLIST(struct pair_owned, owneds, ownedlist)
+AVLTREE_IMPL_ARRAYLIST(struct pair_owned, owneds, ownedlist)
+
+static int owned_cmp_first(struct pair_owned *a, struct pair_owned *b) {
+    return (a->first > b->first) - (a->first < b->first);
+}
+
+static struct pair_owned owned_make(int key, int value) {
+    struct Allocator alloc = allocator_get_default();
+    int *heap = alloc.malloc(sizeof(int), alloc.ctx);
+    assert(heap != NULL);
+    *heap = value;
+    return owned_init(key, heap);
+}
+
+// Checks ordering, parent links and stored heights, returns the height of the subtree (-1 on failure)
+static int ints_check_subtree(struct avltree_node_ints *node, struct avltree_node_ints *parent, size_t *count) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->parent != parent) {
+        return -1;
+    }
+    if (node->left != NULL && node->left->data >= node->data) {
+        return -1;
+    }
+    if (node->right != NULL && node->right->data <= node->data) {
+        return -1;
+    }
+    int lh = ints_check_subtree(node->left, node, count);
+    int rh = ints_check_subtree(node->right, node, count);
+    if (lh < 0 || rh < 0 || lh - rh > 1 || rh - lh > 1) {
+        return -1;
+    }
+    int h = 1 + (lh > rh ? lh : rh);
+    if ((size_t)h != node->height) {
+        return -1;
+    }
+    *count += 1;
+    return h;
+}
+
+static int ints_is_valid(struct avltree_ints *tree) {
+    size_t count = 0;
+    int h = ints_check_subtree(tree->root, NULL, &count);
+    return h >= 0 && count == tree->size;
+}
+
+struct range_collect {
+    int out[64];
+    size_t count;
+    size_t limit;
+};
+static bool collect_range(int *elem, void *ctx) {
+    struct range_collect *c = ctx;
+    if (c->count == c->limit) {
+        return false;
+    }
+    c->out[c->count++] = *elem;
+    return true;
+}
+
+void test_avltree_insert_balance_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+
+    // Sequential inserts are the worst case for an unbalanced tree
+    for (int i = 0; i < 4096; ++i) {
+        assert(ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(tree.size == 4096);
+    assert(ints_is_valid(&tree));
+    // An avl tree of 4096 nodes is at most 1.44 * log2(4096) ~ 18 levels deep, leaves have height 1
+    assert(tree.root->height <= 18);
+    assert(ints_insert(&tree, 10) == AVLTREE_ERR_DUPLICATE);
+
+    // Remove every other element, exercising the two-children path
+    for (int i = 0; i < 4096; i += 2) {
+        assert(ints_remove(&tree, i) == AVLTREE_OK);
+        assert(ints_is_valid(&tree));
+    }
+    assert(tree.size == 2048);
+
+    ints_deinit(&tree);
+    printf("test avltree insert balance scalar type passed\n");
+}
+
+void test_avltree_find_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+
+    assert(ints_find(&tree, 1) == NULL);
+    assert(!ints_contains(&tree, 1));
+
+    for (int i = 0; i < 100; ++i) {
+        assert(ints_insert(&tree, i * 10) == AVLTREE_OK);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        int *found = ints_find(&tree, i * 10);
+        assert(found != NULL);
+        assert(*found == i * 10);
+        assert(ints_contains(&tree, i * 10));
+        assert(ints_find(&tree, i * 10 + 5) == NULL);
+        assert(!ints_contains(&tree, i * 10 + 5));
+    }
+    assert(ints_find(&tree, -10) == NULL);
+
+    assert(ints_find(NULL, 1) == NULL);
+    assert(!ints_contains(NULL, 1));
+
+    ints_deinit(&tree);
+    printf("test avltree find scalar type passed\n");
+}
+
+void test_avltree_bounds_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+
+    assert(ints_lower_bound(&tree, 0) == NULL);
+    assert(ints_upper_bound(&tree, 0) == NULL);
+    assert(ints_floor(&tree, 0) == NULL);
+    assert(ints_ceil(&tree, 0) == NULL);
+    assert(ints_min(&tree) == NULL);
+    assert(ints_max(&tree) == NULL);
+
+    // 0, 10, ..., 990
+    for (int i = 99; i >= 0; --i) {
+        assert(ints_insert(&tree, i * 10) == AVLTREE_OK);
+    }
+
+    assert(*ints_min(&tree) == 0);
+    assert(*ints_max(&tree) == 990);
+
+    for (int v = -5; v <= 1000; ++v) {
+        int *lb = ints_lower_bound(&tree, v);
+        int *ub = ints_upper_bound(&tree, v);
+        int *fl = ints_floor(&tree, v);
+        int *ce = ints_ceil(&tree, v);
+
+        int expected_lb = v <= 0 ? 0 : ((v + 9) / 10) * 10;
+        int expected_ub = v < 0 ? 0 : (v / 10 + 1) * 10;
+        int expected_fl = v < 0 ? -1 : (v / 10) * 10;
+
+        if (expected_lb > 990) {
+            assert(lb == NULL);
+            assert(ce == NULL);
+        } else {
+            assert(lb != NULL && *lb == expected_lb);
+            assert(ce != NULL && *ce == expected_lb);
+        }
+        if (expected_ub > 990) {
+            assert(ub == NULL);
+        } else {
+            assert(ub != NULL && *ub == expected_ub);
+        }
+        if (expected_fl < 0) {
+            assert(fl == NULL);
+        } else {
+            if (expected_fl > 990) {
+                expected_fl = 990;
+            }
+            assert(fl != NULL && *fl == expected_fl);
+        }
+    }
+
+    assert(ints_lower_bound(NULL, 0) == NULL);
+    assert(ints_upper_bound(NULL, 0) == NULL);
+    assert(ints_floor(NULL, 0) == NULL);
+    assert(ints_ceil(NULL, 0) == NULL);
+    assert(ints_min(NULL) == NULL);
+    assert(ints_max(NULL) == NULL);
+
+    ints_deinit(&tree);
+    printf("test avltree bounds scalar type passed\n");
+}
+
+void test_avltree_pooled_scalar_type(void) {
+    struct avltree_ints tree = ints_init_pooled(allocator_get_default(), int_cmp, 64);
+    assert(tree.node_pool != NULL);
+    assert(tree.alloc.ctx == tree.node_pool);
+
+    for (int i = 0; i < 1000; ++i) {
+        assert(ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(ints_is_valid(&tree));
+
+    // 1000 nodes in chunks of 64 nodes
+    size_t chunks = 0;
+    for (struct pool_chunk *c = tree.node_pool->chunks; c != NULL; c = c->next) {
+        chunks++;
+    }
+    assert(chunks == 16);
+
+    // Removed nodes are recycled, reinserting must not grab new chunks
+    for (int i = 0; i < 500; ++i) {
+        assert(ints_remove(&tree, i) == AVLTREE_OK);
+    }
+    for (int i = 0; i < 500; ++i) {
+        assert(ints_insert(&tree, -i - 1) == AVLTREE_OK);
+    }
+    assert(ints_is_valid(&tree));
+    chunks = 0;
+    for (struct pool_chunk *c = tree.node_pool->chunks; c != NULL; c = c->next) {
+        chunks++;
+    }
+    assert(chunks == 16);
+    assert(*ints_min(&tree) == -500);
+    assert(*ints_max(&tree) == 999);
+
+    // clear releases every chunk at once and the tree is reusable
+    ints_clear(&tree);
+    assert(tree.size == 0);
+    assert(tree.root == NULL);
+    assert(tree.node_pool->chunks == NULL);
+    assert(ints_insert(&tree, 42) == AVLTREE_OK);
+    assert(*ints_find(&tree, 42) == 42);
+
+    ints_deinit(&tree);
+    assert(tree.node_pool == NULL);
+    printf("test avltree pooled scalar type passed\n");
+}
+
+void test_avltree_pooled_ptr(void) {
+    struct avltree_intptrs tree = intptrs_init_pooled(allocator_get_default(), intptr_cmp, 8);
+
+    for (int i = 0; i < 100; ++i) {
+        int *value = tree.alloc.malloc(sizeof(int), tree.alloc.ctx);
+        assert(value != NULL);
+        *value = i;
+        assert(intptrs_insert(&tree, value) == AVLTREE_OK);
+    }
+    int key = 50;
+    int *key_ptr = &key;
+    assert(intptrs_find(&tree, key_ptr) != NULL);
+    assert(**intptrs_find(&tree, key_ptr) == 50);
+
+    // The destructor is not a no-op, clear and deinit must visit every node
+    intptrs_clear(&tree);
+    assert(tree.size == 0);
+    for (int i = 0; i < 10; ++i) {
+        int *value = tree.alloc.malloc(sizeof(int), tree.alloc.ctx);
+        *value = i;
+        assert(intptrs_insert(&tree, value) == AVLTREE_OK);
+    }
+    intptrs_deinit(&tree);
+    printf("test avltree pooled ptr passed\n");
+}
+
+void test_avltree_random_insert_remove_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    int present[1000] = { 0 };
+    size_t expected = 0;
+
+    // Pseudo random order, rebalancing stops early at different heights of the descent path
+    unsigned int x = 12345;
+    for (int i = 0; i < 4000; ++i) {
+        x = x * 1103515245u + 12345u;
+        int v = (int)((x >> 16) % 1000);
+        enum avltree_error err = ints_insert(&tree, v);
+        assert(err == (present[v] ? AVLTREE_ERR_DUPLICATE : AVLTREE_OK));
+        expected += !present[v];
+        present[v] = 1;
+        x = x * 1103515245u + 12345u;
+        v = (int)((x >> 16) % 1000);
+        assert(ints_remove(&tree, v) == AVLTREE_OK);
+        expected -= present[v];
+        present[v] = 0;
+        if (i % 50 == 0) {
+            assert(ints_is_valid(&tree));
+        }
+    }
+    assert(ints_is_valid(&tree));
+    assert(tree.size == expected);
+    for (int v = 0; v < 1000; ++v) {
+        assert(ints_contains(&tree, v) == (present[v] != 0));
+    }
+
+    ints_deinit(&tree);
+    printf("test avltree random insert remove scalar type passed\n");
+}
+
+void test_avltree_build_from_sorted_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    int data[1000];
+    for (int i = 0; i < 1000; ++i) {
+        data[i] = i * 2;
+    }
+
+    // Every size up to a few levels, the shape must be a valid avl tree each time
+    for (size_t n = 0; n <= 70; ++n) {
+        assert(ints_build_from_sorted(&tree, data, n) == AVLTREE_OK);
+        assert(ints_is_valid(&tree));
+        assert(tree.size == n);
+    }
+
+    assert(ints_build_from_sorted(&tree, data, 1000) == AVLTREE_OK);
+    assert(ints_is_valid(&tree));
+    assert(tree.root->height == 10);
+    assert(*ints_min(&tree) == 0 && *ints_max(&tree) == 1998);
+    assert(*ints_lower_bound(&tree, 501) == 502);
+
+    // Still an ordinary tree afterwards
+    assert(ints_insert(&tree, 3) == AVLTREE_OK);
+    assert(ints_remove(&tree, 500) == AVLTREE_OK);
+    assert(ints_is_valid(&tree));
+
+    // Bad input leaves the tree alone
+    int unsorted[] = { 1, 3, 2 };
+    int duplicated[] = { 1, 2, 2 };
+    assert(ints_build_from_sorted(&tree, unsorted, 3) == AVLTREE_ERR_UNSORTED);
+    assert(ints_build_from_sorted(&tree, duplicated, 3) == AVLTREE_ERR_DUPLICATE);
+    assert(tree.size == 1000);
+    assert(ints_contains(&tree, 3));
+
+    ints_deinit(&tree);
+
+    // A chunk of exactly n nodes holds the whole tree
+    tree = ints_init_pooled(allocator_get_default(), int_cmp, 1000);
+    assert(ints_build_from_sorted(&tree, data, 1000) == AVLTREE_OK);
+    assert(tree.node_pool->chunks != NULL && tree.node_pool->chunks->next == NULL);
+    assert(ints_is_valid(&tree));
+    ints_deinit(&tree);
+    printf("test avltree build from sorted scalar type passed\n");
+}
+
+void test_avltree_build_from_sorted_ptr(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct avltree_intptrs tree = intptrs_init(gpa, intptr_cmp);
+    int *values[100];
+    for (int i = 0; i < 100; ++i) {
+        values[i] = gpa.malloc(sizeof(int), gpa.ctx);
+        *values[i] = i;
+    }
+    assert(intptrs_build_from_sorted(&tree, (const int **)values, 100) == AVLTREE_OK);
+    int key = 42;
+    int *key_ptr = &key;
+    assert(**intptrs_find(&tree, key_ptr) == 42);
+    intptrs_deinit(&tree);
+    printf("test avltree build from sorted ptr passed\n");
+}
+
+void test_avltree_iterate_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    assert(ints_begin(&tree) == NULL);
+    for (int i = 0; i < 500; ++i) {
+        ints_insert(&tree, (i * 7) % 500);
+    }
+
+    int expected = 0;
+    for (int *it = ints_begin(&tree); it != NULL; it = ints_next(&tree, it)) {
+        assert(*it == expected);
+        expected++;
+    }
+    assert(expected == 500);
+    for (int *it = ints_max(&tree); it != NULL; it = ints_prev(&tree, it)) {
+        expected--;
+        assert(*it == expected);
+    }
+    assert(expected == 0);
+
+    // Iterators come from the lookups too
+    int *it = ints_find(&tree, 250);
+    assert(*ints_next(&tree, it) == 251 && *ints_prev(&tree, it) == 249);
+
+    struct range_collect c = { .count = 0, .limit = 64 };
+    assert(ints_for_each_range(&tree, 10, 20, collect_range, &c) == 10);
+    for (size_t i = 0; i < c.count; ++i) {
+        assert(c.out[i] == 10 + (int)i);
+    }
+    // Bounds that are not keys, empty ranges and the callback stopping the scan
+    ints_remove(&tree, 30);
+    c.count = 0;
+    assert(ints_for_each_range(&tree, 29, 32, collect_range, &c) == 2);
+    assert(c.out[0] == 29 && c.out[1] == 31);
+    c.count = 0;
+    assert(ints_for_each_range(&tree, 20, 20, collect_range, &c) == 0);
+    assert(ints_for_each_range(&tree, 600, 700, collect_range, &c) == 0);
+    c.limit = 3;
+    assert(ints_for_each_range(&tree, 0, 500, collect_range, &c) == 4);
+    assert(c.count == 3);
+
+    ints_deinit(&tree);
+    printf("test avltree iterate scalar type passed\n");
+}
+
+// Fills a tree with the pseudo random values of seed below limit, marking them in present
+static void ints_fill_random(struct avltree_ints *tree, int *present, unsigned int seed, int count, int limit) {
+    for (int i = 0; i < count; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        int v = (int)((seed >> 16) % (unsigned int)limit);
+        if (ints_insert(tree, v) == AVLTREE_OK) {
+            present[v] = 1;
+        }
+    }
+}
+
+static int ints_matches(struct avltree_ints *tree, const int *present, int limit) {
+    size_t expected = 0;
+    for (int v = 0; v < limit; ++v) {
+        if (ints_contains(tree, v) != (present[v] != 0)) {
+            return 0;
+        }
+        expected += present[v] != 0;
+    }
+    return ints_is_valid(tree) && tree->size == expected;
+}
+
+void test_avltree_split_join_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    for (int i = 0; i < 1000; ++i) {
+        ints_insert(&tree, i);
+    }
+
+    // Split at every kind of position, then join back
+    int keys[] = { -5, 0, 1, 333, 500, 999, 1000, 5000 };
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); ++k) {
+        struct avltree_ints greater = ints_split(&tree, keys[k]);
+        int cut = keys[k] < 0 ? 0 : (keys[k] > 1000 ? 1000 : keys[k]);
+        assert(ints_is_valid(&tree) && ints_is_valid(&greater));
+        assert(tree.size == (size_t)cut && greater.size == (size_t)(1000 - cut));
+        assert(tree.size == 0 || *ints_max(&tree) == cut - 1);
+        assert(greater.size == 0 || *ints_min(&greater) == cut);
+        assert(ints_join(&tree, &greater) == AVLTREE_OK);
+        assert(greater.size == 0 && greater.root == NULL);
+        assert(ints_is_valid(&tree) && tree.size == 1000);
+        ints_deinit(&greater);
+    }
+
+    // Joining out of order is refused and changes nothing
+    struct avltree_ints low = ints_init(allocator_get_default(), int_cmp);
+    ints_insert(&low, 5);
+    assert(ints_join(&tree, &low) == AVLTREE_ERR_UNSORTED);
+    assert(tree.size == 1000 && low.size == 1);
+    assert(ints_join(&low, &low) == AVLTREE_ERR_NULL);
+
+    // Trees of very different heights
+    struct avltree_ints high = ints_init(allocator_get_default(), int_cmp);
+    ints_insert(&high, 2000);
+    assert(ints_join(&tree, &high) == AVLTREE_OK);
+    ints_remove(&low, 5);
+    ints_insert(&low, -10);
+    assert(ints_join(&low, &tree) == AVLTREE_OK);
+    assert(ints_is_valid(&low) && low.size == 1002);
+    assert(tree.size == 0);
+
+    ints_deinit(&high);
+    ints_deinit(&low);
+    ints_deinit(&tree);
+    printf("test avltree split join scalar type passed\n");
+}
+
+void test_avltree_set_operations_scalar_type(void) {
+    struct Allocator gpa = allocator_get_default();
+    enum { LIMIT = 2000 };
+    static int present_a[LIMIT];
+    static int present_b[LIMIT];
+    static int expected[LIMIT];
+    unsigned int seeds[] = { 1, 7, 12345 };
+    int counts[][2] = { { 1000, 1000 }, { 1500, 20 }, { 5, 1200 }, { 0, 100 } };
+
+    for (size_t s = 0; s < sizeof(seeds) / sizeof(seeds[0]); ++s) {
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+            for (int op = 0; op < 3; ++op) {
+                struct avltree_ints a = ints_init(gpa, int_cmp);
+                struct avltree_ints b = ints_init(gpa, int_cmp);
+                memset(present_a, 0, sizeof(present_a));
+                memset(present_b, 0, sizeof(present_b));
+                ints_fill_random(&a, present_a, seeds[s], counts[c][0], LIMIT);
+                ints_fill_random(&b, present_b, seeds[s] * 31u + 1u, counts[c][1], LIMIT);
+                for (int v = 0; v < LIMIT; ++v) {
+                    if (op == 0) {
+                        expected[v] = present_a[v] || present_b[v];
+                    } else if (op == 1) {
+                        expected[v] = present_a[v] && present_b[v];
+                    } else {
+                        expected[v] = present_a[v] && !present_b[v];
+                    }
+                }
+                enum avltree_error err = op == 0 ? ints_union(&a, &b)
+                    : op == 1                    ? ints_intersection(&a, &b)
+                                                 : ints_difference(&a, &b);
+                assert(err == AVLTREE_OK);
+                assert(ints_matches(&a, expected, LIMIT));
+                assert(b.size == 0 && b.root == NULL);
+                ints_deinit(&a);
+                ints_deinit(&b);
+            }
+        }
+    }
+
+    // Different allocators can not trade nodes
+    struct allocator_stats astats = allocator_stats_init(gpa);
+    struct avltree_ints a = ints_init(gpa, int_cmp);
+    struct avltree_ints b = ints_init(allocator_get_stats(&astats), int_cmp);
+    ints_insert(&a, 1);
+    ints_insert(&b, 2);
+    assert(ints_union(&a, &b) == AVLTREE_ERR_ALLOCATOR);
+    assert(a.size == 1 && b.size == 1);
+    ints_deinit(&a);
+    ints_deinit(&b);
+
+    // Even an empty self would end up holding nodes its allocator does not own
+    a = ints_init(gpa, int_cmp);
+    b = ints_init_pooled(gpa, int_cmp, 16);
+    ints_insert(&b, 2);
+    assert(ints_union(&a, &b) == AVLTREE_ERR_ALLOCATOR);
+    assert(ints_join(&a, &b) == AVLTREE_ERR_ALLOCATOR);
+    assert(a.size == 0 && b.size == 1);
+    assert(ints_join(&b, &a) == AVLTREE_OK && b.size == 1);
+    ints_deinit(&a);
+    ints_deinit(&b);
+    printf("test avltree set operations scalar type passed\n");
+}
+
+void test_avltree_set_operations_ptr(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct Allocator alloc = allocator_get_stats(&astats);
+    struct avltree_intptrs a = intptrs_init(alloc, intptr_cmp);
+    struct avltree_intptrs b = intptrs_init(alloc, intptr_cmp);
+    for (int i = 0; i < 100; ++i) {
+        int *value = alloc.malloc(sizeof(int), alloc.ctx);
+        *value = i;
+        intptrs_insert(&a, value);
+        value = alloc.malloc(sizeof(int), alloc.ctx);
+        *value = i + 50;
+        intptrs_insert(&b, value);
+    }
+    size_t per_element = sizeof(struct avltree_node_intptrs) + sizeof(int);
+    size_t mallocs = astats.malloc_calls;
+
+    // The union relinks, the 50 duplicates of b are destroyed, nothing is allocated
+    assert(intptrs_union(&a, &b) == AVLTREE_OK);
+    assert(a.size == 150);
+    assert(astats.malloc_calls == mallocs);
+    assert(astats.bytes_live == 150 * per_element);
+
+    struct avltree_intptrs high = intptrs_split(&a, &(int){ 100 });
+    assert(a.size == 100 && high.size == 50);
+    assert(intptrs_intersection(&a, &high) == AVLTREE_OK);
+    assert(a.size == 0);
+    assert(astats.bytes_live == 0);
+
+    intptrs_deinit(&high);
+    intptrs_deinit(&a);
+    intptrs_deinit(&b);
+    printf("test avltree set operations ptr passed\n");
+}
+
+// Fails every allocation once budget runs out, to check that a failed batch leaves the tree alone
+struct budget_ctx {
+    size_t budget;
+};
+
+static void *budget_malloc(size_t size, void *ctx) {
+    struct budget_ctx *budget = (struct budget_ctx *)ctx;
+    if (budget->budget == 0) {
+        return NULL;
+    }
+    budget->budget -= 1;
+    return malloc(size);
+}
+
+static void *budget_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    (void)old_size;
+    (void)ctx;
+    return realloc(ptr, new_size);
+}
+
+static void budget_free(void *ptr, size_t size, void *ctx) {
+    (void)size;
+    (void)ctx;
+    free(ptr);
+}
+
+void test_avltree_batch_scalar_type(void) {
+    struct Allocator gpa = allocator_get_default();
+    enum { LIMIT = 3000 };
+    static int present[LIMIT];
+    static int batch[LIMIT];
+    struct avltree_ints tree = ints_init(gpa, int_cmp);
+
+    // Unsorted and repeated values into an empty tree, then sorted ones that are partly in already
+    int mixed[] = { 9, 2, 7, 2, 5, 9, 0 };
+    assert(ints_insert_batch(&tree, mixed, sizeof(mixed) / sizeof(mixed[0])) == AVLTREE_OK);
+    memset(present, 0, sizeof(present));
+    present[0] = present[2] = present[5] = present[7] = present[9] = 1;
+    assert(ints_matches(&tree, present, LIMIT));
+    int sorted[] = { 1, 2, 3, 4, 5 };
+    assert(ints_insert_batch(&tree, sorted, 5) == AVLTREE_OK);
+    present[1] = present[3] = present[4] = 1;
+    assert(ints_matches(&tree, present, LIMIT) && tree.size == 8);
+    int gone[] = { 9, 4, 4, 100, 0 };
+    assert(ints_remove_batch(&tree, gone, 5) == AVLTREE_OK);
+    present[9] = present[4] = present[0] = 0;
+    assert(ints_matches(&tree, present, LIMIT) && tree.size == 5);
+
+    // Batches of every size against a tree of every size, in random order or sorted
+    unsigned int x = 99;
+    for (int round = 0; round < 200; ++round) {
+        x = x * 1103515245u + 12345u;
+        size_t k = (size_t)((x >> 16) % (round % 20 == 0 ? LIMIT : 64));
+        for (size_t i = 0; i < k; ++i) {
+            x = x * 1103515245u + 12345u;
+            batch[i] = (int)((x >> 16) % LIMIT);
+        }
+        if (round % 3 == 0) {
+            for (size_t i = 0; i < k; ++i) {
+                batch[i] = (int)(i * (LIMIT / (k + 1)));
+            }
+        }
+        bool removing = round % 2 == 1;
+        if (removing) {
+            assert(ints_remove_batch(&tree, batch, k) == AVLTREE_OK);
+        } else {
+            assert(ints_insert_batch(&tree, batch, k) == AVLTREE_OK);
+        }
+        for (size_t i = 0; i < k; ++i) {
+            present[batch[i]] = !removing;
+        }
+        assert(ints_matches(&tree, present, LIMIT));
+    }
+
+    assert(ints_insert_batch(&tree, NULL, 0) == AVLTREE_OK);
+    assert(ints_remove_batch(&tree, NULL, 0) == AVLTREE_OK);
+    assert(ints_insert_batch(NULL, batch, 1) == AVLTREE_ERR_NULL);
+    assert(ints_remove_batch(&tree, NULL, 1) == AVLTREE_ERR_NULL);
+    ints_deinit(&tree);
+
+    // An early duplicate does not make the rest of the batch count as sorted
+    tree = ints_init(allocator_get_default(), int_cmp);
+    for (int i = 1; i <= 6; ++i) {
+        assert(ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    int early_duplicate[] = { 5, 5, 3 };
+    assert(ints_remove_batch(&tree, early_duplicate, 3) == AVLTREE_OK);
+    assert(tree.size == 4 && !ints_contains(&tree, 3) && !ints_contains(&tree, 5));
+    assert(ints_is_valid(&tree));
+    int unsorted_duplicate[] = { 1, 1, 0 };
+    assert(ints_build_from_sorted(&tree, unsorted_duplicate, 3) == AVLTREE_ERR_UNSORTED);
+    ints_deinit(&tree);
+
+    // Out of memory part way through, nothing changes, the sorted batch only needs its nodes
+    struct budget_ctx budget = { 0 };
+    struct Allocator limited = { budget_malloc, budget_realloc, budget_free, &budget };
+    tree = ints_init(limited, int_cmp);
+    budget.budget = 3;
+    assert(ints_insert_batch(&tree, sorted, 5) == AVLTREE_ERR_ALLOC);
+    assert(tree.size == 0 && tree.root == NULL);
+    budget.budget = 5;
+    assert(ints_insert_batch(&tree, sorted, 5) == AVLTREE_OK);
+    budget.budget = 1; // the sort buffer, not the nodes
+    assert(ints_insert_batch(&tree, mixed, sizeof(mixed) / sizeof(mixed[0])) == AVLTREE_ERR_ALLOC);
+    assert(tree.size == 5 && ints_is_valid(&tree));
+    budget.budget = 1;
+    assert(ints_remove_batch(&tree, gone, 5) == AVLTREE_OK);
+    assert(ints_remove_batch(&tree, gone, 5) == AVLTREE_ERR_ALLOC);
+    assert(tree.size == 4 && ints_is_valid(&tree) && !ints_contains(&tree, 4));
+    ints_deinit(&tree);
+
+    // A pooled tree takes the sort buffer from the pool too
+    tree = ints_init_pooled(gpa, int_cmp, 64);
+    assert(ints_insert_batch(&tree, mixed, sizeof(mixed) / sizeof(mixed[0])) == AVLTREE_OK);
+    assert(tree.size == 5 && ints_is_valid(&tree));
+    ints_deinit(&tree);
+    printf("test avltree batch scalar type passed\n");
+}
+
+void test_avltree_batch_ptr(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct Allocator alloc = allocator_get_stats(&astats);
+    struct avltree_intptrs tree = intptrs_init(alloc, intptr_cmp);
+    int *values[6];
+    int numbers[] = { 5, 3, 5, 8, 3, 1 };
+    for (int i = 0; i < 6; ++i) {
+        values[i] = alloc.malloc(sizeof(int), alloc.ctx);
+        *values[i] = numbers[i];
+    }
+    assert(intptrs_insert_batch(&tree, (const int **)values, 6) == AVLTREE_OK);
+    assert(tree.size == 4);
+    // The first of the equal values got in, the later ones are still ours
+    assert(*intptrs_find(&tree, values[2]) == values[0]);
+    assert(*intptrs_find(&tree, values[4]) == values[1]);
+    alloc.free(values[2], sizeof(int), alloc.ctx);
+    alloc.free(values[4], sizeof(int), alloc.ctx);
+    assert(astats.bytes_live == 4 * (sizeof(struct avltree_node_intptrs) + sizeof(int)));
+
+    // The keys are only compared against, the elements found are destroyed
+    int key_numbers[] = { 8, 2, 5 };
+    int *keys[] = { &key_numbers[0], &key_numbers[1], &key_numbers[2] };
+    assert(intptrs_remove_batch(&tree, (const int **)keys, 3) == AVLTREE_OK);
+    assert(tree.size == 2);
+    assert(astats.bytes_live == 2 * (sizeof(struct avltree_node_intptrs) + sizeof(int)));
+    intptrs_deinit(&tree);
+    assert(astats.bytes_live == 0);
+    printf("test avltree batch ptr passed\n");
+}
+
+void test_avltree_cmp_scalar_type(void) {
+    struct avltree_intcmp tree = intcmp_init(allocator_get_default());
+    struct avltree_ints reference = ints_init(allocator_get_default(), int_cmp);
+
+    // Same inserts and removes on both trees, they must end up with the same shape
+    const int N = 5000;
+    for (int i = 0; i < N; ++i) {
+        int value = (i * 7919) % N;
+        assert(intcmp_insert(&tree, value) == AVLTREE_OK);
+        assert(ints_insert(&reference, value) == AVLTREE_OK);
+    }
+    assert(intcmp_insert(&tree, 42) == AVLTREE_ERR_DUPLICATE);
+    for (int i = 0; i < N; i += 3) {
+        assert(intcmp_remove(&tree, i) == AVLTREE_OK);
+        assert(ints_remove(&reference, i) == AVLTREE_OK);
+    }
+    assert(tree.size == reference.size);
+    assert(tree.root->data == reference.root->data && tree.root->height == reference.root->height);
+    int *a = intcmp_begin(&tree);
+    int *b = ints_begin(&reference);
+    while (a != NULL && b != NULL) {
+        assert(*a == *b);
+        a = intcmp_next(&tree, a);
+        b = ints_next(&reference, b);
+    }
+    assert(a == NULL && b == NULL);
+
+    // Lookups and bounds
+    assert(intcmp_contains(&tree, 1) && !intcmp_contains(&tree, 3));
+    assert(*intcmp_find(&tree, 4) == 4 && intcmp_find(&tree, 6) == NULL);
+    assert(*intcmp_lower_bound(&tree, 3) == 4);
+    assert(*intcmp_upper_bound(&tree, 4) == 5);
+
+    // Split and join hand the comparator over without a function pointer
+    struct avltree_intcmp greater = intcmp_split(&tree, N / 2);
+    assert(*intcmp_min(&greater) >= N / 2 && *intcmp_max(&tree) < N / 2);
+    assert(intcmp_insert(&greater, N) == AVLTREE_OK);
+    assert(intcmp_join(&tree, &greater) == AVLTREE_OK);
+    assert(tree.size == reference.size + 1 && *intcmp_max(&tree) == N);
+    intcmp_deinit(&greater);
+
+    int batch[] = { 9, 3, 6, N + 1 };
+    assert(intcmp_insert_batch(&tree, batch, 4) == AVLTREE_OK);
+    assert(intcmp_contains(&tree, 3) && intcmp_contains(&tree, N + 1));
+    intcmp_deinit(&tree);
+    ints_deinit(&reference);
+
+    // Pooled version
+    tree = intcmp_init_pooled(allocator_get_default(), 64);
+    for (int i = 0; i < 200; ++i) {
+        assert(intcmp_insert(&tree, 199 - i) == AVLTREE_OK);
+    }
+    assert(tree.size == 200 && *intcmp_min(&tree) == 0);
+    intcmp_deinit(&tree);
+    printf("test avltree cmp scalar type passed\n");
+}
+
+void test_avltree_arraylist_transfer_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    struct arraylist_intlist list = intlist_init(allocator_get_default());
+
+    // Unsorted with repeats into an empty tree, the repeats are all that stays in the list
+    const int N = 1000;
+    for (int i = 0; i < N; ++i) {
+        assert(intlist_push_back(&list, (i * 7919) % N) == ARRAYLIST_OK);
+    }
+    int repeats[] = { 5, 5, 999, 0 };
+    for (int i = 0; i < 4; ++i) {
+        assert(intlist_push_back(&list, repeats[i]) == ARRAYLIST_OK);
+    }
+    assert(ints_steal_from_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == (size_t)N && ints_is_valid(&tree));
+    assert(list.size == 4);
+    assert(list.data[0] == 0 && list.data[1] == 5 && list.data[2] == 5 && list.data[3] == 999);
+
+    // An early duplicate followed by smaller values must still be sorted before it is linked in
+    struct avltree_ints shuffled = ints_init(allocator_get_default(), int_cmp);
+    struct arraylist_intlist unsorted = intlist_init(allocator_get_default());
+    int with_duplicate[] = { 2, 2, 9, 1, 5 };
+    for (int i = 0; i < 5; ++i) {
+        assert(intlist_push_back(&unsorted, with_duplicate[i]) == ARRAYLIST_OK);
+    }
+    assert(ints_steal_from_arraylist(&shuffled, &unsorted) == AVLTREE_OK);
+    assert(shuffled.size == 4 && ints_is_valid(&shuffled));
+    assert(unsorted.size == 1 && unsorted.data[0] == 2);
+    int in_order[] = { 1, 2, 5, 9 };
+    int *it = ints_begin(&shuffled);
+    for (int i = 0; i < 4; ++i) {
+        assert(it != NULL && *it == in_order[i]);
+        assert(*ints_find(&shuffled, in_order[i]) == in_order[i]);
+        it = ints_next(&shuffled, it);
+    }
+    assert(it == NULL);
+    intlist_deinit(&unsorted);
+    ints_deinit(&shuffled);
+
+    // Already sorted into a non-empty tree, some of them are there already
+    intlist_clear(&list);
+    for (int i = N - 10; i < N + 10; ++i) {
+        assert(intlist_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    assert(ints_steal_from_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == (size_t)N + 10 && ints_is_valid(&tree));
+    assert(list.size == 10);
+    for (size_t i = 0; i < list.size; ++i) {
+        assert(list.data[i] == N - 10 + (int)i);
+    }
+
+    // Sorted and all new, the list is loaded as it is
+    intlist_clear(&list);
+    for (int i = N + 10; i < N + 20; ++i) {
+        assert(intlist_push_back(&list, i) == ARRAYLIST_OK);
+    }
+    assert(ints_steal_from_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == (size_t)N + 20 && list.size == 0 && ints_is_valid(&tree));
+    assert(ints_steal_from_arraylist(&tree, &list) == AVLTREE_OK);
+
+    // Drain appends in order and leaves the tree empty and usable
+    assert(intlist_push_back(&list, -1) == ARRAYLIST_OK);
+    assert(ints_drain_to_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == 0 && tree.root == NULL);
+    assert(list.size == (size_t)N + 21 && list.data[0] == -1);
+    for (size_t i = 1; i < list.size; ++i) {
+        assert(list.data[i] == (int)i - 1);
+    }
+    assert(ints_insert(&tree, 7) == AVLTREE_OK && ints_drain_to_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(list.size == (size_t)N + 22 && list.data[list.size - 1] == 7);
+    ints_deinit(&tree);
+
+    // A pooled tree gives its chunks back at once
+    tree = ints_init_pooled(allocator_get_default(), int_cmp, 64);
+    intlist_clear(&list);
+    for (int i = 0; i < 500; ++i) {
+        assert(intlist_push_back(&list, 499 - i) == ARRAYLIST_OK);
+    }
+    assert(ints_steal_from_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == 500 && list.size == 0 && ints_is_valid(&tree));
+    assert(ints_drain_to_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == 0 && list.size == 500 && list.data[0] == 0 && list.data[499] == 499);
+    assert(ints_insert(&tree, 1) == AVLTREE_OK && tree.size == 1);
+    ints_deinit(&tree);
+
+    assert(ints_drain_to_arraylist(NULL, &list) == AVLTREE_ERR_NULL);
+    assert(ints_steal_from_arraylist(&tree, NULL) == AVLTREE_ERR_NULL);
+    intlist_deinit(&list);
+    printf("test avltree arraylist transfer scalar type passed\n");
+}
+
+void test_avltree_arraylist_transfer_pair(void) {
+    struct avltree_owneds tree = owneds_init(allocator_get_default(), owned_cmp_first);
+    struct arraylist_ownedlist list = ownedlist_init(allocator_get_default());
+
+    // Ownership of the heap ints moves with the pairs, only one container ever destroys them
+    for (int i = 0; i < 100; ++i) {
+        assert(ownedlist_push_back(&list, owned_make(99 - i, i)) == ARRAYLIST_OK);
+    }
+    assert(ownedlist_push_back(&list, owned_make(50, -1)) == ARRAYLIST_OK);
+    assert(owneds_steal_from_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == 100 && list.size == 1);
+    // The first of equal keys wins, like insert
+    assert(list.data[0].first == 50 && *list.data[0].second == -1);
+    struct pair_owned key = { 50, NULL };
+    assert(*owneds_find(&tree, key)->second == 49);
+    ownedlist_clear(&list);
+
+    assert(owneds_drain_to_arraylist(&tree, &list) == AVLTREE_OK);
+    assert(tree.size == 0 && list.size == 100);
+    for (size_t i = 0; i < list.size; ++i) {
+        assert(list.data[i].first == (int)i && *list.data[i].second == 99 - (int)i);
+    }
+    owneds_deinit(&tree);
+    ownedlist_deinit(&list);
+    printf("test avltree arraylist transfer pair passed\n");
+}
+
+int main(void) {
+    test_avltree_insert_balance_scalar_type();
+    test_avltree_random_insert_remove_scalar_type();
+    test_avltree_find_scalar_type();
+    test_avltree_bounds_scalar_type();
+    test_avltree_pooled_scalar_type();
+    test_avltree_pooled_ptr();
+    test_avltree_build_from_sorted_scalar_type();
+    test_avltree_build_from_sorted_ptr();
+    test_avltree_iterate_scalar_type();
+    test_avltree_split_join_scalar_type();
+    test_avltree_set_operations_scalar_type();
+    test_avltree_set_operations_ptr();
+    test_avltree_batch_scalar_type();
+    test_avltree_batch_ptr();
+    test_avltree_cmp_scalar_type();
+    test_avltree_arraylist_transfer_scalar_type();
+    test_avltree_arraylist_transfer_pair();
+    return 0;
+}
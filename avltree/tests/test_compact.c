@@ -0,0 +1,234 @@
+/**
+ * @file test_compact.c
+ * @brief Unit tests for the avltree.h file built with AVLTREE_COMPACT_NODES (small height, no parent)
+ */
+#define AVLTREE_COMPACT_NODES
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "avltree.h"
+
+AVLTREE_TYPE(int, ints)
+AVLTREE_DECL(int, ints)
+AVLTREE_IMPL(int, ints, avltree_noop_deinit)
+
+static int int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+static size_t global_destructor_counter_avltree = 0;
+
+static void intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+    global_destructor_counter_avltree++;
+}
+
+AVLTREE_TYPE(int *, intptrs)
+AVLTREE_DECL(int *, intptrs)
+AVLTREE_IMPL(int *, intptrs, intptr_deinit)
+
+static int intptr_cmp(int **a, int **b) {
+    return (**a > **b) - (**a < **b);
+}
+
+// Checks ordering and stored heights, returns the height of the subtree (-1 on failure)
+static int ints_check_subtree(struct avltree_node_ints *node, size_t *count) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->left != NULL && node->left->data >= node->data) {
+        return -1;
+    }
+    if (node->right != NULL && node->right->data <= node->data) {
+        return -1;
+    }
+    int lh = ints_check_subtree(node->left, count);
+    int rh = ints_check_subtree(node->right, count);
+    if (lh < 0 || rh < 0 || lh - rh > 1 || rh - lh > 1) {
+        return -1;
+    }
+    int h = 1 + (lh > rh ? lh : rh);
+    if (h != node->height) {
+        return -1;
+    }
+    *count += 1;
+    return h;
+}
+
+static int ints_is_valid(struct avltree_ints *tree) {
+    size_t count = 0;
+    int h = ints_check_subtree(tree->root, &count);
+    return h >= 0 && count == tree->size;
+}
+
+struct range_collect {
+    int out[64];
+    size_t count;
+    size_t limit;
+};
+static bool collect_range(int *elem, void *ctx) {
+    struct range_collect *c = ctx;
+    if (c->count == c->limit) {
+        return false;
+    }
+    c->out[c->count++] = *elem;
+    return true;
+}
+
+void test_avltree_compact_layout(void) {
+    struct avltree_node_ints node;
+    assert(sizeof(node.height) == 1);
+    // data, height and the two child pointers, no parent
+    assert(sizeof(struct avltree_node_ints) <= 2 * sizeof(void *) + 2 * sizeof(int));
+    printf("test avltree compact layout passed\n");
+}
+
+void test_avltree_compact_insert_remove_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+
+    for (int i = 0; i < 4096; ++i) {
+        assert(ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(ints_is_valid(&tree));
+    assert(tree.root->height <= 18);
+    assert(ints_insert(&tree, 10) == AVLTREE_ERR_DUPLICATE);
+
+    // Remove every other element, exercising the two-children path
+    for (int i = 0; i < 4096; i += 2) {
+        assert(ints_remove(&tree, i) == AVLTREE_OK);
+    }
+    assert(ints_is_valid(&tree));
+    assert(tree.size == 2048);
+    assert(ints_remove(&tree, 0) == AVLTREE_OK);
+    assert(tree.size == 2048);
+
+    // Pseudo random order, the descent paths go both ways
+    ints_clear(&tree);
+    unsigned int x = 12345;
+    for (int i = 0; i < 2000; ++i) {
+        x = x * 1103515245u + 12345u;
+        ints_insert(&tree, (int)((x >> 16) % 1000));
+        x = x * 1103515245u + 12345u;
+        ints_remove(&tree, (int)((x >> 16) % 1000));
+        if (i % 100 == 0) {
+            assert(ints_is_valid(&tree));
+        }
+    }
+    assert(ints_is_valid(&tree));
+    for (int v = 0; v < 1000; ++v) {
+        int *found = ints_find(&tree, v);
+        assert(found == NULL || *found == v);
+    }
+
+    ints_deinit(&tree);
+    printf("test avltree compact insert remove scalar type passed\n");
+}
+
+void test_avltree_compact_ptr(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct avltree_intptrs tree = intptrs_init(gpa, intptr_cmp);
+    global_destructor_counter_avltree = 0;
+
+    for (int i = 0; i < 100; ++i) {
+        int *value = gpa.malloc(sizeof(int), gpa.ctx);
+        *value = (i * 37) % 100;
+        assert(intptrs_insert(&tree, value) == AVLTREE_OK);
+    }
+    int key = 50;
+    int *key_ptr = &key;
+    assert(**intptrs_find(&tree, key_ptr) == 50);
+    assert(intptrs_remove(&tree, key_ptr) == AVLTREE_OK);
+    assert(global_destructor_counter_avltree == 1);
+    assert(intptrs_find(&tree, key_ptr) == NULL);
+
+    intptrs_clear(&tree);
+    assert(global_destructor_counter_avltree == 100);
+    assert(tree.root == NULL && tree.size == 0);
+
+    for (int i = 0; i < 10; ++i) {
+        int *value = gpa.malloc(sizeof(int), gpa.ctx);
+        *value = i;
+        assert(intptrs_insert(&tree, value) == AVLTREE_OK);
+    }
+    intptrs_deinit(&tree);
+    assert(global_destructor_counter_avltree == 110);
+    printf("test avltree compact ptr passed\n");
+}
+
+void test_avltree_compact_iterate_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    assert(ints_begin(&tree) == NULL);
+    for (int i = 0; i < 500; ++i) {
+        ints_insert(&tree, (i * 7) % 500);
+    }
+
+    int expected = 0;
+    for (int *it = ints_begin(&tree); it != NULL; it = ints_next(&tree, it)) {
+        assert(*it == expected);
+        expected++;
+    }
+    assert(expected == 500);
+    for (int *it = ints_max(&tree); it != NULL; it = ints_prev(&tree, it)) {
+        expected--;
+        assert(*it == expected);
+    }
+    assert(expected == 0);
+
+    // Iterators come from the lookups too
+    int *it = ints_find(&tree, 250);
+    assert(*ints_next(&tree, it) == 251 && *ints_prev(&tree, it) == 249);
+
+    struct range_collect c = { .count = 0, .limit = 64 };
+    assert(ints_for_each_range(&tree, 10, 20, collect_range, &c) == 10);
+    for (size_t i = 0; i < c.count; ++i) {
+        assert(c.out[i] == 10 + (int)i);
+    }
+    // Bounds that are not keys, empty ranges and the callback stopping the scan
+    ints_remove(&tree, 30);
+    c.count = 0;
+    assert(ints_for_each_range(&tree, 29, 32, collect_range, &c) == 2);
+    assert(c.out[0] == 29 && c.out[1] == 31);
+    c.count = 0;
+    assert(ints_for_each_range(&tree, 20, 20, collect_range, &c) == 0);
+    assert(ints_for_each_range(&tree, 600, 700, collect_range, &c) == 0);
+    c.limit = 3;
+    assert(ints_for_each_range(&tree, 0, 500, collect_range, &c) == 4);
+    assert(c.count == 3);
+
+    ints_deinit(&tree);
+    printf("test avltree compact iterate scalar type passed\n");
+}
+
+void test_avltree_compact_set_operations_scalar_type(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct avltree_ints a = ints_init(gpa, int_cmp);
+    struct avltree_ints b = ints_init(gpa, int_cmp);
+    for (int i = 0; i < 600; ++i) {
+        ints_insert(&a, i * 2);
+        ints_insert(&b, i * 3);
+    }
+    assert(ints_union(&a, &b) == AVLTREE_OK);
+    assert(ints_is_valid(&a));
+    assert(a.size == 600 + 400);
+    struct avltree_ints high = ints_split(&a, 900);
+    assert(ints_is_valid(&a) && ints_is_valid(&high));
+    assert(*ints_min(&high) == 900 && *ints_max(&a) == 898);
+    assert(ints_difference(&high, &a) == AVLTREE_OK);
+    assert(ints_is_valid(&high) && a.size == 0);
+    ints_deinit(&high);
+    ints_deinit(&a);
+    ints_deinit(&b);
+    printf("test avltree compact set operations scalar type passed\n");
+}
+
+int main(void) {
+    test_avltree_compact_layout();
+    test_avltree_compact_insert_remove_scalar_type();
+    test_avltree_compact_ptr();
+    test_avltree_compact_iterate_scalar_type();
+    test_avltree_compact_set_operations_scalar_type();
+    return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file test_concurrent.c
+ * @brief Unit tests for the AVLTREE_CONCURRENT version of avltree.h (a tree behind a pthread rwlock),
+ *        they only run when the build defines AVLTREE_PTHREAD
+ */
+#ifdef AVLTREE_PTHREAD
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "avltree.h"
+
+#ifdef AVLTREE_PTHREAD
+AVLTREE_TYPE(int, ints)
+AVLTREE_DECL(int, ints)
+AVLTREE_IMPL(int, ints, avltree_noop_deinit)
+AVLTREE_TYPE_CONCURRENT(int, ints)
+AVLTREE_DECL_CONCURRENT(int, ints)
+AVLTREE_IMPL_CONCURRENT(int, ints)
+
+static int int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+static bool count_elem(int *elem, void *ctx) {
+    (void)elem;
+    (*(size_t *)ctx)++;
+    return true;
+}
+
+// Checks ordering and heights of the whole tree, returns the height of the subtree (-1 on failure)
+static int ints_check_subtree(const struct avltree_node_ints *node, size_t *count) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->left != NULL && node->left->data >= node->data) {
+        return -1;
+    }
+    if (node->right != NULL && node->right->data <= node->data) {
+        return -1;
+    }
+    int left = ints_check_subtree(node->left, count);
+    int right = ints_check_subtree(node->right, count);
+    if (left < 0 || right < 0 || left - right > 1 || right - left > 1) {
+        return -1;
+    }
+    *count += 1;
+    return (left > right ? left : right) + 1;
+}
+
+static void check_tree(const struct avltree_ints *tree, void *ctx) {
+    size_t count = 0;
+    *(bool *)ctx = ints_check_subtree(tree->root, &count) >= 0 && count == tree->size;
+}
+
+struct swap_args {
+    int from;
+    int to;
+    bool moved;
+};
+
+// remove + insert as one step, no reader sees the tree without either
+static void swap_key(struct avltree_ints *tree, void *ctx) {
+    struct swap_args *args = (struct swap_args *)ctx;
+    args->moved = ints_remove(tree, args->from) == AVLTREE_OK && ints_insert(tree, args->to) == AVLTREE_OK;
+}
+
+void test_avltree_concurrent_api_scalar_type(void) {
+    struct avltree_conc_ints tree;
+    assert(conc_ints_init(&tree, allocator_get_default(), int_cmp) == AVLTREE_OK);
+    assert(conc_ints_size(&tree) == 0);
+    int out = -1;
+    assert(!conc_ints_min(&tree, &out) && out == -1);
+    assert(!conc_ints_find(&tree, 1, &out));
+
+    for (int i = 0; i < 100; ++i) {
+        assert(conc_ints_insert(&tree, i * 2) == AVLTREE_OK);
+    }
+    assert(conc_ints_insert(&tree, 10) == AVLTREE_ERR_DUPLICATE);
+    assert(conc_ints_size(&tree) == 100);
+    assert(conc_ints_find(&tree, 42, &out) && out == 42);
+    assert(conc_ints_find(&tree, 42, NULL));
+    assert(!conc_ints_find(&tree, 43, &out) && out == 42);
+    assert(conc_ints_contains(&tree, 198) && !conc_ints_contains(&tree, 199));
+    assert(conc_ints_lower_bound(&tree, 43, &out) && out == 44);
+    assert(conc_ints_upper_bound(&tree, 44, &out) && out == 46);
+    assert(conc_ints_floor(&tree, 43, &out) && out == 42);
+    assert(conc_ints_ceil(&tree, 43, &out) && out == 44);
+    assert(!conc_ints_upper_bound(&tree, 198, &out));
+    assert(!conc_ints_floor(&tree, -1, &out));
+    assert(conc_ints_min(&tree, &out) && out == 0);
+    assert(conc_ints_max(&tree, &out) && out == 198);
+    size_t visited = 0;
+    assert(conc_ints_for_each_range(&tree, 10, 20, count_elem, &visited) == 5 && visited == 5);
+
+    struct swap_args args = { 42, 43, false };
+    assert(conc_ints_write(&tree, swap_key, &args) == AVLTREE_OK && args.moved);
+    assert(!conc_ints_contains(&tree, 42) && conc_ints_contains(&tree, 43));
+    bool valid = false;
+    assert(conc_ints_read(&tree, check_tree, &valid) == AVLTREE_OK && valid);
+
+    assert(conc_ints_remove(&tree, 43) == AVLTREE_OK);
+    assert(conc_ints_size(&tree) == 99);
+    conc_ints_clear(&tree);
+    assert(conc_ints_size(&tree) == 0);
+
+    const int sorted[] = { 1, 3, 5, 7 };
+    assert(conc_ints_build_from_sorted(&tree, sorted, 4) == AVLTREE_OK);
+    assert(conc_ints_max(&tree, &out) && out == 7);
+
+    assert(conc_ints_insert(NULL, 1) == AVLTREE_ERR_NULL);
+    assert(conc_ints_read(&tree, NULL, NULL) == AVLTREE_ERR_NULL);
+    assert(conc_ints_write(NULL, swap_key, &args) == AVLTREE_ERR_NULL);
+    assert(!conc_ints_contains(NULL, 1));
+    assert(conc_ints_size(NULL) == 0);
+    conc_ints_deinit(&tree);
+    conc_ints_deinit(NULL);
+
+    assert(conc_ints_init(&tree, allocator_get_default(), NULL) == AVLTREE_ERR_NULL);
+    assert(conc_ints_init_pooled(&tree, allocator_get_default(), int_cmp, 64) == AVLTREE_OK);
+    assert(tree.tree.node_pool != NULL);
+    for (int i = 0; i < 1000; ++i) {
+        assert(conc_ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(conc_ints_size(&tree) == 1000);
+    conc_ints_deinit(&tree);
+    printf("test avltree concurrent api scalar-type passed\n");
+}
+
+#define CONC_KEYS 4096
+#define CONC_READERS 4
+#define CONC_ROUNDS 20000
+
+struct conc_shared {
+    struct avltree_conc_ints *tree;
+    unsigned int seed;
+    int writer;
+    size_t hits;
+    bool failed;
+};
+
+// Even keys are never touched by the writers, so every reader must always see all of them
+static void *reader_thread(void *arg) {
+    struct conc_shared *shared = (struct conc_shared *)arg;
+    unsigned int seed = shared->seed;
+    for (int round = 0; round < CONC_ROUNDS; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        int key = (int)((seed >> 8) % CONC_KEYS) & ~1;
+        int out = -1;
+        if (!conc_ints_find(shared->tree, key, &out) || out != key) {
+            shared->failed = true;
+        }
+        if (conc_ints_contains(shared->tree, key + 1)) {
+            shared->hits++;
+        }
+        if (round % 512 == 0) {
+            size_t visited = 0;
+            conc_ints_for_each_range(shared->tree, 0, CONC_KEYS, count_elem, &visited);
+            bool valid = false;
+            conc_ints_read(shared->tree, check_tree, &valid);
+            if (visited < CONC_KEYS / 2 || !valid) {
+                shared->failed = true;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Inserts and removes the odd keys while the readers run, each writer has every other one of them
+static void *writer_thread(void *arg) {
+    struct conc_shared *shared = (struct conc_shared *)arg;
+    for (int round = 0; round < CONC_ROUNDS / 4; ++round) {
+        int key = 4 * (round % (CONC_KEYS / 4)) + 2 * shared->writer + 1;
+        if (conc_ints_insert(shared->tree, key) == AVLTREE_OK) {
+            continue;
+        }
+        if (conc_ints_remove(shared->tree, key) != AVLTREE_OK) {
+            shared->failed = true;
+        }
+    }
+    return NULL;
+}
+
+void test_avltree_concurrent_readers_and_writers(void) {
+    struct avltree_conc_ints tree;
+    assert(conc_ints_init(&tree, allocator_get_default(), int_cmp) == AVLTREE_OK);
+    for (int key = 0; key < CONC_KEYS; key += 2) {
+        assert(conc_ints_insert(&tree, key) == AVLTREE_OK);
+    }
+    pthread_t threads[CONC_READERS + 2];
+    struct conc_shared shared[CONC_READERS + 2];
+    for (size_t i = 0; i < CONC_READERS + 2; ++i) {
+        shared[i].tree = &tree;
+        shared[i].seed = (unsigned int)(i * 7919 + 1);
+        shared[i].writer = (int)i - CONC_READERS;
+        shared[i].hits = 0;
+        shared[i].failed = false;
+        void *(*fn)(void *) = i < CONC_READERS ? reader_thread : writer_thread;
+        assert(pthread_create(&threads[i], NULL, fn, &shared[i]) == 0);
+    }
+    for (size_t i = 0; i < CONC_READERS + 2; ++i) {
+        assert(pthread_join(threads[i], NULL) == 0);
+        assert(!shared[i].failed);
+    }
+    bool valid = false;
+    assert(conc_ints_read(&tree, check_tree, &valid) == AVLTREE_OK && valid);
+    for (int key = 0; key < CONC_KEYS; key += 2) {
+        assert(conc_ints_contains(&tree, key));
+    }
+    conc_ints_deinit(&tree);
+    printf("test avltree concurrent readers and writers passed\n");
+}
+#endif // AVLTREE_PTHREAD
+
+int main(void) {
+#ifdef AVLTREE_PTHREAD
+    test_avltree_concurrent_api_scalar_type();
+    test_avltree_concurrent_readers_and_writers();
+#endif
+    return 0;
+}
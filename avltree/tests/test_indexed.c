@@ -0,0 +1,363 @@
+/**
+ * @file test_indexed.c
+ * @brief Unit tests for the AVLTREE_INDEXED version of avltree.h (nodes in an arraylist, 32-bit indices)
+ */
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "avltree.h"
+
+AVLTREE_TYPE_INDEXED(int, ints)
+AVLTREE_DECL_INDEXED(int, ints)
+AVLTREE_IMPL_INDEXED(int, ints, avltree_noop_deinit)
+
+static int int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+static int int_construct(int *location, void *args, struct Allocator *alloc) {
+    (void)alloc;
+    *location = *(int *)args;
+    return 0;
+}
+
+static size_t global_destructor_counter_avltree = 0;
+
+static void intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+    global_destructor_counter_avltree++;
+}
+
+static void intptr_clone(int **dst, int **src, struct Allocator *alloc) {
+    *dst = alloc->malloc(sizeof(int), alloc->ctx);
+    **dst = **src;
+}
+
+AVLTREE_TYPE_INDEXED(int *, intptrs)
+AVLTREE_DECL_INDEXED(int *, intptrs)
+AVLTREE_IMPL_INDEXED(int *, intptrs, intptr_deinit)
+
+static int intptr_cmp(int **a, int **b) {
+    return (**a > **b) - (**a < **b);
+}
+
+// Checks ordering and stored heights, returns the height of the subtree (-1 on failure)
+static int ints_check_subtree(const struct avltree_idx_ints *tree, uint32_t i, size_t *count) {
+    if (i == AVLTREE_IDX_NIL) {
+        return 0;
+    }
+    const struct avltree_idx_node_ints *node = &tree->nodes.data[i];
+    if (node->height == 0) {
+        return -1;
+    }
+    if (node->left != AVLTREE_IDX_NIL && tree->nodes.data[node->left].data >= node->data) {
+        return -1;
+    }
+    if (node->right != AVLTREE_IDX_NIL && tree->nodes.data[node->right].data <= node->data) {
+        return -1;
+    }
+    int lh = ints_check_subtree(tree, node->left, count);
+    int rh = ints_check_subtree(tree, node->right, count);
+    if (lh < 0 || rh < 0 || lh - rh > 1 || rh - lh > 1) {
+        return -1;
+    }
+    int h = 1 + (lh > rh ? lh : rh);
+    if (h != node->height) {
+        return -1;
+    }
+    *count += 1;
+    return h;
+}
+
+// Every slot is either reachable from the root or on the free list
+static int ints_is_valid(const struct avltree_idx_ints *tree) {
+    size_t count = 0;
+    int h = ints_check_subtree(tree, tree->root, &count);
+    size_t free_slots = 0;
+    for (uint32_t i = tree->free_head; i != AVLTREE_IDX_NIL; i = tree->nodes.data[i].left) {
+        if (tree->nodes.data[i].height != 0) {
+            return 0;
+        }
+        free_slots++;
+    }
+    return h >= 0 && count == tree->size && count + free_slots == tree->nodes.size;
+}
+
+struct range_collect {
+    int out[64];
+    size_t count;
+    size_t limit;
+};
+static bool collect_range(int *elem, void *ctx) {
+    struct range_collect *c = ctx;
+    if (c->count == c->limit) {
+        return false;
+    }
+    c->out[c->count++] = *elem;
+    return true;
+}
+
+void test_avltree_indexed_insert_remove_scalar_type(void) {
+    struct avltree_idx_ints tree = idx_ints_init(allocator_get_default(), int_cmp);
+    assert(idx_ints_min(&tree) == NULL);
+    assert(idx_ints_remove(&tree, 1) == AVLTREE_OK);
+
+    for (int i = 0; i < 4096; ++i) {
+        assert(idx_ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(ints_is_valid(&tree));
+    assert(tree.nodes.data[tree.root].height <= 18);
+    assert(idx_ints_insert(&tree, 10) == AVLTREE_ERR_DUPLICATE);
+    assert(tree.size == 4096);
+
+    // Remove every other element, exercising the two-children path
+    for (int i = 0; i < 4096; i += 2) {
+        assert(idx_ints_remove(&tree, i) == AVLTREE_OK);
+    }
+    assert(ints_is_valid(&tree));
+    assert(tree.size == 2048);
+    assert(!idx_ints_contains(&tree, 0));
+    assert(idx_ints_contains(&tree, 1));
+
+    // Pseudo random order, the descent paths go both ways
+    idx_ints_clear(&tree);
+    assert(tree.size == 0 && tree.root == AVLTREE_IDX_NIL);
+    unsigned int x = 12345;
+    for (int i = 0; i < 2000; ++i) {
+        x = x * 1103515245u + 12345u;
+        idx_ints_insert(&tree, (int)((x >> 16) % 1000));
+        x = x * 1103515245u + 12345u;
+        idx_ints_remove(&tree, (int)((x >> 16) % 1000));
+        if (i % 100 == 0) {
+            assert(ints_is_valid(&tree));
+        }
+    }
+    assert(ints_is_valid(&tree));
+    for (int v = 0; v < 1000; ++v) {
+        int *found = idx_ints_find(&tree, v);
+        assert(found == NULL || *found == v);
+    }
+
+    idx_ints_deinit(&tree);
+    printf("test avltree indexed insert remove scalar type passed\n");
+}
+
+void test_avltree_indexed_free_list_scalar_type(void) {
+    struct avltree_idx_ints tree = idx_ints_init(allocator_get_default(), int_cmp);
+    assert(idx_ints_reserve(&tree, 64) == AVLTREE_OK);
+    struct avltree_idx_node_ints *buffer = tree.nodes.data;
+    for (int i = 0; i < 64; ++i) {
+        assert(idx_ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    // Reserved up front, nothing moved
+    assert(tree.nodes.data == buffer);
+    assert(tree.nodes.size == 64);
+
+    for (int i = 0; i < 32; ++i) {
+        assert(idx_ints_remove(&tree, i * 2) == AVLTREE_OK);
+    }
+    assert(tree.free_head != AVLTREE_IDX_NIL);
+    assert(ints_is_valid(&tree));
+
+    // The removed slots are reused before the arraylist grows
+    for (int i = 100; i < 132; ++i) {
+        assert(idx_ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(tree.nodes.size == 64);
+    assert(tree.free_head == AVLTREE_IDX_NIL);
+    assert(ints_is_valid(&tree));
+
+    // A failed emplace gives its slot back
+    int dup = 101;
+    assert(idx_ints_emplace(&tree, int_construct, &dup) == NULL);
+    assert(tree.free_head != AVLTREE_IDX_NIL);
+    assert(tree.size == 64);
+    int fresh = 200;
+    assert(*idx_ints_emplace(&tree, int_construct, &fresh) == 200);
+    assert(tree.nodes.size == 65);
+    assert(ints_is_valid(&tree));
+
+    idx_ints_deinit(&tree);
+    printf("test avltree indexed free list scalar type passed\n");
+}
+
+void test_avltree_indexed_bounds_scalar_type(void) {
+    struct avltree_idx_ints tree = idx_ints_init(allocator_get_default(), int_cmp);
+    for (int i = 0; i < 10; ++i) {
+        idx_ints_insert(&tree, i * 10);
+    }
+    assert(*idx_ints_lower_bound(&tree, 25) == 30);
+    assert(*idx_ints_lower_bound(&tree, 30) == 30);
+    assert(*idx_ints_upper_bound(&tree, 30) == 40);
+    assert(idx_ints_upper_bound(&tree, 90) == NULL);
+    assert(*idx_ints_floor(&tree, 25) == 20);
+    assert(*idx_ints_floor(&tree, 20) == 20);
+    assert(idx_ints_floor(&tree, -1) == NULL);
+    assert(*idx_ints_ceil(&tree, 81) == 90);
+    assert(*idx_ints_min(&tree) == 0);
+    assert(*idx_ints_max(&tree) == 90);
+    idx_ints_deinit(&tree);
+    printf("test avltree indexed bounds scalar type passed\n");
+}
+
+void test_avltree_indexed_deep_clone_scalar_type(void) {
+    struct avltree_idx_ints tree = idx_ints_init(allocator_get_default(), int_cmp);
+    for (int i = 0; i < 100; ++i) {
+        idx_ints_insert(&tree, (i * 37) % 100);
+    }
+    idx_ints_remove(&tree, 5);
+
+    // A plain copy, same slots, same shape, independent buffer
+    struct avltree_idx_ints clone = idx_ints_deep_clone(&tree, NULL);
+    assert(clone.size == tree.size);
+    assert(clone.root == tree.root && clone.free_head == tree.free_head);
+    assert(clone.nodes.data != tree.nodes.data);
+    assert(ints_is_valid(&clone));
+
+    idx_ints_remove(&clone, 50);
+    assert(idx_ints_contains(&tree, 50));
+    assert(!idx_ints_contains(&clone, 50));
+    idx_ints_insert(&clone, 5);
+    assert(!idx_ints_contains(&tree, 5));
+
+    idx_ints_deinit(&clone);
+    idx_ints_deinit(&tree);
+
+    struct avltree_idx_ints empty = idx_ints_init(allocator_get_default(), int_cmp);
+    struct avltree_idx_ints empty_clone = idx_ints_deep_clone(&empty, NULL);
+    assert(empty_clone.size == 0 && empty_clone.root == AVLTREE_IDX_NIL);
+    assert(idx_ints_insert(&empty_clone, 1) == AVLTREE_OK);
+    idx_ints_deinit(&empty_clone);
+    idx_ints_deinit(&empty);
+    printf("test avltree indexed deep clone scalar type passed\n");
+}
+
+void test_avltree_indexed_ptr(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct avltree_idx_intptrs tree = idx_intptrs_init(gpa, intptr_cmp);
+    global_destructor_counter_avltree = 0;
+
+    for (int i = 0; i < 100; ++i) {
+        int *value = gpa.malloc(sizeof(int), gpa.ctx);
+        *value = (i * 37) % 100;
+        assert(idx_intptrs_insert(&tree, value) == AVLTREE_OK);
+    }
+    int key = 50;
+    int *key_ptr = &key;
+    assert(**idx_intptrs_find(&tree, key_ptr) == 50);
+    assert(idx_intptrs_remove(&tree, key_ptr) == AVLTREE_OK);
+    assert(global_destructor_counter_avltree == 1);
+    assert(idx_intptrs_find(&tree, key_ptr) == NULL);
+
+    // The clone owns its own elements, the free slot is not cloned
+    struct avltree_idx_intptrs clone = idx_intptrs_deep_clone(&tree, intptr_clone);
+    assert(clone.size == 99);
+    key = 51;
+    assert(*idx_intptrs_find(&clone, key_ptr) != *idx_intptrs_find(&tree, key_ptr));
+    idx_intptrs_deinit(&clone);
+    assert(global_destructor_counter_avltree == 100);
+
+    idx_intptrs_clear(&tree);
+    assert(global_destructor_counter_avltree == 199);
+    assert(tree.root == AVLTREE_IDX_NIL && tree.size == 0);
+
+    for (int i = 0; i < 10; ++i) {
+        int *value = gpa.malloc(sizeof(int), gpa.ctx);
+        *value = i;
+        assert(idx_intptrs_insert(&tree, value) == AVLTREE_OK);
+    }
+    idx_intptrs_deinit(&tree);
+    assert(global_destructor_counter_avltree == 209);
+    printf("test avltree indexed ptr passed\n");
+}
+
+void test_avltree_indexed_build_from_sorted_scalar_type(void) {
+    struct avltree_idx_ints tree = idx_ints_init(allocator_get_default(), int_cmp);
+    int data[1000];
+    for (int i = 0; i < 1000; ++i) {
+        data[i] = i * 2;
+    }
+    for (size_t n = 0; n <= 70; ++n) {
+        assert(idx_ints_build_from_sorted(&tree, data, n) == AVLTREE_OK);
+        assert(ints_is_valid(&tree));
+    }
+
+    assert(idx_ints_build_from_sorted(&tree, data, 1000) == AVLTREE_OK);
+    assert(ints_is_valid(&tree));
+    assert(tree.nodes.data[tree.root].height == 10);
+    // Slots are in key order, nothing is on the free list
+    for (size_t i = 0; i < 1000; ++i) {
+        assert(tree.nodes.data[i].data == (int)i * 2);
+    }
+    assert(tree.free_head == AVLTREE_IDX_NIL);
+
+    int unsorted[] = { 5, 4 };
+    assert(idx_ints_build_from_sorted(&tree, unsorted, 2) == AVLTREE_ERR_UNSORTED);
+    int unsorted_duplicate[] = { 1, 1, 0 };
+    assert(idx_ints_build_from_sorted(&tree, unsorted_duplicate, 3) == AVLTREE_ERR_UNSORTED);
+    assert(tree.size == 1000);
+    assert(idx_ints_insert(&tree, 1) == AVLTREE_OK);
+    assert(idx_ints_remove(&tree, 0) == AVLTREE_OK);
+    assert(ints_is_valid(&tree));
+
+    idx_ints_deinit(&tree);
+    printf("test avltree indexed build from sorted scalar type passed\n");
+}
+
+void test_avltree_indexed_iterate_scalar_type(void) {
+    struct avltree_idx_ints tree = idx_ints_init(allocator_get_default(), int_cmp);
+    assert(idx_ints_begin(&tree) == NULL);
+    for (int i = 0; i < 500; ++i) {
+        idx_ints_insert(&tree, (i * 7) % 500);
+    }
+
+    int expected = 0;
+    for (int *it = idx_ints_begin(&tree); it != NULL; it = idx_ints_next(&tree, it)) {
+        assert(*it == expected);
+        expected++;
+    }
+    assert(expected == 500);
+    for (int *it = idx_ints_max(&tree); it != NULL; it = idx_ints_prev(&tree, it)) {
+        expected--;
+        assert(*it == expected);
+    }
+    assert(expected == 0);
+
+    // Iterators come from the lookups too
+    int *it = idx_ints_find(&tree, 250);
+    assert(*idx_ints_next(&tree, it) == 251 && *idx_ints_prev(&tree, it) == 249);
+
+    struct range_collect c = { .count = 0, .limit = 64 };
+    assert(idx_ints_for_each_range(&tree, 10, 20, collect_range, &c) == 10);
+    for (size_t i = 0; i < c.count; ++i) {
+        assert(c.out[i] == 10 + (int)i);
+    }
+    // Bounds that are not keys, empty ranges and the callback stopping the scan
+    idx_ints_remove(&tree, 30);
+    c.count = 0;
+    assert(idx_ints_for_each_range(&tree, 29, 32, collect_range, &c) == 2);
+    assert(c.out[0] == 29 && c.out[1] == 31);
+    c.count = 0;
+    assert(idx_ints_for_each_range(&tree, 20, 20, collect_range, &c) == 0);
+    assert(idx_ints_for_each_range(&tree, 600, 700, collect_range, &c) == 0);
+    c.limit = 3;
+    assert(idx_ints_for_each_range(&tree, 0, 500, collect_range, &c) == 4);
+    assert(c.count == 3);
+
+    idx_ints_deinit(&tree);
+    printf("test avltree indexed iterate scalar type passed\n");
+}
+
+int main(void) {
+    test_avltree_indexed_insert_remove_scalar_type();
+    test_avltree_indexed_free_list_scalar_type();
+    test_avltree_indexed_bounds_scalar_type();
+    test_avltree_indexed_deep_clone_scalar_type();
+    test_avltree_indexed_ptr();
+    test_avltree_indexed_build_from_sorted_scalar_type();
+    test_avltree_indexed_iterate_scalar_type();
+    return 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file test_order.c
+ * @brief Unit tests for the avltree.h file built with AVLTREE_ORDER_STATISTICS (subtree counts, select and rank)
+ */
+#define AVLTREE_ORDER_STATISTICS
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "avltree.h"
+
+AVLTREE_TYPE(int, ints)
+AVLTREE_DECL(int, ints)
+AVLTREE_IMPL(int, ints, avltree_noop_deinit)
+
+static int int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+static int int_construct(int *location, void *args, struct Allocator *alloc) {
+    (void)alloc;
+    *location = *(int *)args;
+    return 0;
+}
+
+// Checks ordering, heights and the count of every node, returns the height of the subtree (-1 on failure)
+static int ints_check_subtree(struct avltree_node_ints *node, size_t *count) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->left != NULL && node->left->data >= node->data) {
+        return -1;
+    }
+    if (node->right != NULL && node->right->data <= node->data) {
+        return -1;
+    }
+    size_t below = *count;
+    int lh = ints_check_subtree(node->left, count);
+    int rh = ints_check_subtree(node->right, count);
+    if (lh < 0 || rh < 0 || lh - rh > 1 || rh - lh > 1) {
+        return -1;
+    }
+    *count += 1;
+    if (node->count != *count - below) {
+        return -1;
+    }
+    return 1 + (lh > rh ? lh : rh);
+}
+
+static int ints_is_valid(struct avltree_ints *tree) {
+    size_t count = 0;
+    int h = ints_check_subtree(tree->root, &count);
+    return h >= 0 && count == tree->size;
+}
+
+#define MODEL_KEYS 1000
+
+// select, rank and count_range against a plain array of which keys are there
+static bool ints_matches(const struct avltree_ints *tree, const bool present[MODEL_KEYS]) {
+    size_t below[MODEL_KEYS + 1];
+    below[0] = 0;
+    for (int key = 0; key < MODEL_KEYS; ++key) {
+        below[key + 1] = below[key] + (present[key] ? 1 : 0);
+    }
+    if (below[MODEL_KEYS] != tree->size) {
+        return false;
+    }
+    for (int key = 0; key < MODEL_KEYS; ++key) {
+        if (ints_rank(tree, key) != below[key]) {
+            return false;
+        }
+        int *at = ints_select(tree, below[key]);
+        if (present[key] && (at == NULL || *at != key)) {
+            return false;
+        }
+    }
+    for (int lo = 0; lo < MODEL_KEYS; lo += 37) {
+        for (int hi = lo; hi <= MODEL_KEYS; hi += 91) {
+            if (ints_count_range(tree, lo, hi) != below[hi] - below[lo]) {
+                return false;
+            }
+        }
+    }
+    return ints_select(tree, tree->size) == NULL;
+}
+
+void test_avltree_order_layout(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    assert(ints_select(&tree, 0) == NULL);
+    assert(ints_rank(&tree, 5) == 0);
+    assert(ints_count_range(&tree, 0, 10) == 0);
+    assert(ints_insert(&tree, 7) == AVLTREE_OK);
+    assert(tree.root->count == 1);
+    assert(*ints_select(&tree, 0) == 7 && ints_select(&tree, 1) == NULL);
+    assert(ints_rank(&tree, 7) == 0 && ints_rank(&tree, 8) == 1);
+    assert(ints_select(NULL, 0) == NULL);
+    assert(ints_rank(NULL, 0) == 0 && ints_count_range(NULL, 0, 1) == 0);
+    ints_deinit(&tree);
+    printf("test avltree order layout passed\n");
+}
+
+void test_avltree_order_insert_remove_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp);
+    bool present[MODEL_KEYS] = { false };
+
+    for (int i = 0; i < MODEL_KEYS; i += 3) {
+        assert(ints_insert(&tree, i) == AVLTREE_OK);
+        present[i] = true;
+    }
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+    assert(*ints_select(&tree, 0) == *ints_min(&tree));
+    assert(*ints_select(&tree, tree.size - 1) == *ints_max(&tree));
+    // A duplicate or a missing key leaves every count as it was
+    assert(ints_insert(&tree, 3) == AVLTREE_ERR_DUPLICATE);
+    assert(ints_remove(&tree, 4) == AVLTREE_OK);
+    assert(ints_is_valid(&tree));
+    // Empty and reversed ranges
+    assert(ints_count_range(&tree, 10, 10) == 0);
+    assert(ints_count_range(&tree, 20, 10) == 0);
+
+    // Pseudo random inserts, emplaces and removes, two-children removes included
+    unsigned int x = 2024;
+    for (int i = 0; i < 6000; ++i) {
+        x = x * 1103515245u + 12345u;
+        int key = (int)((x >> 16) % MODEL_KEYS);
+        if (present[key]) {
+            assert(ints_remove(&tree, key) == AVLTREE_OK);
+            present[key] = false;
+        } else if (i % 2 == 0) {
+            assert(ints_insert(&tree, key) == AVLTREE_OK);
+            present[key] = true;
+        } else {
+            assert(ints_emplace(&tree, int_construct, &key) != NULL);
+            present[key] = true;
+        }
+        if (i % 500 == 0) {
+            assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+        }
+    }
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+
+    ints_deinit(&tree);
+    printf("test avltree order insert remove scalar type passed\n");
+}
+
+void test_avltree_order_bulk_scalar_type(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct avltree_ints tree = ints_init(gpa, int_cmp);
+    bool present[MODEL_KEYS] = { false };
+
+    int sorted[MODEL_KEYS / 2];
+    for (int i = 0; i < MODEL_KEYS / 2; ++i) {
+        sorted[i] = i * 2;
+        present[i * 2] = true;
+    }
+    assert(ints_build_from_sorted(&tree, sorted, MODEL_KEYS / 2) == AVLTREE_OK);
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+    // percentiles straight from the counts
+    assert(*ints_select(&tree, tree.size / 2) == MODEL_KEYS / 2);
+    assert(*ints_select(&tree, tree.size * 99 / 100) == 990);
+
+    // split sizes the new tree from the root count
+    struct avltree_ints high = ints_split(&tree, 601);
+    assert(ints_is_valid(&tree) && ints_is_valid(&high));
+    assert(tree.size == 301 && high.size == 199);
+    assert(*ints_select(&high, 0) == 602 && ints_rank(&high, 700) == 49);
+    assert(ints_join(&tree, &high) == AVLTREE_OK);
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+
+    struct avltree_ints other = ints_init(gpa, int_cmp);
+    for (int i = 0; i < MODEL_KEYS; i += 3) {
+        ints_insert(&other, i);
+    }
+    assert(ints_union(&tree, &other) == AVLTREE_OK);
+    for (int i = 0; i < MODEL_KEYS; i += 3) {
+        present[i] = true;
+    }
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+
+    for (int i = 0; i < MODEL_KEYS; i += 5) {
+        ints_insert(&other, i);
+    }
+    assert(ints_intersection(&tree, &other) == AVLTREE_OK);
+    for (int i = 0; i < MODEL_KEYS; ++i) {
+        present[i] = present[i] && i % 5 == 0;
+    }
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+
+    for (int i = 0; i < MODEL_KEYS; i += 4) {
+        ints_insert(&other, i);
+    }
+    assert(ints_difference(&tree, &other) == AVLTREE_OK);
+    for (int i = 0; i < MODEL_KEYS; i += 4) {
+        present[i] = false;
+    }
+    assert(ints_is_valid(&tree) && ints_matches(&tree, present));
+
+    ints_deinit(&other);
+    ints_deinit(&tree);
+    printf("test avltree order bulk scalar type passed\n");
+}
+
+int main(void) {
+    test_avltree_order_layout();
+    test_avltree_order_insert_remove_scalar_type();
+    test_avltree_order_bulk_scalar_type();
+    return 0;
+}
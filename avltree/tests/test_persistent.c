@@ -0,0 +1,347 @@
+/**
+ * @file test_persistent.c
+ * @brief Unit tests for the AVLTREE_PERSISTENT version of avltree.h (path-copying versions sharing nodes),
+ *        with readers on other threads when the build defines AVLTREE_PTHREAD
+ */
+#ifdef AVLTREE_PTHREAD
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "avltree.h"
+
+AVLTREE_TYPE_PERSISTENT(int, ints)
+AVLTREE_DECL_PERSISTENT(int, ints)
+AVLTREE_IMPL_PERSISTENT(int, ints)
+
+static int int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+// Counts the live nodes, and fails every allocation once fail_after are made
+struct counting_ctx {
+    size_t mallocs;
+    size_t frees;
+    size_t fail_after;
+};
+
+static void *counting_malloc(size_t size, void *ctx) {
+    struct counting_ctx *counts = (struct counting_ctx *)ctx;
+    if (counts->fail_after != 0 && counts->mallocs >= counts->fail_after) {
+        return NULL;
+    }
+    counts->mallocs++;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    (void)old_size;
+    (void)ctx;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ptr, size_t size, void *ctx) {
+    (void)size;
+    ((struct counting_ctx *)ctx)->frees++;
+    free(ptr);
+}
+
+static struct Allocator counting_allocator(struct counting_ctx *ctx) {
+    struct Allocator alloc = { counting_malloc, counting_realloc, counting_free, ctx };
+    return alloc;
+}
+
+// Checks ordering, stored heights and balance, returns the height of the subtree (-1 on failure)
+static int ints_check_subtree(const struct avltree_cow_node_ints *node, size_t *count) {
+    if (node == NULL) {
+        return 0;
+    }
+    if (node->refs == 0) {
+        return -1;
+    }
+    if (node->left != NULL && node->left->data >= node->data) {
+        return -1;
+    }
+    if (node->right != NULL && node->right->data <= node->data) {
+        return -1;
+    }
+    int left = ints_check_subtree(node->left, count);
+    int right = ints_check_subtree(node->right, count);
+    if (left < 0 || right < 0 || left - right > 1 || right - left > 1) {
+        return -1;
+    }
+    int height = (left > right ? left : right) + 1;
+    if ((int)node->height != height) {
+        return -1;
+    }
+    *count += 1;
+    return height;
+}
+
+static bool ints_valid(const struct avltree_cow_ints *tree) {
+    size_t count = 0;
+    return ints_check_subtree(tree->root, &count) >= 0 && count == tree->size;
+}
+
+#define MODEL_KEYS 512
+#define MODEL_VERSIONS 8
+
+// The version must hold exactly the keys set in present
+static bool ints_matches(const struct avltree_cow_ints *tree, const bool *present) {
+    size_t expected = 0;
+    for (int key = 0; key < MODEL_KEYS; ++key) {
+        if (cow_ints_contains(tree, key) != present[key]) {
+            return false;
+        }
+        expected += present[key] ? 1 : 0;
+    }
+    return cow_ints_size(tree) == expected && ints_valid(tree);
+}
+
+void test_avltree_persistent_versions_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct avltree_cow_ints tree = cow_ints_init(counting_allocator(&counts), int_cmp);
+    static bool present[MODEL_KEYS];
+    static bool kept_present[MODEL_VERSIONS][MODEL_KEYS];
+    struct avltree_cow_ints kept[MODEL_VERSIONS];
+    memset(present, 0, sizeof(present));
+    for (size_t v = 0; v < MODEL_VERSIONS; ++v) {
+        kept[v] = cow_ints_snapshot(&tree);
+        memcpy(kept_present[v], present, sizeof(present));
+    }
+    unsigned int seed = 7;
+    for (int step = 0; step < 20000; ++step) {
+        seed = seed * 1103515245u + 12345u;
+        int key = (int)((seed >> 8) % MODEL_KEYS);
+        if (present[key]) {
+            assert(cow_ints_remove(&tree, key) == AVLTREE_OK);
+            present[key] = false;
+        } else {
+            assert(cow_ints_insert(&tree, key) == AVLTREE_OK);
+            present[key] = true;
+        }
+        // now and then replace one of the kept versions by the current one
+        if (step % 97 == 0) {
+            size_t v = (size_t)(step / 97) % MODEL_VERSIONS;
+            assert(ints_matches(&kept[v], kept_present[v]));
+            cow_ints_release(&kept[v]);
+            kept[v] = cow_ints_snapshot(&tree);
+            memcpy(kept_present[v], present, sizeof(present));
+        }
+    }
+    assert(ints_matches(&tree, present));
+    for (size_t v = 0; v < MODEL_VERSIONS; ++v) {
+        assert(ints_matches(&kept[v], kept_present[v]));
+    }
+    assert(cow_ints_insert(&tree, *cow_ints_max(&tree)) == AVLTREE_ERR_DUPLICATE);
+    assert(cow_ints_remove(&tree, MODEL_KEYS + 1) == AVLTREE_OK);
+
+    // releasing in any order frees every node exactly once
+    for (size_t v = 0; v < MODEL_VERSIONS; v += 2) {
+        cow_ints_release(&kept[v]);
+    }
+    cow_ints_release(&tree);
+    assert(cow_ints_size(&tree) == 0 && tree.root == NULL);
+    for (size_t v = 1; v < MODEL_VERSIONS; v += 2) {
+        assert(ints_matches(&kept[v], kept_present[v]));
+        cow_ints_release(&kept[v]);
+    }
+    assert(counts.mallocs == counts.frees);
+    cow_ints_release(&tree);
+    cow_ints_release(NULL);
+    printf("test avltree persistent versions scalar-type passed\n");
+}
+
+static bool sum_elem(const int *elem, void *ctx) {
+    *(long *)ctx += *elem;
+    return true;
+}
+
+void test_avltree_persistent_sharing_scalar_type(void) {
+    struct counting_ctx counts = { 0 };
+    struct avltree_cow_ints tree = cow_ints_init(counting_allocator(&counts), int_cmp);
+    const int n = 1 << 14;
+    // nothing shared, every change is in place
+    for (int i = 0; i < n; ++i) {
+        assert(cow_ints_insert(&tree, 2 * i) == AVLTREE_OK);
+    }
+    assert(counts.mallocs == (size_t)n);
+    for (int i = 0; i < n; i += 4) {
+        assert(cow_ints_remove(&tree, 2 * i) == AVLTREE_OK);
+    }
+    assert(counts.mallocs == (size_t)n);
+    const size_t height = tree.root->height;
+
+    // a snapshot does not allocate, a change copies the path only
+    struct avltree_cow_ints snap = cow_ints_snapshot(&tree);
+    assert(counts.mallocs == (size_t)n);
+    assert(snap.root == tree.root && tree.root->refs == 2);
+    size_t before = counts.mallocs;
+    assert(cow_ints_insert(&tree, 1) == AVLTREE_OK);
+    assert(counts.mallocs - before <= height + 1);
+    before = counts.mallocs;
+    assert(cow_ints_remove(&tree, 2 * 7) == AVLTREE_OK);
+    assert(counts.mallocs - before <= 3 * height);
+    assert(tree.root != snap.root);
+    // the second change in a row only copies what the first one did not
+    before = counts.mallocs;
+    assert(cow_ints_insert(&tree, 3) == AVLTREE_OK);
+    assert(counts.mallocs - before <= height);
+
+    assert(cow_ints_contains(&tree, 1) && !cow_ints_contains(&snap, 1));
+    assert(!cow_ints_contains(&tree, 14) && cow_ints_contains(&snap, 14));
+    assert(ints_valid(&tree) && ints_valid(&snap));
+    assert(cow_ints_size(&tree) == cow_ints_size(&snap) + 1);
+
+    assert(*cow_ints_find(&snap, 14) == 14);
+    assert(cow_ints_find(&snap, 15) == NULL);
+    assert(*cow_ints_lower_bound(&tree, 13) == 18);
+    assert(*cow_ints_upper_bound(&snap, 14) == 18);
+    assert(cow_ints_upper_bound(&snap, 2 * n) == NULL);
+    assert(*cow_ints_min(&tree) == 1 && *cow_ints_min(&snap) == 2);
+    assert(*cow_ints_max(&tree) == 2 * (n - 1));
+    long sum = 0;
+    assert(cow_ints_for_each_range(&tree, 0, 10, sum_elem, &sum) == 5);
+    assert(sum == 1 + 2 + 3 + 4 + 6);
+
+    // the snapshot owns the replaced nodes alone now, releasing it frees just those
+    cow_ints_release(&snap);
+    assert(counts.mallocs - counts.frees == cow_ints_size(&tree));
+    assert(ints_valid(&tree));
+    cow_ints_release(&tree);
+    assert(counts.mallocs == counts.frees);
+
+    struct avltree_cow_ints empty = cow_ints_init(allocator_get_default(), int_cmp);
+    struct avltree_cow_ints empty_snap = cow_ints_snapshot(&empty);
+    assert(cow_ints_min(&empty_snap) == NULL && cow_ints_size(&empty_snap) == 0);
+    cow_ints_release(&empty_snap);
+    assert(cow_ints_insert(NULL, 1) == AVLTREE_ERR_NULL);
+    assert(cow_ints_remove(NULL, 1) == AVLTREE_ERR_NULL);
+    assert(cow_ints_find(NULL, 1) == NULL);
+    assert(cow_ints_for_each_range(&empty, 0, 1, NULL, NULL) == 0);
+    printf("test avltree persistent sharing scalar-type passed\n");
+}
+
+void test_avltree_persistent_alloc_failure(void) {
+    struct counting_ctx counts = { 0 };
+    struct avltree_cow_ints tree = cow_ints_init(counting_allocator(&counts), int_cmp);
+    for (int i = 0; i < 2000; ++i) {
+        assert(cow_ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    // every prefix of the allocations of a change fails cleanly, with a snapshot forcing the copies
+    unsigned int seed = 3;
+    for (int step = 0; step < 300; ++step) {
+        struct avltree_cow_ints snap = cow_ints_snapshot(&tree);
+        seed = seed * 1103515245u + 12345u;
+        int key = (int)((seed >> 8) % 2400);
+        bool insert = !cow_ints_contains(&tree, key);
+        size_t size = cow_ints_size(&tree);
+        enum avltree_error err = AVLTREE_ERR_ALLOC;
+        for (size_t allowed = 0; err == AVLTREE_ERR_ALLOC; ++allowed) {
+            counts.fail_after = counts.mallocs + allowed;
+            err = insert ? cow_ints_insert(&tree, key) : cow_ints_remove(&tree, key);
+            if (err == AVLTREE_ERR_ALLOC) {
+                assert(cow_ints_size(&tree) == size && cow_ints_contains(&tree, key) == !insert);
+                assert(ints_valid(&tree));
+            }
+        }
+        counts.fail_after = 0;
+        assert(err == AVLTREE_OK);
+        assert(cow_ints_contains(&tree, key) == insert && cow_ints_contains(&snap, key) == !insert);
+        assert(ints_valid(&tree) && ints_valid(&snap));
+        cow_ints_release(&snap);
+    }
+    cow_ints_release(&tree);
+    assert(counts.mallocs == counts.frees);
+    printf("test avltree persistent alloc failure passed\n");
+}
+
+#ifdef AVLTREE_PTHREAD
+    #include <pthread.h>
+
+    #define WINDOW 1024
+    #define WRITER_STEPS 20000
+    #define READERS 3
+
+// The writer slides a window of WINDOW keys and publishes every state, the readers check each one
+struct published {
+    pthread_mutex_t lock;
+    struct avltree_cow_ints current;
+    bool done;
+};
+
+static void *window_reader(void *arg) {
+    struct published *shared = (struct published *)arg;
+    size_t checked = 0;
+    for (;;) {
+        pthread_mutex_lock(&shared->lock);
+        bool done = shared->done;
+        struct avltree_cow_ints mine = cow_ints_snapshot(&shared->current);
+        pthread_mutex_unlock(&shared->lock);
+        // no lock from here on, the writer keeps changing its own version meanwhile
+        assert(cow_ints_size(&mine) == WINDOW);
+        int lo = *cow_ints_min(&mine);
+        assert(*cow_ints_max(&mine) == lo + WINDOW - 1);
+        long sum = 0;
+        assert(cow_ints_for_each_range(&mine, lo, lo + WINDOW, sum_elem, &sum) == WINDOW);
+        assert(sum == (long)WINDOW * lo + (long)WINDOW * (WINDOW - 1) / 2);
+        cow_ints_release(&mine);
+        checked++;
+        if (done) {
+            break;
+        }
+    }
+    return (void *)checked;
+}
+
+void test_avltree_persistent_lock_free_readers(void) {
+    struct avltree_cow_ints tree = cow_ints_init(allocator_get_default(), int_cmp);
+    for (int i = 0; i < WINDOW; ++i) {
+        assert(cow_ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    struct published shared;
+    assert(pthread_mutex_init(&shared.lock, NULL) == 0);
+    shared.current = cow_ints_snapshot(&tree);
+    shared.done = false;
+    pthread_t readers[READERS];
+    for (size_t i = 0; i < READERS; ++i) {
+        assert(pthread_create(&readers[i], NULL, window_reader, &shared) == 0);
+    }
+    for (int step = 0; step < WRITER_STEPS; ++step) {
+        assert(cow_ints_insert(&tree, step + WINDOW) == AVLTREE_OK);
+        assert(cow_ints_remove(&tree, step) == AVLTREE_OK);
+        struct avltree_cow_ints next = cow_ints_snapshot(&tree);
+        pthread_mutex_lock(&shared.lock);
+        struct avltree_cow_ints old = shared.current;
+        shared.current = next;
+        shared.done = step + 1 == WRITER_STEPS;
+        pthread_mutex_unlock(&shared.lock);
+        cow_ints_release(&old);
+    }
+    for (size_t i = 0; i < READERS; ++i) {
+        void *checked = NULL;
+        assert(pthread_join(readers[i], &checked) == 0);
+        assert(checked != NULL);
+    }
+    assert(ints_valid(&tree) && *cow_ints_min(&tree) == WRITER_STEPS);
+    cow_ints_release(&shared.current);
+    cow_ints_release(&tree);
+    pthread_mutex_destroy(&shared.lock);
+    printf("test avltree persistent lock-free readers passed\n");
+}
+#endif // AVLTREE_PTHREAD
+
+int main(void) {
+    test_avltree_persistent_versions_scalar_type();
+    test_avltree_persistent_sharing_scalar_type();
+    test_avltree_persistent_alloc_failure();
+#ifdef AVLTREE_PTHREAD
+    test_avltree_persistent_lock_free_readers();
+#endif
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file test_stats.c
+ * @brief Unit tests for the avltree.h AVLTREE_STATS counters, checked against the stats allocator
+ */
+#define AVLTREE_STATS
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "avltree.h"
+
+AVLTREE_TYPE(int, ints)
+AVLTREE_DECL(int, ints)
+AVLTREE_IMPL(int, ints, avltree_noop_deinit)
+
+static size_t global_comparator_calls = 0;
+
+static int int_cmp_counted(int *a, int *b) {
+    global_comparator_calls++;
+    return (*a > *b) - (*a < *b);
+}
+
+static int int_construct(int *location, void *args, struct Allocator *alloc) {
+    (void)alloc;
+    *location = *(int *)args;
+    return 0;
+}
+
+void test_avltree_stats_nodes_scalar_type(void) {
+    struct allocator_stats astats = allocator_stats_init(allocator_get_default());
+    struct avltree_ints tree = ints_init(allocator_get_stats(&astats), int_cmp_counted);
+    for (int i = 0; i < 16; ++i) {
+        assert(ints_insert(&tree, i) == AVLTREE_OK);
+    }
+    assert(tree.stats.node_allocs == 16);
+    assert(astats.malloc_calls == 16);
+
+    // A duplicate insert is found before allocating, a duplicate emplace only after
+    assert(ints_insert(&tree, 3) == AVLTREE_ERR_DUPLICATE);
+    assert(tree.stats.node_allocs == 16);
+    int dup = 5;
+    assert(ints_emplace(&tree, int_construct, &dup) == NULL);
+    assert(tree.stats.node_allocs == 17);
+    assert(tree.stats.node_frees == 1);
+
+    assert(ints_remove(&tree, 0) == AVLTREE_OK);
+    assert(ints_remove(&tree, 7) == AVLTREE_OK);
+    assert(tree.stats.node_frees == 3);
+    assert(astats.free_calls == 3);
+
+    ints_deinit(&tree);
+    assert(tree.stats.node_frees == tree.stats.node_allocs);
+    assert(astats.bytes_live == 0);
+    printf("test avltree stats nodes scalar-type passed\n");
+}
+
+void test_avltree_stats_rotations_scalar_type(void) {
+    struct Allocator gpa = allocator_get_default();
+
+    // 1, 2, 3 needs a single left rotation
+    struct avltree_ints tree = ints_init(gpa, int_cmp_counted);
+    ints_insert(&tree, 1);
+    ints_insert(&tree, 2);
+    assert(tree.stats.rotations == 0);
+    ints_insert(&tree, 3);
+    assert(tree.stats.rotations == 1);
+    ints_deinit(&tree);
+
+    // 3, 1, 2 is the left right case, two rotations
+    tree = ints_init(gpa, int_cmp_counted);
+    ints_insert(&tree, 3);
+    ints_insert(&tree, 1);
+    ints_insert(&tree, 2);
+    assert(tree.stats.rotations == 2);
+    assert(tree.root->data == 2);
+    ints_deinit(&tree);
+
+    // Sequential inserts keep rotating at the right spine
+    tree = ints_init(gpa, int_cmp_counted);
+    for (int i = 1; i <= 7; ++i) {
+        ints_insert(&tree, i);
+    }
+    assert(tree.stats.rotations == 4);
+    ints_deinit(&tree);
+    printf("test avltree stats rotations scalar-type passed\n");
+}
+
+void test_avltree_stats_comparisons_scalar_type(void) {
+    struct avltree_ints tree = ints_init(allocator_get_default(), int_cmp_counted);
+    global_comparator_calls = 0;
+    for (int i = 0; i < 64; ++i) {
+        ints_insert(&tree, (i * 29) % 64);
+    }
+    for (int i = 0; i < 64; ++i) {
+        assert(ints_find(&tree, i) != NULL);
+    }
+    assert(ints_find(&tree, 100) == NULL);
+    assert(ints_remove(&tree, 10) == AVLTREE_OK);
+    assert(tree.stats.comparisons > 0);
+    assert(tree.stats.comparisons == global_comparator_calls);
+    ints_deinit(&tree);
+    printf("test avltree stats comparisons scalar-type passed\n");
+}
+
+void test_avltree_stats_pooled_scalar_type(void) {
+    struct avltree_ints tree = ints_init_pooled(allocator_get_default(), int_cmp_counted, 8);
+    for (int i = 0; i < 20; ++i) {
+        ints_insert(&tree, i);
+    }
+    assert(tree.stats.node_allocs == 20);
+
+    // The noop pool fast path releases every chunk at once, the nodes still count as freed
+    ints_clear(&tree);
+    assert(tree.stats.node_frees == 20);
+    for (int i = 0; i < 5; ++i) {
+        ints_insert(&tree, i);
+    }
+    ints_deinit(&tree);
+    assert(tree.stats.node_allocs == 25);
+    assert(tree.stats.node_frees == 25);
+    printf("test avltree stats pooled scalar-type passed\n");
+}
+
+int main(void) {
+    test_avltree_stats_nodes_scalar_type();
+    test_avltree_stats_rotations_scalar_type();
+    test_avltree_stats_comparisons_scalar_type();
+    test_avltree_stats_pooled_scalar_type();
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file bench.h
+ * @brief Small benchmark harness shared by the bench/ suites
+ *
+ * Every case is run once as a warmup and then `reps` times, each repetition gets a fresh setup that is not
+ * timed. The median and the minimum time per operation are recorded, the median is the number to compare
+ * between runs, the minimum is there to tell noise apart from regressions.
+ *
+ * Inputs come from a fixed seed generator, so every run measures exactly the same work.
+ *
+ * @note This must be the first include of every bench source, it selects the POSIX clock.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200809L // For clock_gettime(), mkstemp()
+#endif
+
+#include <stdbool.h> // For bool
+#include <stddef.h> // For size_t
+#include <stdint.h> // For uint64_t
+
+#ifdef _WIN32
+    #include <windows.h> // For QueryPerformanceCounter()
+#else
+    #include <time.h> // For clock_gettime()
+#endif
+
+#ifndef _WIN32
+    #define ARRAYLIST_POSIX // For the snapshot cases of bench_arraylist.c
+#endif
+
+#include "allocator.h"
+#include "arraylist.h"
+
+/**
+ * @struct bench_result
+ * @brief One line of output, one case at one size
+ */
+struct bench_result {
+    const char *suite;    ///< arraylist, avltree, pair...
+    const char *name;     ///< Operation measured
+    const char *variant;  ///< Container version and allocator
+    size_t n;             ///< Elements in the container
+    size_t reps;          ///< Timed repetitions
+    double median_ns;     ///< Median time per operation, in nanoseconds
+    double min_ns;        ///< Fastest repetition, in nanoseconds per operation
+};
+
+ARRAYLIST(struct bench_result, bench_results, arraylist_noop_deinit)
+
+/**
+ * @struct bench_state
+ * @brief Options and collected results of a run
+ */
+struct bench_state {
+    struct arraylist_bench_results results;
+    size_t reps;        ///< Timed repetitions per case
+    const char *filter; ///< Only run cases whose suite, name or variant contains this, NULL for all
+};
+
+/**
+ * @struct bench_case
+ * @brief A measurable operation
+ *
+ * setup and teardown run around every repetition and are not timed, run returns how many operations it did
+ * so the time can be reported per operation.
+ */
+struct bench_case {
+    const char *suite;
+    const char *name;
+    const char *variant;
+    size_t n;
+    void *ctx;
+    void (*setup)(void *ctx, size_t n);
+    size_t (*run)(void *ctx, size_t n);
+    void (*teardown)(void *ctx);
+};
+
+/**
+ * @brief Results of the benchmarked code are added here so the compiler can't drop the work
+ */
+extern volatile size_t bench_sink;
+
+/**
+ * @brief bench_run: Measures a case and appends its result to state
+ * @param state Run options and results
+ * @param c Case to be measured, skipped if it does not match the filter
+ */
+void bench_run(struct bench_state *state, const struct bench_case *c);
+
+void bench_arraylist_suite(struct bench_state *state);
+void bench_avltree_suite(struct bench_state *state);
+void bench_hashmap_suite(struct bench_state *state);
+void bench_pair_suite(struct bench_state *state);
+
+/**
+ * @brief bench_now_ns: Monotonic clock in nanoseconds
+ */
+static inline uint64_t bench_now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @struct bench_rng
+ * @brief xorshift64* generator, reproducible across platforms
+ */
+struct bench_rng {
+    uint64_t state;
+};
+
+#define BENCH_SEED 0x9E3779B97F4A7C15ull
+
+static inline struct bench_rng bench_rng_init(void) {
+    struct bench_rng rng = { BENCH_SEED };
+    return rng;
+}
+
+static inline uint64_t bench_rng_next(struct bench_rng *rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * @brief bench_shuffled: Fills keys with a permutation of 0..n-1, always the same one for the same n
+ */
+static inline void bench_shuffled(int *keys, size_t n) {
+    struct bench_rng rng = bench_rng_init();
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (int)i;
+    }
+    for (size_t i = n; i > 1; --i) {
+        size_t j = (size_t)(bench_rng_next(&rng) % i);
+        int tmp = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+/**
+ * @struct bench_alloc
+ * @brief Allocator under test, the default one or an arena
+ */
+struct bench_alloc {
+    bool use_arena;
+    struct arena_allocator arena;
+};
+
+static inline struct Allocator bench_alloc_begin(struct bench_alloc *a) {
+    if (!a->use_arena) {
+        return allocator_get_default();
+    }
+    a->arena = arena_allocator_init(allocator_get_default(), 0);
+    return allocator_get_arena(&a->arena);
+}
+
+static inline void bench_alloc_end(struct bench_alloc *a) {
+    if (a->use_arena) {
+        arena_allocator_deinit(&a->arena);
+    }
+}
+
+#endif // BENCH_H
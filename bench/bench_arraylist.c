@@ -0,0 +1,586 @@
+/**
+ * @file bench_arraylist.c
+ * @brief ARRAYLIST and ARRAYLIST_DYN microbenchmarks, with the default and the arena allocators, and
+ *        ARRAYLIST_SOA field scans against a list of structs, and the snapshot loads
+ */
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void bench_intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+}
+
+static bool bench_int_less(int *a, int *b) {
+    return *a < *b;
+}
+
+static bool bench_int_eq(int *elem, void *target) {
+    return *elem == *(int *)target;
+}
+
+ARRAYLIST(int, bints, arraylist_noop_deinit)
+ARRAYLIST_DECL_RADIX(int, bints)
+ARRAYLIST_IMPL_RADIX(int, bints, arraylist_radix_key_signed)
+ARRAYLIST_DECL_EQ(int, bints)
+ARRAYLIST_IMPL_EQ(int, bints)
+ARRAYLIST(int *, bptrs, bench_intptr_deinit)
+ARRAYLIST_DYN(int, bints)
+ARRAYLIST_DECL_DYN_RADIX(int, bints)
+ARRAYLIST_IMPL_DYN_RADIX(int, bints, arraylist_radix_key_signed)
+ARRAYLIST_DECL_DYN_EQ(int, bints)
+ARRAYLIST_IMPL_DYN_EQ(int, bints)
+ARRAYLIST_DYN(int *, bptrs)
+
+/* Same particle as rows (ARRAYLIST of structs) and as columns (ARRAYLIST_SOA) for the field scans */
+struct bench_particle {
+    float x, y, z;
+    float vx, vy, vz;
+    float mass;
+    int id;
+};
+
+#define BENCH_PARTICLE_FIELDS(X)                                                                                       \
+    X(float, x) X(float, y) X(float, z) X(float, vx) X(float, vy) X(float, vz) X(float, mass) X(int, id)
+
+#ifdef ARRAYLIST_POSIX
+ARRAYLIST_DECL_IO(int, bints)
+ARRAYLIST_IMPL_IO(int, bints)
+ARRAYLIST_VIEW(int, bints)
+#endif
+
+ARRAYLIST(struct bench_particle, bparticles, arraylist_noop_deinit)
+ARRAYLIST_SOA(BENCH_PARTICLE_FIELDS, bparticles, arraylist_noop_deinit)
+ARRAYLIST_DEQUE(int, bints, arraylist_noop_deinit)
+
+#define BENCH_FIND_LOOKUPS 256
+#define BENCH_INSERT_AT_MAX 10000
+
+/**
+ * Both versions have the same function names apart from the prefix, so the cases are written once and
+ * stamped for each of them:
+ * - tag: suffix of the generated bench functions
+ * - ints/ptrs: struct of the int and int * arraylists
+ * - fn_ints/fn_ptrs: function prefix of each arraylist
+ * - init_ints/init_ptrs: expression creating the arraylist from a local named alloc
+ */
+#define BENCH_ARRAYLIST_CASES(tag, ints, ptrs, fn_ints, fn_ptrs, init_ints, init_ptrs)                                 \
+struct bench_ctx_##tag {                                                                                               \
+    struct bench_alloc alloc;                                                                                          \
+    struct ints list;                                                                                                  \
+    struct ptrs ptr_list;                                                                                              \
+    int keys[BENCH_FIND_LOOKUPS];                                                                                      \
+};                                                                                                                     \
+                                                                                                                       \
+static void bench_setup_empty_##tag(void *p, size_t n) {                                                               \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    struct Allocator alloc = bench_alloc_begin(&ctx->alloc);                                                           \
+    (void)n;                                                                                                           \
+    ctx->list = init_ints;                                                                                             \
+}                                                                                                                      \
+                                                                                                                       \
+static void bench_setup_random_##tag(void *p, size_t n) {                                                              \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    struct bench_rng rng = bench_rng_init();                                                                           \
+    bench_setup_empty_##tag(p, n);                                                                                     \
+    int *data = fn_ints##_emplace_back_n(&ctx->list, n);                                                               \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        data[i] = (int)(bench_rng_next(&rng) >> 33);                                                                   \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+static void bench_setup_sequential_##tag(void *p, size_t n) {                                                          \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    struct bench_rng rng = bench_rng_init();                                                                           \
+    bench_setup_empty_##tag(p, n);                                                                                     \
+    int *data = fn_ints##_emplace_back_n(&ctx->list, n);                                                               \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        data[i] = (int)i;                                                                                              \
+    }                                                                                                                  \
+    for (size_t i = 0; i < BENCH_FIND_LOOKUPS; ++i) {                                                                  \
+        ctx->keys[i] = (int)(bench_rng_next(&rng) % n);                                                                \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+static void bench_setup_ptrs_##tag(void *p, size_t n) {                                                                \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    struct Allocator alloc = bench_alloc_begin(&ctx->alloc);                                                           \
+    ctx->ptr_list = init_ptrs;                                                                                         \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        int *value = alloc.malloc(sizeof(int), alloc.ctx);                                                             \
+        *value = (int)i;                                                                                               \
+        fn_ptrs##_push_back(&ctx->ptr_list, value);                                                                    \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+static void bench_teardown_##tag(void *p) {                                                                            \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    fn_ints##_deinit(&ctx->list);                                                                                      \
+    bench_alloc_end(&ctx->alloc);                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+static void bench_teardown_ptrs_##tag(void *p) {                                                                       \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    fn_ptrs##_deinit(&ctx->ptr_list);                                                                                  \
+    bench_alloc_end(&ctx->alloc);                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_push_back_##tag(void *p, size_t n) {                                                               \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        fn_ints##_push_back(&ctx->list, (int)i);                                                                       \
+    }                                                                                                                  \
+    bench_sink += ctx->list.size;                                                                                      \
+    return n;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_emplace_back_##tag(void *p, size_t n) {                                                            \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        *fn_ints##_emplace_back(&ctx->list) = (int)i;                                                                  \
+    }                                                                                                                  \
+    bench_sink += ctx->list.size;                                                                                      \
+    return n;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_insert_at_##tag(void *p, size_t n) {                                                               \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        fn_ints##_insert_at(&ctx->list, (int)i, ctx->list.size / 2);                                                   \
+    }                                                                                                                  \
+    bench_sink += ctx->list.size;                                                                                      \
+    return n;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_qsort_##tag(void *p, size_t n) {                                                                   \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    fn_ints##_qsort(&ctx->list, bench_int_less);                                                                       \
+    bench_sink += (size_t)ctx->list.data[0];                                                                           \
+    return n;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_radix_sort_##tag(void *p, size_t n) {                                                              \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    fn_ints##_radix_sort_by_key(&ctx->list);                                                                           \
+    bench_sink += (size_t)ctx->list.data[0];                                                                           \
+    return n;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_find_##tag(void *p, size_t n) {                                                                    \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    (void)n;                                                                                                           \
+    for (size_t i = 0; i < BENCH_FIND_LOOKUPS; ++i) {                                                                  \
+        bench_sink += (size_t)(fn_ints##_find(&ctx->list, bench_int_eq, &ctx->keys[i]) - ctx->list.data);              \
+    }                                                                                                                  \
+    return BENCH_FIND_LOOKUPS;                                                                                         \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_find_eq_##tag(void *p, size_t n) {                                                                 \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    (void)n;                                                                                                           \
+    for (size_t i = 0; i < BENCH_FIND_LOOKUPS; ++i) {                                                                  \
+        bench_sink += (size_t)(fn_ints##_find_eq(&ctx->list, ctx->keys[i]) - ctx->list.data);                          \
+    }                                                                                                                  \
+    return BENCH_FIND_LOOKUPS;                                                                                         \
+}                                                                                                                      \
+                                                                                                                       \
+static size_t bench_clear_destroy_##tag(void *p, size_t n) {                                                           \
+    struct bench_ctx_##tag *ctx = p;                                                                                   \
+    fn_ptrs##_clear(&ctx->ptr_list);                                                                                   \
+    bench_sink += ctx->ptr_list.size;                                                                                  \
+    return n;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+static void bench_cases_##tag(struct bench_state *state, const char *variant, bool arena, size_t n) {                  \
+    struct bench_ctx_##tag ctx;                                                                                        \
+    struct bench_case c;                                                                                               \
+    ctx.alloc.use_arena = arena;                                                                                       \
+    c.suite = "arraylist";                                                                                             \
+    c.variant = variant;                                                                                               \
+    c.n = n;                                                                                                           \
+    c.ctx = &ctx;                                                                                                      \
+    c.teardown = bench_teardown_##tag;                                                                                 \
+                                                                                                                       \
+    c.name = "push_back";                                                                                              \
+    c.setup = bench_setup_empty_##tag;                                                                                 \
+    c.run = bench_push_back_##tag;                                                                                     \
+    bench_run(state, &c);                                                                                              \
+                                                                                                                       \
+    c.name = "emplace_back";                                                                                           \
+    c.run = bench_emplace_back_##tag;                                                                                  \
+    bench_run(state, &c);                                                                                              \
+                                                                                                                       \
+    if (n <= BENCH_INSERT_AT_MAX) {                                                                                    \
+        c.name = "insert_at_middle";                                                                                   \
+        c.run = bench_insert_at_##tag;                                                                                 \
+        bench_run(state, &c);                                                                                          \
+    }                                                                                                                  \
+                                                                                                                       \
+    c.name = "qsort_random";                                                                                           \
+    c.setup = bench_setup_random_##tag;                                                                                \
+    c.run = bench_qsort_##tag;                                                                                         \
+    bench_run(state, &c);                                                                                              \
+                                                                                                                       \
+    c.name = "radix_sort_random";                                                                                      \
+    c.run = bench_radix_sort_##tag;                                                                                    \
+    bench_run(state, &c);                                                                                              \
+                                                                                                                       \
+    c.name = "find";                                                                                                   \
+    c.setup = bench_setup_sequential_##tag;                                                                            \
+    c.run = bench_find_##tag;                                                                                          \
+    bench_run(state, &c);                                                                                              \
+                                                                                                                       \
+    c.name = "find_eq";                                                                                                \
+    c.run = bench_find_eq_##tag;                                                                                       \
+    bench_run(state, &c);                                                                                              \
+                                                                                                                       \
+    c.name = "clear_destroy_ptr";                                                                                      \
+    c.setup = bench_setup_ptrs_##tag;                                                                                  \
+    c.run = bench_clear_destroy_##tag;                                                                                 \
+    c.teardown = bench_teardown_ptrs_##tag;                                                                            \
+    bench_run(state, &c);                                                                                              \
+}
+
+BENCH_ARRAYLIST_CASES(macro, arraylist_bints, arraylist_bptrs, bints, bptrs, bints_init(alloc), bptrs_init(alloc))
+BENCH_ARRAYLIST_CASES(
+    dyn,
+    arraylist_dyn_bints,
+    arraylist_dyn_bptrs,
+    dyn_bints,
+    dyn_bptrs,
+    dyn_bints_init(alloc, NULL),
+    dyn_bptrs_init(alloc, bench_intptr_deinit)
+)
+
+struct bench_ctx_particles {
+    struct bench_alloc alloc;
+    struct arraylist_bparticles rows;
+    struct arraylist_soa_bparticles columns;
+};
+
+static struct arraylist_soa_row_bparticles bench_particle_row(size_t i) {
+    struct arraylist_soa_row_bparticles row;
+    row.x = row.y = row.z = (float)i;
+    row.vx = row.vy = row.vz = 1.0f;
+    row.mass = (float)(i % 7);
+    row.id = (int)i;
+    return row;
+}
+
+static void bench_setup_particles_empty(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    struct Allocator alloc = bench_alloc_begin(&ctx->alloc);
+    (void)n;
+    ctx->rows = bparticles_init(alloc);
+    ctx->columns = soa_bparticles_init(alloc);
+}
+
+static void bench_setup_particles(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    bench_setup_particles_empty(p, n);
+    for (size_t i = 0; i < n; ++i) {
+        struct arraylist_soa_row_bparticles row = bench_particle_row(i);
+        struct bench_particle particle = { row.x, row.y, row.z, row.vx, row.vy, row.vz, row.mass, row.id };
+        bparticles_push_back(&ctx->rows, particle);
+        soa_bparticles_push_back(&ctx->columns, row);
+    }
+}
+
+static void bench_teardown_particles(void *p) {
+    struct bench_ctx_particles *ctx = p;
+    bparticles_deinit(&ctx->rows);
+    soa_bparticles_deinit(&ctx->columns);
+    bench_alloc_end(&ctx->alloc);
+}
+
+static size_t bench_scan_field_aos(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    unsigned total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        total += (unsigned)ctx->rows.data[i].id;
+    }
+    bench_sink += total;
+    return n;
+}
+
+static size_t bench_scan_field_soa(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    const int *id = ctx->columns.columns.id;
+    unsigned total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        total += (unsigned)id[i];
+    }
+    bench_sink += total;
+    return n;
+}
+
+static size_t bench_integrate_aos(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    struct bench_particle *data = ctx->rows.data;
+    for (size_t i = 0; i < n; ++i) {
+        data[i].x += data[i].vx * 0.5f;
+    }
+    bench_sink += (size_t)data[n - 1].x;
+    return n;
+}
+
+static size_t bench_integrate_soa(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    float *x = ctx->columns.columns.x;
+    const float *vx = ctx->columns.columns.vx;
+    for (size_t i = 0; i < n; ++i) {
+        x[i] += vx[i] * 0.5f;
+    }
+    bench_sink += (size_t)x[n - 1];
+    return n;
+}
+
+static size_t bench_push_back_aos(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        struct arraylist_soa_row_bparticles row = bench_particle_row(i);
+        struct bench_particle particle = { row.x, row.y, row.z, row.vx, row.vy, row.vz, row.mass, row.id };
+        bparticles_push_back(&ctx->rows, particle);
+    }
+    bench_sink += ctx->rows.size;
+    return n;
+}
+
+static size_t bench_push_back_soa(void *p, size_t n) {
+    struct bench_ctx_particles *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        soa_bparticles_push_back(&ctx->columns, bench_particle_row(i));
+    }
+    bench_sink += ctx->columns.size;
+    return n;
+}
+
+/**
+ * Reading or updating one field of a 32 byte particle, the rows drag the other seven fields through the
+ * cache while the columns only touch the field itself
+ */
+static void bench_cases_particles(struct bench_state *state, bool soa, size_t n) {
+    struct bench_ctx_particles ctx;
+    struct bench_case c;
+    ctx.alloc.use_arena = false;
+    c.suite = "arraylist";
+    c.variant = soa ? "ARRAYLIST_SOA/default" : "ARRAYLIST/aos";
+    c.n = n;
+    c.ctx = &ctx;
+    c.teardown = bench_teardown_particles;
+
+    c.name = "push_back_row";
+    c.setup = bench_setup_particles_empty;
+    c.run = soa ? bench_push_back_soa : bench_push_back_aos;
+    bench_run(state, &c);
+
+    c.name = "scan_field";
+    c.setup = bench_setup_particles;
+    c.run = soa ? bench_scan_field_soa : bench_scan_field_aos;
+    bench_run(state, &c);
+
+    c.name = "integrate_field";
+    c.run = soa ? bench_integrate_soa : bench_integrate_aos;
+    bench_run(state, &c);
+}
+
+struct bench_ctx_deque {
+    struct bench_alloc alloc;
+    struct arraylist_deque_bints list;
+};
+
+static void bench_setup_deque_empty(void *p, size_t n) {
+    struct bench_ctx_deque *ctx = p;
+    struct Allocator alloc = bench_alloc_begin(&ctx->alloc);
+    (void)n;
+    ctx->list = deque_bints_init(alloc);
+}
+
+static void bench_setup_deque(void *p, size_t n) {
+    struct bench_ctx_deque *ctx = p;
+    bench_setup_deque_empty(p, n);
+    for (size_t i = 0; i < n; ++i) {
+        deque_bints_push_back(&ctx->list, (int)i);
+    }
+}
+
+static void bench_teardown_deque(void *p) {
+    struct bench_ctx_deque *ctx = p;
+    deque_bints_deinit(&ctx->list);
+    bench_alloc_end(&ctx->alloc);
+}
+
+static size_t bench_deque_push_back(void *p, size_t n) {
+    struct bench_ctx_deque *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        deque_bints_push_back(&ctx->list, (int)i);
+    }
+    bench_sink += ctx->list.size;
+    return n;
+}
+
+static size_t bench_deque_push_front(void *p, size_t n) {
+    struct bench_ctx_deque *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        deque_bints_push_front(&ctx->list, (int)i);
+    }
+    bench_sink += ctx->list.size;
+    return n;
+}
+
+static size_t bench_deque_scan_at(void *p, size_t n) {
+    struct bench_ctx_deque *ctx = p;
+    unsigned total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        total += (unsigned)*deque_bints_at(&ctx->list, i);
+    }
+    bench_sink += total;
+    return n;
+}
+
+static size_t bench_deque_pop_front(void *p, size_t n) {
+    struct bench_ctx_deque *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        deque_bints_pop_front(&ctx->list);
+    }
+    bench_sink += ctx->list.size;
+    return n;
+}
+
+/**
+ * Growing a segmented list only adds a block, compare push_back with the ARRAYLIST/default one which
+ * reallocs and copies, at() pays a shift and an extra load for it
+ */
+static void bench_cases_deque(struct bench_state *state, size_t n) {
+    struct bench_ctx_deque ctx;
+    struct bench_case c;
+    ctx.alloc.use_arena = false;
+    c.suite = "arraylist";
+    c.variant = "ARRAYLIST_DEQUE/default";
+    c.n = n;
+    c.ctx = &ctx;
+    c.teardown = bench_teardown_deque;
+
+    c.name = "push_back";
+    c.setup = bench_setup_deque_empty;
+    c.run = bench_deque_push_back;
+    bench_run(state, &c);
+
+    c.name = "push_front";
+    c.run = bench_deque_push_front;
+    bench_run(state, &c);
+
+    c.name = "scan_at";
+    c.setup = bench_setup_deque;
+    c.run = bench_deque_scan_at;
+    bench_run(state, &c);
+
+    c.name = "pop_front";
+    c.run = bench_deque_pop_front;
+    bench_run(state, &c);
+}
+
+#ifdef ARRAYLIST_POSIX
+struct bench_ctx_snapshot {
+    char path[32];
+    int fd;
+    struct arraylist_bints list;
+};
+
+static void bench_setup_snapshot(void *p, size_t n) {
+    struct bench_ctx_snapshot *ctx = p;
+    memcpy(ctx->path, "/tmp/bench_snapshot_XXXXXX", sizeof("/tmp/bench_snapshot_XXXXXX"));
+    ctx->fd = mkstemp(ctx->path);
+    ctx->list = bints_init(allocator_get_default());
+    int *data = bints_emplace_back_n(&ctx->list, n);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = (int)i;
+    }
+    bints_save_to_fd(&ctx->list, ctx->fd);
+    bints_clear(&ctx->list);
+}
+
+static void bench_teardown_snapshot(void *p) {
+    struct bench_ctx_snapshot *ctx = p;
+    bints_deinit(&ctx->list);
+    close(ctx->fd);
+    unlink(ctx->path);
+}
+
+static size_t bench_snapshot_fread_push_back(void *p, size_t n) {
+    struct bench_ctx_snapshot *ctx = p;
+    FILE *file = fopen(ctx->path, "rb");
+    struct arraylist_file_header header;
+    if (fread(&header, sizeof(header), 1, file) == 1) {
+        bints_reserve(&ctx->list, (size_t)header.count);
+        int value;
+        while (fread(&value, sizeof(value), 1, file) == 1) {
+            bints_push_back(&ctx->list, value);
+        }
+    }
+    fclose(file);
+    bench_sink += ctx->list.size;
+    return n;
+}
+
+static size_t bench_snapshot_load_from_fd(void *p, size_t n) {
+    struct bench_ctx_snapshot *ctx = p;
+    lseek(ctx->fd, 0, SEEK_SET);
+    bints_load_from_fd(&ctx->list, ctx->fd);
+    bench_sink += ctx->list.size;
+    return n;
+}
+
+static size_t bench_snapshot_map_fd(void *p, size_t n) {
+    struct bench_ctx_snapshot *ctx = p;
+    struct arraylist_view_bints view;
+    view_bints_map_fd(&view, ctx->fd);
+    bench_sink += view.size + (size_t)*view_bints_at(&view, n / 2);
+    view_bints_deinit(&view);
+    return n;
+}
+
+/**
+ * Getting a snapshot of n ints back into memory: element by element as before save_to_fd() existed, one
+ * read() into a reserved buffer, and a mapping that only faults in the page it reads
+ */
+static void bench_cases_snapshot(struct bench_state *state, size_t n) {
+    struct bench_ctx_snapshot ctx;
+    struct bench_case c;
+    c.suite = "arraylist";
+    c.variant = "ARRAYLIST/snapshot";
+    c.n = n;
+    c.ctx = &ctx;
+    c.setup = bench_setup_snapshot;
+    c.teardown = bench_teardown_snapshot;
+
+    c.name = "fread_push_back";
+    c.run = bench_snapshot_fread_push_back;
+    bench_run(state, &c);
+
+    c.name = "load_from_fd";
+    c.run = bench_snapshot_load_from_fd;
+    bench_run(state, &c);
+
+    c.name = "view_map_fd";
+    c.run = bench_snapshot_map_fd;
+    bench_run(state, &c);
+}
+#endif // ARRAYLIST_POSIX
+
+void bench_arraylist_suite(struct bench_state *state) {
+    static const size_t sizes[] = { 1000, 10000, 100000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        bench_cases_macro(state, "ARRAYLIST/default", false, sizes[i]);
+        bench_cases_macro(state, "ARRAYLIST/arena", true, sizes[i]);
+        bench_cases_dyn(state, "ARRAYLIST_DYN/default", false, sizes[i]);
+        bench_cases_dyn(state, "ARRAYLIST_DYN/arena", true, sizes[i]);
+        bench_cases_particles(state, false, sizes[i]);
+        bench_cases_particles(state, true, sizes[i]);
+        bench_cases_deque(state, sizes[i]);
+#ifdef ARRAYLIST_POSIX
+        bench_cases_snapshot(state, sizes[i]);
+#endif
+    }
+}
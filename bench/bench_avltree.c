@@ -0,0 +1,257 @@
+/**
+ * @file bench_avltree.c
+ * @brief AVLTREE insert, remove and lookup with sequential and random keys, heap nodes vs pooled nodes, and
+ *        the compile-time comparator variant
+ */
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "avltree.h"
+
+AVLTREE_TYPE(int, bints)
+AVLTREE_DECL(int, bints)
+AVLTREE_IMPL(int, bints, avltree_noop_deinit)
+
+static int bench_int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+#define bench_int_cmp_macro(a, b) ((*(a) > *(b)) - (*(a) < *(b)))
+
+AVLTREE_TYPE_CMP(int, bcmpints)
+AVLTREE_DECL_CMP(int, bcmpints)
+AVLTREE_IMPL_CMP(int, bcmpints, avltree_noop_deinit, bench_int_cmp_macro)
+
+#define BENCH_AVLTREE_NODES_PER_CHUNK 256
+
+struct bench_avl_ctx {
+    bool pooled;
+    struct avltree_bints tree;
+    int *keys;   ///< Permutation of 0..n-1
+    int *sorted; ///< 0..n-1 in order
+};
+
+static void bench_avl_setup_empty(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    (void)n;
+    if (ctx->pooled) {
+        ctx->tree = bints_init_pooled(allocator_get_default(), bench_int_cmp, BENCH_AVLTREE_NODES_PER_CHUNK);
+    } else {
+        ctx->tree = bints_init(allocator_get_default(), bench_int_cmp);
+    }
+}
+
+static void bench_avl_setup_filled(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    bench_avl_setup_empty(p, n);
+    for (size_t i = 0; i < n; ++i) {
+        bints_insert(&ctx->tree, ctx->keys[i]);
+    }
+}
+
+static void bench_avl_teardown(void *p) {
+    struct bench_avl_ctx *ctx = p;
+    bints_deinit(&ctx->tree);
+}
+
+static size_t bench_avl_insert_sequential(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bints_insert(&ctx->tree, (int)i);
+    }
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+static size_t bench_avl_build_from_sorted(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    bints_build_from_sorted(&ctx->tree, ctx->sorted, n);
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+static size_t bench_avl_insert_random(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bints_insert(&ctx->tree, ctx->keys[i]);
+    }
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+static size_t bench_avl_find_random(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bench_sink += (size_t)*bints_find(&ctx->tree, ctx->keys[n - 1 - i]);
+    }
+    return n;
+}
+
+static size_t bench_avl_find_miss(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bench_sink += bints_find(&ctx->tree, (int)(n + i)) == NULL;
+    }
+    return n;
+}
+
+static size_t bench_avl_remove_sequential(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bints_remove(&ctx->tree, (int)i);
+    }
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+static size_t bench_avl_remove_random(void *p, size_t n) {
+    struct bench_avl_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bints_remove(&ctx->tree, ctx->keys[n - 1 - i]);
+    }
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+struct bench_avl_cmp_ctx {
+    struct avltree_bcmpints tree;
+    int *keys;
+};
+
+static void bench_avl_cmp_setup_empty(void *p, size_t n) {
+    struct bench_avl_cmp_ctx *ctx = p;
+    (void)n;
+    ctx->tree = bcmpints_init(allocator_get_default());
+}
+
+static void bench_avl_cmp_setup_filled(void *p, size_t n) {
+    struct bench_avl_cmp_ctx *ctx = p;
+    bench_avl_cmp_setup_empty(p, n);
+    for (size_t i = 0; i < n; ++i) {
+        bcmpints_insert(&ctx->tree, ctx->keys[i]);
+    }
+}
+
+static void bench_avl_cmp_teardown(void *p) {
+    struct bench_avl_cmp_ctx *ctx = p;
+    bcmpints_deinit(&ctx->tree);
+}
+
+static size_t bench_avl_cmp_insert_random(void *p, size_t n) {
+    struct bench_avl_cmp_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bcmpints_insert(&ctx->tree, ctx->keys[i]);
+    }
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+static size_t bench_avl_cmp_find_random(void *p, size_t n) {
+    struct bench_avl_cmp_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bench_sink += (size_t)*bcmpints_find(&ctx->tree, ctx->keys[n - 1 - i]);
+    }
+    return n;
+}
+
+static size_t bench_avl_cmp_remove_random(void *p, size_t n) {
+    struct bench_avl_cmp_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bcmpints_remove(&ctx->tree, ctx->keys[n - 1 - i]);
+    }
+    bench_sink += ctx->tree.size;
+    return n;
+}
+
+/* Only the cases that descend the tree, where the comparator is called at every level */
+static void bench_avl_cmp_cases(struct bench_state *state, int *keys, size_t n) {
+    struct bench_avl_cmp_ctx ctx;
+    struct bench_case c;
+    ctx.keys = keys;
+    c.suite = "avltree";
+    c.variant = "AVLTREE_CMP/default";
+    c.n = n;
+    c.ctx = &ctx;
+    c.teardown = bench_avl_cmp_teardown;
+
+    c.setup = bench_avl_cmp_setup_empty;
+    c.name = "insert_random";
+    c.run = bench_avl_cmp_insert_random;
+    bench_run(state, &c);
+
+    c.setup = bench_avl_cmp_setup_filled;
+    c.name = "find_random";
+    c.run = bench_avl_cmp_find_random;
+    bench_run(state, &c);
+    c.name = "remove_random";
+    c.run = bench_avl_cmp_remove_random;
+    bench_run(state, &c);
+}
+
+static void bench_avl_cases(
+    struct bench_state *state,
+    const char *variant,
+    bool pooled,
+    int *keys,
+    int *sorted,
+    size_t n
+) {
+    struct bench_avl_ctx ctx;
+    struct bench_case c;
+    ctx.pooled = pooled;
+    ctx.keys = keys;
+    ctx.sorted = sorted;
+    c.suite = "avltree";
+    c.variant = variant;
+    c.n = n;
+    c.ctx = &ctx;
+    c.teardown = bench_avl_teardown;
+
+    c.setup = bench_avl_setup_empty;
+    c.name = "insert_sequential";
+    c.run = bench_avl_insert_sequential;
+    bench_run(state, &c);
+    c.name = "build_from_sorted";
+    c.run = bench_avl_build_from_sorted;
+    bench_run(state, &c);
+    c.name = "insert_random";
+    c.run = bench_avl_insert_random;
+    bench_run(state, &c);
+
+    c.setup = bench_avl_setup_filled;
+    c.name = "find_random";
+    c.run = bench_avl_find_random;
+    bench_run(state, &c);
+    c.name = "find_miss";
+    c.run = bench_avl_find_miss;
+    bench_run(state, &c);
+    c.name = "remove_sequential";
+    c.run = bench_avl_remove_sequential;
+    bench_run(state, &c);
+    c.name = "remove_random";
+    c.run = bench_avl_remove_random;
+    bench_run(state, &c);
+}
+
+void bench_avltree_suite(struct bench_state *state) {
+    static const size_t sizes[] = { 1000, 10000, 100000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        int *keys = malloc(sizes[i] * sizeof(int));
+        int *sorted = malloc(sizes[i] * sizeof(int));
+        if (!keys || !sorted) {
+            fprintf(stderr, "bench: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        bench_shuffled(keys, sizes[i]);
+        for (size_t j = 0; j < sizes[i]; ++j) {
+            sorted[j] = (int)j;
+        }
+        bench_avl_cases(state, "AVLTREE/default", false, keys, sorted, sizes[i]);
+        bench_avl_cases(state, "AVLTREE/pooled", true, keys, sorted, sizes[i]);
+        bench_avl_cmp_cases(state, keys, sizes[i]);
+        free(sorted);
+        free(keys);
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * @file bench_hashmap.c
+ * @brief HASHMAP insert, remove and lookup with the same keys as the avltree suite, growing vs reserved
+ */
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hashmap.h"
+
+HASHMAP(int, int, bmap, hashmap_hash_scalar, hashmap_eq_scalar, hashmap_noop_deinit, hashmap_noop_deinit)
+
+struct bench_map_ctx {
+    bool reserved;
+    struct hashmap_bmap map;
+    int *keys; ///< Permutation of 0..n-1
+};
+
+static void bench_map_setup_empty(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    ctx->map = bmap_init(allocator_get_default());
+    if (ctx->reserved) {
+        bmap_reserve(&ctx->map, n);
+    }
+}
+
+static void bench_map_setup_filled(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    bench_map_setup_empty(p, n);
+    for (size_t i = 0; i < n; ++i) {
+        bmap_insert(&ctx->map, ctx->keys[i], (int)i);
+    }
+}
+
+static void bench_map_teardown(void *p) {
+    struct bench_map_ctx *ctx = p;
+    bmap_deinit(&ctx->map);
+}
+
+static size_t bench_map_insert_sequential(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bmap_insert(&ctx->map, (int)i, (int)i);
+    }
+    bench_sink += ctx->map.size;
+    return n;
+}
+
+static size_t bench_map_insert_random(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bmap_insert(&ctx->map, ctx->keys[i], (int)i);
+    }
+    bench_sink += ctx->map.size;
+    return n;
+}
+
+static size_t bench_map_find_random(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bench_sink += (size_t)*bmap_get(&ctx->map, ctx->keys[n - 1 - i]);
+    }
+    return n;
+}
+
+static size_t bench_map_find_miss(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bench_sink += bmap_get(&ctx->map, (int)(n + i)) == NULL;
+    }
+    return n;
+}
+
+static size_t bench_map_remove_random(void *p, size_t n) {
+    struct bench_map_ctx *ctx = p;
+    for (size_t i = 0; i < n; ++i) {
+        bmap_remove(&ctx->map, ctx->keys[n - 1 - i]);
+    }
+    bench_sink += ctx->map.size;
+    return n;
+}
+
+static void bench_map_cases(struct bench_state *state, const char *variant, bool reserved, int *keys, size_t n) {
+    struct bench_map_ctx ctx;
+    struct bench_case c;
+    ctx.reserved = reserved;
+    ctx.keys = keys;
+    c.suite = "hashmap";
+    c.variant = variant;
+    c.n = n;
+    c.ctx = &ctx;
+    c.teardown = bench_map_teardown;
+
+    c.setup = bench_map_setup_empty;
+    c.name = "insert_sequential";
+    c.run = bench_map_insert_sequential;
+    bench_run(state, &c);
+    c.name = "insert_random";
+    c.run = bench_map_insert_random;
+    bench_run(state, &c);
+
+    c.setup = bench_map_setup_filled;
+    c.name = "find_random";
+    c.run = bench_map_find_random;
+    bench_run(state, &c);
+    c.name = "find_miss";
+    c.run = bench_map_find_miss;
+    bench_run(state, &c);
+    c.name = "remove_random";
+    c.run = bench_map_remove_random;
+    bench_run(state, &c);
+}
+
+void bench_hashmap_suite(struct bench_state *state) {
+    static const size_t sizes[] = { 1000, 10000, 100000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        int *keys = malloc(sizes[i] * sizeof(int));
+        if (!keys) {
+            fprintf(stderr, "bench: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        bench_shuffled(keys, sizes[i]);
+        bench_map_cases(state, "HASHMAP/default", false, keys, sizes[i]);
+        bench_map_cases(state, "HASHMAP/reserved", true, keys, sizes[i]);
+        free(keys);
+    }
+}
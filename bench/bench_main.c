@@ -0,0 +1,176 @@
+/**
+ * @file bench_main.c
+ * @brief Runs every benchmark suite and writes the results as CSV or JSON
+ *
+ * Usage: bench_cdatatypes [--csv FILE] [--json FILE] [--reps N] [--filter TEXT]
+ * Without --csv or --json the CSV goes to stdout, the progress always goes to stderr.
+ *
+ * The output only holds the measurements and the build description, no timestamps, so two runs of the same
+ * build can be diffed directly.
+ */
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef BENCH_BUILD_TYPE
+    #define BENCH_BUILD_TYPE "unknown"
+#endif
+
+#ifndef BENCH_COMPILER
+    #define BENCH_COMPILER "unknown"
+#endif
+
+#define BENCH_DEFAULT_REPS 11
+
+volatile size_t bench_sink = 0;
+
+static int bench_double_cmp(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static bool bench_matches(const struct bench_state *state, const struct bench_case *c) {
+    if (!state->filter) {
+        return true;
+    }
+    return strstr(c->suite, state->filter) != NULL || strstr(c->name, state->filter) != NULL
+        || strstr(c->variant, state->filter) != NULL;
+}
+
+void bench_run(struct bench_state *state, const struct bench_case *c) {
+    if (!bench_matches(state, c)) {
+        return;
+    }
+    double *samples = malloc(state->reps * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    // The first repetition only warms up caches and the allocator
+    for (size_t rep = 0; rep <= state->reps; ++rep) {
+        c->setup(c->ctx, c->n);
+        uint64_t start = bench_now_ns();
+        size_t ops = c->run(c->ctx, c->n);
+        uint64_t end = bench_now_ns();
+        c->teardown(c->ctx);
+        if (rep > 0) {
+            samples[rep - 1] = (double)(end - start) / (double)(ops ? ops : 1);
+        }
+    }
+    qsort(samples, state->reps, sizeof(double), bench_double_cmp);
+
+    struct bench_result result;
+    result.suite = c->suite;
+    result.name = c->name;
+    result.variant = c->variant;
+    result.n = c->n;
+    result.reps = state->reps;
+    result.median_ns = samples[state->reps / 2];
+    result.min_ns = samples[0];
+    free(samples);
+
+    if (bench_results_push_back(&state->results, result) != ARRAYLIST_OK) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "%-10s %-22s %-22s n=%-8zu %12.2f ns/op\n", c->suite, c->name, c->variant, c->n,
+            result.median_ns);
+}
+
+static void bench_write_csv(FILE *out, const struct bench_state *state) {
+    fprintf(out, "suite,name,variant,n,reps,median_ns,min_ns\n");
+    for (size_t i = 0; i < state->results.size; ++i) {
+        const struct bench_result *r = &state->results.data[i];
+        fprintf(out, "%s,%s,%s,%zu,%zu,%.3f,%.3f\n", r->suite, r->name, r->variant, r->n, r->reps, r->median_ns,
+                r->min_ns);
+    }
+}
+
+static void bench_write_json(FILE *out, const struct bench_state *state) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"schema\": 1,\n");
+    fprintf(out, "  \"build_type\": \"%s\",\n", BENCH_BUILD_TYPE);
+    fprintf(out, "  \"compiler\": \"%s\",\n", BENCH_COMPILER);
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < state->results.size; ++i) {
+        const struct bench_result *r = &state->results.data[i];
+        fprintf(out,
+                "    {\"suite\": \"%s\", \"name\": \"%s\", \"variant\": \"%s\", \"n\": %zu, \"reps\": %zu, "
+                "\"median_ns\": %.3f, \"min_ns\": %.3f}%s\n",
+                r->suite, r->name, r->variant, r->n, r->reps, r->median_ns, r->min_ns,
+                i + 1 < state->results.size ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void bench_usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--csv FILE] [--json FILE] [--reps N] [--filter TEXT]\n", prog);
+}
+
+static bool bench_write_file(const char *path, const struct bench_state *state,
+                             void (*writer)(FILE *out, const struct bench_state *state)) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "bench: could not open %s\n", path);
+        return false;
+    }
+    writer(out, state);
+    fclose(out);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    struct bench_state state;
+    state.results = bench_results_init(allocator_get_default());
+    state.reps = BENCH_DEFAULT_REPS;
+    state.filter = NULL;
+    const char *csv_path = NULL;
+    const char *json_path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            long reps = strtol(argv[++i], NULL, 10);
+            if (reps < 1) {
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            state.reps = (size_t)reps;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            state.filter = argv[++i];
+        } else {
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (strcmp(BENCH_BUILD_TYPE, "Release") != 0) {
+        fprintf(stderr, "bench: warning, this is a %s build, numbers are only meaningful on Release\n",
+                BENCH_BUILD_TYPE);
+    }
+
+    bench_arraylist_suite(&state);
+    bench_avltree_suite(&state);
+    bench_hashmap_suite(&state);
+    bench_pair_suite(&state);
+
+    bool ok = true;
+    if (!csv_path && !json_path) {
+        bench_write_csv(stdout, &state);
+    }
+    if (csv_path) {
+        ok = bench_write_file(csv_path, &state, bench_write_csv) && ok;
+    }
+    if (json_path) {
+        ok = bench_write_file(json_path, &state, bench_write_json) && ok;
+    }
+
+    bench_results_deinit(&state.results);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
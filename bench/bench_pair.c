@@ -0,0 +1,84 @@
+/**
+ * @file bench_pair.c
+ * @brief pair_cmp on its own and as the comparator of an arraylist sort
+ */
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pair.h"
+
+PAIR(int, int, bip, pair_noop_deinit, pair_noop_deinit)
+
+static int bench_int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+static bool bench_pair_less(struct pair_bip *a, struct pair_bip *b) {
+    return bip_cmp(a, b, bench_int_cmp, bench_int_cmp) == PAIR_CMP_LESS;
+}
+
+ARRAYLIST(struct pair_bip, bpairs, arraylist_noop_deinit)
+
+struct bench_pair_ctx {
+    bool equal_first; ///< All pairs share the first value, so every compare reaches the second one
+    struct arraylist_bpairs list;
+};
+
+static void bench_pair_setup(void *p, size_t n) {
+    struct bench_pair_ctx *ctx = p;
+    struct bench_rng rng = bench_rng_init();
+    ctx->list = bpairs_init(allocator_get_default());
+    struct pair_bip *pairs = bpairs_emplace_back_n(&ctx->list, n);
+    for (size_t i = 0; i < n; ++i) {
+        int first = ctx->equal_first ? 7 : (int)(bench_rng_next(&rng) >> 33);
+        pairs[i] = bip_init(first, (int)(bench_rng_next(&rng) >> 33));
+    }
+}
+
+static void bench_pair_teardown(void *p) {
+    struct bench_pair_ctx *ctx = p;
+    bpairs_deinit(&ctx->list);
+}
+
+static size_t bench_pair_cmp_run(void *p, size_t n) {
+    struct bench_pair_ctx *ctx = p;
+    struct pair_bip *pairs = ctx->list.data;
+    int acc = 0;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        acc += (int)bip_cmp(&pairs[i], &pairs[i + 1], bench_int_cmp, bench_int_cmp);
+    }
+    bench_sink += (size_t)acc;
+    return n - 1;
+}
+
+static size_t bench_pair_sort_run(void *p, size_t n) {
+    struct bench_pair_ctx *ctx = p;
+    bpairs_qsort(&ctx->list, bench_pair_less);
+    bench_sink += (size_t)ctx->list.data[0].first;
+    return n;
+}
+
+void bench_pair_suite(struct bench_state *state) {
+    static const size_t sizes[] = { 1000, 100000 };
+    struct bench_pair_ctx ctx;
+    struct bench_case c;
+    c.suite = "pair";
+    c.ctx = &ctx;
+    c.setup = bench_pair_setup;
+    c.teardown = bench_pair_teardown;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        c.n = sizes[i];
+        for (int equal = 0; equal <= 1; ++equal) {
+            ctx.equal_first = equal;
+            c.variant = equal ? "PAIR/first_equal" : "PAIR/first_differs";
+            c.name = "pair_cmp";
+            c.run = bench_pair_cmp_run;
+            bench_run(state, &c);
+            c.name = "qsort_by_pair_cmp";
+            c.run = bench_pair_sort_run;
+            bench_run(state, &c);
+        }
+    }
+}
@@ -0,0 +1,356 @@
+/**
+ * @file test.c
+ * @brief Unit tests for the hashmap.h file
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "hashmap.h"
+
+// == SIMPLE TYPE ==
+
+HASHMAP(int, int, ints, hashmap_hash_scalar, hashmap_eq_scalar, hashmap_noop_deinit, hashmap_noop_deinit)
+
+// Every key lands on the same probe sequence with the same h2, eq_fn does all the work
+#define constant_hash(key_ptr) ((void)(key_ptr), (uint64_t)0)
+
+HASHMAP(int, int, colliding, constant_hash, hashmap_eq_scalar, hashmap_noop_deinit, hashmap_noop_deinit)
+
+// == STRING KEYS ==
+
+static size_t global_key_destructor_counter = 0;
+static size_t global_value_destructor_counter = 0;
+
+static void string_deinit(char **str, struct Allocator *alloc) {
+    alloc->free(*str, strlen(*str) + 1, alloc->ctx);
+    global_key_destructor_counter++;
+}
+
+static void intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+    global_value_destructor_counter++;
+}
+
+HASHMAP(char *, int *, words, hashmap_hash_cstring, hashmap_eq_cstring, string_deinit, intptr_deinit)
+
+static char *new_string(struct Allocator *alloc, const char *str) {
+    char *copy = (char *)alloc->malloc(strlen(str) + 1, alloc->ctx);
+    memcpy(copy, str, strlen(str) + 1);
+    return copy;
+}
+
+static int *new_int(struct Allocator *alloc, int value) {
+    int *ptr = (int *)alloc->malloc(sizeof(int), alloc->ctx);
+    *ptr = value;
+    return ptr;
+}
+
+static void *failing_malloc(size_t size, void *ctx) {
+    (void)size;
+    (void)ctx;
+    return NULL;
+}
+
+static int construct_square(int *location, void *args, struct Allocator *alloc) {
+    (void)alloc;
+    int value = *(int *)args;
+    if (value < 0) {
+        return -1;
+    }
+    *location = value * value;
+    return 0;
+}
+
+void test_hashmap_insert_find_scalar_type(void) {
+    struct hashmap_ints map = ints_init(allocator_get_default());
+    assert(ints_size(&map) == 0 && ints_is_empty(&map) && ints_capacity(&map) == 0);
+    assert(ints_get(&map, 1) == NULL && !ints_contains(&map, 1));
+    assert(ints_remove(&map, 1) == HASHMAP_ERR_NOT_FOUND);
+
+    assert(ints_insert(&map, 1, 10) == HASHMAP_OK);
+    assert(ints_capacity(&map) == HASHMAP_GROUP_WIDTH);
+    assert(ints_try_insert(&map, 2, 20) == HASHMAP_OK);
+    assert(ints_try_insert(&map, 2, 99) == HASHMAP_ERR_DUPLICATE);
+    assert(*ints_get(&map, 2) == 20);
+    // insert replaces the value of a key already there
+    assert(ints_insert(&map, 1, 11) == HASHMAP_OK);
+    assert(ints_size(&map) == 2 && *ints_get(&map, 1) == 11);
+    struct pair_ints *entry = ints_find(&map, 2);
+    assert(entry != NULL && entry->first == 2 && entry->second == 20);
+    entry->second = 21;
+    assert(*ints_get(&map, 2) == 21);
+
+    assert(ints_remove(&map, 1) == HASHMAP_OK);
+    assert(ints_remove(&map, 1) == HASHMAP_ERR_NOT_FOUND);
+    assert(!ints_contains(&map, 1) && ints_contains(&map, 2) && ints_size(&map) == 1);
+
+    ints_clear(&map);
+    assert(ints_is_empty(&map) && ints_capacity(&map) == HASHMAP_GROUP_WIDTH && !ints_contains(&map, 2));
+    assert(ints_insert(&map, 3, 30) == HASHMAP_OK && *ints_get(&map, 3) == 30);
+
+    assert(ints_insert(NULL, 1, 1) == HASHMAP_ERR_NULL);
+    assert(ints_get(NULL, 1) == NULL && !ints_contains(NULL, 1) && ints_size(NULL) == 0);
+    assert(ints_next(&map, NULL) == NULL);
+    ints_deinit(&map);
+    assert(map.entries == NULL && map.size == 0);
+    ints_deinit(&map);
+    ints_deinit(NULL);
+    printf("test hashmap insert find scalar type passed\n");
+}
+
+void test_hashmap_incremental_growth_scalar_type(void) {
+    struct hashmap_ints map = ints_init(allocator_get_default());
+    const int n = 100000;
+    bool saw_migration = false;
+    for (int i = 0; i < n; ++i) {
+        size_t capacity_before = ints_capacity(&map);
+        struct pair_ints *old_before = map.old_entries;
+        size_t migrated_before = map.migrated;
+        assert(ints_insert(&map, i, i * 2) == HASHMAP_OK);
+        if (old_before != NULL && map.old_entries == old_before) {
+            // No insert moves more than a step of the old table
+            assert(map.migrated - migrated_before <= HASHMAP_MIGRATE_STEP);
+        }
+        if (map.old_entries != NULL) {
+            saw_migration = true;
+            // While the old table drains, keys of both tables must be found
+            assert(*ints_get(&map, i / 2) == (i / 2) * 2);
+            assert(*ints_get(&map, i) == i * 2);
+            assert(map.migrated <= map.old_mask + 1);
+        }
+        if (ints_capacity(&map) != capacity_before && capacity_before > 0) {
+            assert(ints_capacity(&map) == capacity_before * 2);
+            // Growing does not move the entries, the old table keeps them for now
+            assert(map.old_entries != NULL && map.migrated == 0);
+        }
+    }
+    assert(saw_migration);
+    assert(ints_size(&map) == (size_t)n);
+    for (int i = 0; i < n; ++i) {
+        int *value = ints_get(&map, i);
+        assert(value != NULL && *value == i * 2);
+    }
+    assert(!ints_contains(&map, n) && !ints_contains(&map, -1));
+    // The table never gets more than 7/8 full
+    assert(ints_size(&map) <= ints_capacity(&map) - ints_capacity(&map) / 8);
+
+    // Removes in the middle of a migration
+    for (int i = 0; i < n; i += 2) {
+        assert(ints_remove(&map, i) == HASHMAP_OK);
+    }
+    assert(ints_size(&map) == (size_t)n / 2);
+    for (int i = 0; i < n; ++i) {
+        assert(ints_contains(&map, i) == (i % 2 == 1));
+    }
+    ints_deinit(&map);
+    printf("test hashmap incremental growth scalar type passed\n");
+}
+
+void test_hashmap_churn_scalar_type(void) {
+    struct hashmap_ints map = ints_init(allocator_get_default());
+    // Reference of which keys are in the map, keys are 0..range-1
+    enum { range = 4096 };
+    static bool present[range];
+    memset(present, 0, sizeof(present));
+    size_t expected = 0;
+    unsigned seed = 12345;
+    for (int round = 0; round < 200000; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        int key = (int)((seed >> 8) % range);
+        if ((seed >> 4) & 1) {
+            enum hashmap_error err = ints_try_insert(&map, key, key + 1);
+            assert(err == (present[key] ? HASHMAP_ERR_DUPLICATE : HASHMAP_OK));
+            expected += present[key] ? 0 : 1;
+            present[key] = true;
+        } else {
+            enum hashmap_error err = ints_remove(&map, key);
+            assert(err == (present[key] ? HASHMAP_OK : HASHMAP_ERR_NOT_FOUND));
+            expected -= present[key] ? 1 : 0;
+            present[key] = false;
+        }
+        assert(ints_size(&map) == expected);
+    }
+    // Deleted markers must not make the table grow forever
+    assert(ints_capacity(&map) <= 4 * range);
+    size_t visited = 0;
+    struct pair_ints *entry;
+    for (size_t it = 0; (entry = ints_next(&map, &it)) != NULL;) {
+        assert(present[entry->first] && entry->second == entry->first + 1);
+        visited++;
+    }
+    assert(visited == expected);
+    ints_deinit(&map);
+    printf("test hashmap churn scalar type passed\n");
+}
+
+void test_hashmap_collisions_scalar_type(void) {
+    struct hashmap_colliding map = colliding_init(allocator_get_default());
+    for (int i = 0; i < 300; ++i) {
+        assert(colliding_insert(&map, i, -i) == HASHMAP_OK);
+    }
+    for (int i = 0; i < 300; ++i) {
+        assert(*colliding_get(&map, i) == -i);
+    }
+    for (int i = 0; i < 300; i += 3) {
+        assert(colliding_remove(&map, i) == HASHMAP_OK);
+    }
+    for (int i = 0; i < 300; ++i) {
+        assert(colliding_contains(&map, i) == (i % 3 != 0));
+    }
+    assert(!colliding_contains(&map, 300));
+    colliding_deinit(&map);
+    printf("test hashmap collisions scalar type passed\n");
+}
+
+void test_hashmap_reserve_iterate_scalar_type(void) {
+    struct hashmap_ints map = ints_init(allocator_get_default());
+    assert(ints_reserve(&map, 1000) == HASHMAP_OK);
+    size_t capacity = ints_capacity(&map);
+    assert(capacity - capacity / 8 >= 1000);
+    for (int i = 0; i < 1000; ++i) {
+        assert(ints_insert(&map, i, i) == HASHMAP_OK);
+    }
+    assert(ints_capacity(&map) == capacity && map.old_entries == NULL);
+    assert(ints_reserve(&map, 10) == HASHMAP_OK && ints_capacity(&map) == capacity);
+
+    // Grow once more so the iteration goes over both tables
+    int next_key = 1000;
+    while (map.old_entries == NULL) {
+        assert(ints_insert(&map, next_key, next_key) == HASHMAP_OK);
+        next_key++;
+    }
+    static bool seen[4096];
+    memset(seen, 0, sizeof(seen));
+    size_t visited = 0;
+    struct pair_ints *entry;
+    for (size_t it = 0; (entry = ints_next(&map, &it)) != NULL;) {
+        assert(entry->first >= 0 && entry->first < next_key && !seen[entry->first]);
+        seen[entry->first] = true;
+        visited++;
+    }
+    assert(visited == (size_t)next_key);
+
+    // reserve finishes the unfinished growth at once
+    assert(ints_reserve(&map, (size_t)next_key + 1) == HASHMAP_OK);
+    assert(map.old_entries == NULL && ints_size(&map) == (size_t)next_key);
+    for (int i = 0; i < next_key; ++i) {
+        assert(*ints_get(&map, i) == i);
+    }
+    assert(ints_reserve(&map, SIZE_MAX) == HASHMAP_ERR_CAPACITY);
+    assert(ints_reserve(NULL, 1) == HASHMAP_ERR_NULL);
+    ints_deinit(&map);
+    printf("test hashmap reserve iterate scalar type passed\n");
+}
+
+void test_hashmap_emplace_scalar_type(void) {
+    struct hashmap_ints map = ints_init(allocator_get_default());
+    int args = 7;
+    int *value = NULL;
+    assert(ints_emplace(&map, 1, construct_square, &args, &value) == HASHMAP_OK);
+    assert(value != NULL && *value == 49 && *ints_get(&map, 1) == 49);
+    // Each failure has its own error and leaves out as it was
+    int *untouched = value;
+    assert(ints_emplace(&map, 1, construct_square, &args, &value) == HASHMAP_ERR_DUPLICATE);
+    assert(value == untouched);
+    // A failing constructor leaves the slot free
+    args = -1;
+    assert(ints_emplace(&map, 2, construct_square, &args, &value) == HASHMAP_ERR_CONSTRUCT);
+    assert(!ints_contains(&map, 2) && ints_size(&map) == 1 && value == untouched);
+    assert(ints_emplace(&map, 3, NULL, &args, &value) == HASHMAP_ERR_NULL);
+    args = 3;
+    assert(ints_emplace(&map, 3, construct_square, &args, NULL) == HASHMAP_OK && *ints_get(&map, 3) == 9);
+    ints_deinit(&map);
+    printf("test hashmap emplace scalar type passed\n");
+}
+
+void test_hashmap_alloc_failure(void) {
+    struct Allocator failing = allocator_get_default();
+    failing.malloc = failing_malloc;
+    struct hashmap_ints map = ints_init(failing);
+    assert(ints_insert(&map, 1, 1) == HASHMAP_ERR_ALLOC);
+    assert(ints_try_insert(&map, 1, 1) == HASHMAP_ERR_ALLOC);
+    assert(ints_reserve(&map, 10) == HASHMAP_ERR_ALLOC);
+    assert(ints_size(&map) == 0 && ints_capacity(&map) == 0);
+    ints_deinit(&map);
+
+    // The first table works, the growth fails and leaves the map as it was
+    map = ints_init(allocator_get_default());
+    int key = 0;
+    while (ints_size(&map) < ints_capacity(&map) - ints_capacity(&map) / 8 || key == 0) {
+        assert(ints_insert(&map, key, key) == HASHMAP_OK);
+        key++;
+    }
+    map.alloc.malloc = failing_malloc;
+    assert(ints_insert(&map, key, key) == HASHMAP_ERR_ALLOC);
+    assert(ints_size(&map) == (size_t)key && !ints_contains(&map, key));
+    assert(ints_insert(&map, 0, 100) == HASHMAP_OK && *ints_get(&map, 0) == 100);
+    map.alloc = allocator_get_default();
+    ints_deinit(&map);
+    printf("test hashmap alloc failure passed\n");
+}
+
+void test_hashmap_string_keys_ptr(void) {
+    struct Allocator gpa = allocator_get_default();
+    global_key_destructor_counter = 0;
+    global_value_destructor_counter = 0;
+    struct hashmap_words map = words_init(gpa);
+    char buffer[32];
+    for (int i = 0; i < 500; ++i) {
+        snprintf(buffer, sizeof(buffer), "word%d", i);
+        assert(words_insert(&map, new_string(&gpa, buffer), new_int(&gpa, i)) == HASHMAP_OK);
+    }
+    assert(words_size(&map) == 500);
+    char *lookup = (char *)"word123";
+    assert(**words_get(&map, lookup) == 123);
+    assert(!words_contains(&map, (char *)"word500"));
+
+    // A replace destroys the old value, the key that was given stays with the caller like on try_insert
+    char *replaced = new_string(&gpa, "word7");
+    assert(words_insert(&map, replaced, new_int(&gpa, -7)) == HASHMAP_OK);
+    assert(global_key_destructor_counter == 0 && global_value_destructor_counter == 1);
+    assert(**words_get(&map, (char *)"word7") == -7);
+    gpa.free(replaced, strlen(replaced) + 1, gpa.ctx);
+
+    // A duplicate on try_insert takes nothing, the caller still owns both
+    char *key = new_string(&gpa, "word8");
+    int *value = new_int(&gpa, 8);
+    assert(words_try_insert(&map, key, value) == HASHMAP_ERR_DUPLICATE);
+    assert(global_key_destructor_counter == 0 && global_value_destructor_counter == 1);
+    gpa.free(key, strlen(key) + 1, gpa.ctx);
+    gpa.free(value, sizeof(int), gpa.ctx);
+
+    assert(words_remove(&map, (char *)"word9") == HASHMAP_OK);
+    assert(global_key_destructor_counter == 1 && global_value_destructor_counter == 2);
+    words_clear(&map);
+    assert(global_key_destructor_counter == 500 && global_value_destructor_counter == 501);
+    assert(words_insert(&map, new_string(&gpa, "again"), new_int(&gpa, 1)) == HASHMAP_OK);
+    words_deinit(&map);
+    assert(global_key_destructor_counter == 501 && global_value_destructor_counter == 502);
+    printf("test hashmap string keys ptr passed\n");
+}
+
+void test_hashmap_hash_functions(void) {
+    assert(hashmap_hash_u64(1) != hashmap_hash_u64(2));
+    assert(hashmap_hash_string("abc") == hashmap_hash_bytes("abc", 3));
+    assert(hashmap_hash_string("abcdefghij") != hashmap_hash_string("abcdefghik"));
+    assert(hashmap_hash_bytes("", 0) != hashmap_hash_bytes("\0", 1));
+    // The low 7 bits and the probe bits both change with the key
+    assert((hashmap_mix(1) & 0x7F) != (hashmap_mix(2) & 0x7F) || (hashmap_mix(1) >> 7) != (hashmap_mix(2) >> 7));
+    printf("test hashmap hash functions passed\n");
+}
+
+int main(void) {
+    test_hashmap_insert_find_scalar_type();
+    test_hashmap_incremental_growth_scalar_type();
+    test_hashmap_churn_scalar_type();
+    test_hashmap_collisions_scalar_type();
+    test_hashmap_reserve_iterate_scalar_type();
+    test_hashmap_emplace_scalar_type();
+    test_hashmap_alloc_failure();
+    test_hashmap_string_keys_ptr();
+    test_hashmap_hash_functions();
+    return 0;
+}
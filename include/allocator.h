@@ -7,6 +7,7 @@
 
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * @struct Allocator
@@ -60,4 +61,1007 @@ static inline struct Allocator allocator_get_default(void) {
     };
 }
 
+/**
+ * @brief Union of the types with the strictest alignment requirements, used to align blocks handed out
+ *        by the allocators in this file the same way malloc would
+ */
+union allocator_max_align {
+    long double ld;
+    long long ll;
+    double d;
+    void *p;
+    void (*fp)(void);
+};
+
+/**
+ * @brief Helper struct to get the alignment of allocator_max_align through offsetof in C99
+ */
+struct allocator_align_helper {
+    char c;
+    union allocator_max_align u;
+};
+
+/**
+ * @def ALLOCATOR_ALIGNMENT
+ * @brief Alignment of every block returned by the custom allocators in this file
+ */
+#define ALLOCATOR_ALIGNMENT (offsetof(struct allocator_align_helper, u))
+
+/**
+ * @brief Rounds size up to a multiple of ALLOCATOR_ALIGNMENT
+ */
+static inline size_t allocator_align_up(size_t size) {
+    return (size + ALLOCATOR_ALIGNMENT - 1) / ALLOCATOR_ALIGNMENT * ALLOCATOR_ALIGNMENT;
+}
+
+/* ================================ POOL ALLOCATOR ================================ */
+
+/**
+ * @def POOL_ALLOCATOR_DEFAULT_BLOCKS
+ * @brief Number of blocks per chunk used when pool_allocator_init() receives zero
+ */
+#ifndef POOL_ALLOCATOR_DEFAULT_BLOCKS
+    #define POOL_ALLOCATOR_DEFAULT_BLOCKS 256
+#endif // POOL_ALLOCATOR_DEFAULT_BLOCKS
+
+/**
+ * @struct pool_chunk
+ * @brief Header of a contiguous chunk of blocks, the blocks follow the (aligned) header
+ */
+struct pool_chunk {
+    struct pool_chunk *next; ///< Next chunk, chunks are kept in a singly linked list
+};
+
+/**
+ * @struct pool_allocator
+ * @brief Fixed size block allocator (slab/free-list), meant for node based containers
+ *
+ * Blocks are carved from big contiguous chunks obtained from the backing allocator, freed blocks
+ * are pushed into an intrusive free list and reused before carving new ones.
+ * Requests bigger than the block size are forwarded to the backing allocator, this works because
+ * the Allocator interface always passes the size of the block to realloc and free.
+ *
+ * Usage:
+ * @code
+ * struct pool_allocator pool = pool_allocator_init(allocator_get_default(), sizeof(struct node), 0);
+ * struct Allocator alloc = allocator_get_pool(&pool);
+ * // ... use alloc, pool must outlive it ...
+ * pool_allocator_deinit(&pool); // frees every chunk at once
+ * @endcode
+ *
+ * @warning Not thread safe.
+ */
+struct pool_allocator {
+    struct Allocator backing;  ///< Allocator used to get the chunks and the oversized blocks
+    size_t block_size;         ///< Size of each block, rounded up to ALLOCATOR_ALIGNMENT
+    size_t blocks_per_chunk;   ///< How many blocks each chunk holds
+    struct pool_chunk *chunks; ///< List of all the chunks, newest first
+    void *free_list;           ///< Intrusive list of freed blocks
+    char *bump;                ///< Next never used block in the newest chunk
+    char *bump_end;            ///< End of the newest chunk
+};
+
+/**
+ * @brief Creates a pool allocator, it does not allocate
+ * @param backing Allocator used to get the chunks
+ * @param block_size Size of the blocks, rounded up so it can hold a pointer and keep blocks aligned
+ * @param blocks_per_chunk Blocks per chunk, zero uses POOL_ALLOCATOR_DEFAULT_BLOCKS
+ * @return The pool, call pool_allocator_deinit() when done
+ */
+static inline struct pool_allocator pool_allocator_init(
+    struct Allocator backing,
+    size_t block_size,
+    size_t blocks_per_chunk
+) {
+    struct pool_allocator pool = { 0 };
+    if (block_size < sizeof(void *)) {
+        block_size = sizeof(void *);
+    }
+    pool.backing = backing;
+    pool.block_size = allocator_align_up(block_size);
+    pool.blocks_per_chunk = blocks_per_chunk ? blocks_per_chunk : POOL_ALLOCATOR_DEFAULT_BLOCKS;
+    return pool;
+}
+
+/**
+ * @private
+ * @brief Size of a full chunk, header included
+ */
+static inline size_t pool_allocator_chunk_size(const struct pool_allocator *pool) {
+    return allocator_align_up(sizeof(struct pool_chunk)) + pool->block_size * pool->blocks_per_chunk;
+}
+
+/**
+ * @brief Releases every chunk at once, in O(chunks), leaving the pool empty but reusable
+ * @param pool Pointer to the pool
+ *
+ * @warning Every block handed out by the pool becomes invalid, blocks bigger than the block size
+ *          came from the backing allocator and are not released by this function
+ */
+static inline void pool_allocator_release(struct pool_allocator *pool) {
+    if (!pool) {
+        return;
+    }
+    size_t chunk_size = pool_allocator_chunk_size(pool);
+    struct pool_chunk *chunk = pool->chunks;
+    while (chunk) {
+        struct pool_chunk *next = chunk->next;
+        pool->backing.free(chunk, chunk_size, pool->backing.ctx);
+        chunk = next;
+    }
+    pool->chunks = NULL;
+    pool->free_list = NULL;
+    pool->bump = NULL;
+    pool->bump_end = NULL;
+}
+
+/**
+ * @brief Destroys the pool, releasing every chunk
+ * @param pool Pointer to the pool
+ */
+static inline void pool_allocator_deinit(struct pool_allocator *pool) {
+    if (!pool) {
+        return;
+    }
+    pool_allocator_release(pool);
+    memset(pool, 0, sizeof(*pool));
+}
+
+/**
+ * @brief Pool malloc, pops the free list, carves from the newest chunk or gets a new chunk
+ */
+static inline void *pool_malloc(size_t size, void *ctx) {
+    struct pool_allocator *pool = (struct pool_allocator *)ctx;
+    if (size > pool->block_size) {
+        return pool->backing.malloc(size, pool->backing.ctx);
+    }
+    if (pool->free_list) {
+        void *block = pool->free_list;
+        pool->free_list = *(void **)block;
+        return block;
+    }
+    if (pool->bump == pool->bump_end) {
+        size_t chunk_size = pool_allocator_chunk_size(pool);
+        struct pool_chunk *chunk = (struct pool_chunk *)pool->backing.malloc(chunk_size, pool->backing.ctx);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->bump = (char *)chunk + allocator_align_up(sizeof(struct pool_chunk));
+        pool->bump_end = (char *)chunk + chunk_size;
+    }
+    void *block = pool->bump;
+    pool->bump += pool->block_size;
+    return block;
+}
+
+/**
+ * @brief Pool free, pushes the block into the free list
+ */
+static inline void pool_free(void *ptr, size_t size, void *ctx) {
+    struct pool_allocator *pool = (struct pool_allocator *)ctx;
+    if (!ptr) {
+        return;
+    }
+    if (size > pool->block_size) {
+        pool->backing.free(ptr, size, pool->backing.ctx);
+        return;
+    }
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+}
+
+/**
+ * @brief Pool realloc, blocks are fixed size so it only moves when crossing the block size
+ */
+static inline void *pool_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    struct pool_allocator *pool = (struct pool_allocator *)ctx;
+    if (!ptr) {
+        return pool_malloc(new_size, ctx);
+    }
+    if (old_size <= pool->block_size && new_size <= pool->block_size) {
+        return ptr;
+    }
+    if (old_size > pool->block_size && new_size > pool->block_size) {
+        return pool->backing.realloc(ptr, old_size, new_size, pool->backing.ctx);
+    }
+    void *new_ptr = pool_malloc(new_size, ctx);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    pool_free(ptr, old_size, ctx);
+    return new_ptr;
+}
+
+/**
+ * @brief function that returns an allocator backed by the given pool
+ * @param pool Pointer to the pool, must outlive the returned allocator
+ *
+ * @return An Allocator that uses pool_malloc, pool_realloc, and pool_free
+ */
+static inline struct Allocator allocator_get_pool(struct pool_allocator *pool) {
+    return (struct Allocator) {
+        .malloc = pool_malloc,
+        .realloc = pool_realloc,
+        .free = pool_free,
+        .ctx = pool,
+    };
+}
+
+/* ================================ ARENA ALLOCATOR ================================ */
+
+/**
+ * @def ARENA_ALLOCATOR_DEFAULT_BLOCK
+ * @brief Size of each arena block used when arena_allocator_init() receives zero
+ */
+#ifndef ARENA_ALLOCATOR_DEFAULT_BLOCK
+    #define ARENA_ALLOCATOR_DEFAULT_BLOCK (64 * 1024)
+#endif // ARENA_ALLOCATOR_DEFAULT_BLOCK
+
+/**
+ * @struct arena_block
+ * @brief Header of an arena block, the memory handed out follows the (aligned) header
+ */
+struct arena_block {
+    struct arena_block *prev; ///< Previous (older) block
+    size_t capacity;          ///< Usable bytes after the header
+    size_t used;              ///< Bytes already handed out
+};
+
+/**
+ * @struct arena_allocator
+ * @brief Linear (bump) allocator, everything is released at once with arena_reset_to() or deinit
+ *
+ * malloc bumps a pointer in the newest block, free is a no-op, and realloc of the last allocation
+ * grows or shrinks in place while there is room in the block, which makes the doubling of a single
+ * growing arraylist almost free.
+ *
+ * Usage:
+ * @code
+ * struct arena_allocator arena = arena_allocator_init(allocator_get_default(), 0);
+ * struct Allocator alloc = allocator_get_arena(&arena);
+ * struct arena_marker mark = arena_mark(&arena);
+ * // ... per request containers using alloc ...
+ * arena_reset_to(&arena, mark); // throws everything allocated since mark away
+ * arena_allocator_deinit(&arena);
+ * @endcode
+ *
+ * @warning Not thread safe.
+ * @warning Containers using the arena must not be used after a reset that covers their memory,
+ *          calling their deinit is not needed (the free calls are no-ops) but is harmless before the reset
+ */
+struct arena_allocator {
+    struct Allocator backing;    ///< Allocator used to get the blocks
+    size_t block_size;           ///< Minimum size of each new block
+    struct arena_block *current; ///< Newest block, allocations bump from here
+    char *last;                  ///< Start of the last allocation, the only one realloc can resize in place
+};
+
+/**
+ * @struct arena_marker
+ * @brief Position in the arena returned by arena_mark(), used by arena_reset_to()
+ */
+struct arena_marker {
+    struct arena_block *block; ///< Block that was the newest when marked
+    size_t used;               ///< Bytes used in that block when marked
+};
+
+/**
+ * @brief Creates an arena allocator, it does not allocate
+ * @param backing Allocator used to get the blocks
+ * @param block_size Minimum size of each block, zero uses ARENA_ALLOCATOR_DEFAULT_BLOCK
+ * @return The arena, call arena_allocator_deinit() when done
+ */
+static inline struct arena_allocator arena_allocator_init(struct Allocator backing, size_t block_size) {
+    struct arena_allocator arena = { 0 };
+    arena.backing = backing;
+    arena.block_size = block_size ? block_size : ARENA_ALLOCATOR_DEFAULT_BLOCK;
+    return arena;
+}
+
+/**
+ * @private
+ * @brief Start of the usable memory of a block
+ */
+static inline char *arena_block_data(struct arena_block *block) {
+    return (char *)block + allocator_align_up(sizeof(struct arena_block));
+}
+
+/**
+ * @brief Gets the current position of the arena
+ * @param arena Pointer to the arena
+ * @return A marker to pass to arena_reset_to()
+ */
+static inline struct arena_marker arena_mark(const struct arena_allocator *arena) {
+    struct arena_marker mark = { 0 };
+    if (arena && arena->current) {
+        mark.block = arena->current;
+        mark.used = arena->current->used;
+    }
+    return mark;
+}
+
+/**
+ * @brief Releases everything allocated after mark was taken
+ * @param arena Pointer to the arena
+ * @param mark Marker returned by arena_mark() on this arena, blocks newer than it are freed
+ *
+ * @note A marker taken on an empty arena keeps the oldest block around for reuse instead of freeing it
+ *
+ * @warning Markers taken after mark are invalidated
+ */
+static inline void arena_reset_to(struct arena_allocator *arena, struct arena_marker mark) {
+    if (!arena) {
+        return;
+    }
+    size_t header = allocator_align_up(sizeof(struct arena_block));
+    while (arena->current && arena->current != mark.block && arena->current->prev) {
+        struct arena_block *prev = arena->current->prev;
+        arena->backing.free(arena->current, header + arena->current->capacity, arena->backing.ctx);
+        arena->current = prev;
+    }
+    if (arena->current) {
+        arena->current->used = arena->current == mark.block ? mark.used : 0;
+    }
+    arena->last = NULL;
+}
+
+/**
+ * @brief Releases everything allocated from the arena, keeping one block for reuse
+ * @param arena Pointer to the arena
+ */
+static inline void arena_reset(struct arena_allocator *arena) {
+    struct arena_marker empty = { 0 };
+    arena_reset_to(arena, empty);
+}
+
+/**
+ * @brief Destroys the arena, freeing every block
+ * @param arena Pointer to the arena
+ */
+static inline void arena_allocator_deinit(struct arena_allocator *arena) {
+    if (!arena) {
+        return;
+    }
+    size_t header = allocator_align_up(sizeof(struct arena_block));
+    while (arena->current) {
+        struct arena_block *prev = arena->current->prev;
+        arena->backing.free(arena->current, header + arena->current->capacity, arena->backing.ctx);
+        arena->current = prev;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+/**
+ * @brief Arena malloc, bumps the newest block or gets a new one big enough for size
+ *
+ * @note A size of 0 still takes one aligned unit, so every pointer returned is distinct
+ */
+static inline void *arena_malloc(size_t size, void *ctx) {
+    struct arena_allocator *arena = (struct arena_allocator *)ctx;
+    if (size > (size_t)-1 / 2) {
+        return NULL;
+    }
+    size = allocator_align_up(size > 0 ? size : 1);
+    struct arena_block *block = arena->current;
+    if (!block || block->capacity - block->used < size) {
+        size_t header = allocator_align_up(sizeof(struct arena_block));
+        size_t capacity = size > arena->block_size ? size : arena->block_size;
+        block = (struct arena_block *)arena->backing.malloc(header + capacity, arena->backing.ctx);
+        if (!block) {
+            return NULL;
+        }
+        block->prev = arena->current;
+        block->capacity = capacity;
+        block->used = 0;
+        arena->current = block;
+    }
+    char *ptr = arena_block_data(block) + block->used;
+    block->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+/**
+ * @brief Arena realloc, resizes in place when ptr is the last allocation and the block has room
+ */
+static inline void *arena_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    struct arena_allocator *arena = (struct arena_allocator *)ctx;
+    if (!ptr) {
+        return arena_malloc(new_size, ctx);
+    }
+    if ((char *)ptr == arena->last) {
+        struct arena_block *block = arena->current;
+        size_t offset = (size_t)(arena->last - arena_block_data(block));
+        size_t aligned = allocator_align_up(new_size > 0 ? new_size : 1);
+        if (aligned <= block->capacity - offset) {
+            block->used = offset + aligned;
+            return ptr;
+        }
+    }
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    void *new_ptr = arena_malloc(new_size, ctx);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size);
+    return new_ptr;
+}
+
+/**
+ * @brief Arena free, a no-op, memory is released by arena_reset_to() or arena_allocator_deinit()
+ */
+static inline void arena_free(void *ptr, size_t size, void *ctx) {
+    (void)ptr;
+    (void)size;
+    (void)ctx;
+}
+
+/**
+ * @brief function that returns an allocator backed by the given arena
+ * @param arena Pointer to the arena, must outlive the returned allocator
+ *
+ * @return An Allocator that uses arena_malloc, arena_realloc, and arena_free
+ */
+static inline struct Allocator allocator_get_arena(struct arena_allocator *arena) {
+    return (struct Allocator) {
+        .malloc = arena_malloc,
+        .realloc = arena_realloc,
+        .free = arena_free,
+        .ctx = arena,
+    };
+}
+
+/* ================================ STATS ALLOCATOR ================================ */
+
+/**
+ * @def ALLOCATOR_STATS_BUCKETS
+ * @brief Number of buckets in the size histogram of the stats allocator
+ *
+ * Bucket i counts the requests of up to (16 << i) bytes, the last bucket counts everything bigger.
+ */
+#ifndef ALLOCATOR_STATS_BUCKETS
+    #define ALLOCATOR_STATS_BUCKETS 16
+#endif // ALLOCATOR_STATS_BUCKETS
+
+/**
+ * @struct allocator_stats
+ * @brief Wrapping allocator that counts what goes through it before forwarding to the backing allocator
+ *
+ * Sizes are the ones passed through the interface, so the numbers are exact for the containers in this
+ * library, that always give free and realloc the size of the block they own.
+ * The histogram records the size of every malloc and the new size of every realloc, it is meant to pick
+ * the argument of reserve() calls and the block sizes of pools.
+ *
+ * Usage:
+ * @code
+ * struct allocator_stats stats = allocator_stats_init(allocator_get_default());
+ * struct Allocator alloc = allocator_get_stats(&stats);
+ * // ... containers using alloc ...
+ * printf("peak %zu bytes in %zu mallocs\n", stats.bytes_peak, stats.malloc_calls);
+ * @endcode
+ *
+ * @warning Not thread safe, the counters are plain size_t.
+ */
+struct allocator_stats {
+    struct Allocator backing;                  ///< Allocator doing the real work
+    size_t malloc_calls;                       ///< Calls to malloc
+    size_t realloc_calls;                      ///< Calls to realloc
+    size_t free_calls;                         ///< Calls to free with a non null pointer
+    size_t failed_calls;                       ///< malloc or realloc calls that returned NULL
+    size_t bytes_live;                         ///< Bytes currently allocated
+    size_t bytes_peak;                         ///< Highest value bytes_live reached
+    size_t histogram[ALLOCATOR_STATS_BUCKETS]; ///< Requests by size, see ALLOCATOR_STATS_BUCKETS
+};
+
+/**
+ * @brief Creates a stats allocator, all counters start at zero
+ * @param backing Allocator the calls are forwarded to
+ * @return The stats allocator, it holds no resources of its own
+ */
+static inline struct allocator_stats allocator_stats_init(struct Allocator backing) {
+    struct allocator_stats stats = { 0 };
+    stats.backing = backing;
+    return stats;
+}
+
+/**
+ * @brief Sets every counter back to zero, bytes_live included, the backing allocator is kept
+ * @param stats Pointer to the stats allocator
+ */
+static inline void allocator_stats_reset(struct allocator_stats *stats) {
+    if (!stats) {
+        return;
+    }
+    struct Allocator backing = stats->backing;
+    *stats = allocator_stats_init(backing);
+}
+
+/**
+ * @brief Histogram bucket of a request size
+ * @param size Bytes requested
+ * @return Index into allocator_stats.histogram
+ */
+static inline size_t allocator_stats_bucket(size_t size) {
+    size_t bucket = 0;
+    size_t limit = 16;
+    while (bucket + 1 < ALLOCATOR_STATS_BUCKETS && size > limit) {
+        limit <<= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * @private
+ * @brief Adds bytes to bytes_live and keeps bytes_peak up to date
+ */
+static inline void allocator_stats_grow_live(struct allocator_stats *stats, size_t bytes) {
+    stats->bytes_live += bytes;
+    if (stats->bytes_live > stats->bytes_peak) {
+        stats->bytes_peak = stats->bytes_live;
+    }
+}
+
+/**
+ * @brief Stats malloc, counts the call and its size and forwards it
+ */
+static inline void *stats_malloc(size_t size, void *ctx) {
+    struct allocator_stats *stats = (struct allocator_stats *)ctx;
+    stats->malloc_calls++;
+    stats->histogram[allocator_stats_bucket(size)]++;
+    void *ptr = stats->backing.malloc(size, stats->backing.ctx);
+    if (!ptr) {
+        stats->failed_calls++;
+        return NULL;
+    }
+    allocator_stats_grow_live(stats, size);
+    return ptr;
+}
+
+/**
+ * @brief Stats realloc, counts the call and its new size and forwards it
+ */
+static inline void *stats_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    struct allocator_stats *stats = (struct allocator_stats *)ctx;
+    stats->realloc_calls++;
+    stats->histogram[allocator_stats_bucket(new_size)]++;
+    void *new_ptr = stats->backing.realloc(ptr, old_size, new_size, stats->backing.ctx);
+    if (!new_ptr) {
+        stats->failed_calls++;
+        return NULL;
+    }
+    if (!ptr) {
+        old_size = 0;
+    }
+    stats->bytes_live -= old_size < stats->bytes_live ? old_size : stats->bytes_live;
+    allocator_stats_grow_live(stats, new_size);
+    return new_ptr;
+}
+
+/**
+ * @brief Stats free, counts the call and forwards it
+ */
+static inline void stats_free(void *ptr, size_t size, void *ctx) {
+    struct allocator_stats *stats = (struct allocator_stats *)ctx;
+    if (!ptr) {
+        return;
+    }
+    stats->free_calls++;
+    stats->bytes_live -= size < stats->bytes_live ? size : stats->bytes_live;
+    stats->backing.free(ptr, size, stats->backing.ctx);
+}
+
+/**
+ * @brief function that returns an allocator that counts into the given stats
+ * @param stats Pointer to the stats allocator, must outlive the returned allocator
+ *
+ * @return An Allocator that uses stats_malloc, stats_realloc, and stats_free
+ */
+static inline struct Allocator allocator_get_stats(struct allocator_stats *stats) {
+    return (struct Allocator) {
+        .malloc = stats_malloc,
+        .realloc = stats_realloc,
+        .free = stats_free,
+        .ctx = stats,
+    };
+}
+
+/* ================================ THREAD CACHING ALLOCATOR ================================ */
+
+/**
+ * @def ALLOCATOR_PTHREAD
+ * @brief Define before including the header for the thread caching allocator, it needs pthreads
+ *
+ * Under a strict -std=c99 some pthread declarations need _POSIX_C_SOURCE 200112L or later, defined
+ * before the first system header.
+ */
+#ifdef ALLOCATOR_PTHREAD
+#include <pthread.h> // For pthread_mutex_t, pthread_key_t
+
+/**
+ * @def TCACHE_ALLOCATOR_MAX_SIZE
+ * @brief Biggest request served from the size classes, bigger ones go to the backing allocator
+ *
+ * Size classes are ALLOCATOR_ALIGNMENT apart, so a block wastes less than ALLOCATOR_ALIGNMENT bytes.
+ */
+#ifndef TCACHE_ALLOCATOR_MAX_SIZE
+    #define TCACHE_ALLOCATOR_MAX_SIZE 512
+#endif // TCACHE_ALLOCATOR_MAX_SIZE
+
+/**
+ * @def TCACHE_ALLOCATOR_BATCH
+ * @brief Blocks moved at once between a thread cache and the shared lists, and blocks per new chunk
+ *
+ * A thread cache holding more than twice this many blocks of a class gives this many back.
+ */
+#ifndef TCACHE_ALLOCATOR_BATCH
+    #define TCACHE_ALLOCATOR_BATCH 32
+#endif // TCACHE_ALLOCATOR_BATCH
+
+/**
+ * @def TCACHE_ALLOCATOR_CLASSES
+ * @brief Number of size classes, class c holds blocks of (c + 1) * ALLOCATOR_ALIGNMENT bytes
+ */
+#define TCACHE_ALLOCATOR_CLASSES ((TCACHE_ALLOCATOR_MAX_SIZE + ALLOCATOR_ALIGNMENT - 1) / ALLOCATOR_ALIGNMENT)
+
+/**
+ * @struct tcache_bin
+ * @brief Intrusive list of free blocks of one size class
+ */
+struct tcache_bin {
+    void *head;   ///< First free block, each block holds the next one in its first bytes
+    size_t count; ///< Blocks in the list
+};
+
+/**
+ * @struct tcache_chunk
+ * @brief Header of a contiguous chunk of TCACHE_ALLOCATOR_BATCH blocks of one class
+ */
+struct tcache_chunk {
+    struct tcache_chunk *next; ///< Next chunk, chunks are kept in a singly linked list
+    size_t size;               ///< Size of the chunk, header included, to give it back to the backing allocator
+};
+
+/**
+ * @struct tcache_local
+ * @brief Free blocks cached by one thread, only that thread touches the bins
+ */
+struct tcache_local {
+    struct tcache_bin bins[TCACHE_ALLOCATOR_CLASSES]; ///< Free blocks by size class
+    struct tcache_allocator *owner;                   ///< Allocator the cache belongs to
+    struct tcache_local *next;                        ///< Next cache of the same allocator
+};
+
+/**
+ * @struct tcache_allocator
+ * @brief Thread caching allocator, per thread size class free lists in front of any backing allocator
+ *
+ * Requests up to TCACHE_ALLOCATOR_MAX_SIZE are served from a free list of the calling thread without any
+ * lock. When a list runs dry TCACHE_ALLOCATOR_BATCH blocks are taken from the shared lists at once, or
+ * carved from a new chunk, and when a list grows past twice that a batch goes back, so the lock is taken
+ * once every TCACHE_ALLOCATOR_BATCH calls at most. The size class comes from the size every call already
+ * passes, blocks have no header. Bigger requests are forwarded to the backing allocator under the lock.
+ *
+ * Every call to the backing allocator is made with the lock held, so the backing allocator does not need
+ * to be thread safe itself, a pool, an arena or a stats allocator work.
+ *
+ * Usage:
+ * @code
+ * #define ALLOCATOR_PTHREAD
+ * #include "allocator.h"
+ *
+ * struct tcache_allocator tcache;
+ * tcache_allocator_init(&tcache, allocator_get_default());
+ * struct Allocator alloc = allocator_get_tcache(&tcache);
+ * // ... containers using alloc from any number of threads ...
+ * tcache_allocator_deinit(&tcache); // once they are done, frees every chunk
+ * @endcode
+ *
+ * @note Like the pool, small blocks are recycled and only given back to the backing allocator by deinit.
+ * @note A thread cache is given back to the shared lists when its thread exits.
+ *
+ * @warning A pthread_mutex_t can not be copied, the struct must stay where init put it
+ */
+struct tcache_allocator {
+    struct Allocator backing;                           ///< Allocator for the chunks, caches and big blocks
+    pthread_mutex_t lock;                               ///< Guards every field below and the backing calls
+    pthread_key_t key;                                  ///< Cache of the calling thread
+    struct tcache_bin shared[TCACHE_ALLOCATOR_CLASSES]; ///< Free blocks given back by the threads
+    struct tcache_chunk *chunks;                        ///< Every chunk, newest first
+    struct tcache_local *locals;                        ///< Every thread cache, so deinit can drop them
+};
+
+/**
+ * @private
+ * @brief Size class of a request of size bytes, size must not be bigger than TCACHE_ALLOCATOR_MAX_SIZE
+ */
+static inline size_t tcache_class(size_t size) {
+    return size == 0 ? 0 : (size - 1) / ALLOCATOR_ALIGNMENT;
+}
+
+/**
+ * @private
+ * @brief Moves count blocks, count must not be more than src holds, from the front of src to dst
+ */
+static inline void tcache_bin_move(struct tcache_bin *dst, struct tcache_bin *src, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    void *first = src->head;
+    void *last = first;
+    for (size_t i = 1; i < count; ++i) {
+        last = *(void **)last;
+    }
+    src->head = *(void **)last;
+    src->count -= count;
+    *(void **)last = dst->head;
+    dst->head = first;
+    dst->count += count;
+}
+
+/**
+ * @private
+ * @brief Gives every block of a thread cache back to the shared lists, lock held
+ */
+static inline void tcache_local_drain(struct tcache_allocator *tc, struct tcache_local *local) {
+    for (size_t c = 0; c < TCACHE_ALLOCATOR_CLASSES; ++c) {
+        tcache_bin_move(&tc->shared[c], &local->bins[c], local->bins[c].count);
+    }
+}
+
+/**
+ * @private
+ * @brief Thread exit destructor of the key, drains the cache and frees it
+ */
+static inline void tcache_local_destroy(void *ptr) {
+    struct tcache_local *local = (struct tcache_local *)ptr;
+    struct tcache_allocator *tc = local->owner;
+    pthread_mutex_lock(&tc->lock);
+    tcache_local_drain(tc, local);
+    struct tcache_local **link = &tc->locals;
+    while (*link != local) {
+        link = &(*link)->next;
+    }
+    *link = local->next;
+    tc->backing.free(local, sizeof(*local), tc->backing.ctx);
+    pthread_mutex_unlock(&tc->lock);
+}
+
+/**
+ * @private
+ * @brief Gets the cache of the calling thread, creating it on first use
+ * @return The cache, or NULL if it could not be allocated or registered
+ */
+static inline struct tcache_local *tcache_local_get(struct tcache_allocator *tc) {
+    struct tcache_local *local = (struct tcache_local *)pthread_getspecific(tc->key);
+    if (local) {
+        return local;
+    }
+    pthread_mutex_lock(&tc->lock);
+    local = (struct tcache_local *)tc->backing.malloc(sizeof(*local), tc->backing.ctx);
+    if (local) {
+        memset(local, 0, sizeof(*local));
+        local->owner = tc;
+        if (pthread_setspecific(tc->key, local) == 0) {
+            local->next = tc->locals;
+            tc->locals = local;
+        } else {
+            tc->backing.free(local, sizeof(*local), tc->backing.ctx);
+            local = NULL;
+        }
+    }
+    pthread_mutex_unlock(&tc->lock);
+    return local;
+}
+
+/**
+ * @private
+ * @brief Fills an empty bin with a batch from the shared list, or from a new chunk, lock held
+ */
+static inline void tcache_refill(struct tcache_allocator *tc, struct tcache_bin *bin, size_t c) {
+    struct tcache_bin *shared = &tc->shared[c];
+    if (shared->count > 0) {
+        tcache_bin_move(bin, shared, shared->count < TCACHE_ALLOCATOR_BATCH ? shared->count : TCACHE_ALLOCATOR_BATCH);
+        return;
+    }
+    size_t block_size = (c + 1) * ALLOCATOR_ALIGNMENT;
+    size_t header = allocator_align_up(sizeof(struct tcache_chunk));
+    size_t chunk_size = header + block_size * TCACHE_ALLOCATOR_BATCH;
+    struct tcache_chunk *chunk = (struct tcache_chunk *)tc->backing.malloc(chunk_size, tc->backing.ctx);
+    if (!chunk) {
+        return;
+    }
+    chunk->next = tc->chunks;
+    chunk->size = chunk_size;
+    tc->chunks = chunk;
+    /* linked back to front so the blocks are handed out in address order */
+    char *blocks = (char *)chunk + header;
+    for (size_t i = TCACHE_ALLOCATOR_BATCH; i-- > 0;) {
+        *(void **)(blocks + i * block_size) = bin->head;
+        bin->head = blocks + i * block_size;
+    }
+    bin->count += TCACHE_ALLOCATOR_BATCH;
+}
+
+/**
+ * @brief Creates a thread caching allocator, it does not allocate
+ * @param tc Pointer to the allocator to initialize
+ * @param backing Allocator used for the chunks, the thread caches and the requests over
+ *                TCACHE_ALLOCATOR_MAX_SIZE, it is only called with the lock held
+ * @return 0, or the error of pthread_mutex_init or pthread_key_create, tc is not usable then
+ */
+static inline int tcache_allocator_init(struct tcache_allocator *tc, struct Allocator backing) {
+    memset(tc, 0, sizeof(*tc));
+    tc->backing = backing;
+    int err = pthread_mutex_init(&tc->lock, NULL);
+    if (err != 0) {
+        return err;
+    }
+    err = pthread_key_create(&tc->key, tcache_local_destroy);
+    if (err != 0) {
+        pthread_mutex_destroy(&tc->lock);
+    }
+    return err;
+}
+
+/**
+ * @brief Gives the cache of the calling thread back to the shared lists, for other threads to reuse
+ * @param tc Pointer to the allocator
+ *
+ * @note Not needed before a thread exits, its cache is given back then
+ */
+static inline void tcache_allocator_flush(struct tcache_allocator *tc) {
+    struct tcache_local *local = (struct tcache_local *)pthread_getspecific(tc->key);
+    if (!local) {
+        return;
+    }
+    pthread_mutex_lock(&tc->lock);
+    tcache_local_drain(tc, local);
+    pthread_mutex_unlock(&tc->lock);
+}
+
+/**
+ * @brief Destroys the allocator, freeing every chunk and every thread cache
+ * @param tc Pointer to the allocator
+ *
+ * @warning Every block up to TCACHE_ALLOCATOR_MAX_SIZE becomes invalid, bigger blocks came from the backing
+ *          allocator and are not freed. No thread may use the allocator during or after this call.
+ */
+static inline void tcache_allocator_deinit(struct tcache_allocator *tc) {
+    if (!tc) {
+        return;
+    }
+    /* the key goes first, threads exiting later no longer run the destructor */
+    pthread_key_delete(tc->key);
+    while (tc->locals) {
+        struct tcache_local *next = tc->locals->next;
+        tc->backing.free(tc->locals, sizeof(*tc->locals), tc->backing.ctx);
+        tc->locals = next;
+    }
+    while (tc->chunks) {
+        struct tcache_chunk *next = tc->chunks->next;
+        tc->backing.free(tc->chunks, tc->chunks->size, tc->backing.ctx);
+        tc->chunks = next;
+    }
+    pthread_mutex_destroy(&tc->lock);
+    memset(tc, 0, sizeof(*tc));
+}
+
+/**
+ * @brief Thread caching malloc, pops the list of the calling thread, refilling it in a batch when empty
+ */
+static inline void *tcache_malloc(size_t size, void *ctx) {
+    struct tcache_allocator *tc = (struct tcache_allocator *)ctx;
+    if (size > TCACHE_ALLOCATOR_MAX_SIZE) {
+        pthread_mutex_lock(&tc->lock);
+        void *ptr = tc->backing.malloc(size, tc->backing.ctx);
+        pthread_mutex_unlock(&tc->lock);
+        return ptr;
+    }
+    struct tcache_local *local = tcache_local_get(tc);
+    if (!local) {
+        return NULL;
+    }
+    size_t c = tcache_class(size);
+    struct tcache_bin *bin = &local->bins[c];
+    if (!bin->head) {
+        pthread_mutex_lock(&tc->lock);
+        tcache_refill(tc, bin, c);
+        pthread_mutex_unlock(&tc->lock);
+        if (!bin->head) {
+            return NULL;
+        }
+    }
+    void *block = bin->head;
+    bin->head = *(void **)block;
+    bin->count -= 1;
+    return block;
+}
+
+/**
+ * @brief Thread caching free, pushes the block into the list of the calling thread, giving a batch back
+ *        to the shared lists when it grows too long
+ */
+static inline void tcache_free(void *ptr, size_t size, void *ctx) {
+    struct tcache_allocator *tc = (struct tcache_allocator *)ctx;
+    if (!ptr) {
+        return;
+    }
+    if (size > TCACHE_ALLOCATOR_MAX_SIZE) {
+        pthread_mutex_lock(&tc->lock);
+        tc->backing.free(ptr, size, tc->backing.ctx);
+        pthread_mutex_unlock(&tc->lock);
+        return;
+    }
+    size_t c = tcache_class(size);
+    struct tcache_local *local = tcache_local_get(tc);
+    if (!local) {
+        /* no cache for this thread, the block goes straight to the shared list */
+        pthread_mutex_lock(&tc->lock);
+        *(void **)ptr = tc->shared[c].head;
+        tc->shared[c].head = ptr;
+        tc->shared[c].count += 1;
+        pthread_mutex_unlock(&tc->lock);
+        return;
+    }
+    struct tcache_bin *bin = &local->bins[c];
+    *(void **)ptr = bin->head;
+    bin->head = ptr;
+    bin->count += 1;
+    if (bin->count > 2 * TCACHE_ALLOCATOR_BATCH) {
+        pthread_mutex_lock(&tc->lock);
+        tcache_bin_move(&tc->shared[c], bin, TCACHE_ALLOCATOR_BATCH);
+        pthread_mutex_unlock(&tc->lock);
+    }
+}
+
+/**
+ * @brief Thread caching realloc, stays in place within a size class and only moves when crossing it
+ */
+static inline void *tcache_realloc(void *ptr, size_t old_size, size_t new_size, void *ctx) {
+    struct tcache_allocator *tc = (struct tcache_allocator *)ctx;
+    if (!ptr) {
+        return tcache_malloc(new_size, ctx);
+    }
+    if (old_size <= TCACHE_ALLOCATOR_MAX_SIZE && new_size <= TCACHE_ALLOCATOR_MAX_SIZE
+        && tcache_class(old_size) == tcache_class(new_size)) {
+        return ptr;
+    }
+    if (old_size > TCACHE_ALLOCATOR_MAX_SIZE && new_size > TCACHE_ALLOCATOR_MAX_SIZE) {
+        pthread_mutex_lock(&tc->lock);
+        void *new_ptr = tc->backing.realloc(ptr, old_size, new_size, tc->backing.ctx);
+        pthread_mutex_unlock(&tc->lock);
+        return new_ptr;
+    }
+    void *new_ptr = tcache_malloc(new_size, ctx);
+    if (!new_ptr) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    tcache_free(ptr, old_size, ctx);
+    return new_ptr;
+}
+
+/**
+ * @brief function that returns an allocator backed by the given thread caching allocator
+ * @param tc Pointer to the thread caching allocator, must outlive the returned allocator
+ *
+ * @return An Allocator that uses tcache_malloc, tcache_realloc, and tcache_free
+ */
+static inline struct Allocator allocator_get_tcache(struct tcache_allocator *tc) {
+    return (struct Allocator) {
+        .malloc = tcache_malloc,
+        .realloc = tcache_realloc,
+        .free = tcache_free,
+        .ctx = tc,
+    };
+}
+
+#endif // ALLOCATOR_PTHREAD
+
 #endif // ALLOCATOR_H
@@ -8,10 +8,13 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
 
+#include <limits.h>  // For CHAR_BIT
 #include <stdbool.h> // For bool, true, false
-#include <string.h>  // For memset()
+#include <stdint.h>  // For uint32_t, UINT32_MAX
+#include <string.h>  // For memset(), memcpy(), strcmp()
 
 #include "allocator.h" // For a custom Allocator interface
+#include "arraylist.h" // For the node storage of AVLTREE_INDEXED
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,6 +58,16 @@ extern "C" {
     #define avltree_noop_deinit(ptr, alloc) ((void)0)
 #endif // avltree_noop_deinit
 
+/**
+ * @def AVLTREE_DEINIT_IS_NOOP
+ * @brief Checks, by name, if deinit_fn given to AVLTREE_IMPL is avltree_noop_deinit
+ * @details Used to skip visiting every node when the nodes live in a pool and there is nothing to destroy,
+ *          strcmp() of two literals is folded by the compiler with optimizations on
+ */
+#ifndef AVLTREE_DEINIT_IS_NOOP
+    #define AVLTREE_DEINIT_IS_NOOP(deinit_fn) (strcmp(#deinit_fn, "avltree_noop_deinit") == 0)
+#endif // AVLTREE_DEINIT_IS_NOOP
+
 /**
  * @def AVLTREE_LINKAGE
  * @brief Defines a macro to switch between static inline or another type of linkage before
@@ -195,6 +208,135 @@ extern "C" {
     #define AVLTREE_CAST(T)
 #endif // AVLTREE_CAST(T)
 
+/**
+ * @def AVLTREE_STATS
+ * @brief Define before including the header to give every avltree struct a "stats" field
+ *
+ * The counters tell how many nodes a tree went through and how much balancing and comparing it did,
+ * which is what is needed to size node pools. When AVLTREE_STATS is not defined the field and every
+ * counter update compile to nothing.
+ *
+ * @code
+ * #define AVLTREE_STATS
+ * #include "avltree.h"
+ * // ... use tree ...
+ * printf("%zu rotations, %zu comparisons\n", tree.stats.rotations, tree.stats.comparisons);
+ * @endcode
+ *
+ * @warning Every TU sharing an avltree type must agree on AVLTREE_STATS, it changes the struct layout
+ */
+#ifdef AVLTREE_STATS
+/**
+ * @struct avltree_stats
+ * @brief Counters kept by each avltree when AVLTREE_STATS is defined, zeroed by init()
+ */
+struct avltree_stats {
+    size_t node_allocs; ///< Nodes allocated, a duplicate emplace allocates before it finds out
+    size_t node_frees;  ///< Nodes freed, or handed back together when a pool is released
+    size_t rotations;   ///< Single rotations done by rebalance, a double rotation counts as two
+    size_t comparisons; ///< Calls to comparator_fn
+};
+
+    #define AVLTREE_STATS_FIELD struct avltree_stats stats;
+    /* The cast lets the const functions (find...) count too */
+    #define AVLTREE_STAT_ADD(self, field, n) ((void)(((struct avltree_stats *)&(self)->stats)->field += (n)))
+    #define AVLTREE_CMP(self, a, b) (AVLTREE_STAT_ADD(self, comparisons, 1), (self)->comparator_fn(a, b))
+#else
+    #define AVLTREE_STATS_FIELD
+    #define AVLTREE_STAT_ADD(self, field, n) ((void)0)
+    #define AVLTREE_CMP(self, a, b) ((self)->comparator_fn(a, b))
+#endif // AVLTREE_STATS
+
+/**
+ * @def AVLTREE_HEIGHT_TYPE
+ * @brief Type of the height stored in every node, size_t unless AVLTREE_COMPACT_NODES is defined
+ *
+ * An AVL tree of n nodes is at most about 1.44 * log2(n) high, so unsigned char is enough for any tree
+ * that fits in memory and lets the height share the padding after small keys.
+ */
+
+/**
+ * @def AVLTREE_NO_PARENT
+ * @brief Define before including the header to drop the parent pointer from the nodes
+ *
+ * insert, remove and emplace record the links they walk through on the way down and rebalance back up
+ * through them, and deinit/clear flatten the tree while freeing it, so nothing needs the parent.
+ */
+
+/**
+ * @def AVLTREE_COMPACT_NODES
+ * @brief Define before including the header for the smallest nodes, it implies AVLTREE_NO_PARENT and a
+ *        unsigned char AVLTREE_HEIGHT_TYPE
+ *
+ * A node of int goes from 40 to 24 bytes on 64 bit targets, more nodes per cache line on lookups.
+ *
+ * @warning Every TU sharing an avltree type must agree on these options, they change the node layout
+ */
+#ifdef AVLTREE_COMPACT_NODES
+    #ifndef AVLTREE_HEIGHT_TYPE
+        #define AVLTREE_HEIGHT_TYPE unsigned char
+    #endif // AVLTREE_HEIGHT_TYPE
+    #ifndef AVLTREE_NO_PARENT
+        #define AVLTREE_NO_PARENT
+    #endif // AVLTREE_NO_PARENT
+#endif // AVLTREE_COMPACT_NODES
+
+#ifndef AVLTREE_HEIGHT_TYPE
+    #define AVLTREE_HEIGHT_TYPE size_t
+#endif // AVLTREE_HEIGHT_TYPE
+
+#ifdef AVLTREE_NO_PARENT
+    #define AVLTREE_HAS_PARENT 0
+    #define AVLTREE_PARENT_FIELD(name)
+    #define AVLTREE_SET_PARENT(node, value) ((void)0)
+    #define AVLTREE_GET_PARENT(node) NULL
+#else
+    #define AVLTREE_HAS_PARENT 1
+    #define AVLTREE_PARENT_FIELD(name) struct avltree_node_##name *parent;
+    #define AVLTREE_SET_PARENT(node, value) ((void)((node)->parent = (value)))
+    #define AVLTREE_GET_PARENT(node) ((node)->parent)
+#endif // AVLTREE_NO_PARENT
+
+/**
+ * @def AVLTREE_ORDER_STATISTICS
+ * @brief Define before including the header to keep the size of every subtree in its node, which gives the
+ *        trees select, rank and count_range in O(log n)
+ *
+ * The count is refreshed wherever the height is, so rotations, joins and splits keep it for free. The one
+ * extra cost is on insert and remove: the ancestors above the first subtree whose height did not change are
+ * still walked to refresh their count. When AVLTREE_ORDER_STATISTICS is not defined the field, its updates
+ * and the three functions compile to nothing.
+ *
+ * @code
+ * #define AVLTREE_ORDER_STATISTICS
+ * #include "avltree.h"
+ * // ... fill latencies ...
+ * int *p99 = latencies_select(&latencies, latencies.size * 99 / 100);
+ * @endcode
+ *
+ * @warning Every TU sharing an avltree type must agree on AVLTREE_ORDER_STATISTICS, it changes the node layout
+ */
+#ifdef AVLTREE_ORDER_STATISTICS
+    #define AVLTREE_HAS_COUNT 1
+    #define AVLTREE_COUNT_FIELD size_t count;
+    #define AVLTREE_NODE_COUNT(node) ((node) != NULL ? (node)->count : (size_t)0)
+    #define AVLTREE_UPDATE_COUNT(node)                                                                                 \
+        ((void)((node)->count = AVLTREE_NODE_COUNT((node)->left) + AVLTREE_NODE_COUNT((node)->right) + 1))
+#else
+    #define AVLTREE_HAS_COUNT 0
+    #define AVLTREE_COUNT_FIELD
+    #define AVLTREE_NODE_COUNT(node) ((void)(node), (size_t)0)
+    #define AVLTREE_UPDATE_COUNT(node) ((void)(node))
+#endif // AVLTREE_ORDER_STATISTICS
+
+/**
+ * @def AVLTREE_MAX_HEIGHT
+ * @brief Bound on the height of any tree, the size of the descent paths kept on the stack
+ */
+#ifndef AVLTREE_MAX_HEIGHT
+    #define AVLTREE_MAX_HEIGHT (sizeof(size_t) * CHAR_BIT * 3 / 2)
+#endif // AVLTREE_MAX_HEIGHT
+
 /**
  * @enum avltree_error
  * @brief Error codes for the avltree
@@ -204,8 +346,17 @@ enum avltree_error {
     AVLTREE_ERR_NULL = -1,      ///< Null pointer
     AVLTREE_ERR_DUPLICATE = -2, ///< An attempt to insert a duplicate was made
     AVLTREE_ERR_ALLOC = -3,     ///< Allocation failure
+    AVLTREE_ERR_UNSORTED = -4,  ///< Input of build_from_sorted or join is not in ascending order
+    AVLTREE_ERR_ALLOCATOR = -5, ///< Trees given to a set operation do not share the same allocator
 };
 
+/**
+ * @brief Checks if two allocators are the same one, so nodes made by one can be freed by the other
+ */
+static inline bool avltree_same_allocator(const struct Allocator *a, const struct Allocator *b) {
+    return a->malloc == b->malloc && a->realloc == b->realloc && a->free == b->free && a->ctx == b->ctx;
+}
+
 // clang-format off
 
 /**
@@ -244,6 +395,21 @@ enum avltree_error {
     #define AVLTREE_FN(name, func) name##_##func
 #endif
 
+/**
+ * @private
+ * @def AVLTREE_NODE_TYPE(T, name)
+ * @brief Defines the node struct shared by AVLTREE_TYPE and AVLTREE_TYPE_CMP
+ */
+#define AVLTREE_NODE_TYPE(T, name)                                                                                     \
+struct avltree_node_##name {                                                                                           \
+    T data;                                                                                                            \
+    AVLTREE_HEIGHT_TYPE height;                                                                                        \
+    struct avltree_node_##name *left;                                                                                  \
+    struct avltree_node_##name *right;                                                                                 \
+    AVLTREE_PARENT_FIELD(name)                                                                                         \
+    AVLTREE_COUNT_FIELD                                                                                                \
+};
+
 /**
  * @def AVLTREE_TYPE(T, name)
  * @brief Defines an avltree structure for a specific type T
@@ -253,16 +419,19 @@ enum avltree_error {
  * This macro defines two structures:
  * - A struct named "avltree_node_##name" with the following fields:
  * - - "data": Value of type T that each node in the tree holds
- * - - "height": Current height in the tree
+ * - - "height": Current height in the tree, of AVLTREE_HEIGHT_TYPE
  * - - "left": Pointer to the left node
  * - - "right": Pointer to the right node
- * - - "parent": Pointer to the parent node
+ * - - "parent": Pointer to the parent node, not there when AVLTREE_NO_PARENT is defined
+ * - - "count": Number of nodes in the subtree rooted here, only when AVLTREE_ORDER_STATISTICS is defined
  *
  * - A struct named avltree_##name with the following fields:
  * - - "alloc": Allocator struct used to allocate nodes
  * - - "root": Pointer to the root node
  * - - "comparator_fn": Function pointer that knows how to compare two types T for balancing
  * - - "size": Size of the tree
+ * - - "node_pool": Pool owning the nodes when created with init_pooled, NULL otherwise
+ * - - "stats": Only when AVLTREE_STATS is defined, see struct avltree_stats
  * @code
  * // Example: Define an avltree for integers
  * AVLTREE_TYPE(int, ints)
@@ -270,52 +439,132 @@ enum avltree_error {
  * @endcode
  */
 #define AVLTREE_TYPE(T, name)                                                                                          \
-struct avltree_node_##name {                                                                                           \
-    T data;                                                                                                            \
-    size_t height;                                                                                                     \
-    struct avltree_node_##name *left;                                                                                  \
-    struct avltree_node_##name *right;                                                                                 \
-    struct avltree_node_##name *parent;                                                                                \
-};                                                                                                                     \
+AVLTREE_NODE_TYPE(T, name)                                                                                             \
                                                                                                                        \
 struct avltree_##name {                                                                                                \
     struct Allocator alloc;                                                                                            \
     struct avltree_node_##name *root;                                                                                  \
     int (*comparator_fn)(T *a, T *b);                                                                                  \
     size_t size;                                                                                                       \
+    struct pool_allocator *node_pool;                                                                                  \
+    AVLTREE_STATS_FIELD                                                                                                \
 };
 
 /**
- * @def AVLTREE_DECL(T, name)
- * @brief Declares all functions for an avltree type
+ * @def AVLTREE_TYPE_CMP(T, name)
+ * @brief Defines an avltree structure for a specific type T, without the comparator_fn field
  * @param T The type avltree will hold
  * @param name The name suffix for the avltree type
  *
- * @details
- * The following functions are declared:
- * 
- * @note All functions declared here operates on the avltree_##name struct
- * @note User code may create and operate on the node struct, but it is not part of the public api
+ * Same node and fields as AVLTREE_TYPE but comparator_fn, for AVLTREE_DECL_CMP and AVLTREE_IMPL_CMP where
+ * the comparator is a compile-time parameter.
  */
-#define AVLTREE_DECL(T, name)                                                                                          \
+#define AVLTREE_TYPE_CMP(T, name)                                                                                      \
+AVLTREE_NODE_TYPE(T, name)                                                                                             \
+                                                                                                                       \
+struct avltree_##name {                                                                                                \
+    struct Allocator alloc;                                                                                            \
+    struct avltree_node_##name *root;                                                                                  \
+    size_t size;                                                                                                       \
+    struct pool_allocator *node_pool;                                                                                  \
+    AVLTREE_STATS_FIELD                                                                                                \
+};
+
+/**
+ * @def AVLTREE_ORDER_DECL(T, name)
+ * @def AVLTREE_ORDER_IMPL(T, name)
+ * @brief Declare and implement select, rank and count_range inside AVLTREE_DECL and AVLTREE_IMPL, both are
+ *        empty unless AVLTREE_ORDER_STATISTICS is defined
+ */
+#ifdef AVLTREE_ORDER_STATISTICS
+#define AVLTREE_ORDER_DECL(T, name)                                                                                    \
 /**                                                                                                                    \
- * @brief init: Creates a new avltree                                                                                  \
- * @param alloc Custom allocator instance, if null, default alloc will be used                                         \
- * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
- *                      Must have the following prototype:                                                             \
- *                      int (*comparator_fn)(T *a, T *b);                                                              \
- * @return A zero initialized avltree structure                                                                        \
+ * @brief select: Gets the element at position k of the in-order sequence, the (k + 1)-th smallest one                 \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param k Zero based position, select(0) is min() and select(size - 1) is max()                                      \
+ * @return Pointer to the element, or NULL if k is not less than size                                                  \
  *                                                                                                                     \
- * @note It does not allocate                                                                                          \
+ * @note O(log n), one step down per level guided by the counts, no comparison is made                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, select)(const struct avltree_##name *self, size_t k);               \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief rank: Counts the elements less than value, value does not need to be in the tree                             \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to rank                                                                                          \
+ * @return How many elements are less than value, the position select() finds it at when it is in the tree             \
  *                                                                                                                     \
- * @warning The comparator function must not be null, otherwise this data structure will not work.                     \
- * @warning Call name##deinit() when done.                                                                             \
+ * @note O(log n)                                                                                                      \
  */                                                                                                                    \
-AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init)(                                           \
-    const struct Allocator alloc,                                                                                      \
-    int (*comparator_fn)(T *a, T *b)                                                                                   \
-);                                                                                                                     \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN(name, rank)(const struct avltree_##name *self, T value);              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief count_range: Counts the elements in [lo, hi), the ones for_each_range would visit                            \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param lo First key of the range, included                                                                          \
+ * @param hi Last key of the range, excluded                                                                           \
+ * @return rank(hi) - rank(lo), 0 when hi is not greater than lo                                                       \
+ *                                                                                                                     \
+ * @note O(log n) however many elements are in range                                                                   \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN(name, count_range)(const struct avltree_##name *self, T lo, T hi);
+
+#define AVLTREE_ORDER_IMPL(T, name)                                                                                    \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, select)(const struct avltree_##name *self, size_t k) {                             \
+    AVLTREE_ENSURE_PTR(self != NULL, "select(): self is null.");                                                       \
+    if (k >= self->size) {                                                                                             \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    while (current != NULL) {                                                                                          \
+        size_t left = AVLTREE_NODE_COUNT(current->left);                                                               \
+        if (k < left) {                                                                                                \
+            current = current->left;                                                                                   \
+        } else if (k == left) {                                                                                        \
+            return &current->data;                                                                                     \
+        } else {                                                                                                       \
+            /* skip the left subtree and current itself */                                                             \
+            k -= left + 1;                                                                                             \
+            current = current->right;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return NULL;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE size_t AVLTREE_FN(name, rank)(const struct avltree_##name *self, T value) {                            \
+    AVLTREE_ENSURE(self != NULL, 0, "rank(): self is null.");                                                          \
+    size_t rank = 0;                                                                                                   \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    while (current != NULL) {                                                                                          \
+        if (AVLTREE_FN(name, cmp)(self, &value, &current->data) <= 0) {                                                \
+            current = current->left;                                                                                   \
+        } else {                                                                                                       \
+            /* current and its whole left subtree are less than value */                                               \
+            rank += AVLTREE_NODE_COUNT(current->left) + 1;                                                             \
+            current = current->right;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return rank;                                                                                                       \
+}                                                                                                                      \
                                                                                                                        \
+AVLTREE_LINKAGE size_t AVLTREE_FN(name, count_range)(const struct avltree_##name *self, T lo, T hi) {                  \
+    AVLTREE_ENSURE(self != NULL, 0, "count_range(): self is null.");                                                   \
+    if (AVLTREE_FN(name, cmp)(self, &lo, &hi) >= 0) {                                                                  \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    return AVLTREE_FN(name, rank)(self, hi) - AVLTREE_FN(name, rank)(self, lo);                                        \
+}
+#else
+    #define AVLTREE_ORDER_DECL(T, name)
+    #define AVLTREE_ORDER_IMPL(T, name)
+#endif // AVLTREE_ORDER_STATISTICS
+
+/**
+ * @private
+ * @def AVLTREE_DECL_COMMON(T, name)
+ * @brief Declares every function of AVLTREE_DECL but init and init_pooled, shared with AVLTREE_DECL_CMP
+ */
+#define AVLTREE_DECL_COMMON(T, name)                                                                                   \
 /**                                                                                                                    \
  * @brief deep_clone: Deeply clones an avltree                                                                         \
  * @param self Pointer to the avltree to copy from                                                                     \
@@ -349,6 +598,8 @@ AVLTREE_NODISCARD AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_F
  * Safe to call on NULL or already deinitialized avltrees, returns early                                               \
  *                                                                                                                     \
  * @note Will call the destructor on data items if provided                                                            \
+ * @note If the tree was created with init_pooled and deinit_fn is avltree_noop_deinit, the nodes                      \
+ *       are not visited, the pool chunks are released in O(chunks)                                                    \
  * @note The self parameter will be left in an unusable, NULL/uninitialized state and should not be                    \
  *       used, to reuse it, one must call init again and reinitialize it                                               \
  */                                                                                                                    \
@@ -357,6 +608,9 @@ AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN(name, deinit)(struct avltree_##na
 /**                                                                                                                    \
  * @brief clear: Cleats the tree, leaving it in an empty but reusable state                                            \
  * @param self Pointer to the avltree                                                                                  \
+ *                                                                                                                     \
+ * @note If the tree was created with init_pooled and deinit_fn is avltree_noop_deinit, the pool                       \
+ *       chunks are released in O(chunks) instead of visiting every node                                               \
  */                                                                                                                    \
 AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN(name, clear)(struct avltree_##name *self);                              \
                                                                                                                        \
@@ -397,537 +651,4363 @@ AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, emplace)(
     int (*construct_fn)(T *location, void *args, struct Allocator *alloc),                                             \
     void *args                                                                                                         \
 );                                                                                                                     \
-
-/**
- * @def AVLTREE_IMPL(T, name, deinit_fn)
- * @brief Implements all functions for an avltree type
- * @param T The type avltree will hold
- * @param name The name suffix for the avltree type
- * @param deinit_fn The function that knows how to free type T and its members (may be a macro or
- *                  a normal function), recommended to inline the function
- *
- * Implements the functions of the AVLTREE_DECL macro
- *
- * @note This macro should be used in a .c file, not in a header
- * @note All functions declared here operates on the avltree_##name struct
- * @note User code may create and operate on the node struct, but it is not part of the public api
- *
- * @warning If the type T doesn't need to have a destructor, or one doesn't want to pass it
- *          and manually free, then a noop must be passed, like the already provided
- *          avltree_noop_deinit macro, or (void), or a macro/function that does nothing.
- */
-#define AVLTREE_IMPL(T, name, deinit_fn)                                                                               \
 /**                                                                                                                    \
- * @private                                                                                                            \
- * @brief node_allocate: Allocates a new node with the given allocator                                                 \
- * @param alloc Pointer to the Allocator interface                                                                     \
- * @return A new zeroed allocated node                                                                                 \
- * Assumes allocator is never null, as the avltree gets it by value, it's impossible to be null                        \
+ * @brief find: Finds the element that compares equal to value                                                         \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to search for                                                                                    \
+ * @return Pointer to the element stored in the tree, or NULL if not found or self is null                             \
+ *                                                                                                                     \
+ * @warning The element must not be modified in a way that changes its ordering                                        \
  */                                                                                                                    \
-AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_allocate)(struct Allocator *alloc) {                 \
-    struct avltree_node_##name *new_node = AVLTREE_CAST(T)alloc->malloc(sizeof(*new_node), alloc->ctx);                \
-    if (new_node) {                                                                                                    \
-        memset(new_node, 0, sizeof(*new_node));                                                                        \
-    }                                                                                                                  \
-    return new_node;                                                                                                   \
-}                                                                                                                      \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, find)(const struct avltree_##name *self, T value);                  \
                                                                                                                        \
 /**                                                                                                                    \
- * @private                                                                                                            \
- * @brief node_get_height: Gets the height of a node                                                                   \
- * @param node Pointer to the node                                                                                     \
- * @return The height of the node, or zero if node is null                                                             \
- * This private function is needed to ensure it returns 0 in case of null and doesn't access height directly           \
+ * @brief contains: Checks if there is an element that compares equal to value                                         \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to search for                                                                                    \
+ * @return True if found, false if not found or self is null                                                           \
  */                                                                                                                    \
-AVLTREE_LINKAGE int AVLTREE_FN(name, node_get_height)(struct avltree_node_##name *node) {                              \
-    if (node == NULL) {                                                                                                \
-        return 0;                                                                                                      \
-    }                                                                                                                  \
-    return node->height;                                                                                               \
-}                                                                                                                      \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN(name, contains)(const struct avltree_##name *self, T value);            \
                                                                                                                        \
 /**                                                                                                                    \
- * @private                                                                                                            \
- * @brief node_set_height: Sets the height of a node                                                                   \
- * @param node Pointer to the node                                                                                     \
- * This private function is needed to ensure it returns in case of null and doesn't access height directly             \
+ * @brief lower_bound: Finds the first (smallest) element that is not less than value                                  \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to compare against                                                                               \
+ * @return Pointer to the element, or NULL if every element is less than value or self is null                         \
  */                                                                                                                    \
-AVLTREE_LINKAGE void AVLTREE_FN(name, node_set_height)(struct avltree_node_##name *node) {                             \
-    if (node == NULL) {                                                                                                \
-        return;                                                                                                        \
-    }                                                                                                                  \
-    /* ternary operator to get the max height of left or right node */                                                 \
-    size_t max_height =                                                                                                \
-        (AVLTREE_FN(name, node_get_height)(node->left) > AVLTREE_FN(name, node_get_height)(node->right)) ?             \
-            AVLTREE_FN(name, node_get_height)(node->left) :                                                            \
-            AVLTREE_FN(name, node_get_height)(node->right);                                                            \
-    node->height = max_height + 1;                                                                                     \
-}                                                                                                                      \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, lower_bound)(const struct avltree_##name *self, T value);           \
                                                                                                                        \
 /**                                                                                                                    \
- * @private                                                                                                            \
- * @brief node_get_balance_factor: Gets the balance factor of a node                                                   \
- * @param node Pointer to the node                                                                                     \
- * @return The balance factor                                                                                          \
- * This private function is needed to ensure it returns 0 in case of null and doesn't access node's fields directly    \
+ * @brief upper_bound: Finds the first (smallest) element that is greater than value                                   \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to compare against                                                                               \
+ * @return Pointer to the element, or NULL if no element is greater than value or self is null                         \
  */                                                                                                                    \
-AVLTREE_LINKAGE int AVLTREE_FN(name, node_get_balance_factor)(struct avltree_node_##name *node) {                      \
-    if (node == NULL) {                                                                                                \
-        return 0;                                                                                                      \
-    }                                                                                                                  \
-    return AVLTREE_FN(name, node_get_height)(node->left) - AVLTREE_FN(name, node_get_height)(node->right);             \
-}                                                                                                                      \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, upper_bound)(const struct avltree_##name *self, T value);           \
                                                                                                                        \
 /**                                                                                                                    \
- * @private                                                                                                            \
- * @brief right_rotation: Rotates a node to the right                                                                  \
- * @param node Pointer to the node                                                                                     \
- * @return The node that got into the place of the node parameter, the new root of the subtree                         \
- * Demonstration of the rotation:                                                                                      \
- *             4                            2                                                                          \
- *            / \                          / \                                                                         \
- *           2   6                        1   4                                                                        \
- *          / \                 =>       /   / \                                                                       \
- *         1   3                       -1   3   6                                                                      \
- *        /                                                                                                            \
- *      -1                                                                                                             \
- * 4 = node                     | 2 = left_of_node                                                                     \
- * 6 = node.right (unchanged)   | 4 = left_of_node.right (node)                                                        \
- * 2 = node.left (left_of_node) | 1 = leftOfNode.left                                                                  \
- * 1 = left_of_node.left        | 3 = node.left                                                                        \
- * 3 = left_of_node.right       | 6 = node.right                                                                       \
+ * @brief floor: Finds the greatest element that is less than or equal to value                                        \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to compare against                                                                               \
+ * @return Pointer to the element, or NULL if every element is greater than value or self is null                      \
  */                                                                                                                    \
-AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, right_rotation)(struct avltree_node_##name *node) {       \
-    struct avltree_node_##name *left_of_node = node->left; /* 2 the new root of subtree */                             \
-    struct avltree_node_##name *right_of_left_node  = left_of_node->right; /* 3 right of the left of node */           \
-    left_of_node->right = node; /* 4 goes to the right of 2 */                                                         \
-    node->left = right_of_left_node; /* 3 goes to the left of 4 */                                                     \
-    /* Update parents */                                                                                               \
-    if (right_of_left_node != NULL) {                                                                                  \
-        right_of_left_node->parent = node; /* 4 is now parent of 3 */                                                  \
-    }                                                                                                                  \
-    left_of_node->parent = node->parent; /* the parent of 4 is now the parent of 2 */                                  \
-    node->parent = left_of_node; /* 2 is now parent of 4 */                                                            \
-    /* Set heights */                                                                                                  \
-    AVLTREE_FN(name, node_set_height)(node);                                                                           \
-    AVLTREE_FN(name, node_set_height)(left_of_node);                                                                   \
-    return left_of_node; /* return the new root */                                                                     \
-}                                                                                                                      \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, floor)(const struct avltree_##name *self, T value);                 \
                                                                                                                        \
 /**                                                                                                                    \
- * @private                                                                                                            \
- * @brief left_rotation: Rotates a node to the left                                                                    \
- * @param node Pointer to the node                                                                                     \
- * @return The node that got into the place of the node parameter, the new root of the subtree                         \
- * Demonstration of the rotation:                                                                                      \
- *             4                          6                                                                            \
- *            / \                        / \                                                                           \
- *           2   6                      4   8                                                                          \
- *              / \           =>       / \   \                                                                         \
- *             5   8                  2   5   9                                                                        \
- *                  \                                                                                                  \
- *                   9                                                                                                 \
- * 4 = node                     | 6 = rightOfNode                                                                      \
- * 6 = node.right (rightOfNode) | 4 = leftOfNode.right (node)                                                          \
- * 2 = node.left (unchanged)    | 8 = leftOfNode.left                                                                  \
- * 5 = rightOfNode.left         | 2 = node.left                                                                        \
- * 8 = rightOfNode.right        | 5 = node.right                                                                       \
+ * @brief ceil: Finds the smallest element that is greater than or equal to value                                      \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to compare against                                                                               \
+ * @return Pointer to the element, or NULL if every element is less than value or self is null                         \
+ *                                                                                                                     \
+ * @note Same result as lower_bound, provided to pair with floor                                                       \
  */                                                                                                                    \
-AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, left_rotation)(struct avltree_node_##name *node) {        \
-    struct avltree_node_##name *right_of_node = node->right; /* 6 the new root of subtree */                           \
-    struct avltree_node_##name *left_of_right_node  = right_of_node->left; /* 5 left of the right of node */           \
-    right_of_node->left = node; /* 4 goes to the right of 6 */                                                         \
-    node->right = left_of_right_node; /* 5 goes to the right of 4 */                                                   \
-    /* Update parents */                                                                                               \
-    if (left_of_right_node != NULL) {                                                                                  \
-        left_of_right_node->parent = node; /* 4 is now parent of 5 */                                                  \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, ceil)(const struct avltree_##name *self, T value);                  \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief min: Gets the smallest element of the tree                                                                   \
+ * @param self Pointer to the avltree                                                                                  \
+ * @return Pointer to the element, or NULL if the tree is empty or self is null                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, min)(const struct avltree_##name *self);                            \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief max: Gets the greatest element of the tree                                                                   \
+ * @param self Pointer to the avltree                                                                                  \
+ * @return Pointer to the element, or NULL if the tree is empty or self is null                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, max)(const struct avltree_##name *self);                            \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief build_from_sorted: Replaces the contents of the tree with the n values of data, in O(n)                      \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param data Values in strictly ascending order by comparator_fn, an arraylist can pass its data and size            \
+ * @param n How many values data holds                                                                                 \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or data is null, AVLTREE_ERR_DUPLICATE or                              \
+ *         AVLTREE_ERR_UNSORTED if two neighbours are equal or out of order, or AVLTREE_ERR_ALLOC                      \
+ *                                                                                                                     \
+ * The input is checked with n - 1 comparisons and every node is allocated before any is linked, then the              \
+ * tree is built perfectly balanced in one in-order pass, with no descent and no rotation.                             \
+ * On any error the tree is left untouched and keeps its values.                                                       \
+ *                                                                                                                     \
+ * @note The values are copied in, the tree owns them after AVLTREE_OK, just like after insert                         \
+ * @note The previous contents are destroyed as with clear                                                             \
+ * @note With init_pooled(backing, comparator_fn, n) all the nodes are carved from a single chunk                      \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, build_from_sorted)(                                 \
+    struct avltree_##name *self,                                                                                       \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief insert_batch: Inserts the k values, in any order, merging them into the tree in one pass                     \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param values Values to insert, they may be unsorted, repeat themselves or already be in the tree                   \
+ * @param k How many values there are                                                                                  \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or values is null, or AVLTREE_ERR_ALLOC                                \
+ *                                                                                                                     \
+ * The batch is sorted once, unless it already is in strictly ascending order, then a single split/join pass           \
+ * walks only the subtrees the batch falls in and rebalances each of them once on the way back up, the new             \
+ * values that land in an empty subtree are built into a balanced one directly. O(k log k + k log(n / k + 1))          \
+ * comparisons instead of the k log n of k inserts.                                                                    \
+ *                                                                                                                     \
+ * Values that compare equal to an element of the tree, or to an earlier value of the batch, are skipped as a          \
+ * duplicate insert would skip them, so the first of them wins and ownership of the others stays with the              \
+ * caller. How many got in is the growth of self->size.                                                                \
+ *                                                                                                                     \
+ * @note Every node, and the buffer the sort needs, is allocated before the tree is touched, on                        \
+ *       AVLTREE_ERR_ALLOC the tree is left as it was                                                                  \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, insert_batch)(                                      \
+    struct avltree_##name *self,                                                                                       \
+    const T *values,                                                                                                   \
+    size_t k                                                                                                           \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief remove_batch: Removes the elements equal to any of the k values, in one pass                                 \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param values Values to remove, they may be unsorted, repeat themselves or not be in the tree                       \
+ * @param k How many values there are                                                                                  \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or values is null, or AVLTREE_ERR_ALLOC if the batch is not            \
+ *         sorted and the buffer to sort it could not be allocated, nothing is removed then                            \
+ *                                                                                                                     \
+ * Same pass as insert_batch, O(k log k + k log(n / k + 1)), the removed elements are destroyed with                   \
+ * deinit_fn just like remove does, the values given are only compared against.                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, remove_batch)(                                      \
+    struct avltree_##name *self,                                                                                       \
+    const T *values,                                                                                                   \
+    size_t k                                                                                                           \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief begin: Gets the smallest element, where an in-order iteration starts                                         \
+ * @param self Pointer to the avltree                                                                                  \
+ * @return Pointer to the element, or NULL if the tree is empty or self is null                                        \
+ *                                                                                                                     \
+ * Iterating, NULL is the end in both directions:                                                                      \
+ * @code                                                                                                               \
+ * for (int *it = ints_begin(&tree); it != NULL; it = ints_next(&tree, it)) { ... }                                    \
+ * for (int *it = ints_max(&tree); it != NULL; it = ints_prev(&tree, it)) { ... }                                      \
+ * @endcode                                                                                                            \
+ *                                                                                                                     \
+ * @warning insert, remove and emplace invalidate the iteration, it is safe to modify the element as long as           \
+ *          its order does not change                                                                                  \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, begin)(const struct avltree_##name *self);                          \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief next: Gets the element following it in order                                                                 \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param it Pointer to an element of the tree, as returned by begin, next, prev, find and friends                     \
+ * @return Pointer to the next element, or NULL past the greatest one                                                  \
+ *                                                                                                                     \
+ * @note Amortized O(1) through the parent links, O(log n) descending from the root with AVLTREE_NO_PARENT             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, next)(const struct avltree_##name *self, T *it);                    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief prev: Gets the element preceding it in order                                                                 \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param it Pointer to an element of the tree, as returned by begin, next, prev, find and friends                     \
+ * @return Pointer to the previous element, or NULL before the smallest one                                            \
+ *                                                                                                                     \
+ * @note Amortized O(1) through the parent links, O(log n) descending from the root with AVLTREE_NO_PARENT             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN(name, prev)(const struct avltree_##name *self, T *it);                    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief for_each_range: Calls fn on every element in [lo, hi), in order                                              \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param lo First key of the range, included                                                                          \
+ * @param hi Last key of the range, excluded                                                                           \
+ * @param fn Function called on every element, returning false stops the scan                                          \
+ *           Must have the following prototype:                                                                        \
+ *           bool (*fn)(T *elem, void *ctx);                                                                           \
+ * @param ctx Pointer given back to fn                                                                                 \
+ * @return How many elements fn was called on                                                                          \
+ *                                                                                                                     \
+ * @note O(log n + k) for k elements in range, with a stack of at most the tree height, no recursion                   \
+ *                                                                                                                     \
+ * @warning fn must not insert or remove, nor change the order of the element it gets                                  \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN(name, for_each_range)(                                                \
+    const struct avltree_##name *self,                                                                                 \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(T *elem, void *ctx),                                                                                    \
+    void *ctx                                                                                                          \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief split: Moves every element not less than key out of self into a new tree, in O(log n)                        \
+ * @param self Pointer to the avltree, keeps the elements less than key                                                \
+ * @param key Where to split                                                                                           \
+ * @return A tree with the elements not less than key, sharing the allocator and comparator of self                    \
+ *                                                                                                                     \
+ * @note No node is allocated or freed, they change trees as they are                                                  \
+ *                                                                                                                     \
+ * @warning If self is NULL or was created with init_pooled then it returns a zero-initialized struct,                 \
+ *          if asserts are enabled then it crashes. The pool belongs to self, to split pooled nodes create             \
+ *          the trees with init and a shared allocator_get_pool()                                                      \
+ * @warning The return of this function should not be discarded, if doing so, memory may be leaked                     \
+ */                                                                                                                    \
+AVLTREE_NODISCARD AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, split)(                        \
+    struct avltree_##name *self,                                                                                       \
+    T key                                                                                                              \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief join: Moves every element of other into self, when all of them are greater than those of self                \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param other Pointer to the avltree whose elements all go after the ones of self, left empty                        \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or other is null or both are the same tree,                            \
+ *         AVLTREE_ERR_UNSORTED if the greatest element of self is not less than the smallest one of other,            \
+ *         or AVLTREE_ERR_ALLOCATOR if the trees do not share the same allocator                                       \
+ *                                                                                                                     \
+ * @note O(log n), no node is allocated or freed                                                                       \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, join)(                                              \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief union: Moves every element of other into self, the ones self already has are destroyed                       \
+ * @param self Pointer to the avltree, receives the union                                                              \
+ * @param other Pointer to the avltree to merge in, left empty                                                         \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or other is null or both are the same tree, or                         \
+ *         AVLTREE_ERR_ALLOCATOR if the trees do not share the same allocator                                          \
+ *                                                                                                                     \
+ * @note Join based, O(m log(n / m + 1)) for the smaller size m, the nodes are relinked, never reallocated.            \
+ *       The two halves of every step are independent of each other                                                    \
+ * @note On equal elements the one of self is kept                                                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, union)(                                             \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief intersection: Keeps in self only the elements other also has, everything else is destroyed                   \
+ * @param self Pointer to the avltree, receives the intersection                                                       \
+ * @param other Pointer to the avltree to intersect with, left empty                                                   \
+ * @return Same as union                                                                                               \
+ *                                                                                                                     \
+ * @note Same cost as union, on equal elements the one of self is kept                                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, intersection)(                                      \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief difference: Removes from self the elements other has, other is destroyed as a whole                          \
+ * @param self Pointer to the avltree, receives the difference                                                         \
+ * @param other Pointer to the avltree with the elements to remove, left empty                                         \
+ * @return Same as union                                                                                               \
+ *                                                                                                                     \
+ * @note Same cost as union                                                                                            \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, difference)(                                        \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+);                                                                                                                     \
+                                                                                                                       \
+AVLTREE_ORDER_DECL(T, name)
+
+/**
+ * @def AVLTREE_DECL(T, name)
+ * @brief Declares all functions for an avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ *
+ * @details
+ * The following functions are declared:
+ * - init, init_pooled, deep_clone, deinit, clear
+ * - insert, remove, emplace
+ * - find, contains, lower_bound, upper_bound, floor, ceil, min, max
+ * - build_from_sorted, insert_batch, remove_batch, begin, next, prev, for_each_range
+ * - split, join, union, intersection, difference
+ * - select, rank, count_range, only when AVLTREE_ORDER_STATISTICS is defined
+ *
+ * @note All functions declared here operates on the avltree_##name struct
+ * @note User code may create and operate on the node struct, but it is not part of the public api
+ */
+#define AVLTREE_DECL(T, name)                                                                                          \
+/**                                                                                                                    \
+ * @brief init: Creates a new avltree                                                                                  \
+ * @param alloc Custom allocator instance, if null, default alloc will be used                                         \
+ * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
+ *                      Must have the following prototype:                                                             \
+ *                      int (*comparator_fn)(T *a, T *b);                                                              \
+ * @return A zero initialized avltree structure                                                                        \
+ *                                                                                                                     \
+ * @note It does not allocate                                                                                          \
+ *                                                                                                                     \
+ * @warning The comparator function must not be null, otherwise this data structure will not work.                     \
+ * @warning Call name##deinit() when done.                                                                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init)(                                           \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief init_pooled: Creates a new avltree whose nodes come from an owned pool allocator                             \
+ * @param backing Allocator used for the pool itself and its chunks                                                    \
+ * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
+ *                      Must have the following prototype:                                                             \
+ *                      int (*comparator_fn)(T *a, T *b);                                                              \
+ * @param nodes_per_chunk How many nodes each contiguous chunk holds, zero uses POOL_ALLOCATOR_DEFAULT_BLOCKS          \
+ * @return An empty avltree, or a zero initialized struct if the pool could not be allocated                           \
+ *                                                                                                                     \
+ * @note Allocates only the pool bookkeeping, chunks are allocated on demand by insert/emplace                         \
+ * @note Removed nodes are recycled by the pool, and if deinit_fn is avltree_noop_deinit,                              \
+ *       clear and deinit release whole chunks in O(chunks) instead of visiting every node                             \
+ *                                                                                                                     \
+ * @warning The comparator function must not be null, otherwise this data structure will not work.                     \
+ * @warning Call name##deinit() when done.                                                                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init_pooled)(                                    \
+    const struct Allocator backing,                                                                                    \
+    int (*comparator_fn)(T *a, T *b),                                                                                  \
+    size_t nodes_per_chunk                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+AVLTREE_DECL_COMMON(T, name)
+
+/**
+ * @def AVLTREE_DECL_CMP(T, name)
+ * @brief Declares all functions for an avltree type defined with AVLTREE_TYPE_CMP
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ *
+ * @details
+ * The same functions as AVLTREE_DECL, init and init_pooled just do not take a comparator_fn, the
+ * comparator is the cmp_macro given to AVLTREE_IMPL_CMP.
+ */
+#define AVLTREE_DECL_CMP(T, name)                                                                                      \
+/**                                                                                                                    \
+ * @brief init: Creates a new avltree                                                                                  \
+ * @param alloc Custom allocator instance, if null, default alloc will be used                                         \
+ * @return A zero initialized avltree structure                                                                        \
+ *                                                                                                                     \
+ * @note It does not allocate                                                                                          \
+ *                                                                                                                     \
+ * @warning Call name##deinit() when done.                                                                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init)(                                           \
+    const struct Allocator alloc                                                                                       \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief init_pooled: Creates a new avltree whose nodes come from an owned pool allocator                             \
+ * @param backing Allocator used for the pool itself and its chunks                                                    \
+ * @param nodes_per_chunk How many nodes each contiguous chunk holds, zero uses POOL_ALLOCATOR_DEFAULT_BLOCKS          \
+ * @return An empty avltree, or a zero initialized struct if the pool could not be allocated                           \
+ *                                                                                                                     \
+ * @note Allocates only the pool bookkeeping, chunks are allocated on demand by insert/emplace                         \
+ * @note Removed nodes are recycled by the pool, and if deinit_fn is avltree_noop_deinit,                              \
+ *       clear and deinit release whole chunks in O(chunks) instead of visiting every node                             \
+ *                                                                                                                     \
+ * @warning Call name##deinit() when done.                                                                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init_pooled)(                                    \
+    const struct Allocator backing,                                                                                    \
+    size_t nodes_per_chunk                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+AVLTREE_DECL_COMMON(T, name)
+
+/**
+ * @private
+ * @def AVLTREE_IMPL_COMMON(T, name, deinit_fn)
+ * @brief Implements every function of AVLTREE_DECL_COMMON, shared by AVLTREE_IMPL and AVLTREE_IMPL_CMP
+ *
+ * Comparisons go through the private name##_cmp, and empty trees sharing the allocator and comparator of
+ * another through name##_init_like, both defined by the public macro before expanding this one.
+ */
+#define AVLTREE_IMPL_COMMON(T, name, deinit_fn)                                                                        \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_allocate: Allocates a new node with the given allocator                                                 \
+ * @param alloc Pointer to the Allocator interface                                                                     \
+ * @return A new zeroed allocated node                                                                                 \
+ * Assumes allocator is never null, as the avltree gets it by value, it's impossible to be null                        \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_allocate)(struct Allocator *alloc) {                 \
+    struct avltree_node_##name *new_node = AVLTREE_CAST(T)alloc->malloc(sizeof(*new_node), alloc->ctx);                \
+    if (new_node) {                                                                                                    \
+        memset(new_node, 0, sizeof(*new_node));                                                                        \
+    }                                                                                                                  \
+    return new_node;                                                                                                   \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_get_height: Gets the height of a node                                                                   \
+ * @param node Pointer to the node                                                                                     \
+ * @return The height of the node, or zero if node is null                                                             \
+ * This private function is needed to ensure it returns 0 in case of null and doesn't access height directly           \
+ */                                                                                                                    \
+AVLTREE_LINKAGE int AVLTREE_FN(name, node_get_height)(struct avltree_node_##name *node) {                              \
+    if (node == NULL) {                                                                                                \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    return (int)node->height;                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_set_height: Sets the height of a node, and its subtree count with AVLTREE_ORDER_STATISTICS              \
+ * @param node Pointer to the node                                                                                     \
+ * This private function is needed to ensure it returns in case of null and doesn't access height directly             \
+ */                                                                                                                    \
+AVLTREE_LINKAGE void AVLTREE_FN(name, node_set_height)(struct avltree_node_##name *node) {                             \
+    if (node == NULL) {                                                                                                \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    /* ternary operator to get the max height of left or right node */                                                 \
+    int max_height =                                                                                                   \
+        (AVLTREE_FN(name, node_get_height)(node->left) > AVLTREE_FN(name, node_get_height)(node->right)) ?             \
+            AVLTREE_FN(name, node_get_height)(node->left) :                                                            \
+            AVLTREE_FN(name, node_get_height)(node->right);                                                            \
+    node->height = (AVLTREE_HEIGHT_TYPE)(max_height + 1);                                                              \
+    AVLTREE_UPDATE_COUNT(node);                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_get_balance_factor: Gets the balance factor of a node                                                   \
+ * @param node Pointer to the node                                                                                     \
+ * @return The balance factor                                                                                          \
+ * This private function is needed to ensure it returns 0 in case of null and doesn't access node's fields directly    \
+ */                                                                                                                    \
+AVLTREE_LINKAGE int AVLTREE_FN(name, node_get_balance_factor)(struct avltree_node_##name *node) {                      \
+    if (node == NULL) {                                                                                                \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    return AVLTREE_FN(name, node_get_height)(node->left) - AVLTREE_FN(name, node_get_height)(node->right);             \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief right_rotation: Rotates a node to the right                                                                  \
+ * @param node Pointer to the node                                                                                     \
+ * @return The node that got into the place of the node parameter, the new root of the subtree                         \
+ * Demonstration of the rotation:                                                                                      \
+ *             4                            2                                                                          \
+ *            / \                          / \                                                                         \
+ *           2   6                        1   4                                                                        \
+ *          / \                 =>       /   / \                                                                       \
+ *         1   3                       -1   3   6                                                                      \
+ *        /                                                                                                            \
+ *      -1                                                                                                             \
+ * 4 = node                     | 2 = left_of_node                                                                     \
+ * 6 = node.right (unchanged)   | 4 = left_of_node.right (node)                                                        \
+ * 2 = node.left (left_of_node) | 1 = leftOfNode.left                                                                  \
+ * 1 = left_of_node.left        | 3 = node.left                                                                        \
+ * 3 = left_of_node.right       | 6 = node.right                                                                       \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, right_rotation)(struct avltree_node_##name *node) {       \
+    struct avltree_node_##name *left_of_node = node->left; /* 2 the new root of subtree */                             \
+    struct avltree_node_##name *right_of_left_node  = left_of_node->right; /* 3 right of the left of node */           \
+    left_of_node->right = node; /* 4 goes to the right of 2 */                                                         \
+    node->left = right_of_left_node; /* 3 goes to the left of 4 */                                                     \
+    /* Update parents */                                                                                               \
+    if (right_of_left_node != NULL) {                                                                                  \
+        AVLTREE_SET_PARENT(right_of_left_node, node); /* 4 is now parent of 3 */                                       \
     }                                                                                                                  \
-    right_of_node->parent = node->parent; /* the parent of 4 is now the parent of 6 */                                 \
-    node->parent = right_of_node; /* 6 is now parent of 4 */                                                           \
+    AVLTREE_SET_PARENT(left_of_node, node->parent); /* the parent of 4 is now the parent of 2 */                       \
+    AVLTREE_SET_PARENT(node, left_of_node); /* 2 is now parent of 4 */                                                 \
     /* Set heights */                                                                                                  \
     AVLTREE_FN(name, node_set_height)(node);                                                                           \
-    AVLTREE_FN(name, node_set_height)(right_of_node);                                                                  \
-    return right_of_node; /* return the new root */                                                                    \
+    AVLTREE_FN(name, node_set_height)(left_of_node);                                                                   \
+    return left_of_node; /* return the new root */                                                                     \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief left_rotation: Rotates a node to the left                                                                    \
+ * @param node Pointer to the node                                                                                     \
+ * @return The node that got into the place of the node parameter, the new root of the subtree                         \
+ * Demonstration of the rotation:                                                                                      \
+ *             4                          6                                                                            \
+ *            / \                        / \                                                                           \
+ *           2   6                      4   8                                                                          \
+ *              / \           =>       / \   \                                                                         \
+ *             5   8                  2   5   9                                                                        \
+ *                  \                                                                                                  \
+ *                   9                                                                                                 \
+ * 4 = node                     | 6 = rightOfNode                                                                      \
+ * 6 = node.right (rightOfNode) | 4 = leftOfNode.right (node)                                                          \
+ * 2 = node.left (unchanged)    | 8 = leftOfNode.left                                                                  \
+ * 5 = rightOfNode.left         | 2 = node.left                                                                        \
+ * 8 = rightOfNode.right        | 5 = node.right                                                                       \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, left_rotation)(struct avltree_node_##name *node) {        \
+    struct avltree_node_##name *right_of_node = node->right; /* 6 the new root of subtree */                           \
+    struct avltree_node_##name *left_of_right_node  = right_of_node->left; /* 5 left of the right of node */           \
+    right_of_node->left = node; /* 4 goes to the right of 6 */                                                         \
+    node->right = left_of_right_node; /* 5 goes to the right of 4 */                                                   \
+    /* Update parents */                                                                                               \
+    if (left_of_right_node != NULL) {                                                                                  \
+        AVLTREE_SET_PARENT(left_of_right_node, node); /* 4 is now parent of 5 */                                       \
+    }                                                                                                                  \
+    AVLTREE_SET_PARENT(right_of_node, node->parent); /* the parent of 4 is now the parent of 6 */                      \
+    AVLTREE_SET_PARENT(node, right_of_node); /* 6 is now parent of 4 */                                                \
+    /* Set heights */                                                                                                  \
+    AVLTREE_FN(name, node_set_height)(node);                                                                           \
+    AVLTREE_FN(name, node_set_height)(right_of_node);                                                                  \
+    return right_of_node; /* return the new root */                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief rebalance: balances a node                                                                                   \
+ * @param self Pointer to the avltree, only used for the AVLTREE_STATS counters                                        \
+ * @param node Pointer to the node                                                                                     \
+ * @return The balanced node, may be different than the original parameter                                             \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, rebalance)(                                               \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *node                                                                                   \
+) {                                                                                                                    \
+    (void)self; /* only read by the AVLTREE_STATS counters */                                                          \
+    /* Children may have changed height below, so refresh this one before reading the balance */                       \
+    AVLTREE_FN(name, node_set_height)(node);                                                                           \
+    int balance_factor = AVLTREE_FN(name, node_get_balance_factor)(node);                                              \
+    /* Left Left case */                                                                                               \
+    if (balance_factor > 1 && AVLTREE_FN(name, node_get_balance_factor)(node->left) >= 0) {                            \
+        /* Perform a right rotation on node */                                                                         \
+        AVLTREE_STAT_ADD(self, rotations, 1);                                                                          \
+        return AVLTREE_FN(name, right_rotation)(node);                                                                 \
+    }                                                                                                                  \
+    /* Right Right case */                                                                                             \
+    if (balance_factor < -1 && AVLTREE_FN(name, node_get_balance_factor)(node->right) <= 0) {                          \
+        /* Perform a left rotation on node */                                                                          \
+        AVLTREE_STAT_ADD(self, rotations, 1);                                                                          \
+        return AVLTREE_FN(name, left_rotation)(node);                                                                  \
+    }                                                                                                                  \
+    /* Left Right case */                                                                                              \
+    if (balance_factor > 1 && AVLTREE_FN(name, node_get_balance_factor)(node->left) < 0) {                             \
+        /* Perform a left rotation on node->left and then right rotation on node */                                    \
+        node->left = AVLTREE_FN(name, left_rotation)(node->left);                                                      \
+        AVLTREE_STAT_ADD(self, rotations, 2);                                                                          \
+        return AVLTREE_FN(name, right_rotation)(node);                                                                 \
+    }                                                                                                                  \
+    /* Right Left case */                                                                                              \
+    if (balance_factor < -1 && AVLTREE_FN(name, node_get_balance_factor)(node->right) > 0) {                           \
+        /* Perform a right rotation on node->right and then left rotation on node */                                   \
+        node->right = AVLTREE_FN(name, right_rotation)(node->right);                                                   \
+        AVLTREE_STAT_ADD(self, rotations, 2);                                                                          \
+        return AVLTREE_FN(name, left_rotation)(node);                                                                  \
+    }                                                                                                                  \
+    return node;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief minimum: gets the minimum of a subtree from the given node                                                   \
+ * @param node Pointer to the node                                                                                     \
+ * @return The minimum of the subtree or NULL if node is null                                                          \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, minimum)(struct avltree_node_##name *node) {              \
+    if (node == NULL) {                                                                                                \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    while (node->left != NULL) {                                                                                       \
+        node = node->left;                                                                                             \
+    }                                                                                                                  \
+    return node;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief maximum: gets the maximum of a subtree from the given node                                                   \
+ * @param node Pointer to the node                                                                                     \
+ * @return The maximum of the subtree or NULL if node is null                                                          \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, maximum)(struct avltree_node_##name *node) {              \
+    if (node == NULL) {                                                                                                \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    while (node->right != NULL) {                                                                                      \
+        node = node->right;                                                                                            \
+    }                                                                                                                  \
+    return node;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, successor)(                                               \
+    const struct avltree_##name *self,                                                                                 \
+    struct avltree_node_##name *node                                                                                   \
+) {                                                                                                                    \
+    if (node->right != NULL) {                                                                                         \
+        return AVLTREE_FN(name, minimum)(node->right);                                                                 \
+    }                                                                                                                  \
+    if (AVLTREE_HAS_PARENT) {                                                                                          \
+        /* climb while coming from the right, the first parent reached from its left is the successor */               \
+        struct avltree_node_##name *parent = AVLTREE_GET_PARENT(node);                                                 \
+        while (parent != NULL && node == parent->right) {                                                              \
+            node = parent;                                                                                             \
+            parent = AVLTREE_GET_PARENT(parent);                                                                       \
+        }                                                                                                              \
+        return parent;                                                                                                 \
+    }                                                                                                                  \
+    /* no parent links, the successor is the last node the descent went left from */                                   \
+    struct avltree_node_##name *candidate = NULL;                                                                      \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    while (current != node) {                                                                                          \
+        if (AVLTREE_FN(name, cmp)(self, &node->data, &current->data) < 0) {                                            \
+            candidate = current;                                                                                       \
+            current = current->left;                                                                                   \
+        } else {                                                                                                       \
+            current = current->right;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate;                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, predecessor)(                                             \
+    const struct avltree_##name *self,                                                                                 \
+    struct avltree_node_##name *node                                                                                   \
+) {                                                                                                                    \
+    if (node->left != NULL) {                                                                                          \
+        return AVLTREE_FN(name, maximum)(node->left);                                                                  \
+    }                                                                                                                  \
+    if (AVLTREE_HAS_PARENT) {                                                                                          \
+        struct avltree_node_##name *parent = AVLTREE_GET_PARENT(node);                                                 \
+        while (parent != NULL && node == parent->left) {                                                               \
+            node = parent;                                                                                             \
+            parent = AVLTREE_GET_PARENT(parent);                                                                       \
+        }                                                                                                              \
+        return parent;                                                                                                 \
+    }                                                                                                                  \
+    struct avltree_node_##name *candidate = NULL;                                                                      \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    while (current != node) {                                                                                          \
+        if (AVLTREE_FN(name, cmp)(self, &node->data, &current->data) > 0) {                                            \
+            candidate = current;                                                                                       \
+            current = current->right;                                                                                  \
+        } else {                                                                                                       \
+            current = current->left;                                                                                   \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate;                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief rebalance_path: Rebalances the nodes of a descent path, from the deepest one up to the root                  \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param path Links walked through from the root (&self->root, then &node->left or &node->right)                      \
+ * @param depth Number of links in path                                                                                \
+ *                                                                                                                     \
+ * Every link is rewritten with the new root of its subtree, so no parent pointer is needed to relink.                 \
+ * The walk stops at the first subtree whose height did not change, the ancestors above it can not have                \
+ * become unbalanced. With AVLTREE_ORDER_STATISTICS their count did change, so it goes on refreshing just that.        \
+ */                                                                                                                    \
+AVLTREE_LINKAGE void AVLTREE_FN(name, rebalance_path)(                                                                 \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name **path[],                                                                               \
+    size_t depth                                                                                                       \
+) {                                                                                                                    \
+    while (depth > 0) {                                                                                                \
+        struct avltree_node_##name **link = path[--depth];                                                             \
+        AVLTREE_HEIGHT_TYPE old_height = (*link)->height;                                                              \
+        *link = AVLTREE_FN(name, rebalance)(self, *link);                                                              \
+        if ((*link)->height == old_height) {                                                                           \
+            break;                                                                                                     \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (AVLTREE_HAS_COUNT && depth > 0) {                                                                           \
+        struct avltree_node_##name *ancestor = *path[--depth];                                                         \
+        AVLTREE_UPDATE_COUNT(ancestor);                                                                                \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief destroy_subtree: Destroys and frees every node below curr in O(n), without recursion, stack or parent        \
+ *        pointers                                                                                                     \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param curr Root of the subtree to destroy                                                                          \
+ * @return How many nodes were freed                                                                                   \
+ *                                                                                                                     \
+ * While the current node has a left child it is rotated up, once there is none the node is destroyed                  \
+ * and the walk goes to the right child, flattening the tree as it is freed.                                           \
+ */                                                                                                                    \
+AVLTREE_LINKAGE size_t AVLTREE_FN(name, destroy_subtree)(                                                              \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *curr                                                                                   \
+) {                                                                                                                    \
+    size_t freed = 0;                                                                                                  \
+    while (curr) {                                                                                                     \
+        if (curr->left) {                                                                                              \
+            struct avltree_node_##name *left = curr->left;                                                             \
+            curr->left = left->right;                                                                                  \
+            left->right = curr;                                                                                        \
+            curr = left;                                                                                               \
+        } else {                                                                                                       \
+            struct avltree_node_##name *right = curr->right;                                                           \
+            deinit_fn(&curr->data, &self->alloc);                                                                      \
+            self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                    \
+            freed += 1;                                                                                                \
+            curr = right;                                                                                              \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return freed;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN(name, destroy_nodes)(struct avltree_##name *self) {                                    \
+    AVLTREE_FN(name, destroy_subtree)(self, self->root);                                                               \
+    self->root = NULL;                                                                                                 \
+    self->size = 0;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_join: Joins two subtrees and a middle node, every key of left < node < every key of right               \
+ * @return The root of the joined subtree, its parent link is left to the caller                                       \
+ *                                                                                                                     \
+ * Descends the spine of the taller subtree down to where the shorter one fits next to it, then rebalances             \
+ * on the way back up, O(|height(left) - height(right)| + 1).                                                          \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_join)(                                               \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *left,                                                                                  \
+    struct avltree_node_##name *node,                                                                                  \
+    struct avltree_node_##name *right                                                                                  \
+) {                                                                                                                    \
+    int left_height = AVLTREE_FN(name, node_get_height)(left);                                                         \
+    int right_height = AVLTREE_FN(name, node_get_height)(right);                                                       \
+    if (left_height > right_height + 1) {                                                                              \
+        left->right = AVLTREE_FN(name, node_join)(self, left->right, node, right);                                     \
+        AVLTREE_SET_PARENT(left->right, left);                                                                         \
+        return AVLTREE_FN(name, rebalance)(self, left);                                                                \
+    }                                                                                                                  \
+    if (right_height > left_height + 1) {                                                                              \
+        right->left = AVLTREE_FN(name, node_join)(self, left, node, right->left);                                      \
+        AVLTREE_SET_PARENT(right->left, right);                                                                        \
+        return AVLTREE_FN(name, rebalance)(self, right);                                                               \
+    }                                                                                                                  \
+    node->left = left;                                                                                                 \
+    node->right = right;                                                                                               \
+    if (left != NULL) {                                                                                                \
+        AVLTREE_SET_PARENT(left, node);                                                                                \
+    }                                                                                                                  \
+    if (right != NULL) {                                                                                               \
+        AVLTREE_SET_PARENT(right, node);                                                                               \
+    }                                                                                                                  \
+    AVLTREE_FN(name, node_set_height)(node);                                                                           \
+    return node;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_pop_min: Unlinks the smallest node of a non empty subtree into *min, returns the new root               \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_pop_min)(                                            \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *node,                                                                                  \
+    struct avltree_node_##name **min                                                                                   \
+) {                                                                                                                    \
+    if (node->left == NULL) {                                                                                          \
+        *min = node;                                                                                                   \
+        return node->right;                                                                                            \
+    }                                                                                                                  \
+    node->left = AVLTREE_FN(name, node_pop_min)(self, node->left, min);                                                \
+    if (node->left != NULL) {                                                                                          \
+        AVLTREE_SET_PARENT(node->left, node);                                                                          \
+    }                                                                                                                  \
+    return AVLTREE_FN(name, rebalance)(self, node);                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_join2: Joins two subtrees without a middle node, every key of left < every key of right                 \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_join2)(                                              \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *left,                                                                                  \
+    struct avltree_node_##name *right                                                                                  \
+) {                                                                                                                    \
+    if (right == NULL) {                                                                                               \
+        return left;                                                                                                   \
+    }                                                                                                                  \
+    struct avltree_node_##name *min = NULL;                                                                            \
+    right = AVLTREE_FN(name, node_pop_min)(self, right, &min);                                                         \
+    return AVLTREE_FN(name, node_join)(self, left, min, right);                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_split: Splits a subtree by key into the nodes less than key, the one equal to it and the greater        \
+ *        ones, O(log n), the node equal to the key is unlinked into *equal, NULL if there is none                     \
+ */                                                                                                                    \
+AVLTREE_LINKAGE void AVLTREE_FN(name, node_split)(                                                                     \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *node,                                                                                  \
+    T *key,                                                                                                            \
+    struct avltree_node_##name **less,                                                                                 \
+    struct avltree_node_##name **equal,                                                                                \
+    struct avltree_node_##name **greater                                                                               \
+) {                                                                                                                    \
+    if (node == NULL) {                                                                                                \
+        *less = NULL;                                                                                                  \
+        *equal = NULL;                                                                                                 \
+        *greater = NULL;                                                                                               \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    struct avltree_node_##name *left = node->left;                                                                     \
+    struct avltree_node_##name *right = node->right;                                                                   \
+    int cmp = AVLTREE_FN(name, cmp)(self, key, &node->data);                                                           \
+    if (cmp == 0) {                                                                                                    \
+        *less = left;                                                                                                  \
+        *equal = node;                                                                                                 \
+        *greater = right;                                                                                              \
+    } else if (cmp < 0) {                                                                                              \
+        struct avltree_node_##name *left_greater = NULL;                                                               \
+        AVLTREE_FN(name, node_split)(self, left, key, less, equal, &left_greater);                                     \
+        *greater = AVLTREE_FN(name, node_join)(self, left_greater, node, right);                                       \
+    } else {                                                                                                           \
+        struct avltree_node_##name *right_less = NULL;                                                                 \
+        AVLTREE_FN(name, node_split)(self, right, key, &right_less, equal, greater);                                   \
+        *less = AVLTREE_FN(name, node_join)(self, left, node, right_less);                                             \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_union: Union of two subtrees, the nodes of a are kept over the equal ones of b, which are freed         \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_union)(                                              \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *a,                                                                                     \
+    struct avltree_node_##name *b,                                                                                     \
+    size_t *freed                                                                                                      \
+) {                                                                                                                    \
+    if (a == NULL) {                                                                                                   \
+        return b;                                                                                                      \
+    }                                                                                                                  \
+    if (b == NULL) {                                                                                                   \
+        return a;                                                                                                      \
+    }                                                                                                                  \
+    struct avltree_node_##name *b_less = NULL;                                                                         \
+    struct avltree_node_##name *b_equal = NULL;                                                                        \
+    struct avltree_node_##name *b_greater = NULL;                                                                      \
+    AVLTREE_FN(name, node_split)(self, b, &a->data, &b_less, &b_equal, &b_greater);                                    \
+    if (b_equal != NULL) {                                                                                             \
+        b_equal->left = NULL;                                                                                          \
+        b_equal->right = NULL;                                                                                         \
+        *freed += AVLTREE_FN(name, destroy_subtree)(self, b_equal);                                                    \
+    }                                                                                                                  \
+    /* both halves are independent of each other */                                                                    \
+    struct avltree_node_##name *left = AVLTREE_FN(name, node_union)(self, a->left, b_less, freed);                     \
+    struct avltree_node_##name *right = AVLTREE_FN(name, node_union)(self, a->right, b_greater, freed);                \
+    return AVLTREE_FN(name, node_join)(self, left, a, right);                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_intersection: Intersection of two subtrees, the nodes of a are kept, everything else is freed           \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_intersection)(                                       \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *a,                                                                                     \
+    struct avltree_node_##name *b,                                                                                     \
+    size_t *freed                                                                                                      \
+) {                                                                                                                    \
+    if (a == NULL || b == NULL) {                                                                                      \
+        *freed += AVLTREE_FN(name, destroy_subtree)(self, a);                                                          \
+        *freed += AVLTREE_FN(name, destroy_subtree)(self, b);                                                          \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    struct avltree_node_##name *b_less = NULL;                                                                         \
+    struct avltree_node_##name *b_equal = NULL;                                                                        \
+    struct avltree_node_##name *b_greater = NULL;                                                                      \
+    AVLTREE_FN(name, node_split)(self, b, &a->data, &b_less, &b_equal, &b_greater);                                    \
+    struct avltree_node_##name *left = AVLTREE_FN(name, node_intersection)(self, a->left, b_less, freed);              \
+    struct avltree_node_##name *right = AVLTREE_FN(name, node_intersection)(self, a->right, b_greater, freed);         \
+    if (b_equal != NULL) {                                                                                             \
+        b_equal->left = NULL;                                                                                          \
+        b_equal->right = NULL;                                                                                         \
+        *freed += AVLTREE_FN(name, destroy_subtree)(self, b_equal);                                                    \
+        return AVLTREE_FN(name, node_join)(self, left, a, right);                                                      \
+    }                                                                                                                  \
+    a->left = NULL;                                                                                                    \
+    a->right = NULL;                                                                                                   \
+    *freed += AVLTREE_FN(name, destroy_subtree)(self, a);                                                              \
+    return AVLTREE_FN(name, node_join2)(self, left, right);                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_difference: Nodes of a not in b, everything else is freed                                               \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_difference)(                                         \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *a,                                                                                     \
+    struct avltree_node_##name *b,                                                                                     \
+    size_t *freed                                                                                                      \
+) {                                                                                                                    \
+    if (a == NULL || b == NULL) {                                                                                      \
+        *freed += AVLTREE_FN(name, destroy_subtree)(self, b);                                                          \
+        return a;                                                                                                      \
+    }                                                                                                                  \
+    struct avltree_node_##name *a_less = NULL;                                                                         \
+    struct avltree_node_##name *a_equal = NULL;                                                                        \
+    struct avltree_node_##name *a_greater = NULL;                                                                      \
+    AVLTREE_FN(name, node_split)(self, a, &b->data, &a_less, &a_equal, &a_greater);                                    \
+    struct avltree_node_##name *left = AVLTREE_FN(name, node_difference)(self, a_less, b->left, freed);                \
+    struct avltree_node_##name *right = AVLTREE_FN(name, node_difference)(self, a_greater, b->right, freed);           \
+    if (a_equal != NULL) {                                                                                             \
+        a_equal->left = NULL;                                                                                          \
+        a_equal->right = NULL;                                                                                         \
+        *freed += AVLTREE_FN(name, destroy_subtree)(self, a_equal);                                                    \
+    }                                                                                                                  \
+    b->left = NULL;                                                                                                    \
+    b->right = NULL;                                                                                                   \
+    *freed += AVLTREE_FN(name, destroy_subtree)(self, b);                                                              \
+    return AVLTREE_FN(name, node_join2)(self, left, right);                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_count_lesser: Counts the smaller of two subtrees, visiting both in turns so it costs                    \
+ *        O(min(|a|, |b|)), *a_is_lesser tells which one it was                                                        \
+ */                                                                                                                    \
+AVLTREE_LINKAGE size_t AVLTREE_FN(name, node_count_lesser)(                                                            \
+    struct avltree_node_##name *a,                                                                                     \
+    struct avltree_node_##name *b,                                                                                     \
+    bool *a_is_lesser                                                                                                  \
+) {                                                                                                                    \
+    struct avltree_node_##name *stack[2][AVLTREE_MAX_HEIGHT];                                                          \
+    size_t depth[2] = { 0, 0 };                                                                                        \
+    struct avltree_node_##name *node = NULL;                                                                           \
+    for (node = a; node != NULL; node = node->left) {                                                                  \
+        stack[0][depth[0]++] = node;                                                                                   \
+    }                                                                                                                  \
+    for (node = b; node != NULL; node = node->left) {                                                                  \
+        stack[1][depth[1]++] = node;                                                                                   \
+    }                                                                                                                  \
+    for (size_t count = 0;; ++count) {                                                                                 \
+        for (int side = 0; side < 2; ++side) {                                                                         \
+            if (depth[side] == 0) {                                                                                    \
+                *a_is_lesser = side == 0;                                                                              \
+                return count;                                                                                          \
+            }                                                                                                          \
+            node = stack[side][--depth[side]];                                                                         \
+            for (node = node->right; node != NULL; node = node->left) {                                                \
+                stack[side][depth[side]++] = node;                                                                     \
+            }                                                                                                          \
+        }                                                                                                              \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief set_operation_check: Shared argument checks of join, union, intersection and difference                      \
+ */                                                                                                                    \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, set_operation_check)(                                              \
+    const struct avltree_##name *self,                                                                                 \
+    const struct avltree_##name *other                                                                                 \
+) {                                                                                                                    \
+    if (self == NULL || other == NULL || self == other) {                                                              \
+        return AVLTREE_ERR_NULL;                                                                                       \
+    }                                                                                                                  \
+    /* the nodes of other end up in self even when self is empty, so they must be freeable by its allocator */         \
+    if (other->size > 0 && !avltree_same_allocator(&self->alloc, &other->alloc)) {                                     \
+        return AVLTREE_ERR_ALLOCATOR;                                                                                  \
+    }                                                                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief set_operation_finish: Hangs the result root in self, counts the freed nodes and leaves other empty           \
+ */                                                                                                                    \
+AVLTREE_LINKAGE void AVLTREE_FN(name, set_operation_finish)(                                                           \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other,                                                                                      \
+    struct avltree_node_##name *root,                                                                                  \
+    size_t freed                                                                                                       \
+) {                                                                                                                    \
+    if (root != NULL) {                                                                                                \
+        AVLTREE_SET_PARENT(root, NULL);                                                                                \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, freed);                                                                         \
+    self->size = self->size + other->size - freed;                                                                     \
+    self->root = root;                                                                                                 \
+    other->root = NULL;                                                                                                \
+    other->size = 0;                                                                                                   \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_remove_one: Removes the element equal to value from the subtree hanging from root                       \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param root Link holding the subtree, &self->root for the whole tree, rewritten with its new root                   \
+ * @param value Value to remove                                                                                        \
+ * @return If an element was found and destroyed, self->size is left to the caller                                     \
+ */                                                                                                                    \
+AVLTREE_LINKAGE bool AVLTREE_FN(name, node_remove_one)(                                                                \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name **root,                                                                                 \
+    T *value                                                                                                           \
+) {                                                                                                                    \
+    /* Search value to remove position, recording the links walked through for the rebalance */                        \
+    struct avltree_node_##name **path[AVLTREE_MAX_HEIGHT];                                                             \
+    size_t depth = 0;                                                                                                  \
+    struct avltree_node_##name **link = root;                                                                          \
+    while (*link != NULL) {                                                                                            \
+        int cmp = AVLTREE_FN(name, cmp)(self, value, &(*link)->data);                                                  \
+        if (cmp == 0) {                                                                                                \
+            break;                                                                                                     \
+        }                                                                                                              \
+        path[depth++] = link;                                                                                          \
+        link = (cmp < 0) ? &(*link)->left : &(*link)->right;                                                           \
+    }                                                                                                                  \
+    /* Not found */                                                                                                    \
+    if (*link == NULL) {                                                                                               \
+        return false;                                                                                                  \
+    }                                                                                                                  \
+    struct avltree_node_##name *del_pos = *link;                                                                       \
+    if (del_pos->left != NULL && del_pos->right != NULL) { /* two children node, remove successor */                   \
+        /* del_pos stays in the tree and on the path, walk on down to its successor */                                 \
+        path[depth++] = link;                                                                                          \
+        link = &del_pos->right;                                                                                        \
+        while ((*link)->left != NULL) {                                                                                \
+            path[depth++] = link;                                                                                      \
+            link = &(*link)->left;                                                                                     \
+        }                                                                                                              \
+        struct avltree_node_##name *successor = *link;                                                                 \
+        /* just swap the data, do not need to free the del_pos node itself */                                          \
+        T tmp = del_pos->data;                                                                                         \
+        del_pos->data = successor->data;                                                                               \
+        successor->data = tmp;                                                                                         \
+        del_pos = successor;                                                                                           \
+    }                                                                                                                  \
+    /* node with only 1 or no child, relink parent or root to child */                                                 \
+    struct avltree_node_##name *child = (del_pos->left != NULL) ? del_pos->left : del_pos->right;                      \
+    if (child != NULL) {                                                                                               \
+        AVLTREE_SET_PARENT(child, depth > 0 ? *path[depth - 1] : NULL);                                                \
+    }                                                                                                                  \
+    *link = child;                                                                                                     \
+    deinit_fn(&del_pos->data, &self->alloc);                                                                           \
+    self->alloc.free(del_pos, sizeof(*del_pos), self->alloc.ctx);                                                      \
+    AVLTREE_STAT_ADD(self, node_frees, 1);                                                                             \
+    /* rebalance, going up through the path from the first ancestor */                                                 \
+    AVLTREE_FN(name, rebalance_path)(self, path, depth);                                                               \
+    return true;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, check_sorted)(                                                     \
+    const struct avltree_##name *self,                                                                                 \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+) {                                                                                                                    \
+    /* an equal pair does not end the scan, a later descending one still means the batch must be sorted */             \
+    enum avltree_error order = AVLTREE_OK;                                                                             \
+    for (size_t i = 1; i < n; ++i) {                                                                                   \
+        int cmp = AVLTREE_FN(name, cmp)(self, (T *)&data[i - 1], (T *)&data[i]);                                       \
+        if (cmp > 0) {                                                                                                 \
+            return AVLTREE_ERR_UNSORTED;                                                                               \
+        }                                                                                                              \
+        if (cmp == 0) {                                                                                                \
+            order = AVLTREE_ERR_DUPLICATE;                                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return order;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, build_subtree)(                                           \
+    struct avltree_node_##name **chain,                                                                                \
+    const T *data,                                                                                                     \
+    size_t *next,                                                                                                      \
+    size_t count                                                                                                       \
+) {                                                                                                                    \
+    if (count == 0) {                                                                                                  \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    /* in-order, so the nodes take the values in the order they are given */                                           \
+    struct avltree_node_##name *left = AVLTREE_FN(name, build_subtree)(chain, data, next, count / 2);                  \
+    struct avltree_node_##name *node = *chain;                                                                         \
+    *chain = node->right;                                                                                              \
+    memcpy(&node->data, &data[(*next)++], sizeof(T));                                                                  \
+    node->left = left;                                                                                                 \
+    node->right = AVLTREE_FN(name, build_subtree)(chain, data, next, count - count / 2 - 1);                           \
+    if (node->left != NULL) {                                                                                          \
+        AVLTREE_SET_PARENT(node->left, node);                                                                          \
+    }                                                                                                                  \
+    if (node->right != NULL) {                                                                                         \
+        AVLTREE_SET_PARENT(node->right, node);                                                                         \
+    }                                                                                                                  \
+    AVLTREE_FN(name, node_set_height)(node);                                                                           \
+    return node;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief batch_sort: Sorts the n values of a batch, a buffer of 2 * n values, keeping the order of equal ones         \
+ * @return The half of buffer holding the sorted values                                                                \
+ *                                                                                                                     \
+ * Bottom-up merge sort, the halves swap roles every pass so no value is copied back.                                  \
+ */                                                                                                                    \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, batch_sort)(                                                                       \
+    const struct avltree_##name *self,                                                                                 \
+    T *buffer,                                                                                                         \
+    size_t n                                                                                                           \
+) {                                                                                                                    \
+    T *src = buffer;                                                                                                   \
+    T *dst = buffer + n;                                                                                               \
+    for (size_t width = 1; width < n; width *= 2) {                                                                    \
+        for (size_t lo = 0; lo < n; lo += 2 * width) {                                                                 \
+            size_t mid = (n - lo > width) ? lo + width : n;                                                            \
+            size_t hi = (n - mid > width) ? mid + width : n;                                                           \
+            size_t i = lo;                                                                                             \
+            size_t j = mid;                                                                                            \
+            size_t out = lo;                                                                                           \
+            while (i < mid && j < hi) {                                                                                \
+                /* only a strictly smaller right value goes first, equal ones keep their order */                      \
+                dst[out++] = (AVLTREE_FN(name, cmp)(self, &src[j], &src[i]) < 0) ? src[j++] : src[i++];                \
+            }                                                                                                          \
+            while (i < mid) {                                                                                          \
+                dst[out++] = src[i++];                                                                                 \
+            }                                                                                                          \
+            while (j < hi) {                                                                                           \
+                dst[out++] = src[j++];                                                                                 \
+            }                                                                                                          \
+        }                                                                                                              \
+        T *tmp = src;                                                                                                  \
+        src = dst;                                                                                                     \
+        dst = tmp;                                                                                                     \
+    }                                                                                                                  \
+    return src;                                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief batch_prepare: Gets the batch in ascending order, sorted into a new buffer only when it is not already       \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param values The batch as given                                                                                    \
+ * @param k Its size, updated to the values left when unique asks for the repeated ones to be dropped                  \
+ * @param unique Drop every value equal to the one before it, the first one of each run stays                          \
+ * @param buffer Set to the buffer to free with batch_release, NULL when the batch is used as it is                    \
+ * @return The values in order, or NULL if the buffer could not be allocated                                           \
+ */                                                                                                                    \
+AVLTREE_LINKAGE const T *AVLTREE_FN(name, batch_prepare)(                                                              \
+    struct avltree_##name *self,                                                                                       \
+    const T *values,                                                                                                   \
+    size_t *k,                                                                                                         \
+    bool unique,                                                                                                       \
+    T **buffer                                                                                                         \
+) {                                                                                                                    \
+    *buffer = NULL;                                                                                                    \
+    enum avltree_error order = AVLTREE_FN(name, check_sorted)(self, values, *k);                                       \
+    if (order == AVLTREE_OK || (order == AVLTREE_ERR_DUPLICATE && !unique)) {                                          \
+        return values;                                                                                                 \
+    }                                                                                                                  \
+    if (*k > SIZE_MAX / 2 / sizeof(T)) {                                                                               \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    *buffer = AVLTREE_CAST(T)self->alloc.malloc(2 * *k * sizeof(T), self->alloc.ctx);                                  \
+    if (*buffer == NULL) {                                                                                             \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    memcpy(*buffer, values, *k * sizeof(T));                                                                           \
+    T *sorted = AVLTREE_FN(name, batch_sort)(self, *buffer, *k);                                                       \
+    if (unique) {                                                                                                      \
+        size_t kept = 1;                                                                                               \
+        for (size_t i = 1; i < *k; ++i) {                                                                              \
+            if (AVLTREE_FN(name, cmp)(self, &sorted[kept - 1], &sorted[i]) != 0) {                                     \
+                sorted[kept++] = sorted[i];                                                                            \
+            }                                                                                                          \
+        }                                                                                                              \
+        *k = kept;                                                                                                     \
+    }                                                                                                                  \
+    return (const T *)sorted;                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN(name, batch_release)(struct avltree_##name *self, T *buffer, size_t k) {               \
+    if (buffer != NULL) {                                                                                              \
+        self->alloc.free(buffer, 2 * k * sizeof(T), self->alloc.ctx);                                                  \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief batch_lower: First position in [lo, hi) of an ascending batch whose value is not less than key               \
+ */                                                                                                                    \
+AVLTREE_LINKAGE size_t AVLTREE_FN(name, batch_lower)(                                                                  \
+    const struct avltree_##name *self,                                                                                 \
+    const T *values,                                                                                                   \
+    size_t lo,                                                                                                         \
+    size_t hi,                                                                                                         \
+    T *key                                                                                                             \
+) {                                                                                                                    \
+    while (lo < hi) {                                                                                                  \
+        size_t mid = lo + (hi - lo) / 2;                                                                               \
+        if (AVLTREE_FN(name, cmp)(self, (T *)&values[mid], key) < 0) {                                                 \
+            lo = mid + 1;                                                                                              \
+        } else {                                                                                                       \
+            hi = mid;                                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return lo;                                                                                                         \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_insert_one: Inserts one value of a batch into a subtree with a plain descent, returns its new root      \
+ *                                                                                                                     \
+ * Where a single value of the batch is left for a subtree, descending costs one comparison a level and the            \
+ * rebalance stops at the first height that holds, splitting around every node would cost two and a join.              \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_insert_one)(                                         \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *root,                                                                                  \
+    const T *value,                                                                                                    \
+    struct avltree_node_##name **chain,                                                                                \
+    size_t *added                                                                                                      \
+) {                                                                                                                    \
+    struct avltree_node_##name **path[AVLTREE_MAX_HEIGHT];                                                             \
+    size_t depth = 0;                                                                                                  \
+    struct avltree_node_##name **link = &root;                                                                         \
+    while (*link != NULL) {                                                                                            \
+        int cmp = AVLTREE_FN(name, cmp)(self, (T *)value, &(*link)->data);                                             \
+        if (cmp == 0) {                                                                                                \
+            return root;                                                                                               \
+        }                                                                                                              \
+        path[depth++] = link;                                                                                          \
+        link = (cmp < 0) ? &(*link)->left : &(*link)->right;                                                           \
+    }                                                                                                                  \
+    struct avltree_node_##name *new_node = *chain;                                                                     \
+    *chain = new_node->right;                                                                                          \
+    new_node->right = NULL;                                                                                            \
+    memcpy(&new_node->data, value, sizeof(T));                                                                         \
+    new_node->height = 1;                                                                                              \
+    AVLTREE_UPDATE_COUNT(new_node);                                                                                    \
+    AVLTREE_SET_PARENT(new_node, depth > 0 ? *path[depth - 1] : NULL);                                                 \
+    *link = new_node;                                                                                                  \
+    AVLTREE_FN(name, rebalance_path)(self, path, depth);                                                               \
+    *added += 1;                                                                                                       \
+    return root;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_insert_sorted: Merges the strictly ascending values[lo, hi) into a subtree, returns its new root        \
+ * @param chain Allocated nodes, chained through right, taken by the values that are not in the subtree yet            \
+ * @param added Incremented by how many values got in                                                                  \
+ *                                                                                                                     \
+ * The values go down split around each node, the ones equal to it are dropped, and every node is joined back          \
+ * with its two merged children, only subtrees some value fell in are visited.                                         \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_insert_sorted)(                                      \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *node,                                                                                  \
+    const T *values,                                                                                                   \
+    size_t lo,                                                                                                         \
+    size_t hi,                                                                                                         \
+    struct avltree_node_##name **chain,                                                                                \
+    size_t *added                                                                                                      \
+) {                                                                                                                    \
+    if (lo == hi) {                                                                                                    \
+        return node;                                                                                                   \
+    }                                                                                                                  \
+    if (node == NULL) {                                                                                                \
+        size_t next = 0;                                                                                               \
+        *added += hi - lo;                                                                                             \
+        return AVLTREE_FN(name, build_subtree)(chain, values + lo, &next, hi - lo);                                    \
+    }                                                                                                                  \
+    if (hi - lo == 1) {                                                                                                \
+        return AVLTREE_FN(name, node_insert_one)(self, node, &values[lo], chain, added);                               \
+    }                                                                                                                  \
+    size_t mid = AVLTREE_FN(name, batch_lower)(self, values, lo, hi, &node->data);                                     \
+    size_t right_lo = mid;                                                                                             \
+    if (mid < hi && AVLTREE_FN(name, cmp)(self, (T *)&values[mid], &node->data) == 0) {                                \
+        right_lo += 1;                                                                                                 \
+    }                                                                                                                  \
+    struct avltree_node_##name *left =                                                                                 \
+        AVLTREE_FN(name, node_insert_sorted)(self, node->left, values, lo, mid, chain, added);                         \
+    struct avltree_node_##name *right =                                                                                \
+        AVLTREE_FN(name, node_insert_sorted)(self, node->right, values, right_lo, hi, chain, added);                   \
+    return AVLTREE_FN(name, node_join)(self, left, node, right);                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_remove_sorted: Removes the elements equal to any of the ascending values[lo, hi) from a subtree         \
+ * @param removed Incremented by how many elements were destroyed                                                      \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, node_remove_sorted)(                                      \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_node_##name *node,                                                                                  \
+    const T *values,                                                                                                   \
+    size_t lo,                                                                                                         \
+    size_t hi,                                                                                                         \
+    size_t *removed                                                                                                    \
+) {                                                                                                                    \
+    if (node == NULL || lo == hi) {                                                                                    \
+        return node;                                                                                                   \
+    }                                                                                                                  \
+    if (hi - lo == 1) {                                                                                                \
+        *removed += AVLTREE_FN(name, node_remove_one)(self, &node, (T *)&values[lo]) ? 1 : 0;                          \
+        return node;                                                                                                   \
+    }                                                                                                                  \
+    size_t mid = AVLTREE_FN(name, batch_lower)(self, values, lo, hi, &node->data);                                     \
+    bool equal = mid < hi && AVLTREE_FN(name, cmp)(self, (T *)&values[mid], &node->data) == 0;                         \
+    struct avltree_node_##name *left =                                                                                 \
+        AVLTREE_FN(name, node_remove_sorted)(self, node->left, values, lo, mid, removed);                              \
+    struct avltree_node_##name *right =                                                                                \
+        AVLTREE_FN(name, node_remove_sorted)(self, node->right, values, equal ? mid + 1 : mid, hi, removed);           \
+    if (!equal) {                                                                                                      \
+        return AVLTREE_FN(name, node_join)(self, left, node, right);                                                   \
+    }                                                                                                                  \
+    node->left = NULL;                                                                                                 \
+    node->right = NULL;                                                                                                \
+    *removed += AVLTREE_FN(name, destroy_subtree)(self, node);                                                         \
+    AVLTREE_STAT_ADD(self, node_frees, 1);                                                                             \
+    return AVLTREE_FN(name, node_join2)(self, left, right);                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, deep_clone)(                                                    \
+    const struct avltree_##name *self,                                                                                 \
+    void (*deep_clone_fn)(T *dst, T *src, struct Allocator *alloc)                                                     \
+) {                                                                                                                    \
+    struct avltree_##name clone = { 0 };                                                                               \
+    AVLTREE_ENSURE(self != NULL, clone, "deep_clone(): avltree is null.");                                             \
+    AVLTREE_ENSURE(deep_clone_fn != NULL, clone, "deep_clone(): deep_clone_fn function is null.");                     \
+    return clone;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN(name, deinit)(struct avltree_##name *self) {                                           \
+    if (!self) {                                                                                                       \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, self->size);                                                                    \
+    if (self->node_pool != NULL && AVLTREE_DEINIT_IS_NOOP(deinit_fn)) {                                                \
+        /* nothing to destroy, the nodes go away with the pool chunks below */                                         \
+        self->root = NULL;                                                                                             \
+    }                                                                                                                  \
+    AVLTREE_FN(name, destroy_nodes)(self);                                                                             \
+    if (self->node_pool != NULL) {                                                                                     \
+        struct pool_allocator *pool = self->node_pool;                                                                 \
+        struct Allocator backing = pool->backing;                                                                      \
+        pool_allocator_deinit(pool);                                                                                   \
+        backing.free(pool, sizeof(*pool), backing.ctx);                                                                \
+        self->node_pool = NULL;                                                                                        \
+    }                                                                                                                  \
+    memset(&self->alloc, 0, sizeof(self->alloc));                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN(name, clear)(struct avltree_##name *self) {                                            \
+    if (!self || self->size == 0) {                                                                                    \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, self->size);                                                                    \
+    if (self->node_pool != NULL && AVLTREE_DEINIT_IS_NOOP(deinit_fn)) {                                                \
+        /* nothing to destroy, hand every chunk back at once */                                                        \
+        pool_allocator_release(self->node_pool);                                                                       \
+        self->root = NULL;                                                                                             \
+        self->size = 0;                                                                                                \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_FN(name, destroy_nodes)(self);                                                                             \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, insert)(struct avltree_##name *self, T value) {                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "insert(): self is null.");                                         \
+    /* Search valid position, recording the links walked through for the rebalance */                                  \
+    struct avltree_node_##name **path[AVLTREE_MAX_HEIGHT];                                                             \
+    size_t depth = 0;                                                                                                  \
+    struct avltree_node_##name **link = &self->root;                                                                   \
+    while (*link != NULL) {                                                                                            \
+        int cmp = AVLTREE_FN(name, cmp)(self, &value, &(*link)->data);                                                 \
+        if (cmp == 0) {                                                                                                \
+            return AVLTREE_ERR_DUPLICATE;                                                                              \
+        }                                                                                                              \
+        path[depth++] = link;                                                                                          \
+        link = (cmp < 0) ? &(*link)->left : &(*link)->right;                                                           \
+    }                                                                                                                  \
+    /* Allocate new node */                                                                                            \
+    struct avltree_node_##name *new_node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
+    AVLTREE_ENSURE(new_node != NULL, AVLTREE_ERR_ALLOC, "insert(): allocation of new node failed.");                   \
+    AVLTREE_STAT_ADD(self, node_allocs, 1);                                                                            \
+    new_node->data = value;                                                                                            \
+    new_node->height = 1;                                                                                              \
+    AVLTREE_UPDATE_COUNT(new_node);                                                                                    \
+    /* Insert into position, then update heights and rebalance going up through the path */                            \
+    AVLTREE_SET_PARENT(new_node, depth > 0 ? *path[depth - 1] : NULL);                                                 \
+    *link = new_node;                                                                                                  \
+    AVLTREE_FN(name, rebalance_path)(self, path, depth);                                                               \
+    self->size += 1;                                                                                                   \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, remove)(struct avltree_##name *self, T value) {                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "remove(): self is null.");                                         \
+    if (AVLTREE_FN(name, node_remove_one)(self, &self->root, &value)) {                                                \
+        self->size -= 1;                                                                                               \
+    }                                                                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, emplace)(                                                                          \
+    struct avltree_##name *self,                                                                                       \
+    int (*construct_fn)(T *location, void *args, struct Allocator *alloc),                                             \
+    void *args                                                                                                         \
+) {                                                                                                                    \
+    AVLTREE_ENSURE_PTR(self != NULL, "emplace(): self is null.");                                                      \
+    AVLTREE_ENSURE_PTR(construct_fn != NULL, "emplace(): constructor function is null.");                              \
+    /* Allocate new node */                                                                                            \
+    struct avltree_node_##name *new_node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
+    AVLTREE_ENSURE_PTR(new_node != NULL, "emplace(): allocation of new node failed.");                                 \
+    AVLTREE_STAT_ADD(self, node_allocs, 1);                                                                            \
+    /* Construct new node inplace */                                                                                   \
+    if (construct_fn(&new_node->data, args, &self->alloc) != 0) {                                                      \
+        self->alloc.free(new_node, sizeof(*new_node), self->alloc.ctx);                                                \
+        AVLTREE_STAT_ADD(self, node_frees, 1);                                                                         \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    /* Search valid position using the constructed value, recording the links walked through */                        \
+    struct avltree_node_##name **path[AVLTREE_MAX_HEIGHT];                                                             \
+    size_t depth = 0;                                                                                                  \
+    struct avltree_node_##name **link = &self->root;                                                                   \
+    while (*link != NULL) {                                                                                            \
+        int cmp = AVLTREE_FN(name, cmp)(self, &new_node->data, &(*link)->data);                                        \
+        if (cmp == 0) {                                                                                                \
+            deinit_fn(&new_node->data, &self->alloc);                                                                  \
+            self->alloc.free(new_node, sizeof(*new_node), self->alloc.ctx);                                            \
+            AVLTREE_STAT_ADD(self, node_frees, 1);                                                                     \
+            return NULL;                                                                                               \
+        }                                                                                                              \
+        path[depth++] = link;                                                                                          \
+        link = (cmp < 0) ? &(*link)->left : &(*link)->right;                                                           \
+    }                                                                                                                  \
+    new_node->height = 1;                                                                                              \
+    AVLTREE_UPDATE_COUNT(new_node);                                                                                    \
+    /* Insert node into position, then update heights and rebalance going up through the path */                       \
+    AVLTREE_SET_PARENT(new_node, depth > 0 ? *path[depth - 1] : NULL);                                                 \
+    *link = new_node;                                                                                                  \
+    AVLTREE_FN(name, rebalance_path)(self, path, depth);                                                               \
+    self->size += 1;                                                                                                   \
+    return &new_node->data;                                                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, find)(const struct avltree_##name *self, T value) {                                \
+    AVLTREE_ENSURE_PTR(self != NULL, "find(): self is null.");                                                         \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    while (current != NULL) {                                                                                          \
+        int cmp = AVLTREE_FN(name, cmp)(self, &value, &current->data);                                                 \
+        if (cmp < 0) {                                                                                                 \
+            current = current->left;                                                                                   \
+        } else if (cmp > 0) {                                                                                          \
+            current = current->right;                                                                                  \
+        } else {                                                                                                       \
+            return &current->data;                                                                                     \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return NULL;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN(name, contains)(const struct avltree_##name *self, T value) {                          \
+    AVLTREE_ENSURE(self != NULL, false, "contains(): self is null.");                                                  \
+    return AVLTREE_FN(name, find)(self, value) != NULL;                                                                \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, lower_bound)(const struct avltree_##name *self, T value) {                         \
+    AVLTREE_ENSURE_PTR(self != NULL, "lower_bound(): self is null.");                                                  \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    struct avltree_node_##name *candidate = NULL;                                                                      \
+    while (current != NULL) {                                                                                          \
+        if (AVLTREE_FN(name, cmp)(self, &value, &current->data) <= 0) {                                                \
+            /* current is not less than value, remember it and look for a smaller one */                               \
+            candidate = current;                                                                                       \
+            current = current->left;                                                                                   \
+        } else {                                                                                                       \
+            current = current->right;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate ? &candidate->data : NULL;                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, upper_bound)(const struct avltree_##name *self, T value) {                         \
+    AVLTREE_ENSURE_PTR(self != NULL, "upper_bound(): self is null.");                                                  \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    struct avltree_node_##name *candidate = NULL;                                                                      \
+    while (current != NULL) {                                                                                          \
+        if (AVLTREE_FN(name, cmp)(self, &value, &current->data) < 0) {                                                 \
+            /* current is greater than value, remember it and look for a smaller one */                                \
+            candidate = current;                                                                                       \
+            current = current->left;                                                                                   \
+        } else {                                                                                                       \
+            current = current->right;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate ? &candidate->data : NULL;                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, floor)(const struct avltree_##name *self, T value) {                               \
+    AVLTREE_ENSURE_PTR(self != NULL, "floor(): self is null.");                                                        \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    struct avltree_node_##name *candidate = NULL;                                                                      \
+    while (current != NULL) {                                                                                          \
+        int cmp = AVLTREE_FN(name, cmp)(self, &value, &current->data);                                                 \
+        if (cmp == 0) {                                                                                                \
+            return &current->data;                                                                                     \
+        }                                                                                                              \
+        if (cmp > 0) {                                                                                                 \
+            /* current is less than value, remember it and look for a greater one */                                   \
+            candidate = current;                                                                                       \
+            current = current->right;                                                                                  \
+        } else {                                                                                                       \
+            current = current->left;                                                                                   \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate ? &candidate->data : NULL;                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, ceil)(const struct avltree_##name *self, T value) {                                \
+    AVLTREE_ENSURE_PTR(self != NULL, "ceil(): self is null.");                                                         \
+    return AVLTREE_FN(name, lower_bound)(self, value);                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, min)(const struct avltree_##name *self) {                                          \
+    AVLTREE_ENSURE_PTR(self != NULL, "min(): self is null.");                                                          \
+    struct avltree_node_##name *node = AVLTREE_FN(name, minimum)(self->root);                                          \
+    return node ? &node->data : NULL;                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, max)(const struct avltree_##name *self) {                                          \
+    AVLTREE_ENSURE_PTR(self != NULL, "max(): self is null.");                                                          \
+    struct avltree_node_##name *node = AVLTREE_FN(name, maximum)(self->root);                                          \
+    return node ? &node->data : NULL;                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, build_from_sorted)(                                                \
+    struct avltree_##name *self,                                                                                       \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "build_from_sorted(): self is null.");                              \
+    AVLTREE_ENSURE(n == 0 || data != NULL, AVLTREE_ERR_NULL, "build_from_sorted(): data is null.");                    \
+    enum avltree_error err = AVLTREE_FN(name, check_sorted)(self, data, n);                                            \
+    if (err != AVLTREE_OK) {                                                                                           \
+        return err;                                                                                                    \
+    }                                                                                                                  \
+    /* Allocate every node up front, chained through right, so a failure leaves the tree as it was */                  \
+    struct avltree_node_##name *chain = NULL;                                                                          \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        struct avltree_node_##name *node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
+        if (node == NULL) {                                                                                            \
+            while (chain != NULL) {                                                                                    \
+                struct avltree_node_##name *next = chain->right;                                                       \
+                self->alloc.free(chain, sizeof(*chain), self->alloc.ctx);                                              \
+                chain = next;                                                                                          \
+            }                                                                                                          \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
+        }                                                                                                              \
+        node->right = chain;                                                                                           \
+        chain = node;                                                                                                  \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_allocs, n);                                                                            \
+    AVLTREE_FN(name, clear)(self);                                                                                     \
+    size_t next = 0;                                                                                                   \
+    self->root = AVLTREE_FN(name, build_subtree)(&chain, data, &next, n);                                              \
+    self->size = n;                                                                                                    \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, insert_batch)(                                                     \
+    struct avltree_##name *self,                                                                                       \
+    const T *values,                                                                                                   \
+    size_t k                                                                                                           \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "insert_batch(): self is null.");                                   \
+    AVLTREE_ENSURE(k == 0 || values != NULL, AVLTREE_ERR_NULL, "insert_batch(): values is null.");                     \
+    if (k == 0) {                                                                                                      \
+        return AVLTREE_OK;                                                                                             \
+    }                                                                                                                  \
+    size_t unique = k;                                                                                                 \
+    T *buffer = NULL;                                                                                                  \
+    const T *sorted = AVLTREE_FN(name, batch_prepare)(self, values, &unique, true, &buffer);                           \
+    if (sorted == NULL) {                                                                                              \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    /* A node for every value up front, chained through right, so a failure leaves the tree as it was */               \
+    struct avltree_node_##name *chain = NULL;                                                                          \
+    for (size_t i = 0; i < unique; ++i) {                                                                              \
+        struct avltree_node_##name *node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
+        if (node == NULL) {                                                                                            \
+            while (chain != NULL) {                                                                                    \
+                struct avltree_node_##name *next = chain->right;                                                       \
+                self->alloc.free(chain, sizeof(*chain), self->alloc.ctx);                                              \
+                chain = next;                                                                                          \
+            }                                                                                                          \
+            AVLTREE_FN(name, batch_release)(self, buffer, k);                                                          \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
+        }                                                                                                              \
+        node->right = chain;                                                                                           \
+        chain = node;                                                                                                  \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_allocs, unique);                                                                       \
+    size_t added = 0;                                                                                                  \
+    self->root = AVLTREE_FN(name, node_insert_sorted)(self, self->root, sorted, 0, unique, &chain, &added);            \
+    if (self->root != NULL) {                                                                                          \
+        AVLTREE_SET_PARENT(self->root, NULL);                                                                          \
+    }                                                                                                                  \
+    self->size += added;                                                                                               \
+    /* the nodes of the values that were already in the tree */                                                        \
+    while (chain != NULL) {                                                                                            \
+        struct avltree_node_##name *next = chain->right;                                                               \
+        self->alloc.free(chain, sizeof(*chain), self->alloc.ctx);                                                      \
+        chain = next;                                                                                                  \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, unique - added);                                                                \
+    AVLTREE_FN(name, batch_release)(self, buffer, k);                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, remove_batch)(                                                     \
+    struct avltree_##name *self,                                                                                       \
+    const T *values,                                                                                                   \
+    size_t k                                                                                                           \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "remove_batch(): self is null.");                                   \
+    AVLTREE_ENSURE(k == 0 || values != NULL, AVLTREE_ERR_NULL, "remove_batch(): values is null.");                     \
+    if (k == 0 || self->size == 0) {                                                                                   \
+        return AVLTREE_OK;                                                                                             \
+    }                                                                                                                  \
+    size_t count = k;                                                                                                  \
+    T *buffer = NULL;                                                                                                  \
+    const T *sorted = AVLTREE_FN(name, batch_prepare)(self, values, &count, false, &buffer);                           \
+    if (sorted == NULL) {                                                                                              \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    size_t removed = 0;                                                                                                \
+    self->root = AVLTREE_FN(name, node_remove_sorted)(self, self->root, sorted, 0, count, &removed);                   \
+    if (self->root != NULL) {                                                                                          \
+        AVLTREE_SET_PARENT(self->root, NULL);                                                                          \
+    }                                                                                                                  \
+    self->size -= removed;                                                                                             \
+    AVLTREE_FN(name, batch_release)(self, buffer, k);                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, begin)(const struct avltree_##name *self) {                                        \
+    AVLTREE_ENSURE_PTR(self != NULL, "begin(): self is null.");                                                        \
+    return AVLTREE_FN(name, min)(self);                                                                                \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, next)(const struct avltree_##name *self, T *it) {                                  \
+    AVLTREE_ENSURE_PTR(self != NULL, "next(): self is null.");                                                         \
+    AVLTREE_ENSURE_PTR(it != NULL, "next(): it is null.");                                                             \
+    /* data is the first member, so the element and its node share the address */                                      \
+    struct avltree_node_##name *node = (struct avltree_node_##name *)(void *)it;                                       \
+    node = AVLTREE_FN(name, successor)(self, node);                                                                    \
+    return node ? &node->data : NULL;                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN(name, prev)(const struct avltree_##name *self, T *it) {                                  \
+    AVLTREE_ENSURE_PTR(self != NULL, "prev(): self is null.");                                                         \
+    AVLTREE_ENSURE_PTR(it != NULL, "prev(): it is null.");                                                             \
+    struct avltree_node_##name *node = (struct avltree_node_##name *)(void *)it;                                       \
+    node = AVLTREE_FN(name, predecessor)(self, node);                                                                  \
+    return node ? &node->data : NULL;                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE size_t AVLTREE_FN(name, for_each_range)(                                                               \
+    const struct avltree_##name *self,                                                                                 \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(T *elem, void *ctx),                                                                                    \
+    void *ctx                                                                                                          \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, 0, "for_each_range(): self is null.");                                                \
+    AVLTREE_ENSURE(fn != NULL, 0, "for_each_range(): fn is null.");                                                    \
+    /* the stack holds the nodes still to visit, smallest on top, every one of them not less than lo */                \
+    struct avltree_node_##name *stack[AVLTREE_MAX_HEIGHT];                                                             \
+    size_t depth = 0;                                                                                                  \
+    size_t visited = 0;                                                                                                \
+    struct avltree_node_##name *current = self->root;                                                                  \
+    while (current != NULL) {                                                                                          \
+        if (AVLTREE_FN(name, cmp)(self, &lo, &current->data) <= 0) {                                                   \
+            stack[depth++] = current;                                                                                  \
+            current = current->left;                                                                                   \
+        } else {                                                                                                       \
+            current = current->right;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (depth > 0) {                                                                                                \
+        struct avltree_node_##name *node = stack[--depth];                                                             \
+        if (AVLTREE_FN(name, cmp)(self, &node->data, &hi) >= 0) {                                                      \
+            break;                                                                                                     \
+        }                                                                                                              \
+        visited += 1;                                                                                                  \
+        if (!fn(&node->data, ctx)) {                                                                                   \
+            break;                                                                                                     \
+        }                                                                                                              \
+        for (current = node->right; current != NULL; current = current->left) {                                        \
+            stack[depth++] = current;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return visited;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, split)(struct avltree_##name *self, T key) {                    \
+    struct avltree_##name greater = { 0 };                                                                             \
+    AVLTREE_ENSURE(self != NULL, greater, "split(): self is null.");                                                   \
+    AVLTREE_ENSURE(self->node_pool == NULL, greater, "split(): the pool of a pooled tree can not be shared.");         \
+    greater = AVLTREE_FN(name, init_like)(self);                                                                       \
+    struct avltree_node_##name *less = NULL;                                                                           \
+    struct avltree_node_##name *equal = NULL;                                                                          \
+    struct avltree_node_##name *more = NULL;                                                                           \
+    AVLTREE_FN(name, node_split)(self, self->root, &key, &less, &equal, &more);                                        \
+    if (equal != NULL) {                                                                                               \
+        more = AVLTREE_FN(name, node_join)(self, NULL, equal, more);                                                   \
+    }                                                                                                                  \
+    if (less != NULL) {                                                                                                \
+        AVLTREE_SET_PARENT(less, NULL);                                                                                \
+    }                                                                                                                  \
+    if (more != NULL) {                                                                                                \
+        AVLTREE_SET_PARENT(more, NULL);                                                                                \
+    }                                                                                                                  \
+    if (AVLTREE_HAS_COUNT) {                                                                                           \
+        greater.size = AVLTREE_NODE_COUNT(more);                                                                       \
+    } else {                                                                                                           \
+        bool less_is_lesser = false;                                                                                   \
+        size_t lesser = AVLTREE_FN(name, node_count_lesser)(less, more, &less_is_lesser);                              \
+        greater.size = less_is_lesser ? self->size - lesser : lesser;                                                  \
+    }                                                                                                                  \
+    greater.root = more;                                                                                               \
+    self->size -= greater.size;                                                                                        \
+    self->root = less;                                                                                                 \
+    return greater;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, join)(                                                             \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+) {                                                                                                                    \
+    enum avltree_error err = AVLTREE_FN(name, set_operation_check)(self, other);                                       \
+    AVLTREE_ENSURE(err == AVLTREE_OK, err, "join(): null, same or differently allocated trees.");                      \
+    if (self->size > 0 && other->size > 0) {                                                                           \
+        T *self_max = AVLTREE_FN(name, max)(self);                                                                     \
+        T *other_min = AVLTREE_FN(name, min)(other);                                                                   \
+        if (AVLTREE_FN(name, cmp)(self, self_max, other_min) >= 0) {                                                   \
+            return AVLTREE_ERR_UNSORTED;                                                                               \
+        }                                                                                                              \
+    }                                                                                                                  \
+    struct avltree_node_##name *root = AVLTREE_FN(name, node_join2)(self, self->root, other->root);                    \
+    AVLTREE_FN(name, set_operation_finish)(self, other, root, 0);                                                      \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, union)(                                                            \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+) {                                                                                                                    \
+    enum avltree_error err = AVLTREE_FN(name, set_operation_check)(self, other);                                       \
+    AVLTREE_ENSURE(err == AVLTREE_OK, err, "union(): null, same or differently allocated trees.");                     \
+    size_t freed = 0;                                                                                                  \
+    struct avltree_node_##name *root = AVLTREE_FN(name, node_union)(self, self->root, other->root, &freed);            \
+    AVLTREE_FN(name, set_operation_finish)(self, other, root, freed);                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, intersection)(                                                     \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+) {                                                                                                                    \
+    enum avltree_error err = AVLTREE_FN(name, set_operation_check)(self, other);                                       \
+    AVLTREE_ENSURE(err == AVLTREE_OK, err, "intersection(): null, same or differently allocated trees.");              \
+    size_t freed = 0;                                                                                                  \
+    struct avltree_node_##name *root = AVLTREE_FN(name, node_intersection)(self, self->root, other->root, &freed);     \
+    AVLTREE_FN(name, set_operation_finish)(self, other, root, freed);                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, difference)(                                                       \
+    struct avltree_##name *self,                                                                                       \
+    struct avltree_##name *other                                                                                       \
+) {                                                                                                                    \
+    enum avltree_error err = AVLTREE_FN(name, set_operation_check)(self, other);                                       \
+    AVLTREE_ENSURE(err == AVLTREE_OK, err, "difference(): null, same or differently allocated trees.");                \
+    size_t freed = 0;                                                                                                  \
+    struct avltree_node_##name *root = AVLTREE_FN(name, node_difference)(self, self->root, other->root, &freed);       \
+    AVLTREE_FN(name, set_operation_finish)(self, other, root, freed);                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_ORDER_IMPL(T, name)
+
+/**
+ * @def AVLTREE_IMPL(T, name, deinit_fn)
+ * @brief Implements all functions for an avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ * @param deinit_fn The function that knows how to free type T and its members (may be a macro or
+ *                  a normal function), recommended to inline the function
+ *
+ * Implements the functions of the AVLTREE_DECL macro
+ *
+ * @note This macro should be used in a .c file, not in a header
+ * @note All functions declared here operates on the avltree_##name struct
+ * @note User code may create and operate on the node struct, but it is not part of the public api
+ *
+ * @warning If the type T doesn't need to have a destructor, or one doesn't want to pass it
+ *          and manually free, then a noop must be passed, like the already provided
+ *          avltree_noop_deinit macro, or (void), or a macro/function that does nothing.
+ */
+#define AVLTREE_IMPL(T, name, deinit_fn)                                                                               \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief cmp: Compares a and b with the comparator_fn given to init                                                   \
+ */                                                                                                                    \
+AVLTREE_LINKAGE int AVLTREE_FN(name, cmp)(const struct avltree_##name *self, T *a, T *b) {                             \
+    AVLTREE_STAT_ADD(self, comparisons, 1);                                                                            \
+    return self->comparator_fn(a, b);                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief init_like: Creates an empty avltree with the allocator and comparator_fn of self                             \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init_like)(const struct avltree_##name *self) {                 \
+    return AVLTREE_FN(name, init)(self->alloc, self->comparator_fn);                                                   \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init)(                                                          \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+) {                                                                                                                    \
+    struct avltree_##name avltree = { 0 };                                                                             \
+    avltree.alloc = alloc;                                                                                             \
+    avltree.root = NULL;                                                                                               \
+    avltree.comparator_fn = comparator_fn;                                                                             \
+    return avltree;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init_pooled)(                                                   \
+    const struct Allocator backing,                                                                                    \
+    int (*comparator_fn)(T *a, T *b),                                                                                  \
+    size_t nodes_per_chunk                                                                                             \
+) {                                                                                                                    \
+    struct avltree_##name avltree = { 0 };                                                                             \
+    struct pool_allocator *pool = (struct pool_allocator *)backing.malloc(sizeof(*pool), backing.ctx);                 \
+    AVLTREE_ENSURE(pool != NULL, avltree, "init_pooled(): allocation of the node pool failed.");                       \
+    *pool = pool_allocator_init(backing, sizeof(struct avltree_node_##name), nodes_per_chunk);                         \
+    avltree = AVLTREE_FN(name, init)(allocator_get_pool(pool), comparator_fn);                                         \
+    avltree.node_pool = pool;                                                                                          \
+    return avltree;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_IMPL_COMMON(T, name, deinit_fn)
+
+/**
+ * @def AVLTREE_IMPL_CMP(T, name, deinit_fn, cmp_macro)
+ * @brief Implements all functions for an avltree type declared with AVLTREE_TYPE_CMP and AVLTREE_DECL_CMP,
+ *        with the comparator baked in at compile-time
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ * @param deinit_fn The function that knows how to free type T and its members (may be a macro or
+ *                  a normal function), recommended to inline the function
+ * @param cmp_macro Three-way comparator (may be a macro or a normal function) taking two T* and
+ *                  returning < 0, 0 or > 0, same convention as comparator_fn
+ *
+ * @details
+ * Same trick as the compile-time deinit_fn: every descent of insert, remove, the lookups and the bulk
+ * operations expands cmp_macro instead of loading comparator_fn from the tree and calling through it, so
+ * the compiler can inline the comparison. The functions and their behaviour are the ones of AVLTREE_IMPL,
+ * only init and init_pooled lose their comparator_fn parameter.
+ *
+ * @code
+ * #define int_cmp(a, b) ((*(a) > *(b)) - (*(a) < *(b)))
+ * AVLTREE_TYPE_CMP(int, ints)
+ * AVLTREE_DECL_CMP(int, ints)
+ * AVLTREE_IMPL_CMP(int, ints, avltree_noop_deinit, int_cmp)
+ * // ...
+ * struct avltree_ints tree = ints_init(allocator_get_default());
+ * ints_insert(&tree, 42);
+ * @endcode
+ *
+ * @note This macro should be used in a .c file, not in a header
+ * @note AVLTREE_IMPL_CONCURRENT passes a comparator_fn to init, it only wraps AVLTREE_IMPL trees
+ */
+#define AVLTREE_IMPL_CMP(T, name, deinit_fn, cmp_macro)                                                                \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief cmp: Compares a and b with the cmp_macro given to AVLTREE_IMPL_CMP, expanded inline                          \
+ */                                                                                                                    \
+AVLTREE_LINKAGE int AVLTREE_FN(name, cmp)(const struct avltree_##name *self, T *a, T *b) {                             \
+    AVLTREE_STAT_ADD(self, comparisons, 1);                                                                            \
+    (void)self;                                                                                                        \
+    return (cmp_macro(a, b));                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief init_like: Creates an empty avltree with the allocator of self                                               \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init_like)(const struct avltree_##name *self) {                 \
+    return AVLTREE_FN(name, init)(self->alloc);                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init)(                                                          \
+    const struct Allocator alloc                                                                                       \
+) {                                                                                                                    \
+    struct avltree_##name avltree = { 0 };                                                                             \
+    avltree.alloc = alloc;                                                                                             \
+    avltree.root = NULL;                                                                                               \
+    return avltree;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init_pooled)(                                                   \
+    const struct Allocator backing,                                                                                    \
+    size_t nodes_per_chunk                                                                                             \
+) {                                                                                                                    \
+    struct avltree_##name avltree = { 0 };                                                                             \
+    struct pool_allocator *pool = (struct pool_allocator *)backing.malloc(sizeof(*pool), backing.ctx);                 \
+    AVLTREE_ENSURE(pool != NULL, avltree, "init_pooled(): allocation of the node pool failed.");                       \
+    *pool = pool_allocator_init(backing, sizeof(struct avltree_node_##name), nodes_per_chunk);                         \
+    avltree = AVLTREE_FN(name, init)(allocator_get_pool(pool));                                                        \
+    avltree.node_pool = pool;                                                                                          \
+    return avltree;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_IMPL_COMMON(T, name, deinit_fn)
+
+/**
+ * @def AVLTREE_DECL_ARRAYLIST(T, name, list_name)
+ * @brief Declares the bulk moves between an avltree and an arraylist of the same T, drain_to_arraylist and
+ *        steal_from_arraylist
+ * @param T The type both containers hold
+ * @param name The name suffix for the avltree type, declared with AVLTREE_DECL or AVLTREE_DECL_CMP
+ * @param list_name The name suffix for the arraylist type, declared with ARRAYLIST_DECL or ARRAYLIST_DECL_CMP
+ *
+ * @details
+ * Only declares, after the DECL macros of both types:
+ * - enum avltree_error AVLTREE_FN(name, drain_to_arraylist)(struct avltree_##name *self, struct arraylist_##list_name *list);
+ * - enum avltree_error AVLTREE_FN(name, steal_from_arraylist)(struct avltree_##name *self, struct arraylist_##list_name *list);
+ */
+#define AVLTREE_DECL_ARRAYLIST(T, name, list_name)                                                                     \
+/**                                                                                                                    \
+ * @brief drain_to_arraylist: Moves every element of self, in ascending order, to the end of list                      \
+ * @param self Pointer to the avltree, left empty and still usable                                                     \
+ * @param list Pointer to the arraylist receiving the elements                                                         \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or list is null, or AVLTREE_ERR_ALLOC if the list could not be         \
+ *         reserved, both containers are then untouched                                                                \
+ *                                                                                                                     \
+ * @note The list is reserved once, then the tree is walked in order flattening it like deinit does, every             \
+ *       element is memcpy'd into its slot and the node freed, a pooled tree hands all of its chunks back at           \
+ *       once after the walk. deinit_fn is never called, the list owns the elements afterwards                         \
+ * @warning The elements are moved bitwise, memory they own goes with them and is later given to the                   \
+ *          deinit_fn of the list with the allocator of the list                                                       \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, drain_to_arraylist)(                                \
+    struct avltree_##name *self,                                                                                       \
+    struct arraylist_##list_name *list                                                                                 \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief steal_from_arraylist: Moves every element of list into self, sorting and loading them in bulk                \
+ * @param self Pointer to the avltree receiving the elements                                                           \
+ * @param list Pointer to the arraylist to take the elements from                                                      \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or list is null, or AVLTREE_ERR_ALLOC if the sort buffer or            \
+ *         the nodes could not be allocated, both containers are then untouched                                        \
+ *                                                                                                                     \
+ * @note Elements equal to one already in self, or to one before them in the list, stay in the list, in                \
+ *       ascending order, and nothing else does, the list keeps its capacity. deinit_fn is never called, so            \
+ *       the ones left over are for the caller to deinit or keep                                                       \
+ * @note Sorted with a stable merge sort (skipped when the list is already in order), then every node is               \
+ *       allocated up front and the elements memcpy'd in, an empty tree is built in O(n) like                          \
+ *       build_from_sorted, otherwise they are merged in like insert_batch                                             \
+ * @warning Same as drain_to_arraylist, the elements are moved bitwise                                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, steal_from_arraylist)(                              \
+    struct avltree_##name *self,                                                                                       \
+    struct arraylist_##list_name *list                                                                                 \
+);
+
+/**
+ * @def AVLTREE_IMPL_ARRAYLIST(T, name, list_name)
+ * @brief Implements drain_to_arraylist and steal_from_arraylist
+ * @param T The type both containers hold
+ * @param name The name suffix for the avltree type
+ * @param list_name The name suffix for the arraylist type
+ *
+ * @details
+ * Moving between the two with insert and push_back copies every element twice and destroys the source, these
+ * hand the elements over with one memcpy each and never call a deinit_fn, so whatever T owns changes container
+ * with it, a list of pairs holding heap memory included, like pair steal does for one pair. It goes after the
+ * IMPL macros of both types, AVLTREE_IMPL or AVLTREE_IMPL_CMP for the tree.
+ *
+ * @code
+ * ARRAYLIST(int, ints, arraylist_noop_deinit)
+ * AVLTREE_TYPE(int, set)
+ * AVLTREE_DECL(int, set)
+ * AVLTREE_IMPL(int, set, avltree_noop_deinit)
+ * AVLTREE_DECL_ARRAYLIST(int, set, ints)
+ * AVLTREE_IMPL_ARRAYLIST(int, set, ints)
+ * // ...
+ * set_steal_from_arraylist(&tree, &list); // list keeps the duplicates only
+ * set_drain_to_arraylist(&tree, &list);   // appended in ascending order, tree is empty
+ * @endcode
+ *
+ * @note This macro should be used in a .c file, not in a header
+ */
+#define AVLTREE_IMPL_ARRAYLIST(T, name, list_name)                                                                     \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief transfer_keeps: Checks if the i-th of the ascending values goes into the tree, it must not be equal to       \
+ *        the value before it nor to an element already in the tree                                                    \
+ */                                                                                                                    \
+AVLTREE_LINKAGE bool AVLTREE_FN(name, transfer_keeps)(const struct avltree_##name *self, const T *values, size_t i) {  \
+    if (i > 0 && AVLTREE_FN(name, cmp)(self, (T *)&values[i - 1], (T *)&values[i]) == 0) {                             \
+        return false;                                                                                                  \
+    }                                                                                                                  \
+    return self->root == NULL || !AVLTREE_FN(name, contains)(self, values[i]);                                         \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, drain_to_arraylist)(                                               \
+    struct avltree_##name *self,                                                                                       \
+    struct arraylist_##list_name *list                                                                                 \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "drain_to_arraylist(): self is null.");                             \
+    AVLTREE_ENSURE(list != NULL, AVLTREE_ERR_NULL, "drain_to_arraylist(): list is null.");                             \
+    if (self->size == 0) {                                                                                             \
+        return AVLTREE_OK;                                                                                             \
+    }                                                                                                                  \
+    if (self->size > SIZE_MAX - list->size                                                                             \
+        || ARRAYLIST_FN(list_name, reserve)(list, list->size + self->size) != ARRAYLIST_OK) {                          \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    T *out = list->data + list->size;                                                                                  \
+    bool pooled = self->node_pool != NULL;                                                                             \
+    struct avltree_node_##name *curr = self->root;                                                                     \
+    while (curr) {                                                                                                     \
+        if (curr->left) {                                                                                              \
+            struct avltree_node_##name *left = curr->left;                                                             \
+            curr->left = left->right;                                                                                  \
+            left->right = curr;                                                                                        \
+            curr = left;                                                                                               \
+        } else {                                                                                                       \
+            struct avltree_node_##name *right = curr->right;                                                           \
+            memcpy(out++, &curr->data, sizeof(T));                                                                     \
+            if (!pooled) {                                                                                             \
+                self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                \
+            }                                                                                                          \
+            curr = right;                                                                                              \
+        }                                                                                                              \
+    }                                                                                                                  \
+    if (pooled) {                                                                                                      \
+        pool_allocator_release(self->node_pool);                                                                       \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, self->size);                                                                    \
+    list->size += self->size;                                                                                          \
+    self->root = NULL;                                                                                                 \
+    self->size = 0;                                                                                                    \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, steal_from_arraylist)(                                             \
+    struct avltree_##name *self,                                                                                       \
+    struct arraylist_##list_name *list                                                                                 \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "steal_from_arraylist(): self is null.");                           \
+    AVLTREE_ENSURE(list != NULL, AVLTREE_ERR_NULL, "steal_from_arraylist(): list is null.");                           \
+    size_t n = list->size;                                                                                             \
+    if (n == 0) {                                                                                                      \
+        return AVLTREE_OK;                                                                                             \
+    }                                                                                                                  \
+    T *buffer = NULL;                                                                                                  \
+    T *sorted = (T *)AVLTREE_FN(name, batch_prepare)(self, list->data, &n, false, &buffer);                            \
+    if (sorted == NULL) {                                                                                              \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    size_t kept = 0;                                                                                                   \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        kept += AVLTREE_FN(name, transfer_keeps)(self, sorted, i) ? 1 : 0;                                             \
+    }                                                                                                                  \
+    if (kept == 0) {                                                                                                   \
+        AVLTREE_FN(name, batch_release)(self, buffer, n);                                                              \
+        return AVLTREE_OK;                                                                                             \
+    }                                                                                                                  \
+    /* The list was in order but some elements stay, they are split off through a copy so it is left as it was */      \
+    if (kept < n && buffer == NULL) {                                                                                  \
+        if (n > SIZE_MAX / 2 / sizeof(T)) {                                                                            \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
+        }                                                                                                              \
+        buffer = AVLTREE_CAST(T)self->alloc.malloc(2 * n * sizeof(T), self->alloc.ctx);                                \
+        if (buffer == NULL) {                                                                                          \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
+        }                                                                                                              \
+        memcpy(buffer, sorted, n * sizeof(T));                                                                         \
+        sorted = buffer;                                                                                               \
+    }                                                                                                                  \
+    struct avltree_node_##name *chain = NULL;                                                                          \
+    for (size_t i = 0; i < kept; ++i) {                                                                                \
+        struct avltree_node_##name *node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
+        if (node == NULL) {                                                                                            \
+            while (chain != NULL) {                                                                                    \
+                struct avltree_node_##name *next = chain->right;                                                       \
+                self->alloc.free(chain, sizeof(*chain), self->alloc.ctx);                                              \
+                chain = next;                                                                                          \
+            }                                                                                                          \
+            AVLTREE_FN(name, batch_release)(self, buffer, n);                                                          \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
+        }                                                                                                              \
+        node->right = chain;                                                                                           \
+        chain = node;                                                                                                  \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_allocs, kept);                                                                         \
+    /* Compacted in place, sorted[i - 1] is only overwritten while every element before it was kept, by itself */      \
+    size_t taken = 0;                                                                                                  \
+    size_t left = 0;                                                                                                   \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        if (AVLTREE_FN(name, transfer_keeps)(self, sorted, i)) {                                                       \
+            sorted[taken++] = sorted[i];                                                                               \
+        } else {                                                                                                       \
+            list->data[left++] = sorted[i];                                                                            \
+        }                                                                                                              \
+    }                                                                                                                  \
+    size_t added = 0;                                                                                                  \
+    self->root = AVLTREE_FN(name, node_insert_sorted)(self, self->root, sorted, 0, kept, &chain, &added);              \
+    AVLTREE_SET_PARENT(self->root, NULL);                                                                              \
+    self->size += added;                                                                                               \
+    list->size = left;                                                                                                 \
+    AVLTREE_FN(name, batch_release)(self, buffer, n);                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}
+
+/* ====== AVLTREE_INDEXED Index based (nodes in an arraylist) version START ====== */
+
+/**
+ * @def AVLTREE_USE_PREFIX_INDEXED
+ * @brief Defines at compile-time if the functions will use the avltree_idx_* prefix
+ * Same as AVLTREE_USE_PREFIX, but for the indexed version.
+ * Generates functions with the pattern avltree_idx_##name##_function() instead of idx_##name##_function()
+ *
+ * @warning The @c AVLTREE_FN_IDX macro is for intenal use only, I can't see any usefulness for user code
+ */
+#ifdef AVLTREE_USE_PREFIX_INDEXED
+    #define AVLTREE_FN_IDX(name, func) avltree_idx_##name##_##func
+#else
+    #define AVLTREE_FN_IDX(name, func) idx_##name##_##func
+#endif
+
+/**
+ * @def AVLTREE_IDX_NIL
+ * @brief Index standing for "no node" in the indexed version, the NULL of the pointer version
+ */
+#define AVLTREE_IDX_NIL UINT32_MAX
+
+/**
+ * @def AVLTREE_TYPE_INDEXED(T, name)
+ * @brief Defines an avltree structure for a specific type T whose nodes live in one arraylist
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ *
+ * @details
+ * Instead of one allocation per node, every node is a slot of an ARRAYLIST and links to its children by
+ * 32-bit index. Nodes are smaller (no pointers, no parent), neighbours in the array are usually close in
+ * the tree, and the whole tree is a single buffer: deep_clone is one memcpy and the buffer can be written
+ * out and read back as is. Removed slots go to a free list and are reused by the next insertions.
+ *
+ * This macro defines three structures:
+ * - A struct named "avltree_idx_node_##name" with the following fields:
+ * - - "data": Value of type T that each node in the tree holds
+ * - - "left": Index of the left node, or the next free slot while the slot is free
+ * - - "right": Index of the right node
+ * - - "height": Current height in the tree, 0 marks a free slot
+ *
+ * - The arraylist of nodes, "arraylist_avltree_idx_nodes_##name", see ARRAYLIST_TYPE
+ *
+ * - A struct named "avltree_idx_##name" with the following fields:
+ * - - "nodes": Arraylist holding every slot, live or free
+ * - - "root": Index of the root node, AVLTREE_IDX_NIL when empty
+ * - - "free_head": First slot of the free list, AVLTREE_IDX_NIL when there is none
+ * - - "size": Size of the tree
+ * - - "comparator_fn": Function pointer that knows how to compare two types T for balancing
+ * - - "stats": Only when AVLTREE_STATS is defined, see struct avltree_stats
+ * @code
+ * // Example: Define an indexed avltree for integers
+ * AVLTREE_TYPE_INDEXED(int, ints)
+ * // Creates a struct named struct avltree_idx_ints
+ * @endcode
+ *
+ * @note The node arraylist functions follow ARRAYLIST_LINKAGE, when sharing an indexed tree across TUs
+ *       set it the same way as AVLTREE_LINKAGE
+ */
+#define AVLTREE_TYPE_INDEXED(T, name)                                                                                  \
+struct avltree_idx_node_##name {                                                                                       \
+    T data;                                                                                                            \
+    uint32_t left;                                                                                                     \
+    uint32_t right;                                                                                                    \
+    unsigned char height;                                                                                              \
+};                                                                                                                     \
+                                                                                                                       \
+ARRAYLIST_TYPE(struct avltree_idx_node_##name, avltree_idx_nodes_##name)                                               \
+                                                                                                                       \
+struct avltree_idx_##name {                                                                                            \
+    struct arraylist_avltree_idx_nodes_##name nodes;                                                                   \
+    uint32_t root;                                                                                                     \
+    uint32_t free_head;                                                                                                \
+    size_t size;                                                                                                       \
+    int (*comparator_fn)(T *a, T *b);                                                                                  \
+    AVLTREE_STATS_FIELD                                                                                                \
+};
+
+/**
+ * @def AVLTREE_DECL_INDEXED(T, name)
+ * @brief Declares all functions for an indexed avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ *
+ * @details
+ * Same functions and semantics as AVLTREE_DECL, operating on struct avltree_idx_##name and prefixed with
+ * idx_, apart from:
+ * - init_pooled is not there, the node arraylist already is the pool
+ * - reserve, to size the node arraylist up front
+ * - deep_clone accepts a NULL deep_clone_fn for a plain copy of the elements
+ *
+ * @warning Pointers returned by emplace, find and the bound functions point into the node arraylist,
+ *          the next insert or emplace may move it, just like with an ARRAYLIST
+ */
+#define AVLTREE_DECL_INDEXED(T, name)                                                                                  \
+ARRAYLIST_DECL(struct avltree_idx_node_##name, avltree_idx_nodes_##name)                                               \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief init: Creates a new indexed avltree                                                                          \
+ * @param alloc Custom allocator instance, used for the node arraylist                                                 \
+ * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
+ *                      Must have the following prototype:                                                             \
+ *                      int (*comparator_fn)(T *a, T *b);                                                              \
+ * @return An empty avltree                                                                                            \
+ *                                                                                                                     \
+ * @note It does not allocate                                                                                          \
+ *                                                                                                                     \
+ * @warning The comparator function must not be null, otherwise this data structure will not work.                     \
+ * @warning Call name##deinit() when done.                                                                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_idx_##name AVLTREE_FN_IDX(name, init)(                                   \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief deep_clone: Deeply clones an indexed avltree                                                                 \
+ * @param self Pointer to the avltree to copy from                                                                     \
+ * @param deep_clone_fn Function that knows how to clone a single element of type T, or NULL                           \
+ *                      Must have the following prototype:                                                             \
+ *                      void (*deep_clone_fn)(T *dst, T *src, struct Allocator *alloc);                                \
+ * @return A new avltree struct that is independent of self, with the same shape and slot layout                       \
+ *                                                                                                                     \
+ * @note The node arraylist is copied with one memcpy, free slots included, then deep_clone_fn is                      \
+ *       called on every live slot, when T owns nothing pass NULL and the memcpy is the whole clone                    \
+ *                                                                                                                     \
+ * @warning If self is NULL or the allocation fails then it returns a zero-initialized struct,                         \
+ *          if asserts are enabled then it crashes                                                                     \
+ * @warning The return of this function should not be discarded, if doing so, memory may be leaked                     \
+ */                                                                                                                    \
+AVLTREE_NODISCARD AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_idx_##name AVLTREE_FN_IDX(name, deep_clone)(           \
+    const struct avltree_idx_##name *self,                                                                             \
+    void (*deep_clone_fn)(T *dst, T *src, struct Allocator *alloc)                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief deinit: Destroys and frees the avltree                                                                       \
+ * @param self Pointer to the avltree to deinitialize                                                                  \
+ *                                                                                                                     \
+ * Calls deinit_fn on every live slot, in slot order, then frees the node arraylist                                    \
+ * Safe to call on NULL or already deinitialized avltrees, returns early                                               \
+ *                                                                                                                     \
+ * @note If deinit_fn is avltree_noop_deinit the slots are not visited, it is a single free                            \
+ * @note The self parameter will be left in an unusable, NULL/uninitialized state and should not be                    \
+ *       used, to reuse it, one must call init again and reinitialize it                                               \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, deinit)(struct avltree_idx_##name *self);                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief clear: Clears the tree, leaving it in an empty but reusable state                                            \
+ * @param self Pointer to the avltree                                                                                  \
+ *                                                                                                                     \
+ * @note The node arraylist keeps its capacity, only deinit gives the memory back                                      \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, clear)(struct avltree_idx_##name *self);                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief reserve: Makes room for at least capacity nodes so the next insertions do not allocate                       \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param capacity Number of nodes to make room for, free slots included                                               \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self is null, or AVLTREE_ERR_ALLOC on allocation failure or                 \
+ *         if capacity does not fit the 32-bit indices                                                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, reserve)(                                       \
+    struct avltree_idx_##name *self,                                                                                   \
+    size_t capacity                                                                                                    \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief insert: Inserts a new value in the tree                                                                      \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to be inserted                                                                                   \
+ * @return AVLTREE_OK if insertion was okay, AVLTREE_ERR_NULL if avltree passed was null,                              \
+ *         AVLTREE_ERR_DUPLICATE if the value is already there, or AVLTREE_ERR_ALLOC if allocation failure             \
+ *         happened or every index is taken                                                                            \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, insert)(                                        \
+    struct avltree_idx_##name *self,                                                                                   \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief remove: Removes a value from the tree, its slot goes to the free list                                        \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param value Value to be removed                                                                                    \
+ * @return AVLTREE_OK if removed or not found, AVLTREE_ERR_NULL if avltree passed was null                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, remove)(                                        \
+    struct avltree_idx_##name *self,                                                                                   \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief emplace: Inserts in-place a new value in the tree                                                            \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param construct_fn Function that knows how to construct type T, same contract as emplace of AVLTREE_DECL           \
+ * @param args Pointer to the arguments used in the constructor function                                               \
+ * @return Pointer of type T to the already constructed node value inplace, or NULL on failure                         \
+ *         (self is null, constructor_fn is null, duplicate, allocation failure or constructor failure)                \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, emplace)(                                                       \
+    struct avltree_idx_##name *self,                                                                                   \
+    int (*construct_fn)(T *location, void *args, struct Allocator *alloc),                                             \
+    void *args                                                                                                         \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief find: Finds a value in the tree                                                                              \
+ * @return Pointer to the element equal to value, or NULL if there is none                                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, find)(const struct avltree_idx_##name *self, T value);          \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief contains: Checks if a value is in the tree                                                                   \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_IDX(name, contains)(const struct avltree_idx_##name *self, T value);    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief lower_bound: Smallest element not less than value, or NULL                                                   \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, lower_bound)(const struct avltree_idx_##name *self, T value);   \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief upper_bound: Smallest element greater than value, or NULL                                                    \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, upper_bound)(const struct avltree_idx_##name *self, T value);   \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief floor: Greatest element not greater than value, or NULL                                                      \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, floor)(const struct avltree_idx_##name *self, T value);         \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief ceil: Smallest element not less than value, or NULL, same as lower_bound                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, ceil)(const struct avltree_idx_##name *self, T value);          \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief min: Smallest element of the tree, or NULL when empty                                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, min)(const struct avltree_idx_##name *self);                    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief max: Greatest element of the tree, or NULL when empty                                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, max)(const struct avltree_idx_##name *self);                    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief build_from_sorted: Replaces the contents of the tree with the n values of data, in O(n)                      \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param data Values in strictly ascending order by comparator_fn, an arraylist can pass its data and size            \
+ * @param n How many values data holds                                                                                 \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or data is null, AVLTREE_ERR_DUPLICATE or                              \
+ *         AVLTREE_ERR_UNSORTED if two neighbours are equal or out of order, or AVLTREE_ERR_ALLOC                      \
+ *                                                                                                                     \
+ * The input is checked with n - 1 comparisons and the node arraylist is reserved before anything changes, then the    \
+ * tree is built perfectly balanced in one in-order pass, with no descent and no rotation.                             \
+ * On any error the tree is left untouched and keeps its values.                                                       \
+ *                                                                                                                     \
+ * @note The values are copied in, the tree owns them after AVLTREE_OK, just like after insert                         \
+ * @note The previous contents are destroyed as with clear                                                             \
+ * @note The node arraylist is grown once to n slots and slot i holds the i-th value, in order                         \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, build_from_sorted)(                             \
+    struct avltree_idx_##name *self,                                                                                   \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief begin: Gets the smallest element, where an in-order iteration starts                                         \
+ * @param self Pointer to the avltree                                                                                  \
+ * @return Pointer to the element, or NULL if the tree is empty or self is null                                        \
+ *                                                                                                                     \
+ * Iterating, NULL is the end in both directions:                                                                      \
+ * @code                                                                                                               \
+ * for (int *it = idx_ints_begin(&tree); it != NULL; it = idx_ints_next(&tree, it)) { ... }                            \
+ * for (int *it = idx_ints_max(&tree); it != NULL; it = idx_ints_prev(&tree, it)) { ... }                              \
+ * @endcode                                                                                                            \
+ *                                                                                                                     \
+ * @warning insert, remove and emplace invalidate the iteration, it is safe to modify the element as long as           \
+ *          its order does not change                                                                                  \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, begin)(const struct avltree_idx_##name *self);                  \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief next: Gets the element following it in order                                                                 \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param it Pointer to an element of the tree, as returned by begin, next, prev, find and friends,                    \
+ *           the node arraylist must not have moved since                                                              \
+ * @return Pointer to the next element, or NULL past the greatest one                                                  \
+ *                                                                                                                     \
+ * @note O(log n), there are no parent links to climb so it descends from the root                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, next)(const struct avltree_idx_##name *self, T *it);            \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief prev: Gets the element preceding it in order                                                                 \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param it Pointer to an element of the tree, as returned by begin, next, prev, find and friends,                    \
+ *           the node arraylist must not have moved since                                                              \
+ * @return Pointer to the previous element, or NULL before the smallest one                                            \
+ *                                                                                                                     \
+ * @note O(log n), there are no parent links to climb so it descends from the root                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, prev)(const struct avltree_idx_##name *self, T *it);            \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief for_each_range: Calls fn on every element in [lo, hi), in order                                              \
+ * @param self Pointer to the avltree                                                                                  \
+ * @param lo First key of the range, included                                                                          \
+ * @param hi Last key of the range, excluded                                                                           \
+ * @param fn Function called on every element, returning false stops the scan                                          \
+ *           Must have the following prototype:                                                                        \
+ *           bool (*fn)(T *elem, void *ctx);                                                                           \
+ * @param ctx Pointer given back to fn                                                                                 \
+ * @return How many elements fn was called on                                                                          \
+ *                                                                                                                     \
+ * @note O(log n + k) for k elements in range, with a stack of at most the tree height, no recursion                   \
+ *                                                                                                                     \
+ * @warning fn must not insert or remove, nor change the order of the element it gets                                  \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN_IDX(name, for_each_range)(                                            \
+    const struct avltree_idx_##name *self,                                                                             \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(T *elem, void *ctx),                                                                                    \
+    void *ctx                                                                                                          \
+);
+
+/**
+ * @def AVLTREE_IMPL_INDEXED(T, name, deinit_fn)
+ * @brief Implements all functions for an indexed avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ * @param deinit_fn Destructor of the elements, same as AVLTREE_IMPL
+ */
+#define AVLTREE_IMPL_INDEXED(T, name, deinit_fn)                                                                       \
+ARRAYLIST_IMPL(struct avltree_idx_node_##name, avltree_idx_nodes_##name, arraylist_noop_deinit)                        \
+                                                                                                                       \
+AVLTREE_LINKAGE int AVLTREE_FN_IDX(name, node_get_height)(const struct avltree_idx_node_##name *nodes, uint32_t i) {   \
+    return i == AVLTREE_IDX_NIL ? 0 : (int)nodes[i].height;                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, node_set_height)(struct avltree_idx_node_##name *nodes, uint32_t i) {        \
+    int left_height = AVLTREE_FN_IDX(name, node_get_height)(nodes, nodes[i].left);                                     \
+    int right_height = AVLTREE_FN_IDX(name, node_get_height)(nodes, nodes[i].right);                                   \
+    nodes[i].height = (unsigned char)((left_height > right_height ? left_height : right_height) + 1);                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE int AVLTREE_FN_IDX(name, node_get_balance_factor)(                                                     \
+    const struct avltree_idx_node_##name *nodes,                                                                       \
+    uint32_t i                                                                                                         \
+) {                                                                                                                    \
+    if (i == AVLTREE_IDX_NIL) {                                                                                        \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    return AVLTREE_FN_IDX(name, node_get_height)(nodes, nodes[i].left)                                                 \
+        - AVLTREE_FN_IDX(name, node_get_height)(nodes, nodes[i].right);                                                \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, right_rotation)(struct avltree_idx_node_##name *nodes, uint32_t i) {     \
+    uint32_t left_of_node = nodes[i].left;                                                                             \
+    nodes[i].left = nodes[left_of_node].right;                                                                         \
+    nodes[left_of_node].right = i;                                                                                     \
+    AVLTREE_FN_IDX(name, node_set_height)(nodes, i);                                                                   \
+    AVLTREE_FN_IDX(name, node_set_height)(nodes, left_of_node);                                                        \
+    return left_of_node;                                                                                               \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, left_rotation)(struct avltree_idx_node_##name *nodes, uint32_t i) {      \
+    uint32_t right_of_node = nodes[i].right;                                                                           \
+    nodes[i].right = nodes[right_of_node].left;                                                                        \
+    nodes[right_of_node].left = i;                                                                                     \
+    AVLTREE_FN_IDX(name, node_set_height)(nodes, i);                                                                   \
+    AVLTREE_FN_IDX(name, node_set_height)(nodes, right_of_node);                                                       \
+    return right_of_node;                                                                                              \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, rebalance)(struct avltree_idx_##name *self, uint32_t i) {                \
+    struct avltree_idx_node_##name *nodes = self->nodes.data;                                                          \
+    AVLTREE_FN_IDX(name, node_set_height)(nodes, i);                                                                   \
+    int balance_factor = AVLTREE_FN_IDX(name, node_get_balance_factor)(nodes, i);                                      \
+    if (balance_factor > 1) {                                                                                          \
+        if (AVLTREE_FN_IDX(name, node_get_balance_factor)(nodes, nodes[i].left) < 0) {                                 \
+            /* Left Right case */                                                                                      \
+            nodes[i].left = AVLTREE_FN_IDX(name, left_rotation)(nodes, nodes[i].left);                                 \
+            AVLTREE_STAT_ADD(self, rotations, 1);                                                                      \
+        }                                                                                                              \
+        /* Left Left case */                                                                                           \
+        AVLTREE_STAT_ADD(self, rotations, 1);                                                                          \
+        return AVLTREE_FN_IDX(name, right_rotation)(nodes, i);                                                         \
+    }                                                                                                                  \
+    if (balance_factor < -1) {                                                                                         \
+        if (AVLTREE_FN_IDX(name, node_get_balance_factor)(nodes, nodes[i].right) > 0) {                                \
+            /* Right Left case */                                                                                      \
+            nodes[i].right = AVLTREE_FN_IDX(name, right_rotation)(nodes, nodes[i].right);                              \
+            AVLTREE_STAT_ADD(self, rotations, 1);                                                                      \
+        }                                                                                                              \
+        /* Right Right case */                                                                                         \
+        AVLTREE_STAT_ADD(self, rotations, 1);                                                                          \
+        return AVLTREE_FN_IDX(name, left_rotation)(nodes, i);                                                          \
+    }                                                                                                                  \
+    return i;                                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, relink)(                                                                     \
+    struct avltree_idx_##name *self,                                                                                   \
+    uint32_t parent,                                                                                                   \
+    uint32_t from,                                                                                                     \
+    uint32_t to                                                                                                        \
+) {                                                                                                                    \
+    struct avltree_idx_node_##name *nodes = self->nodes.data;                                                          \
+    if (parent == AVLTREE_IDX_NIL) {                                                                                   \
+        self->root = to;                                                                                               \
+    } else if (nodes[parent].left == from) {                                                                           \
+        nodes[parent].left = to;                                                                                       \
+    } else {                                                                                                           \
+        nodes[parent].right = to;                                                                                      \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, rebalance_path)(                                                             \
+    struct avltree_idx_##name *self,                                                                                   \
+    const uint32_t path[],                                                                                             \
+    size_t depth                                                                                                       \
+) {                                                                                                                    \
+    while (depth > 0) {                                                                                                \
+        uint32_t node = path[--depth];                                                                                 \
+        unsigned char old_height = self->nodes.data[node].height;                                                      \
+        uint32_t subtree = AVLTREE_FN_IDX(name, rebalance)(self, node);                                                \
+        if (subtree != node) {                                                                                         \
+            AVLTREE_FN_IDX(name, relink)(self, depth > 0 ? path[depth - 1] : AVLTREE_IDX_NIL, node, subtree);          \
+        }                                                                                                              \
+        if (self->nodes.data[subtree].height == old_height) {                                                          \
+            break;                                                                                                     \
+        }                                                                                                              \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, take_slot)(struct avltree_idx_##name *self) {                            \
+    uint32_t slot = self->free_head;                                                                                   \
+    if (slot != AVLTREE_IDX_NIL) {                                                                                     \
+        self->free_head = self->nodes.data[slot].left;                                                                 \
+    } else {                                                                                                           \
+        /* AVLTREE_IDX_NIL itself is never handed out as a slot */                                                     \
+        if (self->nodes.size >= (size_t)AVLTREE_IDX_NIL) {                                                             \
+            return AVLTREE_IDX_NIL;                                                                                    \
+        }                                                                                                              \
+        if (ARRAYLIST_FN(avltree_idx_nodes_##name, emplace_back)(&self->nodes) == NULL) {                              \
+            return AVLTREE_IDX_NIL;                                                                                    \
+        }                                                                                                              \
+        slot = (uint32_t)(self->nodes.size - 1);                                                                       \
+    }                                                                                                                  \
+    self->nodes.data[slot].left = AVLTREE_IDX_NIL;                                                                     \
+    self->nodes.data[slot].right = AVLTREE_IDX_NIL;                                                                    \
+    self->nodes.data[slot].height = 1;                                                                                 \
+    AVLTREE_STAT_ADD(self, node_allocs, 1);                                                                            \
+    return slot;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, release_slot)(struct avltree_idx_##name *self, uint32_t slot) {              \
+    self->nodes.data[slot].height = 0;                                                                                 \
+    self->nodes.data[slot].left = self->free_head;                                                                     \
+    self->free_head = slot;                                                                                            \
+    AVLTREE_STAT_ADD(self, node_frees, 1);                                                                             \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, destroy_slots)(struct avltree_idx_##name *self) {                            \
+    if (AVLTREE_DEINIT_IS_NOOP(deinit_fn)) {                                                                           \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    for (size_t i = 0; i < self->nodes.size; ++i) {                                                                    \
+        if (self->nodes.data[i].height != 0) {                                                                         \
+            deinit_fn(&self->nodes.data[i].data, &self->nodes.alloc);                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, successor)(const struct avltree_idx_##name *self, uint32_t node) {       \
+    const struct avltree_idx_node_##name *nodes = self->nodes.data;                                                    \
+    uint32_t current = nodes[node].right;                                                                              \
+    if (current != AVLTREE_IDX_NIL) {                                                                                  \
+        while (nodes[current].left != AVLTREE_IDX_NIL) {                                                               \
+            current = nodes[current].left;                                                                             \
+        }                                                                                                              \
+        return current;                                                                                                \
+    }                                                                                                                  \
+    /* no parent links, the successor is the last node the descent went left from */                                   \
+    uint32_t candidate = AVLTREE_IDX_NIL;                                                                              \
+    current = self->root;                                                                                              \
+    while (current != node) {                                                                                          \
+        if (AVLTREE_CMP(self, (T *)&nodes[node].data, (T *)&nodes[current].data) < 0) {                                \
+            candidate = current;                                                                                       \
+            current = nodes[current].left;                                                                             \
+        } else {                                                                                                       \
+            current = nodes[current].right;                                                                            \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate;                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, predecessor)(const struct avltree_idx_##name *self, uint32_t node) {     \
+    const struct avltree_idx_node_##name *nodes = self->nodes.data;                                                    \
+    uint32_t current = nodes[node].left;                                                                               \
+    if (current != AVLTREE_IDX_NIL) {                                                                                  \
+        while (nodes[current].right != AVLTREE_IDX_NIL) {                                                              \
+            current = nodes[current].right;                                                                            \
+        }                                                                                                              \
+        return current;                                                                                                \
+    }                                                                                                                  \
+    uint32_t candidate = AVLTREE_IDX_NIL;                                                                              \
+    current = self->root;                                                                                              \
+    while (current != node) {                                                                                          \
+        if (AVLTREE_CMP(self, (T *)&nodes[node].data, (T *)&nodes[current].data) > 0) {                                \
+            candidate = current;                                                                                       \
+            current = nodes[current].right;                                                                            \
+        } else {                                                                                                       \
+            current = nodes[current].left;                                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate;                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, check_sorted)(                                                 \
+    const struct avltree_idx_##name *self,                                                                             \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+) {                                                                                                                    \
+    /* same rules as the pointer version, a descending pair anywhere wins over an earlier equal one */                 \
+    enum avltree_error order = AVLTREE_OK;                                                                             \
+    for (size_t i = 1; i < n; ++i) {                                                                                   \
+        int cmp = AVLTREE_CMP(self, (T *)&data[i - 1], (T *)&data[i]);                                                 \
+        if (cmp > 0) {                                                                                                 \
+            return AVLTREE_ERR_UNSORTED;                                                                               \
+        }                                                                                                              \
+        if (cmp == 0) {                                                                                                \
+            order = AVLTREE_ERR_DUPLICATE;                                                                             \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return order;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE uint32_t AVLTREE_FN_IDX(name, build_subtree)(                                                          \
+    struct avltree_idx_##name *self,                                                                                   \
+    uint32_t lo,                                                                                                       \
+    uint32_t hi                                                                                                        \
+) {                                                                                                                    \
+    if (lo >= hi) {                                                                                                    \
+        return AVLTREE_IDX_NIL;                                                                                        \
+    }                                                                                                                  \
+    /* slot i holds the i-th value, the middle of [lo, hi) is the subtree root */                                      \
+    uint32_t mid = lo + (hi - lo) / 2;                                                                                 \
+    struct avltree_idx_node_##name *node = &self->nodes.data[mid];                                                     \
+    node->left = AVLTREE_FN_IDX(name, build_subtree)(self, lo, mid);                                                   \
+    node->right = AVLTREE_FN_IDX(name, build_subtree)(self, mid + 1, hi);                                              \
+    AVLTREE_FN_IDX(name, node_set_height)(self->nodes.data, mid);                                                      \
+    return mid;                                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_idx_##name AVLTREE_FN_IDX(name, init)(                                                  \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+) {                                                                                                                    \
+    struct avltree_idx_##name avltree = { 0 };                                                                         \
+    avltree.nodes = ARRAYLIST_FN(avltree_idx_nodes_##name, init)(alloc);                                               \
+    avltree.root = AVLTREE_IDX_NIL;                                                                                    \
+    avltree.free_head = AVLTREE_IDX_NIL;                                                                               \
+    avltree.comparator_fn = comparator_fn;                                                                             \
+    return avltree;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_idx_##name AVLTREE_FN_IDX(name, deep_clone)(                                            \
+    const struct avltree_idx_##name *self,                                                                             \
+    void (*deep_clone_fn)(T *dst, T *src, struct Allocator *alloc)                                                     \
+) {                                                                                                                    \
+    struct avltree_idx_##name clone = { 0 };                                                                           \
+    AVLTREE_ENSURE(self != NULL, clone, "deep_clone(): avltree is null.");                                             \
+    clone = *self;                                                                                                     \
+    clone.nodes = ARRAYLIST_FN(avltree_idx_nodes_##name, init)(self->nodes.alloc);                                     \
+    if (self->nodes.size > 0) {                                                                                        \
+        enum arraylist_error err = ARRAYLIST_FN(avltree_idx_nodes_##name, reserve)(&clone.nodes, self->nodes.size);    \
+        if (err != ARRAYLIST_OK) {                                                                                     \
+            struct avltree_idx_##name empty = { 0 };                                                                   \
+            return empty;                                                                                              \
+        }                                                                                                              \
+        memcpy(clone.nodes.data, self->nodes.data, self->nodes.size * sizeof(*self->nodes.data));                      \
+        clone.nodes.size = self->nodes.size;                                                                           \
+    }                                                                                                                  \
+    if (deep_clone_fn != NULL) {                                                                                       \
+        for (size_t i = 0; i < clone.nodes.size; ++i) {                                                                \
+            if (clone.nodes.data[i].height != 0) {                                                                     \
+                deep_clone_fn(&clone.nodes.data[i].data, &self->nodes.data[i].data, &clone.nodes.alloc);               \
+            }                                                                                                          \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return clone;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, deinit)(struct avltree_idx_##name *self) {                                   \
+    if (!self) {                                                                                                       \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, self->size);                                                                    \
+    AVLTREE_FN_IDX(name, destroy_slots)(self);                                                                         \
+    ARRAYLIST_FN(avltree_idx_nodes_##name, deinit)(&self->nodes);                                                      \
+    self->root = AVLTREE_IDX_NIL;                                                                                      \
+    self->free_head = AVLTREE_IDX_NIL;                                                                                 \
+    self->size = 0;                                                                                                    \
+    self->comparator_fn = NULL;                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_IDX(name, clear)(struct avltree_idx_##name *self) {                                    \
+    if (!self || self->nodes.size == 0) {                                                                              \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_STAT_ADD(self, node_frees, self->size);                                                                    \
+    AVLTREE_FN_IDX(name, destroy_slots)(self);                                                                         \
+    /* the whole free list goes with the slots, the buffer is kept for the next insertions */                          \
+    self->nodes.size = 0;                                                                                              \
+    self->root = AVLTREE_IDX_NIL;                                                                                      \
+    self->free_head = AVLTREE_IDX_NIL;                                                                                 \
+    self->size = 0;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, reserve)(struct avltree_idx_##name *self, size_t capacity) {   \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "reserve(): self is null.");                                        \
+    AVLTREE_ENSURE(capacity <= (size_t)AVLTREE_IDX_NIL, AVLTREE_ERR_ALLOC, "reserve(): capacity past the indices.");   \
+    if (ARRAYLIST_FN(avltree_idx_nodes_##name, reserve)(&self->nodes, capacity) != ARRAYLIST_OK) {                     \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, insert)(struct avltree_idx_##name *self, T value) {            \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "insert(): self is null.");                                         \
+    /* Search valid position, recording the nodes walked through for the rebalance, as indices the path                \
+       survives the node arraylist moving when the new slot is taken */                                                \
+    uint32_t path[AVLTREE_MAX_HEIGHT];                                                                                 \
+    size_t depth = 0;                                                                                                  \
+    uint32_t current = self->root;                                                                                     \
+    int cmp = 0;                                                                                                       \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        cmp = AVLTREE_CMP(self, &value, &self->nodes.data[current].data);                                              \
+        if (cmp == 0) {                                                                                                \
+            return AVLTREE_ERR_DUPLICATE;                                                                              \
+        }                                                                                                              \
+        path[depth++] = current;                                                                                       \
+        current = (cmp < 0) ? self->nodes.data[current].left : self->nodes.data[current].right;                        \
+    }                                                                                                                  \
+    uint32_t slot = AVLTREE_FN_IDX(name, take_slot)(self);                                                             \
+    AVLTREE_ENSURE(slot != AVLTREE_IDX_NIL, AVLTREE_ERR_ALLOC, "insert(): allocation of new node failed.");            \
+    self->nodes.data[slot].data = value;                                                                               \
+    /* Insert into position, then update heights and rebalance going up through the path */                            \
+    if (depth == 0) {                                                                                                  \
+        self->root = slot;                                                                                             \
+    } else if (cmp < 0) {                                                                                              \
+        self->nodes.data[path[depth - 1]].left = slot;                                                                 \
+    } else {                                                                                                           \
+        self->nodes.data[path[depth - 1]].right = slot;                                                                \
+    }                                                                                                                  \
+    AVLTREE_FN_IDX(name, rebalance_path)(self, path, depth);                                                           \
+    self->size += 1;                                                                                                   \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, remove)(struct avltree_idx_##name *self, T value) {            \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "remove(): self is null.");                                         \
+    struct avltree_idx_node_##name *nodes = self->nodes.data;                                                          \
+    uint32_t path[AVLTREE_MAX_HEIGHT];                                                                                 \
+    size_t depth = 0;                                                                                                  \
+    uint32_t current = self->root;                                                                                     \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        int cmp = AVLTREE_CMP(self, &value, &nodes[current].data);                                                     \
+        if (cmp == 0) {                                                                                                \
+            break;                                                                                                     \
+        }                                                                                                              \
+        path[depth++] = current;                                                                                       \
+        current = (cmp < 0) ? nodes[current].left : nodes[current].right;                                              \
+    }                                                                                                                  \
+    /* Not found */                                                                                                    \
+    if (current == AVLTREE_IDX_NIL) {                                                                                  \
+        return AVLTREE_OK;                                                                                             \
+    }                                                                                                                  \
+    uint32_t del_pos = current;                                                                                        \
+    if (nodes[del_pos].left != AVLTREE_IDX_NIL && nodes[del_pos].right != AVLTREE_IDX_NIL) {                           \
+        /* two children node, del_pos stays on the path, walk on down to its successor and swap the data */            \
+        path[depth++] = del_pos;                                                                                       \
+        uint32_t successor = nodes[del_pos].right;                                                                     \
+        while (nodes[successor].left != AVLTREE_IDX_NIL) {                                                             \
+            path[depth++] = successor;                                                                                 \
+            successor = nodes[successor].left;                                                                         \
+        }                                                                                                              \
+        T tmp = nodes[del_pos].data;                                                                                   \
+        nodes[del_pos].data = nodes[successor].data;                                                                   \
+        nodes[successor].data = tmp;                                                                                   \
+        del_pos = successor;                                                                                           \
+    }                                                                                                                  \
+    /* node with only 1 or no child, relink parent or root to child */                                                 \
+    uint32_t child = (nodes[del_pos].left != AVLTREE_IDX_NIL) ? nodes[del_pos].left : nodes[del_pos].right;            \
+    AVLTREE_FN_IDX(name, relink)(self, depth > 0 ? path[depth - 1] : AVLTREE_IDX_NIL, del_pos, child);                 \
+    deinit_fn(&nodes[del_pos].data, &self->nodes.alloc);                                                               \
+    AVLTREE_FN_IDX(name, release_slot)(self, del_pos);                                                                 \
+    AVLTREE_FN_IDX(name, rebalance_path)(self, path, depth);                                                           \
+    self->size -= 1;                                                                                                   \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, emplace)(                                                                      \
+    struct avltree_idx_##name *self,                                                                                   \
+    int (*construct_fn)(T *location, void *args, struct Allocator *alloc),                                             \
+    void *args                                                                                                         \
+) {                                                                                                                    \
+    AVLTREE_ENSURE_PTR(self != NULL, "emplace(): self is null.");                                                      \
+    AVLTREE_ENSURE_PTR(construct_fn != NULL, "emplace(): constructor function is null.");                              \
+    /* Take the slot first, nothing moves the node arraylist after this */                                             \
+    uint32_t slot = AVLTREE_FN_IDX(name, take_slot)(self);                                                             \
+    AVLTREE_ENSURE_PTR(slot != AVLTREE_IDX_NIL, "emplace(): allocation of new node failed.");                          \
+    struct avltree_idx_node_##name *nodes = self->nodes.data;                                                          \
+    if (construct_fn(&nodes[slot].data, args, &self->nodes.alloc) != 0) {                                              \
+        AVLTREE_FN_IDX(name, release_slot)(self, slot);                                                                \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    uint32_t path[AVLTREE_MAX_HEIGHT];                                                                                 \
+    size_t depth = 0;                                                                                                  \
+    uint32_t current = self->root;                                                                                     \
+    int cmp = 0;                                                                                                       \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        cmp = AVLTREE_CMP(self, &nodes[slot].data, &nodes[current].data);                                              \
+        if (cmp == 0) {                                                                                                \
+            deinit_fn(&nodes[slot].data, &self->nodes.alloc);                                                          \
+            AVLTREE_FN_IDX(name, release_slot)(self, slot);                                                            \
+            return NULL;                                                                                               \
+        }                                                                                                              \
+        path[depth++] = current;                                                                                       \
+        current = (cmp < 0) ? nodes[current].left : nodes[current].right;                                              \
+    }                                                                                                                  \
+    if (depth == 0) {                                                                                                  \
+        self->root = slot;                                                                                             \
+    } else if (cmp < 0) {                                                                                              \
+        nodes[path[depth - 1]].left = slot;                                                                            \
+    } else {                                                                                                           \
+        nodes[path[depth - 1]].right = slot;                                                                           \
+    }                                                                                                                  \
+    AVLTREE_FN_IDX(name, rebalance_path)(self, path, depth);                                                           \
+    self->size += 1;                                                                                                   \
+    return &nodes[slot].data;                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, find)(const struct avltree_idx_##name *self, T value) {                        \
+    AVLTREE_ENSURE_PTR(self != NULL, "find(): self is null.");                                                         \
+    uint32_t current = self->root;                                                                                     \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        int cmp = AVLTREE_CMP(self, &value, &self->nodes.data[current].data);                                          \
+        if (cmp < 0) {                                                                                                 \
+            current = self->nodes.data[current].left;                                                                  \
+        } else if (cmp > 0) {                                                                                          \
+            current = self->nodes.data[current].right;                                                                 \
+        } else {                                                                                                       \
+            return &self->nodes.data[current].data;                                                                    \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return NULL;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_IDX(name, contains)(const struct avltree_idx_##name *self, T value) {                  \
+    AVLTREE_ENSURE(self != NULL, false, "contains(): self is null.");                                                  \
+    return AVLTREE_FN_IDX(name, find)(self, value) != NULL;                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, lower_bound)(const struct avltree_idx_##name *self, T value) {                 \
+    AVLTREE_ENSURE_PTR(self != NULL, "lower_bound(): self is null.");                                                  \
+    uint32_t current = self->root;                                                                                     \
+    uint32_t candidate = AVLTREE_IDX_NIL;                                                                              \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        if (AVLTREE_CMP(self, &value, &self->nodes.data[current].data) <= 0) {                                         \
+            candidate = current;                                                                                       \
+            current = self->nodes.data[current].left;                                                                  \
+        } else {                                                                                                       \
+            current = self->nodes.data[current].right;                                                                 \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate != AVLTREE_IDX_NIL ? &self->nodes.data[candidate].data : NULL;                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, upper_bound)(const struct avltree_idx_##name *self, T value) {                 \
+    AVLTREE_ENSURE_PTR(self != NULL, "upper_bound(): self is null.");                                                  \
+    uint32_t current = self->root;                                                                                     \
+    uint32_t candidate = AVLTREE_IDX_NIL;                                                                              \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        if (AVLTREE_CMP(self, &value, &self->nodes.data[current].data) < 0) {                                          \
+            candidate = current;                                                                                       \
+            current = self->nodes.data[current].left;                                                                  \
+        } else {                                                                                                       \
+            current = self->nodes.data[current].right;                                                                 \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate != AVLTREE_IDX_NIL ? &self->nodes.data[candidate].data : NULL;                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, floor)(const struct avltree_idx_##name *self, T value) {                       \
+    AVLTREE_ENSURE_PTR(self != NULL, "floor(): self is null.");                                                        \
+    uint32_t current = self->root;                                                                                     \
+    uint32_t candidate = AVLTREE_IDX_NIL;                                                                              \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        int cmp = AVLTREE_CMP(self, &value, &self->nodes.data[current].data);                                          \
+        if (cmp == 0) {                                                                                                \
+            return &self->nodes.data[current].data;                                                                    \
+        }                                                                                                              \
+        if (cmp > 0) {                                                                                                 \
+            candidate = current;                                                                                       \
+            current = self->nodes.data[current].right;                                                                 \
+        } else {                                                                                                       \
+            current = self->nodes.data[current].left;                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return candidate != AVLTREE_IDX_NIL ? &self->nodes.data[candidate].data : NULL;                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, ceil)(const struct avltree_idx_##name *self, T value) {                        \
+    AVLTREE_ENSURE_PTR(self != NULL, "ceil(): self is null.");                                                         \
+    return AVLTREE_FN_IDX(name, lower_bound)(self, value);                                                             \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, min)(const struct avltree_idx_##name *self) {                                  \
+    AVLTREE_ENSURE_PTR(self != NULL, "min(): self is null.");                                                          \
+    uint32_t current = self->root;                                                                                     \
+    if (current == AVLTREE_IDX_NIL) {                                                                                  \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    while (self->nodes.data[current].left != AVLTREE_IDX_NIL) {                                                        \
+        current = self->nodes.data[current].left;                                                                      \
+    }                                                                                                                  \
+    return &self->nodes.data[current].data;                                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, max)(const struct avltree_idx_##name *self) {                                  \
+    AVLTREE_ENSURE_PTR(self != NULL, "max(): self is null.");                                                          \
+    uint32_t current = self->root;                                                                                     \
+    if (current == AVLTREE_IDX_NIL) {                                                                                  \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    while (self->nodes.data[current].right != AVLTREE_IDX_NIL) {                                                       \
+        current = self->nodes.data[current].right;                                                                     \
+    }                                                                                                                  \
+    return &self->nodes.data[current].data;                                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_IDX(name, build_from_sorted)(                                            \
+    struct avltree_idx_##name *self,                                                                                   \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "build_from_sorted(): self is null.");                              \
+    AVLTREE_ENSURE(n == 0 || data != NULL, AVLTREE_ERR_NULL, "build_from_sorted(): data is null.");                    \
+    enum avltree_error err = AVLTREE_FN_IDX(name, check_sorted)(self, data, n);                                        \
+    if (err != AVLTREE_OK) {                                                                                           \
+        return err;                                                                                                    \
+    }                                                                                                                  \
+    /* Grow once before touching anything, a failure leaves the tree as it was */                                      \
+    err = AVLTREE_FN_IDX(name, reserve)(self, n);                                                                      \
+    if (err != AVLTREE_OK) {                                                                                           \
+        return err;                                                                                                    \
+    }                                                                                                                  \
+    AVLTREE_FN_IDX(name, clear)(self);                                                                                 \
+    for (size_t i = 0; i < n; ++i) {                                                                                   \
+        memcpy(&self->nodes.data[i].data, &data[i], sizeof(T));                                                        \
+    }                                                                                                                  \
+    self->nodes.size = n;                                                                                              \
+    AVLTREE_STAT_ADD(self, node_allocs, n);                                                                            \
+    self->root = AVLTREE_FN_IDX(name, build_subtree)(self, 0, (uint32_t)n);                                            \
+    self->size = n;                                                                                                    \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, begin)(const struct avltree_idx_##name *self) {                                \
+    AVLTREE_ENSURE_PTR(self != NULL, "begin(): self is null.");                                                        \
+    return AVLTREE_FN_IDX(name, min)(self);                                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, next)(const struct avltree_idx_##name *self, T *it) {                          \
+    AVLTREE_ENSURE_PTR(self != NULL, "next(): self is null.");                                                         \
+    AVLTREE_ENSURE_PTR(it != NULL, "next(): it is null.");                                                             \
+    /* data is the first member, so the element pointer gives back its slot */                                         \
+    struct avltree_idx_node_##name *node = (struct avltree_idx_node_##name *)(void *)it;                               \
+    uint32_t slot = AVLTREE_FN_IDX(name, successor)(self, (uint32_t)(node - self->nodes.data));                        \
+    return slot != AVLTREE_IDX_NIL ? &self->nodes.data[slot].data : NULL;                                              \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE T *AVLTREE_FN_IDX(name, prev)(const struct avltree_idx_##name *self, T *it) {                          \
+    AVLTREE_ENSURE_PTR(self != NULL, "prev(): self is null.");                                                         \
+    AVLTREE_ENSURE_PTR(it != NULL, "prev(): it is null.");                                                             \
+    struct avltree_idx_node_##name *node = (struct avltree_idx_node_##name *)(void *)it;                               \
+    uint32_t slot = AVLTREE_FN_IDX(name, predecessor)(self, (uint32_t)(node - self->nodes.data));                      \
+    return slot != AVLTREE_IDX_NIL ? &self->nodes.data[slot].data : NULL;                                              \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE size_t AVLTREE_FN_IDX(name, for_each_range)(                                                           \
+    const struct avltree_idx_##name *self,                                                                             \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(T *elem, void *ctx),                                                                                    \
+    void *ctx                                                                                                          \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, 0, "for_each_range(): self is null.");                                                \
+    AVLTREE_ENSURE(fn != NULL, 0, "for_each_range(): fn is null.");                                                    \
+    struct avltree_idx_node_##name *nodes = self->nodes.data;                                                          \
+    uint32_t stack[AVLTREE_MAX_HEIGHT];                                                                                \
+    size_t depth = 0;                                                                                                  \
+    size_t visited = 0;                                                                                                \
+    uint32_t current = self->root;                                                                                     \
+    while (current != AVLTREE_IDX_NIL) {                                                                               \
+        if (AVLTREE_CMP(self, &lo, &nodes[current].data) <= 0) {                                                       \
+            stack[depth++] = current;                                                                                  \
+            current = nodes[current].left;                                                                             \
+        } else {                                                                                                       \
+            current = nodes[current].right;                                                                            \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (depth > 0) {                                                                                                \
+        uint32_t node = stack[--depth];                                                                                \
+        if (AVLTREE_CMP(self, &nodes[node].data, &hi) >= 0) {                                                          \
+            break;                                                                                                     \
+        }                                                                                                              \
+        visited += 1;                                                                                                  \
+        if (!fn(&nodes[node].data, ctx)) {                                                                             \
+            break;                                                                                                     \
+        }                                                                                                              \
+        for (current = nodes[node].right; current != AVLTREE_IDX_NIL; current = nodes[current].left) {                 \
+            stack[depth++] = current;                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return visited;                                                                                                    \
+}
+
+
+/* ====== AVLTREE_CONCURRENT Reader-writer locked version START ====== */
+
+/**
+ * @def AVLTREE_PTHREAD
+ * @brief Define before including the header for AVLTREE_CONCURRENT, a tree behind a pthread rwlock
+ *
+ * @details
+ * Readers (find, contains, the bounds, for_each_range) share the lock and run in parallel, writers
+ * (insert, remove, clear) take it alone. The readers copy the element out instead of returning a pointer
+ * into the tree, since a writer may free that node as soon as the lock is released. Compound operations,
+ * or iterating with begin/next, go through read() and write(), which run a function with the lock held.
+ *
+ * Under a strict -std=c99 the rwlock is only declared with _POSIX_C_SOURCE 200112L or later, defined
+ * before the first system header.
+ */
+#ifdef AVLTREE_PTHREAD
+#include <pthread.h> // For pthread_rwlock_t
+
+/**
+ * @def AVLTREE_USE_PREFIX_CONCURRENT
+ * @brief Defines at compile-time if the functions will use the avltree_conc_* prefix
+ * Same as AVLTREE_USE_PREFIX, but for the concurrent version.
+ * Generates functions with the pattern avltree_conc_##name##_function() instead of conc_##name##_function()
+ *
+ * @warning The @c AVLTREE_FN_CONC macro is for intenal use only, I can't see any usefulness for user code
+ */
+#ifdef AVLTREE_USE_PREFIX_CONCURRENT
+    #define AVLTREE_FN_CONC(name, func) avltree_conc_##name##_##func
+#else
+    #define AVLTREE_FN_CONC(name, func) conc_##name##_##func
+#endif
+
+/**
+ * @def AVLTREE_TYPE_CONCURRENT(T, name)
+ * @brief Defines a thread-safe avltree structure wrapping the avltree_##name of AVLTREE_TYPE(T, name)
+ * @param T The type avltree will hold
+ * @param name The name suffix of an avltree type already defined with AVLTREE_TYPE
+ *
+ * This macro defines a struct named "avltree_conc_##name" with the following fields:
+ * - "lock": Reader-writer lock guarding every access to the tree
+ * - "tree": The avltree itself, only to be touched with the lock held, see read() and write()
+ * @code
+ * AVLTREE_TYPE(int, ints)
+ * AVLTREE_TYPE_CONCURRENT(int, ints)
+ * // Creates a struct named struct avltree_conc_ints
+ * @endcode
+ *
+ * @warning A pthread_rwlock_t can not be copied, the struct must stay where init put it
+ */
+#define AVLTREE_TYPE_CONCURRENT(T, name)                                                                               \
+struct avltree_conc_##name {                                                                                           \
+    pthread_rwlock_t lock;                                                                                             \
+    struct avltree_##name tree;                                                                                        \
+};
+
+/**
+ * @def AVLTREE_DECL_CONCURRENT(T, name)
+ * @brief Declares all functions for a concurrent avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type, AVLTREE_DECL(T, name) must come first
+ *
+ * @details
+ * The following functions are declared:
+ * - init, init_pooled, deinit, read, write
+ * - insert, remove, clear, build_from_sorted (exclusive)
+ * - size, find, contains, lower_bound, upper_bound, floor, ceil, min, max, for_each_range (shared)
+ *
+ * @note Every function but init and deinit is safe to call from any number of threads at once
+ *
+ * @warning With AVLTREE_STATS the readers bump the comparison counter concurrently, that counter is
+ *          then only an estimate
+ */
+#define AVLTREE_DECL_CONCURRENT(T, name)                                                                               \
+/**                                                                                                                    \
+ * @brief init: Initializes a concurrent avltree in place                                                              \
+ * @param self Pointer to the struct to initialize, it must not move afterwards                                        \
+ * @param alloc Custom allocator instance, nodes are only allocated and freed with the write lock held                 \
+ * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
+ *                      Must have the following prototype:                                                             \
+ *                      int (*comparator_fn)(T *a, T *b);                                                              \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self or comparator_fn is null, or AVLTREE_ERR_ALLOC if the                  \
+ *         lock could not be created                                                                                   \
+ *                                                                                                                     \
+ * @warning Not thread-safe, no other thread can use self before init returns                                          \
+ * @warning Call deinit() when done.                                                                                   \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, init)(                                         \
+    struct avltree_conc_##name *self,                                                                                  \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief init_pooled: Initializes a concurrent avltree in place whose nodes come from an owned pool                   \
+ * @param self Pointer to the struct to initialize, it must not move afterwards                                        \
+ * @param backing Allocator used for the pool itself and its chunks                                                    \
+ * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
+ * @param nodes_per_chunk How many nodes each contiguous chunk holds, zero uses POOL_ALLOCATOR_DEFAULT_BLOCKS          \
+ * @return Same as init(), AVLTREE_ERR_ALLOC as well if the pool could not be allocated                                \
+ *                                                                                                                     \
+ * @note The pool is not thread-safe by itself, it does not need to be, only writers touch it                          \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, init_pooled)(                                  \
+    struct avltree_conc_##name *self,                                                                                  \
+    const struct Allocator backing,                                                                                    \
+    int (*comparator_fn)(T *a, T *b),                                                                                  \
+    size_t nodes_per_chunk                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief deinit: Destroys the tree, as the deinit of the avltree, then the lock                                       \
+ * @param self Pointer to the concurrent avltree, null is ignored                                                      \
+ *                                                                                                                     \
+ * @warning Not thread-safe, every other thread must be done with self                                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN_CONC(name, deinit)(struct avltree_conc_##name *self);                   \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief read: Runs fn on the tree with the lock shared, for iterations and compound lookups                          \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param fn Function that may call any const function of the avltree on tree                                          \
+ *           Must have the following prototype:                                                                        \
+ *           void (*fn)(const struct avltree_##name *tree, void *ctx);                                                 \
+ * @param ctx Pointer given back to fn                                                                                 \
+ * @return AVLTREE_OK, or AVLTREE_ERR_NULL if self or fn is null                                                       \
+ *                                                                                                                     \
+ * @warning Pointers into the tree are only valid until fn returns                                                     \
+ * @warning fn must not call other functions of self, the lock is not recursive                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, read)(                                         \
+    struct avltree_conc_##name *self,                                                                                  \
+    void (*fn)(const struct avltree_##name *tree, void *ctx),                                                          \
+    void *ctx                                                                                                          \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief write: Runs fn on the tree with the lock held exclusively, for read-modify-write sequences                   \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param fn Function that may call any function of the avltree on tree                                                \
+ *           Must have the following prototype:                                                                        \
+ *           void (*fn)(struct avltree_##name *tree, void *ctx);                                                       \
+ * @param ctx Pointer given back to fn                                                                                 \
+ * @return AVLTREE_OK, or AVLTREE_ERR_NULL if self or fn is null                                                       \
+ *                                                                                                                     \
+ * @warning fn must not call other functions of self, the lock is not recursive                                        \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, write)(                                        \
+    struct avltree_conc_##name *self,                                                                                  \
+    void (*fn)(struct avltree_##name *tree, void *ctx),                                                                \
+    void *ctx                                                                                                          \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief insert: Inserts a new value with the lock held exclusively                                                   \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to be inserted                                                                                   \
+ * @return Same as the insert of the avltree                                                                           \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, insert)(                                       \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief remove: Removes a value with the lock held exclusively                                                       \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to be removed                                                                                    \
+ * @return Same as the remove of the avltree                                                                           \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, remove)(                                       \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief clear: Clears the tree with the lock held exclusively                                                        \
+ * @param self Pointer to the concurrent avltree, null is ignored                                                      \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN_CONC(name, clear)(struct avltree_conc_##name *self);                    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief build_from_sorted: Replaces the contents with the n values of data, lock held exclusively                    \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param data Values in strictly ascending order by comparator_fn                                                     \
+ * @param n How many values data holds                                                                                 \
+ * @return Same as the build_from_sorted of the avltree                                                                \
+ *                                                                                                                     \
+ * @note The nodes are made and checked inside the lock, readers wait for the whole build                              \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, build_from_sorted)(                            \
+    struct avltree_conc_##name *self,                                                                                  \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief size: Gets the number of elements with the lock shared                                                       \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @return The size, 0 if self is null                                                                                 \
+ *                                                                                                                     \
+ * @note Already stale when it returns if writers are running                                                          \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN_CONC(name, size)(struct avltree_conc_##name *self);                   \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief find: Copies the element that compares equal to value, with the lock shared                                  \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to search for                                                                                    \
+ * @param out Where the element is copied to, may be null to only test for it                                          \
+ * @return True if found, false if not found or self is null                                                           \
+ *                                                                                                                     \
+ * @note A copy and not a pointer, a writer may free the node right after the lock is released                         \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, find)(                                                       \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value,                                                                                                           \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief contains: Checks if there is an element that compares equal to value, with the lock shared                   \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to search for                                                                                    \
+ * @return True if found, false if not found or self is null                                                           \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, contains)(struct avltree_conc_##name *self, T value);        \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief lower_bound: Copies the first element that is not less than value, with the lock shared                      \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to compare against                                                                               \
+ * @param out Where the element is copied to, may be null                                                              \
+ * @return True if there is one, false if every element is less than value or self is null                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, lower_bound)(                                                \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value,                                                                                                           \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief upper_bound: Copies the first element that is greater than value, with the lock shared                       \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to compare against                                                                               \
+ * @param out Where the element is copied to, may be null                                                              \
+ * @return True if there is one, false if no element is greater than value or self is null                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, upper_bound)(                                                \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value,                                                                                                           \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief floor: Copies the greatest element that is less than or equal to value, with the lock shared                 \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to compare against                                                                               \
+ * @param out Where the element is copied to, may be null                                                              \
+ * @return True if there is one, false if every element is greater than value or self is null                          \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, floor)(                                                      \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value,                                                                                                           \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief ceil: Copies the smallest element that is greater than or equal to value, with the lock shared               \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param value Value to compare against                                                                               \
+ * @param out Where the element is copied to, may be null                                                              \
+ * @return True if there is one, false if every element is less than value or self is null                             \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, ceil)(                                                       \
+    struct avltree_conc_##name *self,                                                                                  \
+    T value,                                                                                                           \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief min: Copies the smallest element, with the lock shared                                                       \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param out Where the element is copied to, may be null                                                              \
+ * @return True if there is one, false if the tree is empty or self is null                                            \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, min)(struct avltree_conc_##name *self, T *out);              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief max: Copies the greatest element, with the lock shared                                                       \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param out Where the element is copied to, may be null                                                              \
+ * @return True if there is one, false if the tree is empty or self is null                                            \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, max)(struct avltree_conc_##name *self, T *out);              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief for_each_range: Calls fn on every element in [lo, hi), in order, with the lock shared                        \
+ * @param self Pointer to the concurrent avltree                                                                       \
+ * @param lo First key of the range, included                                                                          \
+ * @param hi Last key of the range, excluded                                                                           \
+ * @param fn Function called on every element, returning false stops the scan                                          \
+ *           Must have the following prototype:                                                                        \
+ *           bool (*fn)(T *elem, void *ctx);                                                                           \
+ * @param ctx Pointer given back to fn                                                                                 \
+ * @return How many elements fn was called on                                                                          \
+ *                                                                                                                     \
+ * @note Writers wait for the whole scan, keep fn short on long ranges                                                 \
+ *                                                                                                                     \
+ * @warning fn runs in every reader thread at once, it must not modify the element                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN_CONC(name, for_each_range)(                                           \
+    struct avltree_conc_##name *self,                                                                                  \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(T *elem, void *ctx),                                                                                    \
+    void *ctx                                                                                                          \
+);
+
+/**
+ * @def AVLTREE_IMPL_CONCURRENT(T, name)
+ * @brief Implements all functions for a concurrent avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type, AVLTREE_IMPL(T, name, deinit_fn) must come first
+ *
+ * @note A pthread_rwlock_t grants the lock to readers while other readers hold it, so under a steady
+ *       stream of readers a writer may wait long on some platforms
+ */
+#define AVLTREE_IMPL_CONCURRENT(T, name)                                                                               \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief copy_out: Copies the element found under the lock to out, when there is one and out is given                 \
+ * @return True if found is not null                                                                                   \
+ */                                                                                                                    \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, copy_out)(const T *found, T *out) {                                         \
+    if (found == NULL) {                                                                                               \
+        return false;                                                                                                  \
+    }                                                                                                                  \
+    if (out != NULL) {                                                                                                 \
+        *out = *found;                                                                                                 \
+    }                                                                                                                  \
+    return true;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, init)(                                                        \
+    struct avltree_conc_##name *self,                                                                                  \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "init(): self is null.");                                           \
+    AVLTREE_ENSURE(comparator_fn != NULL, AVLTREE_ERR_NULL, "init(): comparator_fn is null.");                         \
+    if (pthread_rwlock_init(&self->lock, NULL) != 0) {                                                                 \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    self->tree = AVLTREE_FN(name, init)(alloc, comparator_fn);                                                         \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, init_pooled)(                                                 \
+    struct avltree_conc_##name *self,                                                                                  \
+    const struct Allocator backing,                                                                                    \
+    int (*comparator_fn)(T *a, T *b),                                                                                  \
+    size_t nodes_per_chunk                                                                                             \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "init_pooled(): self is null.");                                    \
+    AVLTREE_ENSURE(comparator_fn != NULL, AVLTREE_ERR_NULL, "init_pooled(): comparator_fn is null.");                  \
+    self->tree = AVLTREE_FN(name, init_pooled)(backing, comparator_fn, nodes_per_chunk);                               \
+    if (self->tree.node_pool == NULL) {                                                                                \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    if (pthread_rwlock_init(&self->lock, NULL) != 0) {                                                                 \
+        AVLTREE_FN(name, deinit)(&self->tree);                                                                         \
+        return AVLTREE_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_CONC(name, deinit)(struct avltree_conc_##name *self) {                                 \
+    if (self == NULL) {                                                                                                \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_FN(name, deinit)(&self->tree);                                                                             \
+    pthread_rwlock_destroy(&self->lock);                                                                               \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, read)(                                                        \
+    struct avltree_conc_##name *self,                                                                                  \
+    void (*fn)(const struct avltree_##name *tree, void *ctx),                                                          \
+    void *ctx                                                                                                          \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "read(): self is null.");                                           \
+    AVLTREE_ENSURE(fn != NULL, AVLTREE_ERR_NULL, "read(): fn is null.");                                               \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    fn(&self->tree, ctx);                                                                                              \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, write)(                                                       \
+    struct avltree_conc_##name *self,                                                                                  \
+    void (*fn)(struct avltree_##name *tree, void *ctx),                                                                \
+    void *ctx                                                                                                          \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "write(): self is null.");                                          \
+    AVLTREE_ENSURE(fn != NULL, AVLTREE_ERR_NULL, "write(): fn is null.");                                              \
+    pthread_rwlock_wrlock(&self->lock);                                                                                \
+    fn(&self->tree, ctx);                                                                                              \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return AVLTREE_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, insert)(struct avltree_conc_##name *self, T value) {          \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "insert(): self is null.");                                         \
+    pthread_rwlock_wrlock(&self->lock);                                                                                \
+    enum avltree_error err = AVLTREE_FN(name, insert)(&self->tree, value);                                             \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return err;                                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, remove)(struct avltree_conc_##name *self, T value) {          \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "remove(): self is null.");                                         \
+    pthread_rwlock_wrlock(&self->lock);                                                                                \
+    enum avltree_error err = AVLTREE_FN(name, remove)(&self->tree, value);                                             \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return err;                                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_CONC(name, clear)(struct avltree_conc_##name *self) {                                  \
+    if (self == NULL) {                                                                                                \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    pthread_rwlock_wrlock(&self->lock);                                                                                \
+    AVLTREE_FN(name, clear)(&self->tree);                                                                              \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_CONC(name, build_from_sorted)(                                           \
+    struct avltree_conc_##name *self,                                                                                  \
+    const T *data,                                                                                                     \
+    size_t n                                                                                                           \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "build_from_sorted(): self is null.");                              \
+    pthread_rwlock_wrlock(&self->lock);                                                                                \
+    enum avltree_error err = AVLTREE_FN(name, build_from_sorted)(&self->tree, data, n);                                \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return err;                                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE size_t AVLTREE_FN_CONC(name, size)(struct avltree_conc_##name *self) {                                 \
+    AVLTREE_ENSURE(self != NULL, 0, "size(): self is null.");                                                          \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    size_t size = self->tree.size;                                                                                     \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return size;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, find)(struct avltree_conc_##name *self, T value, T *out) {                  \
+    AVLTREE_ENSURE(self != NULL, false, "find(): self is null.");                                                      \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, find)(&self->tree, value), out);                     \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, contains)(struct avltree_conc_##name *self, T value) {                      \
+    AVLTREE_ENSURE(self != NULL, false, "contains(): self is null.");                                                  \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN(name, contains)(&self->tree, value);                                                       \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, lower_bound)(struct avltree_conc_##name *self, T value, T *out) {           \
+    AVLTREE_ENSURE(self != NULL, false, "lower_bound(): self is null.");                                               \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, lower_bound)(&self->tree, value), out);              \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, upper_bound)(struct avltree_conc_##name *self, T value, T *out) {           \
+    AVLTREE_ENSURE(self != NULL, false, "upper_bound(): self is null.");                                               \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, upper_bound)(&self->tree, value), out);              \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, floor)(struct avltree_conc_##name *self, T value, T *out) {                 \
+    AVLTREE_ENSURE(self != NULL, false, "floor(): self is null.");                                                     \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, floor)(&self->tree, value), out);                    \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, ceil)(struct avltree_conc_##name *self, T value, T *out) {                  \
+    AVLTREE_ENSURE(self != NULL, false, "ceil(): self is null.");                                                      \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, ceil)(&self->tree, value), out);                     \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, min)(struct avltree_conc_##name *self, T *out) {                            \
+    AVLTREE_ENSURE(self != NULL, false, "min(): self is null.");                                                       \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, min)(&self->tree), out);                             \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_CONC(name, max)(struct avltree_conc_##name *self, T *out) {                            \
+    AVLTREE_ENSURE(self != NULL, false, "max(): self is null.");                                                       \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    bool found = AVLTREE_FN_CONC(name, copy_out)(AVLTREE_FN(name, max)(&self->tree), out);                             \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return found;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE size_t AVLTREE_FN_CONC(name, for_each_range)(                                                          \
+    struct avltree_conc_##name *self,                                                                                  \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(T *elem, void *ctx),                                                                                    \
+    void *ctx                                                                                                          \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, 0, "for_each_range(): self is null.");                                                \
+    pthread_rwlock_rdlock(&self->lock);                                                                                \
+    size_t visited = AVLTREE_FN(name, for_each_range)(&self->tree, lo, hi, fn, ctx);                                   \
+    pthread_rwlock_unlock(&self->lock);                                                                                \
+    return visited;                                                                                                    \
+}
+#endif // AVLTREE_PTHREAD
+
+
+/* ====== AVLTREE_PERSISTENT Path-copying (copy-on-write) version START ====== */
+
+/**
+ * @def AVLTREE_USE_PREFIX_PERSISTENT
+ * @brief Defines at compile-time if the functions will use the avltree_cow_* prefix
+ * Same as AVLTREE_USE_PREFIX, but for the persistent version.
+ * Generates functions with the pattern avltree_cow_##name##_function() instead of cow_##name##_function()
+ *
+ * @warning The @c AVLTREE_FN_COW macro is for intenal use only, I can't see any usefulness for user code
+ */
+#ifdef AVLTREE_USE_PREFIX_PERSISTENT
+    #define AVLTREE_FN_COW(name, func) avltree_cow_##name##_##func
+#else
+    #define AVLTREE_FN_COW(name, func) cow_##name##_##func
+#endif
+
+/**
+ * @def AVLTREE_REFCOUNT
+ * @def AVLTREE_REF_INIT
+ * @def AVLTREE_REF_LOAD
+ * @def AVLTREE_REF_INC
+ * @def AVLTREE_REF_DEC
+ * @brief Reference count of the persistent nodes, atomic so versions can be released from any thread
+ * @details C11 <stdatomic.h> when the compiler has it, otherwise the GCC/Clang __atomic builtins, which
+ * is also the path for C99 and C++ builds. Define AVLTREE_ATOMICS_GNU before including the header to
+ * skip <stdatomic.h> on a C11 compiler. With neither, the count is a plain size_t and every version of
+ * a tree must stay on one thread.
+ * AVLTREE_REF_DEC gives back the count after the decrement, the one that reaches zero frees the node.
+ */
+#if !defined(AVLTREE_ATOMICS_GNU) && !defined(__cplusplus) && defined(__STDC_VERSION__)                                \
+    && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+    #include <stdatomic.h> // For atomic_fetch_add_explicit(), atomic_fetch_sub_explicit()...
+    #define AVLTREE_REFCOUNT _Atomic(size_t)
+    #define AVLTREE_REF_INIT(ptr, value) atomic_init((ptr), (value))
+    #define AVLTREE_REF_LOAD(ptr) atomic_load_explicit((ptr), memory_order_acquire)
+    #define AVLTREE_REF_INC(ptr) ((void)atomic_fetch_add_explicit((ptr), 1, memory_order_relaxed))
+    #define AVLTREE_REF_DEC(ptr) (atomic_fetch_sub_explicit((ptr), 1, memory_order_acq_rel) - 1)
+#elif defined(__GNUC__) || defined(__clang__)
+    #define AVLTREE_REFCOUNT size_t
+    #define AVLTREE_REF_INIT(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELAXED)
+    #define AVLTREE_REF_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define AVLTREE_REF_INC(ptr) ((void)__atomic_add_fetch((ptr), 1, __ATOMIC_RELAXED))
+    #define AVLTREE_REF_DEC(ptr) __atomic_sub_fetch((ptr), 1, __ATOMIC_ACQ_REL)
+#else
+    #define AVLTREE_REFCOUNT size_t
+    #define AVLTREE_REF_INIT(ptr, value) ((void)(*(ptr) = (value)))
+    #define AVLTREE_REF_LOAD(ptr) (*(ptr))
+    #define AVLTREE_REF_INC(ptr) ((void)++*(ptr))
+    #define AVLTREE_REF_DEC(ptr) (--*(ptr))
+#endif // AVLTREE_REFCOUNT
+
+/**
+ * @def AVLTREE_TYPE_PERSISTENT(T, name)
+ * @brief Defines a persistent avltree structure for a specific type T, whose versions share nodes
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ *
+ * @details
+ * Each struct avltree_cow_##name is one version of the tree. snapshot() gives a second version in O(1)
+ * by sharing the root, and insert and remove copy only the nodes on the path they change that some other
+ * version still shares, O(log n) nodes, every other subtree stays shared. Nodes are reference counted and
+ * freed by the release() of the last version holding them. While a version shares nothing, insert and
+ * remove change its nodes in place, as the plain avltree does.
+ *
+ * A version can be read (find, bounds, for_each_range, snapshot) from any number of threads without locks,
+ * only insert, remove and release need the version to themselves. Different versions are independent,
+ * even when they share nodes.
+ *
+ * This macro defines two structures:
+ * - A struct named "avltree_cow_node_##name" with the following fields:
+ * - - "data": Value of type T that each node in the tree holds
+ * - - "left": Pointer to the left node
+ * - - "right": Pointer to the right node
+ * - - "refs": How many versions and parent nodes point to this node, see AVLTREE_REFCOUNT
+ * - - "height": Current height in the tree, of AVLTREE_HEIGHT_TYPE
+ *
+ * - A struct named avltree_cow_##name with the following fields:
+ * - - "alloc": Allocator struct used to allocate nodes, shared by every version
+ * - - "root": Pointer to the root node of this version
+ * - - "comparator_fn": Function pointer that knows how to compare two types T for balancing
+ * - - "size": Size of this version
+ * @code
+ * // Example: Define a persistent avltree for integers
+ * AVLTREE_TYPE_PERSISTENT(int, ints)
+ * // Creates a struct named struct avltree_cow_ints
+ * @endcode
+ *
+ * @note A node copy copies T as is, so the elements are never destroyed by the tree: T should be a value
+ *       type, or a pointer owned somewhere else that outlives every version
+ */
+#define AVLTREE_TYPE_PERSISTENT(T, name)                                                                               \
+struct avltree_cow_node_##name {                                                                                       \
+    T data;                                                                                                            \
+    struct avltree_cow_node_##name *left;                                                                              \
+    struct avltree_cow_node_##name *right;                                                                             \
+    AVLTREE_REFCOUNT refs;                                                                                             \
+    AVLTREE_HEIGHT_TYPE height;                                                                                        \
+};                                                                                                                     \
+                                                                                                                       \
+struct avltree_cow_##name {                                                                                            \
+    struct Allocator alloc;                                                                                            \
+    struct avltree_cow_node_##name *root;                                                                              \
+    int (*comparator_fn)(T *a, T *b);                                                                                  \
+    size_t size;                                                                                                       \
+};
+
+/**
+ * @def AVLTREE_DECL_PERSISTENT(T, name)
+ * @brief Declares all functions for a persistent avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ *
+ * @details
+ * The following functions are declared:
+ * - init, snapshot, release
+ * - insert, remove
+ * - size, find, contains, lower_bound, upper_bound, min, max, for_each_range
+ *
+ * @note All functions declared here operates on the avltree_cow_##name struct
+ */
+#define AVLTREE_DECL_PERSISTENT(T, name)                                                                               \
+/**                                                                                                                    \
+ * @brief init: Creates the empty first version of a persistent avltree                                                \
+ * @param alloc Custom allocator instance, it must be thread-safe if versions are released on other threads            \
+ * @param comparator_fn Custom compare function that knows how to compare two types T                                  \
+ *                      Must have the following prototype:                                                             \
+ *                      int (*comparator_fn)(T *a, T *b);                                                              \
+ * @return An empty version                                                                                            \
+ *                                                                                                                     \
+ * @note It does not allocate                                                                                          \
+ *                                                                                                                     \
+ * @warning The comparator function must not be null, otherwise this data structure will not work.                     \
+ * @warning Call release() on every version when done.                                                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_cow_##name AVLTREE_FN_COW(name, init)(                                   \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief snapshot: Creates a new version with the same elements as self, in O(1)                                      \
+ * @param self Pointer to the version to share                                                                         \
+ * @return A version sharing every node of self, later changes to either one do not show in the other                  \
+ *                                                                                                                     \
+ * @note Safe to call from several threads on the same version, as long as none of them changes it                     \
+ *                                                                                                                     \
+ * @warning If self is NULL then it returns a zero-initialized struct, if asserts are enabled then it crashes          \
+ * @warning The return of this function should not be discarded, the shared nodes would never be freed                 \
+ */                                                                                                                    \
+AVLTREE_NODISCARD AVLTREE_UNUSED AVLTREE_LINKAGE struct avltree_cow_##name AVLTREE_FN_COW(name, snapshot)(             \
+    const struct avltree_cow_##name *self                                                                              \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief release: Drops the version, freeing the nodes no other version shares                                        \
+ * @param self Pointer to the version, null is ignored                                                                 \
+ *                                                                                                                     \
+ * @note self is left as an empty version of the same tree, usable again                                               \
+ * @note Freeing from the root down stops at the first node another version holds, so releasing a                      \
+ *       version that shares most of its nodes is O(nodes it owns alone)                                               \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE void AVLTREE_FN_COW(name, release)(struct avltree_cow_##name *self);                    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief insert: Inserts a new value in this version                                                                  \
+ * @param self Pointer to the version                                                                                  \
+ * @param value Value to be inserted                                                                                   \
+ * @return AVLTREE_OK, AVLTREE_ERR_NULL if self is null, AVLTREE_ERR_DUPLICATE if an equal value is                    \
+ *         already there, or AVLTREE_ERR_ALLOC, in which case the version keeps its elements                           \
+ *                                                                                                                     \
+ * @note Allocates the new node plus a copy of every path node another version shares                                  \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_COW(name, insert)(                                        \
+    struct avltree_cow_##name *self,                                                                                   \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief remove: Removes a value from this version                                                                    \
+ * @param self Pointer to the version                                                                                  \
+ * @param value Value to be removed                                                                                    \
+ * @return AVLTREE_OK, also when there is no such value, AVLTREE_ERR_NULL if self is null, or                          \
+ *         AVLTREE_ERR_ALLOC, in which case the version keeps its elements                                             \
+ *                                                                                                                     \
+ * @note Allocates a copy of every path node another version shares, plus the shared nodes a rotation                  \
+ *       may move, all before the tree changes                                                                         \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_COW(name, remove)(                                        \
+    struct avltree_cow_##name *self,                                                                                   \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief size: Gets the number of elements of this version                                                            \
+ * @param self Pointer to the version                                                                                  \
+ * @return The size, 0 if self is null                                                                                 \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN_COW(name, size)(const struct avltree_cow_##name *self);               \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief find: Finds the element that compares equal to value                                                         \
+ * @param self Pointer to the version                                                                                  \
+ * @param value Value to search for                                                                                    \
+ * @return Pointer to the element, or NULL if not found or self is null                                                \
+ *                                                                                                                     \
+ * @note Valid until the version is changed or released, the node may be shared so it is read-only                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, find)(const struct avltree_cow_##name *self, T value);    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief contains: Checks if there is an element that compares equal to value                                         \
+ * @param self Pointer to the version                                                                                  \
+ * @param value Value to search for                                                                                    \
+ * @return True if found, false if not found or self is null                                                           \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE bool AVLTREE_FN_COW(name, contains)(const struct avltree_cow_##name *self, T value);    \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief lower_bound: Finds the first (smallest) element that is not less than value                                  \
+ * @param self Pointer to the version                                                                                  \
+ * @param value Value to compare against                                                                               \
+ * @return Pointer to the element, or NULL if every element is less than value or self is null                         \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, lower_bound)(                                             \
+    const struct avltree_cow_##name *self,                                                                             \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief upper_bound: Finds the first (smallest) element that is greater than value                                   \
+ * @param self Pointer to the version                                                                                  \
+ * @param value Value to compare against                                                                               \
+ * @return Pointer to the element, or NULL if no element is greater than value or self is null                         \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, upper_bound)(                                             \
+    const struct avltree_cow_##name *self,                                                                             \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief min: Gets the smallest element of this version                                                               \
+ * @param self Pointer to the version                                                                                  \
+ * @return Pointer to the element, or NULL if the version is empty or self is null                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, min)(const struct avltree_cow_##name *self);              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief max: Gets the greatest element of this version                                                               \
+ * @param self Pointer to the version                                                                                  \
+ * @return Pointer to the element, or NULL if the version is empty or self is null                                     \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, max)(const struct avltree_cow_##name *self);              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief for_each_range: Calls fn on every element in [lo, hi), in order                                              \
+ * @param self Pointer to the version                                                                                  \
+ * @param lo First key of the range, included                                                                          \
+ * @param hi Last key of the range, excluded                                                                           \
+ * @param fn Function called on every element, returning false stops the scan                                          \
+ *           Must have the following prototype:                                                                        \
+ *           bool (*fn)(const T *elem, void *ctx);                                                                     \
+ * @param ctx Pointer given back to fn                                                                                 \
+ * @return How many elements fn was called on                                                                          \
+ *                                                                                                                     \
+ * @note O(log n + k) for k elements in range, with a stack of at most the tree height, no recursion                   \
+ */                                                                                                                    \
+AVLTREE_UNUSED AVLTREE_LINKAGE size_t AVLTREE_FN_COW(name, for_each_range)(                                            \
+    const struct avltree_cow_##name *self,                                                                             \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(const T *elem, void *ctx),                                                                              \
+    void *ctx                                                                                                          \
+);
+
+/**
+ * @def AVLTREE_IMPL_PERSISTENT(T, name)
+ * @brief Implements all functions for a persistent avltree type
+ * @param T The type avltree will hold
+ * @param name The name suffix for the avltree type
+ */
+#define AVLTREE_IMPL_PERSISTENT(T, name)                                                                               \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief node_height: Height of a subtree, 0 for NULL                                                                 \
+ */                                                                                                                    \
+AVLTREE_LINKAGE AVLTREE_HEIGHT_TYPE AVLTREE_FN_COW(name, node_height)(const struct avltree_cow_node_##name *node) {    \
+    return node != NULL ? node->height : 0;                                                                            \
 }                                                                                                                      \
                                                                                                                        \
 /**                                                                                                                    \
  * @private                                                                                                            \
- * @brief rebalance: balances a node                                                                                   \
- * @param node Pointer to the node                                                                                     \
- * @return The balanced node, may be different than the original parameter                                             \
+ * @brief update_height: Recomputes the height of node from its children                                               \
  */                                                                                                                    \
-AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, rebalance)(struct avltree_node_##name *node) {            \
-    int balance_factor = AVLTREE_FN(name, node_get_balance_factor)(node);                                              \
-    /* Left Left case */                                                                                               \
-    if (balance_factor > 1 && AVLTREE_FN(name, node_get_balance_factor)(node->left) >= 0) {                            \
-        /* Perform a right rotation on node */                                                                         \
-        return AVLTREE_FN(name, right_rotation)(node);                                                                 \
+AVLTREE_LINKAGE void AVLTREE_FN_COW(name, update_height)(struct avltree_cow_node_##name *node) {                       \
+    AVLTREE_HEIGHT_TYPE left = AVLTREE_FN_COW(name, node_height)(node->left);                                          \
+    AVLTREE_HEIGHT_TYPE right = AVLTREE_FN_COW(name, node_height)(node->right);                                        \
+    node->height = (AVLTREE_HEIGHT_TYPE)((left > right ? left : right) + 1);                                           \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief is_shared: Checks if another version or parent node also points to node                                      \
+ */                                                                                                                    \
+AVLTREE_LINKAGE bool AVLTREE_FN_COW(name, is_shared)(struct avltree_cow_node_##name *node) {                           \
+    return node != NULL && AVLTREE_REF_LOAD(&node->refs) > 1;                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief release_node: Drops one reference to node, freeing it and going on to its children when it                   \
+ *        was the last one                                                                                             \
+ */                                                                                                                    \
+AVLTREE_LINKAGE void AVLTREE_FN_COW(name, release_node)(                                                               \
+    struct avltree_cow_##name *self,                                                                                   \
+    struct avltree_cow_node_##name *node                                                                               \
+) {                                                                                                                    \
+    /* depth first, one pending sibling per level at most */                                                           \
+    struct avltree_cow_node_##name *stack[AVLTREE_MAX_HEIGHT + 1];                                                     \
+    size_t depth = 0;                                                                                                  \
+    if (node != NULL) {                                                                                                \
+        stack[depth++] = node;                                                                                         \
     }                                                                                                                  \
-    /* Right Right case */                                                                                             \
-    if (balance_factor < -1 && AVLTREE_FN(name, node_get_balance_factor)(node->right) <= 0) {                          \
-        /* Perform a left rotation on node */                                                                          \
-        return AVLTREE_FN(name, left_rotation)(node);                                                                  \
+    while (depth > 0) {                                                                                                \
+        struct avltree_cow_node_##name *current = stack[--depth];                                                      \
+        if (AVLTREE_REF_DEC(&current->refs) != 0) {                                                                    \
+            continue;                                                                                                  \
+        }                                                                                                              \
+        if (current->left != NULL) {                                                                                   \
+            stack[depth++] = current->left;                                                                            \
+        }                                                                                                              \
+        if (current->right != NULL) {                                                                                  \
+            stack[depth++] = current->right;                                                                           \
+        }                                                                                                              \
+        self->alloc.free(current, sizeof(*current), self->alloc.ctx);                                                  \
     }                                                                                                                  \
-    /* Left Right case */                                                                                              \
-    if (balance_factor > 1 && AVLTREE_FN(name, node_get_balance_factor)(node->left) < 0) {                             \
-        /* Perform a left rotation on node->left and then right rotation on node */                                    \
-        node->left = AVLTREE_FN(name, left_rotation)(node->left);                                                      \
-        return AVLTREE_FN(name, right_rotation)(node);                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief copy_into: Makes copy a private duplicate of node in this version, dropping the reference                    \
+ *        of this version to node                                                                                      \
+ * @return copy                                                                                                        \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_cow_node_##name *AVLTREE_FN_COW(name, copy_into)(                                       \
+    struct avltree_cow_##name *self,                                                                                   \
+    struct avltree_cow_node_##name *copy,                                                                              \
+    struct avltree_cow_node_##name *node                                                                               \
+) {                                                                                                                    \
+    copy->data = node->data;                                                                                           \
+    copy->left = node->left;                                                                                           \
+    copy->right = node->right;                                                                                         \
+    copy->height = node->height;                                                                                       \
+    AVLTREE_REF_INIT(&copy->refs, 1);                                                                                  \
+    if (copy->left != NULL) {                                                                                          \
+        AVLTREE_REF_INC(&copy->left->refs);                                                                            \
     }                                                                                                                  \
-    /* Right Left case */                                                                                              \
-    if (balance_factor < -1 && AVLTREE_FN(name, node_get_balance_factor)(node->right) > 0) {                           \
-        /* Perform a right rotation on node->right and then left rotation on node */                                   \
-        node->right = AVLTREE_FN(name, right_rotation)(node->right);                                                   \
-        return AVLTREE_FN(name, left_rotation)(node);                                                                  \
+    if (copy->right != NULL) {                                                                                         \
+        AVLTREE_REF_INC(&copy->right->refs);                                                                           \
     }                                                                                                                  \
-    return node;                                                                                                       \
+    AVLTREE_FN_COW(name, release_node)(self, node);                                                                    \
+    return copy;                                                                                                       \
 }                                                                                                                      \
                                                                                                                        \
 /**                                                                                                                    \
  * @private                                                                                                            \
- * @brief minimum: gets the minimum of a subtree from the given node                                                   \
- * @param node Pointer to the node                                                                                     \
- * @return The minimum of the subtree or NULL if node is null                                                          \
+ * @brief own: Gives back node if only this version holds it, otherwise a fresh copy of it                             \
+ * @return The node to change, or NULL if the copy could not be allocated, node then is untouched                      \
  */                                                                                                                    \
-AVLTREE_LINKAGE struct avltree_node_##name *AVLTREE_FN(name, minimum)(struct avltree_node_##name *node) {              \
-    if (node == NULL) {                                                                                                \
+AVLTREE_LINKAGE struct avltree_cow_node_##name *AVLTREE_FN_COW(name, own)(                                             \
+    struct avltree_cow_##name *self,                                                                                   \
+    struct avltree_cow_node_##name *node                                                                               \
+) {                                                                                                                    \
+    if (!AVLTREE_FN_COW(name, is_shared)(node)) {                                                                      \
+        return node;                                                                                                   \
+    }                                                                                                                  \
+    struct avltree_cow_node_##name *copy = AVLTREE_CAST(struct avltree_cow_node_##name)self->alloc.malloc(             \
+        sizeof(*copy), self->alloc.ctx                                                                                 \
+    );                                                                                                                 \
+    if (copy == NULL) {                                                                                                \
         return NULL;                                                                                                   \
     }                                                                                                                  \
-    while (node->left != NULL) {                                                                                       \
-        node = node->left;                                                                                             \
+    return AVLTREE_FN_COW(name, copy_into)(self, copy, node);                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief own_spare: own() taking the copy from spares, which remove() sized beforehand                                \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_cow_node_##name *AVLTREE_FN_COW(name, own_spare)(                                       \
+    struct avltree_cow_##name *self,                                                                                   \
+    struct avltree_cow_node_##name *node,                                                                              \
+    struct avltree_cow_node_##name **spares,                                                                           \
+    size_t *spare_count                                                                                                \
+) {                                                                                                                    \
+    if (!AVLTREE_FN_COW(name, is_shared)(node)) {                                                                      \
+        return node;                                                                                                   \
     }                                                                                                                  \
-    return node;                                                                                                       \
+    return AVLTREE_FN_COW(name, copy_into)(self, spares[--*spare_count], node);                                        \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, init)(                                                          \
-    const struct Allocator alloc,                                                                                      \
-    int (*comparator_fn)(T *a, T *b)                                                                                   \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief rotate_right: Rotates the owned node and its owned left child, returns the new subtree root                  \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_cow_node_##name *AVLTREE_FN_COW(name, rotate_right)(                                    \
+    struct avltree_cow_node_##name *node                                                                               \
 ) {                                                                                                                    \
-    struct avltree_##name avltree = { 0 };                                                                             \
-    avltree.alloc = alloc;                                                                                             \
-    avltree.root = NULL;                                                                                               \
-    avltree.comparator_fn = comparator_fn;                                                                             \
-    return avltree;                                                                                                    \
+    struct avltree_cow_node_##name *left = node->left;                                                                 \
+    node->left = left->right;                                                                                          \
+    left->right = node;                                                                                                \
+    AVLTREE_FN_COW(name, update_height)(node);                                                                         \
+    AVLTREE_FN_COW(name, update_height)(left);                                                                         \
+    return left;                                                                                                       \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE struct avltree_##name AVLTREE_FN(name, deep_clone)(                                                    \
-    const struct avltree_##name *self,                                                                                 \
-    void (*deep_clone_fn)(T *dst, T *src, struct Allocator *alloc)                                                     \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief rotate_left: Rotates the owned node and its owned right child, returns the new subtree root                  \
+ */                                                                                                                    \
+AVLTREE_LINKAGE struct avltree_cow_node_##name *AVLTREE_FN_COW(name, rotate_left)(                                     \
+    struct avltree_cow_node_##name *node                                                                               \
 ) {                                                                                                                    \
-    struct avltree_##name clone = { 0 };                                                                               \
-    AVLTREE_ENSURE(self != NULL, clone, "deep_clone(): avltree is null.");                                             \
-    AVLTREE_ENSURE(deep_clone_fn != NULL, clone, "deep_clone(): deep_clone_fn function is null.");                     \
-    return clone;                                                                                                      \
+    struct avltree_cow_node_##name *right = node->right;                                                               \
+    node->right = right->left;                                                                                         \
+    right->left = node;                                                                                                \
+    AVLTREE_FN_COW(name, update_height)(node);                                                                         \
+    AVLTREE_FN_COW(name, update_height)(right);                                                                        \
+    return right;                                                                                                      \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE void AVLTREE_FN(name, deinit)(struct avltree_##name *self) {                                           \
-    if (!self) {                                                                                                       \
-        return;                                                                                                        \
-    }                                                                                                                  \
-    struct avltree_node_##name *curr = self->root;                                                                     \
-    struct avltree_node_##name *last = NULL;                                                                           \
-    while (curr) {                                                                                                     \
-        if (last == curr->parent) {                                                                                    \
-            /* descending from parent */                                                                               \
-            if (curr->left) {                                                                                          \
-                last = curr;                                                                                           \
-                curr = curr->left;                                                                                     \
-                continue;                                                                                              \
-            }                                                                                                          \
-            if (curr->right) {                                                                                         \
-                last = curr;                                                                                           \
-                curr = curr->right;                                                                                    \
-                continue;                                                                                              \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief rebalance_path: Updates heights and rotates going up through the owned nodes of path,                        \
+ *        copying a shared child before a rotation moves it                                                            \
+ * @param spares Nodes for those copies, never needed after an insert, see spares_needed()                             \
+ */                                                                                                                    \
+AVLTREE_LINKAGE void AVLTREE_FN_COW(name, rebalance_path)(                                                             \
+    struct avltree_cow_##name *self,                                                                                   \
+    struct avltree_cow_node_##name **path[],                                                                           \
+    size_t depth,                                                                                                      \
+    struct avltree_cow_node_##name **spares,                                                                           \
+    size_t *spare_count                                                                                                \
+) {                                                                                                                    \
+    while (depth > 0) {                                                                                                \
+        struct avltree_cow_node_##name **link = path[--depth];                                                         \
+        struct avltree_cow_node_##name *node = *link;                                                                  \
+        AVLTREE_HEIGHT_TYPE left = AVLTREE_FN_COW(name, node_height)(node->left);                                      \
+        AVLTREE_HEIGHT_TYPE right = AVLTREE_FN_COW(name, node_height)(node->right);                                    \
+        if (left > right + 1) {                                                                                        \
+            struct avltree_cow_node_##name *child = AVLTREE_FN_COW(name, own_spare)(                                   \
+                self, node->left, spares, spare_count                                                                  \
+            );                                                                                                         \
+            if (AVLTREE_FN_COW(name, node_height)(child->left) < AVLTREE_FN_COW(name, node_height)(child->right)) {    \
+                child->right = AVLTREE_FN_COW(name, own_spare)(self, child->right, spares, spare_count);               \
+                child = AVLTREE_FN_COW(name, rotate_left)(child);                                                      \
             }                                                                                                          \
-            /* arrived at a leaf, destroy and climb up */                                                              \
-            struct avltree_node_##name *parent = curr->parent;                                                         \
-            deinit_fn(&curr->data, &self->alloc);                                                                      \
-            self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                    \
-            last = curr;                                                                                               \
-            curr = parent;                                                                                             \
-        } else if (last == curr->left) {                                                                               \
-            /* came up from left, go right if exists, else deinitilize */                                              \
-            if (curr->right) {                                                                                         \
-                last = curr;                                                                                           \
-                curr = curr->right;                                                                                    \
-            } else {                                                                                                   \
-                struct avltree_node_##name *parent = curr->parent;                                                     \
-                deinit_fn(&curr->data, &self->alloc);                                                                  \
-                self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                \
-                last = curr;                                                                                           \
-                curr = parent;                                                                                         \
+            node->left = child;                                                                                        \
+            *link = AVLTREE_FN_COW(name, rotate_right)(node);                                                          \
+        } else if (right > left + 1) {                                                                                 \
+            struct avltree_cow_node_##name *child = AVLTREE_FN_COW(name, own_spare)(                                   \
+                self, node->right, spares, spare_count                                                                 \
+            );                                                                                                         \
+            if (AVLTREE_FN_COW(name, node_height)(child->right) < AVLTREE_FN_COW(name, node_height)(child->left)) {    \
+                child->left = AVLTREE_FN_COW(name, own_spare)(self, child->left, spares, spare_count);                 \
+                child = AVLTREE_FN_COW(name, rotate_right)(child);                                                     \
             }                                                                                                          \
+            node->right = child;                                                                                       \
+            *link = AVLTREE_FN_COW(name, rotate_left)(node);                                                           \
         } else {                                                                                                       \
-            /* came up from right (last == curr->right) */                                                             \
-            /* just finished the right subtree, we always handle left before right */                                  \
-            /* coming from right means both children have been processed, just delete it */                            \
-            struct avltree_node_##name *parent = curr->parent;                                                         \
-            deinit_fn(&curr->data, &self->alloc);                                                                      \
-            self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                    \
-            last = curr;                                                                                               \
-            curr = parent;                                                                                             \
+            AVLTREE_FN_COW(name, update_height)(node);                                                                 \
         }                                                                                                              \
     }                                                                                                                  \
-    self->root = NULL;                                                                                                 \
-    self->size = 0;                                                                                                    \
-    self->comparator_fn = NULL;                                                                                        \
-    memset(&self->alloc, 0, sizeof(self->alloc));                                                                      \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE void AVLTREE_FN(name, clear)(struct avltree_##name *self) {                                            \
-    if (!self || self->size == 0) {                                                                                    \
-        return;                                                                                                        \
-    }                                                                                                                  \
-    struct avltree_node_##name *curr = self->root;                                                                     \
-    struct avltree_node_##name *last = NULL;                                                                           \
-    while (curr) {                                                                                                     \
-        if (last == curr->parent) {                                                                                    \
-            /* descending from parent */                                                                               \
-            if (curr->left) {                                                                                          \
-                last = curr;                                                                                           \
-                curr = curr->left;                                                                                     \
-                continue;                                                                                              \
-            }                                                                                                          \
-            if (curr->right) {                                                                                         \
-                last = curr;                                                                                           \
-                curr = curr->right;                                                                                    \
-                continue;                                                                                              \
-            }                                                                                                          \
-            /* arrived at a leaf, destroy and climb up */                                                              \
-            struct avltree_node_##name *parent = curr->parent;                                                         \
-            deinit_fn(&curr->data, &self->alloc);                                                                      \
-            self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                    \
-            last = curr;                                                                                               \
-            curr = parent;                                                                                             \
-        } else if (last == curr->left) {                                                                               \
-            /* came up from left, go right if exists, else deinitilize */                                              \
-            if (curr->right) {                                                                                         \
-                last = curr;                                                                                           \
-                curr = curr->right;                                                                                    \
-            } else {                                                                                                   \
-                struct avltree_node_##name *parent = curr->parent;                                                     \
-                deinit_fn(&curr->data, &self->alloc);                                                                  \
-                self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                \
-                last = curr;                                                                                           \
-                curr = parent;                                                                                         \
-            }                                                                                                          \
-        } else {                                                                                                       \
-            /* came up from right (last == curr->right) */                                                             \
-            /* just finished the right subtree, we always handle left before right */                                  \
-            /* coming from right means both children have been processed, just delete it */                            \
-            struct avltree_node_##name *parent = curr->parent;                                                         \
-            deinit_fn(&curr->data, &self->alloc);                                                                      \
-            self->alloc.free(curr, sizeof(*curr), self->alloc.ctx);                                                    \
-            last = curr;                                                                                               \
-            curr = parent;                                                                                             \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief spares_needed: Counts the shared nodes the rebalance after a remove may have to copy                         \
+ * @param path Owned links from the root down to the parent of the removed node, before the removal                    \
+ * @param last The link of the removed node                                                                            \
+ *                                                                                                                     \
+ * @details                                                                                                            \
+ * The subtree beside the path does not change, and a node can only rotate if that side was already                    \
+ * the taller one, which also tells if the rotation is a double one, so this is an upper bound.                        \
+ */                                                                                                                    \
+AVLTREE_LINKAGE size_t AVLTREE_FN_COW(name, spares_needed)(                                                            \
+    struct avltree_cow_node_##name **path[],                                                                           \
+    size_t depth,                                                                                                      \
+    struct avltree_cow_node_##name **last                                                                              \
+) {                                                                                                                    \
+    size_t needed = 0;                                                                                                 \
+    for (size_t i = 0; i < depth; ++i) {                                                                               \
+        struct avltree_cow_node_##name *node = *path[i];                                                               \
+        struct avltree_cow_node_##name **next = i + 1 < depth ? path[i + 1] : last;                                    \
+        bool went_left = next == &node->left;                                                                          \
+        struct avltree_cow_node_##name *side = went_left ? node->right : node->left;                                   \
+        struct avltree_cow_node_##name *walked = went_left ? node->left : node->right;                                 \
+        if (AVLTREE_FN_COW(name, node_height)(side) <= AVLTREE_FN_COW(name, node_height)(walked)) {                    \
+            continue;                                                                                                  \
+        }                                                                                                              \
+        bool side_shared = AVLTREE_FN_COW(name, is_shared)(side);                                                      \
+        needed += side_shared ? 1 : 0;                                                                                 \
+        struct avltree_cow_node_##name *inner = went_left ? side->left : side->right;                                  \
+        struct avltree_cow_node_##name *outer = went_left ? side->right : side->left;                                  \
+        if (AVLTREE_FN_COW(name, node_height)(inner) > AVLTREE_FN_COW(name, node_height)(outer)) {                     \
+            needed += side_shared || AVLTREE_FN_COW(name, is_shared)(inner) ? 1 : 0;                                   \
         }                                                                                                              \
     }                                                                                                                  \
+    return needed;                                                                                                     \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_cow_##name AVLTREE_FN_COW(name, init)(                                                  \
+    const struct Allocator alloc,                                                                                      \
+    int (*comparator_fn)(T *a, T *b)                                                                                   \
+) {                                                                                                                    \
+    struct avltree_cow_##name self = { 0 };                                                                            \
+    self.alloc = alloc;                                                                                                \
+    self.comparator_fn = comparator_fn;                                                                                \
+    return self;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE struct avltree_cow_##name AVLTREE_FN_COW(name, snapshot)(const struct avltree_cow_##name *self) {      \
+    struct avltree_cow_##name version = { 0 };                                                                         \
+    AVLTREE_ENSURE(self != NULL, version, "snapshot(): self is null.");                                                \
+    version = *self;                                                                                                   \
+    if (version.root != NULL) {                                                                                        \
+        AVLTREE_REF_INC(&version.root->refs);                                                                          \
+    }                                                                                                                  \
+    return version;                                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE void AVLTREE_FN_COW(name, release)(struct avltree_cow_##name *self) {                                  \
+    if (self == NULL) {                                                                                                \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    AVLTREE_FN_COW(name, release_node)(self, self->root);                                                              \
     self->root = NULL;                                                                                                 \
     self->size = 0;                                                                                                    \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, insert)(struct avltree_##name *self, T value) {                    \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_COW(name, insert)(struct avltree_cow_##name *self, T value) {            \
     AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "insert(): self is null.");                                         \
-    /* Search valid position */                                                                                        \
-    struct avltree_node_##name *current = self->root;                                                                  \
-    struct avltree_node_##name *insert_pos = NULL;                                                                     \
-    while (current != NULL) {                                                                                          \
-        int cmp = self->comparator_fn(&value, &current->data);                                                         \
-        insert_pos = current;                                                                                          \
-        if (cmp < 0) {                                                                                                 \
-            current = current->left;                                                                                   \
-        } else if (cmp > 0) {                                                                                          \
-            current = current->right;                                                                                  \
-        } else {                                                                                                       \
-            return AVLTREE_ERR_DUPLICATE;                                                                              \
-        }                                                                                                              \
+    /* Checked first, so a duplicate does not copy the path for nothing */                                             \
+    if (AVLTREE_FN_COW(name, find)(self, value) != NULL) {                                                             \
+        return AVLTREE_ERR_DUPLICATE;                                                                                  \
     }                                                                                                                  \
-    /* Allocate new node */                                                                                            \
-    struct avltree_node_##name *new_node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
+    struct avltree_cow_node_##name *new_node = AVLTREE_CAST(struct avltree_cow_node_##name)self->alloc.malloc(         \
+        sizeof(*new_node), self->alloc.ctx                                                                             \
+    );                                                                                                                 \
     AVLTREE_ENSURE(new_node != NULL, AVLTREE_ERR_ALLOC, "insert(): allocation of new node failed.");                   \
     new_node->data = value;                                                                                            \
-    /* Insert into position */                                                                                         \
-    if (insert_pos == NULL) {                                                                                          \
-        self->root = new_node;                                                                                         \
-    } else {                                                                                                           \
-        if (self->comparator_fn(&value, &insert_pos->data) < 0) {                                                      \
-            insert_pos->left = new_node;                                                                               \
-        } else {                                                                                                       \
-            insert_pos->right = new_node;                                                                              \
-        }                                                                                                              \
-        new_node->parent = insert_pos;                                                                                 \
-    }                                                                                                                  \
-    /* Update height and rebalance, going up through parent pointer */                                                 \
-    struct avltree_node_##name *current_insert_pos = new_node;                                                         \
-    while (current_insert_pos != NULL) {                                                                               \
-        struct avltree_node_##name *old_parent = current_insert_pos->parent;                                           \
-        struct avltree_node_##name *new_subroot = AVLTREE_FN(name, rebalance)(current_insert_pos);                     \
-        /* If subtree root changed, update the parent pointer or the tree root */                                      \
-        if (new_subroot != current_insert_pos) {                                                                       \
-            if (old_parent == NULL) {                                                                                  \
-                /* current_insert_pos was the tree root, new root of the tree is then new_subroot */                   \
-                self->root = new_subroot;                                                                              \
-            } else if (old_parent->left == current_insert_pos) {                                                       \
-                /* the old node was the left child of its parent, set old_parent->left to the new root */              \
-                old_parent->left = new_subroot;                                                                        \
-            } else {                                                                                                   \
-                /* the old node was the right child of its parent, set old_parent->right to the new root */            \
-                old_parent->right = new_subroot;                                                                       \
-            }                                                                                                          \
+    new_node->left = NULL;                                                                                             \
+    new_node->right = NULL;                                                                                            \
+    new_node->height = 1;                                                                                              \
+    AVLTREE_REF_INIT(&new_node->refs, 1);                                                                              \
+    /* Descend making every node of the path private to this version */                                                \
+    struct avltree_cow_node_##name **path[AVLTREE_MAX_HEIGHT];                                                         \
+    size_t depth = 0;                                                                                                  \
+    struct avltree_cow_node_##name **link = &self->root;                                                               \
+    while (*link != NULL) {                                                                                            \
+        struct avltree_cow_node_##name *node = AVLTREE_FN_COW(name, own)(self, *link);                                 \
+        if (node == NULL) {                                                                                            \
+            /* the copies made so far hold the same elements, the version is unchanged */                              \
+            self->alloc.free(new_node, sizeof(*new_node), self->alloc.ctx);                                            \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
         }                                                                                                              \
-        /* move up */                                                                                                  \
-        current_insert_pos = old_parent;                                                                               \
+        *link = node;                                                                                                  \
+        path[depth++] = link;                                                                                          \
+        link = self->comparator_fn(&value, &node->data) < 0 ? &node->left : &node->right;                              \
     }                                                                                                                  \
+    *link = new_node;                                                                                                  \
+    /* An insert only rotates nodes of its own path, which are private already */                                      \
+    AVLTREE_FN_COW(name, rebalance_path)(self, path, depth, NULL, NULL);                                               \
     self->size += 1;                                                                                                   \
     return AVLTREE_OK;                                                                                                 \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE enum avltree_error AVLTREE_FN(name, remove)(struct avltree_##name *self, T value) {                    \
+AVLTREE_LINKAGE enum avltree_error AVLTREE_FN_COW(name, remove)(struct avltree_cow_##name *self, T value) {            \
     AVLTREE_ENSURE(self != NULL, AVLTREE_ERR_NULL, "remove(): self is null.");                                         \
-    /* Search value to remove position */                                                                              \
-    struct avltree_node_##name *del_pos = self->root;                                                                  \
-    while (del_pos != NULL) {                                                                                          \
-        int cmp = self->comparator_fn(&value, &del_pos->data);                                                         \
-        if (cmp < 0) {                                                                                                 \
-            del_pos = del_pos->left;                                                                                   \
-        } else if (cmp > 0) {                                                                                          \
-            del_pos = del_pos->right;                                                                                  \
-        } else {                                                                                                       \
-            break;                                                                                                     \
-        }                                                                                                              \
-    }                                                                                                                  \
-    /* Not found */                                                                                                    \
-    if (del_pos == NULL) {                                                                                             \
+    if (AVLTREE_FN_COW(name, find)(self, value) == NULL) {                                                             \
         return AVLTREE_OK;                                                                                             \
     }                                                                                                                  \
-    struct avltree_node_##name *start = NULL; /* ancestor to begin rebalancing from */                                 \
-    if (del_pos->left == NULL || del_pos->right == NULL) { /* node with only 1 or no child */                          \
-        struct avltree_node_##name *child = (del_pos->left != NULL) ? del_pos->left : del_pos->right;                  \
-        /* relink parent or root to child */                                                                           \
-        if (del_pos->parent == NULL) {                                                                                 \
-            /* deletion position is root */                                                                            \
-            self->root = child;                                                                                        \
-        } else if (del_pos->parent->left == del_pos) {                                                                 \
-            /* if del_pos->parent->left is equal to deletion position, move child to it */                             \
-            del_pos->parent->left = child;                                                                             \
-        } else {                                                                                                       \
-            del_pos->parent->right = child;                                                                            \
+    /* Descend making every node of the path private, down to the node to unlink */                                    \
+    struct avltree_cow_node_##name **path[AVLTREE_MAX_HEIGHT];                                                         \
+    size_t depth = 0;                                                                                                  \
+    struct avltree_cow_node_##name **link = &self->root;                                                               \
+    struct avltree_cow_node_##name *target = NULL;                                                                     \
+    for (;;) {                                                                                                         \
+        struct avltree_cow_node_##name *node = AVLTREE_FN_COW(name, own)(self, *link);                                 \
+        if (node == NULL) {                                                                                            \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
         }                                                                                                              \
-        if (child != NULL) {                                                                                           \
-            child->parent = del_pos->parent;                                                                           \
+        *link = node;                                                                                                  \
+        int cmp = target == NULL ? self->comparator_fn(&value, &node->data) : -1;                                      \
+        if (cmp == 0) {                                                                                                \
+            target = node;                                                                                             \
+            if (node->left == NULL || node->right == NULL) {                                                           \
+                break;                                                                                                 \
+            }                                                                                                          \
+            /* two children, the successor is unlinked instead and its value moves up */                               \
+            path[depth++] = link;                                                                                      \
+            link = &node->right;                                                                                       \
+            continue;                                                                                                  \
         }                                                                                                              \
-        start = del_pos->parent;                                                                                       \
-        deinit_fn(&del_pos->data, &self->alloc);                                                                       \
-        self->alloc.free(del_pos, sizeof(*del_pos), self->alloc.ctx);                                                  \
-    } else { /* two children node, remove successor */                                                                 \
-        struct avltree_node_##name *successor = AVLTREE_FN(name, minimum)(del_pos->right);                             \
-        /* just swap the data, do not need to free the del_pos node itself */                                          \
-        T tmp = del_pos->data;                                                                                         \
-        del_pos->data = successor->data;                                                                               \
-        successor->data = tmp;                                                                                         \
-        /* successor has no left child, but may have a right child */                                                  \
-        struct avltree_node_##name *child = successor->right;                                                          \
-        /* relink successor parents to child */                                                                        \
-        if (successor->parent->left == successor) {                                                                    \
-            successor->parent->left = child;                                                                           \
-        } else {                                                                                                       \
-            successor->parent->right = child;                                                                          \
+        if (target != NULL && node->left == NULL) {                                                                    \
+            break;                                                                                                     \
         }                                                                                                              \
-        start = successor->parent;                                                                                     \
-        deinit_fn(&successor->data, &self->alloc);                                                                     \
-        self->alloc.free(successor, sizeof(*successor), self->alloc.ctx);                                              \
+        path[depth++] = link;                                                                                          \
+        link = cmp < 0 ? &node->left : &node->right;                                                                   \
     }                                                                                                                  \
-    /* rebalance, going up through the first ancestor */                                                               \
-    struct avltree_node_##name *node = start;                                                                          \
-    while (node != NULL) {                                                                                             \
-        struct avltree_node_##name *old_parent = node->parent;                                                         \
-        struct avltree_node_##name *new_subroot = AVLTREE_FN(name, rebalance)(node);                                   \
-        /* If subtree root changed, update the parent pointer or the tree root */                                      \
-        if (new_subroot != node) {                                                                                     \
-            if (old_parent == NULL) {                                                                                  \
-                new_subroot->parent = old_parent; /* ensure parent pointer on the new root */                          \
-                /* node was the tree root, new root of the tree is then new_subroot */                                 \
-                self->root = new_subroot;                                                                              \
-            } else if (old_parent->left == node) {                                                                     \
-                /* the old node was the left child of its parent, set old_parent->left to the new root */              \
-                old_parent->left = new_subroot;                                                                        \
-            } else {                                                                                                   \
-                /* the old node was the right child of its parent, set old_parent->right to the new root */            \
-                old_parent->right = new_subroot;                                                                       \
+    /* Nodes for the rotations, allocated before anything changes */                                                   \
+    struct avltree_cow_node_##name *spares[2 * AVLTREE_MAX_HEIGHT];                                                    \
+    size_t spare_count = AVLTREE_FN_COW(name, spares_needed)(path, depth, link);                                       \
+    for (size_t i = 0; i < spare_count; ++i) {                                                                         \
+        spares[i] = AVLTREE_CAST(struct avltree_cow_node_##name)self->alloc.malloc(                                    \
+            sizeof(*spares[i]), self->alloc.ctx                                                                        \
+        );                                                                                                             \
+        if (spares[i] == NULL) {                                                                                       \
+            while (i > 0) {                                                                                            \
+                --i;                                                                                                   \
+                self->alloc.free(spares[i], sizeof(*spares[i]), self->alloc.ctx);                                      \
             }                                                                                                          \
+            return AVLTREE_ERR_ALLOC;                                                                                  \
         }                                                                                                              \
-        /* move up */                                                                                                  \
-        node = old_parent;                                                                                             \
+    }                                                                                                                  \
+    struct avltree_cow_node_##name *victim = *link;                                                                    \
+    if (victim != target) {                                                                                            \
+        target->data = victim->data;                                                                                   \
+    }                                                                                                                  \
+    /* the child changes parent, the reference victim had becomes the one of the parent */                             \
+    *link = victim->left != NULL ? victim->left : victim->right;                                                       \
+    self->alloc.free(victim, sizeof(*victim), self->alloc.ctx);                                                        \
+    AVLTREE_FN_COW(name, rebalance_path)(self, path, depth, spares, &spare_count);                                     \
+    while (spare_count > 0) {                                                                                          \
+        --spare_count;                                                                                                 \
+        self->alloc.free(spares[spare_count], sizeof(*spares[spare_count]), self->alloc.ctx);                          \
     }                                                                                                                  \
     self->size -= 1;                                                                                                   \
     return AVLTREE_OK;                                                                                                 \
 }                                                                                                                      \
                                                                                                                        \
-AVLTREE_LINKAGE T *AVLTREE_FN(name, emplace)(                                                                          \
-    struct avltree_##name *self,                                                                                       \
-    int (*construct_fn)(T *location, void *args, struct Allocator *alloc),                                             \
-    void *args                                                                                                         \
-) {                                                                                                                    \
-    AVLTREE_ENSURE_PTR(self != NULL, "emplace(): self is null.");                                                      \
-    AVLTREE_ENSURE_PTR(construct_fn != NULL, "emplace(): constructor function is null.");                              \
-    /* Allocate new node */                                                                                            \
-    struct avltree_node_##name *new_node = AVLTREE_FN(name, node_allocate)(&self->alloc);                              \
-    AVLTREE_ENSURE_PTR(new_node != NULL, "emplace(): allocation of new node failed.");                                 \
-    /* Construct new node inplace */                                                                                   \
-    if (construct_fn(&new_node->data, args, &self->alloc) != 0) {                                                      \
+AVLTREE_LINKAGE size_t AVLTREE_FN_COW(name, size)(const struct avltree_cow_##name *self) {                             \
+    AVLTREE_ENSURE(self != NULL, 0, "size(): self is null.");                                                          \
+    return self->size;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, find)(const struct avltree_cow_##name *self, T value) {                  \
+    AVLTREE_ENSURE_PTR(self != NULL, "find(): self is null.");                                                         \
+    struct avltree_cow_node_##name *node = self->root;                                                                 \
+    while (node != NULL) {                                                                                             \
+        int cmp = self->comparator_fn(&value, &node->data);                                                            \
+        if (cmp == 0) {                                                                                                \
+            return &node->data;                                                                                        \
+        }                                                                                                              \
+        node = cmp < 0 ? node->left : node->right;                                                                     \
+    }                                                                                                                  \
+    return NULL;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE bool AVLTREE_FN_COW(name, contains)(const struct avltree_cow_##name *self, T value) {                  \
+    AVLTREE_ENSURE(self != NULL, false, "contains(): self is null.");                                                  \
+    return AVLTREE_FN_COW(name, find)(self, value) != NULL;                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, lower_bound)(const struct avltree_cow_##name *self, T value) {           \
+    AVLTREE_ENSURE_PTR(self != NULL, "lower_bound(): self is null.");                                                  \
+    const T *best = NULL;                                                                                              \
+    struct avltree_cow_node_##name *node = self->root;                                                                 \
+    while (node != NULL) {                                                                                             \
+        if (self->comparator_fn(&node->data, &value) >= 0) {                                                           \
+            best = &node->data;                                                                                        \
+            node = node->left;                                                                                         \
+        } else {                                                                                                       \
+            node = node->right;                                                                                        \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return best;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, upper_bound)(const struct avltree_cow_##name *self, T value) {           \
+    AVLTREE_ENSURE_PTR(self != NULL, "upper_bound(): self is null.");                                                  \
+    const T *best = NULL;                                                                                              \
+    struct avltree_cow_node_##name *node = self->root;                                                                 \
+    while (node != NULL) {                                                                                             \
+        if (self->comparator_fn(&node->data, &value) > 0) {                                                            \
+            best = &node->data;                                                                                        \
+            node = node->left;                                                                                         \
+        } else {                                                                                                       \
+            node = node->right;                                                                                        \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return best;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, min)(const struct avltree_cow_##name *self) {                            \
+    AVLTREE_ENSURE_PTR(self != NULL, "min(): self is null.");                                                          \
+    struct avltree_cow_node_##name *node = self->root;                                                                 \
+    if (node == NULL) {                                                                                                \
         return NULL;                                                                                                   \
     }                                                                                                                  \
-    /* Search valid position using the constructed value */                                                            \
-    struct avltree_node_##name *current = self->root;                                                                  \
-    struct avltree_node_##name *insert_pos = NULL;                                                                     \
+    while (node->left != NULL) {                                                                                       \
+        node = node->left;                                                                                             \
+    }                                                                                                                  \
+    return &node->data;                                                                                                \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE const T *AVLTREE_FN_COW(name, max)(const struct avltree_cow_##name *self) {                            \
+    AVLTREE_ENSURE_PTR(self != NULL, "max(): self is null.");                                                          \
+    struct avltree_cow_node_##name *node = self->root;                                                                 \
+    if (node == NULL) {                                                                                                \
+        return NULL;                                                                                                   \
+    }                                                                                                                  \
+    while (node->right != NULL) {                                                                                      \
+        node = node->right;                                                                                            \
+    }                                                                                                                  \
+    return &node->data;                                                                                                \
+}                                                                                                                      \
+                                                                                                                       \
+AVLTREE_LINKAGE size_t AVLTREE_FN_COW(name, for_each_range)(                                                           \
+    const struct avltree_cow_##name *self,                                                                             \
+    T lo,                                                                                                              \
+    T hi,                                                                                                              \
+    bool (*fn)(const T *elem, void *ctx),                                                                              \
+    void *ctx                                                                                                          \
+) {                                                                                                                    \
+    AVLTREE_ENSURE(self != NULL, 0, "for_each_range(): self is null.");                                                \
+    AVLTREE_ENSURE(fn != NULL, 0, "for_each_range(): fn is null.");                                                    \
+    struct avltree_cow_node_##name *stack[AVLTREE_MAX_HEIGHT];                                                         \
+    size_t depth = 0;                                                                                                  \
+    size_t visited = 0;                                                                                                \
+    struct avltree_cow_node_##name *current = self->root;                                                              \
     while (current != NULL) {                                                                                          \
-        int cmp = self->comparator_fn(&new_node->data, &current->data);                                                \
-        insert_pos = current;                                                                                          \
-        if (cmp < 0) {                                                                                                 \
+        if (self->comparator_fn(&lo, &current->data) <= 0) {                                                           \
+            stack[depth++] = current;                                                                                  \
             current = current->left;                                                                                   \
-        } else if (cmp > 0) {                                                                                          \
-            current = current->right;                                                                                  \
         } else {                                                                                                       \
-            deinit_fn(&new_node->data, &self->alloc);                                                                  \
-            self->alloc.free(new_node, sizeof(*new_node), self->alloc.ctx);                                            \
-            return NULL;                                                                                               \
+            current = current->right;                                                                                  \
         }                                                                                                              \
     }                                                                                                                  \
-    /* Insert node into position */                                                                                    \
-    if (insert_pos == NULL) {                                                                                          \
-        self->root = new_node;                                                                                         \
-    } else {                                                                                                           \
-        if (self->comparator_fn(&new_node->data, &insert_pos->data) < 0) {                                             \
-            insert_pos->left = new_node;                                                                               \
-        } else {                                                                                                       \
-            insert_pos->right = new_node;                                                                              \
-        }                                                                                                              \
-        new_node->parent = insert_pos;                                                                                 \
-    }                                                                                                                  \
-    /* Update height and rebalance, going up through parent pointer */                                                 \
-    struct avltree_node_##name *current_insert_pos = new_node;                                                         \
-    while (current_insert_pos != NULL) {                                                                               \
-        struct avltree_node_##name *old_parent = current_insert_pos->parent;                                           \
-        struct avltree_node_##name *new_subroot = AVLTREE_FN(name, rebalance)(current_insert_pos);                     \
-        /* If subtree root changed, update the parent pointer or the tree root */                                      \
-        if (new_subroot != current_insert_pos) {                                                                       \
-            if (old_parent == NULL) {                                                                                  \
-                /* current_insert_pos was the tree root, new root of the tree is then new_subroot */                   \
-                self->root = new_subroot;                                                                              \
-            } else if (old_parent->left == current_insert_pos) {                                                       \
-                /* the old node was the left child of its parent, set old_parent->left to the new root */              \
-                old_parent->left = new_subroot;                                                                        \
-            } else {                                                                                                   \
-                /* the old node was the right child of its parent, set old_parent->right to the new root */            \
-                old_parent->right = new_subroot;                                                                       \
-            }                                                                                                          \
+    while (depth > 0) {                                                                                                \
+        struct avltree_cow_node_##name *node = stack[--depth];                                                         \
+        if (self->comparator_fn(&node->data, &hi) >= 0) {                                                              \
+            break;                                                                                                     \
+        }                                                                                                              \
+        visited += 1;                                                                                                  \
+        if (!fn(&node->data, ctx)) {                                                                                   \
+            break;                                                                                                     \
+        }                                                                                                              \
+        for (current = node->right; current != NULL; current = current->left) {                                        \
+            stack[depth++] = current;                                                                                  \
         }                                                                                                              \
-        /* move up */                                                                                                  \
-        current_insert_pos = old_parent;                                                                               \
     }                                                                                                                  \
-    self->size += 1;                                                                                                   \
-    return &new_node->data;                                                                                            \
-}                                                                                                                      \
+    return visited;                                                                                                    \
+}
 
 // clang-format on
 
@@ -0,0 +1,622 @@
+/**
+ * @file executor.h
+ * @brief Single-header executor interface to run the parallel algorithms on a custom thread pool
+ *
+ * The containers only see a struct Executor, a submit and a wait function pointer plus a ctx, so
+ * this header has no platform dependencies unless EXECUTOR_PTHREAD is defined before including it,
+ * which adds two small pthread based pools, a FIFO one and a work-stealing one.
+ */
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct Executor
+ * @brief Executor interface for different thread pools
+ *
+ * The parallel functions submit every task of a phase and then call wait() before touching the
+ * results, the tasks of a phase never depend on each other.
+ */
+typedef struct Executor {
+    bool (*submit)(void (*task)(void *arg), void *arg, void *ctx); ///< Queues task(arg), false if it could not
+    void (*wait)(void *ctx); ///< Blocks until every task submitted so far has finished
+    void *ctx;               ///< Context in case it is needed
+} Executor;
+
+/**
+ * @brief Submits task(arg) to the executor, running it on the calling thread if it gets rejected
+ */
+static inline void executor_submit_or_run(struct Executor *executor, void (*task)(void *arg), void *arg) {
+    if (!executor->submit(task, arg, executor->ctx)) {
+        task(arg);
+    }
+}
+
+/**
+ * @brief Serial submit, runs the task right away on the calling thread
+ */
+static inline bool executor_serial_submit(void (*task)(void *arg), void *arg, void *ctx) {
+    (void)ctx;
+    task(arg);
+    return true;
+}
+
+/**
+ * @brief Serial wait, every task already finished inside submit
+ */
+static inline void executor_serial_wait(void *ctx) {
+    (void)ctx;
+}
+
+/**
+ * @brief function that returns the serial executor
+ *
+ * @return An Executor that runs every task inline, the parallel functions then behave like the
+ *         serial ones plus the task bookkeeping
+ */
+static inline struct Executor executor_get_serial(void) {
+    return (struct Executor) {
+        .submit = executor_serial_submit,
+        .wait = executor_serial_wait,
+        .ctx = NULL,
+    };
+}
+
+/* ================================ PTHREAD POOL ================================ */
+
+#ifdef EXECUTOR_PTHREAD
+#include <pthread.h>
+
+/**
+ * @def EXECUTOR_PTHREAD_MAX_THREADS
+ * @brief Maximum number of worker threads of an executor_thread_pool
+ */
+#ifndef EXECUTOR_PTHREAD_MAX_THREADS
+    #define EXECUTOR_PTHREAD_MAX_THREADS 64
+#endif // EXECUTOR_PTHREAD_MAX_THREADS
+
+/**
+ * @def EXECUTOR_PTHREAD_QUEUE_CAP
+ * @brief Capacity of the task queue, submit() rejects tasks once it is full
+ */
+#ifndef EXECUTOR_PTHREAD_QUEUE_CAP
+    #define EXECUTOR_PTHREAD_QUEUE_CAP 256
+#endif // EXECUTOR_PTHREAD_QUEUE_CAP
+
+/**
+ * @struct executor_task
+ * @brief Queued task of the thread pool
+ */
+struct executor_task {
+    void (*fn)(void *arg); ///< Task function
+    void *arg;             ///< Argument given to fn
+};
+
+/**
+ * @struct executor_thread_pool
+ * @brief Fixed size pthread pool with a bounded FIFO queue
+ *
+ * The thread calling wait() also runs queued tasks instead of just sleeping, so a pool with
+ * N workers keeps N + 1 threads busy.
+ *
+ * Usage:
+ * @code
+ * #define EXECUTOR_PTHREAD
+ * #include "executor.h"
+ * struct executor_thread_pool pool;
+ * if (executor_thread_pool_init(&pool, 3) == 0) {
+ *     struct Executor executor = executor_get_thread_pool(&pool);
+ *     // ... use executor, pool must outlive it ...
+ *     executor_thread_pool_deinit(&pool);
+ * }
+ * @endcode
+ *
+ * @warning wait() waits for every task of the pool, sharing a pool between threads works but each
+ *          caller also waits for the tasks of the others. Never call wait() from inside a task.
+ */
+struct executor_thread_pool {
+    pthread_mutex_t lock;                                   ///< Guards every field below
+    pthread_cond_t has_work;                                ///< Signaled on submit and on shutdown
+    pthread_cond_t done;                                    ///< Signaled when pending drops to zero
+    pthread_t threads[EXECUTOR_PTHREAD_MAX_THREADS];        ///< Worker threads
+    size_t nthreads;                                        ///< How many workers were started
+    struct executor_task queue[EXECUTOR_PTHREAD_QUEUE_CAP]; ///< Ring buffer of queued tasks
+    size_t head;                                            ///< Index of the oldest queued task
+    size_t count;                                           ///< Queued tasks
+    size_t pending;                                         ///< Queued plus running tasks
+    bool stop;                                              ///< Set by deinit, workers exit
+};
+
+/**
+ * @private
+ * @brief Pops the oldest task, the lock must be held and count must be non zero
+ */
+static inline struct executor_task executor_thread_pool_pop(struct executor_thread_pool *pool) {
+    struct executor_task task = pool->queue[pool->head];
+    pool->head = (pool->head + 1) % EXECUTOR_PTHREAD_QUEUE_CAP;
+    pool->count--;
+    return task;
+}
+
+/**
+ * @private
+ * @brief Runs a popped task without the lock and marks it as finished, the lock must be held
+ */
+static inline void executor_thread_pool_run(struct executor_thread_pool *pool, struct executor_task task) {
+    pthread_mutex_unlock(&pool->lock);
+    task.fn(task.arg);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+        pthread_cond_broadcast(&pool->done);
+    }
+}
+
+/**
+ * @private
+ * @brief Worker loop, runs tasks until deinit sets stop and the queue is empty
+ */
+static inline void *executor_thread_pool_worker(void *arg) {
+    struct executor_thread_pool *pool = (struct executor_thread_pool *)arg;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->count == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        }
+        if (pool->count == 0) {
+            break;
+        }
+        executor_thread_pool_run(pool, executor_thread_pool_pop(pool));
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * @brief Thread pool submit, queues the task unless the queue is full
+ */
+static inline bool executor_thread_pool_submit(void (*task)(void *arg), void *arg, void *ctx) {
+    struct executor_thread_pool *pool = (struct executor_thread_pool *)ctx;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == EXECUTOR_PTHREAD_QUEUE_CAP || pool->stop) {
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    pool->queue[(pool->head + pool->count) % EXECUTOR_PTHREAD_QUEUE_CAP] = (struct executor_task) { task, arg };
+    pool->count++;
+    pool->pending++;
+    pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+/**
+ * @brief Thread pool wait, helps with the queued tasks and then sleeps until the running ones finish
+ */
+static inline void executor_thread_pool_wait(void *ctx) {
+    struct executor_thread_pool *pool = (struct executor_thread_pool *)ctx;
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        if (pool->count > 0) {
+            executor_thread_pool_run(pool, executor_thread_pool_pop(pool));
+        } else {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Starts a pool with nthreads workers (clamped to EXECUTOR_PTHREAD_MAX_THREADS)
+ *
+ * @return 0 on success, -1 if the synchronization primitives or the first thread could not be
+ *         created, the pool is then unusable and must not be deinitialized
+ *
+ * @note Zero workers is valid, every task then runs on the thread that calls wait()
+ */
+static inline int executor_thread_pool_init(struct executor_thread_pool *pool, size_t nthreads) {
+    if (nthreads > EXECUTOR_PTHREAD_MAX_THREADS) {
+        nthreads = EXECUTOR_PTHREAD_MAX_THREADS;
+    }
+    pool->nthreads = 0;
+    pool->head = 0;
+    pool->count = 0;
+    pool->pending = 0;
+    pool->stop = false;
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&pool->has_work, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    if (pthread_cond_init(&pool->done, NULL) != 0) {
+        pthread_cond_destroy(&pool->has_work);
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    // A pool with fewer workers than asked still works, only failing to start any is an error
+    while (pool->nthreads < nthreads) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL, executor_thread_pool_worker, pool) != 0) {
+            break;
+        }
+        pool->nthreads++;
+    }
+    if (nthreads > 0 && pool->nthreads == 0) {
+        pthread_cond_destroy(&pool->done);
+        pthread_cond_destroy(&pool->has_work);
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the tasks still queued, joins every worker and destroys the pool
+ */
+static inline void executor_thread_pool_deinit(struct executor_thread_pool *pool) {
+    executor_thread_pool_wait(pool);
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->nthreads; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_mutex_destroy(&pool->lock);
+    pool->nthreads = 0;
+}
+
+/**
+ * @brief function that returns an executor backed by the given pool
+ *
+ * @return An Executor whose ctx is pool, it must outlive the executor
+ */
+static inline struct Executor executor_get_thread_pool(struct executor_thread_pool *pool) {
+    return (struct Executor) {
+        .submit = executor_thread_pool_submit,
+        .wait = executor_thread_pool_wait,
+        .ctx = pool,
+    };
+}
+
+/* ============================== WORK-STEALING POOL ============================== */
+
+/**
+ * @def EXECUTOR_STEAL_DEQUE_CAP
+ * @brief Capacity of the deque of each worker of an executor_steal_pool, submit() tries the other
+ *        deques when one is full and rejects the task once all of them are
+ */
+#ifndef EXECUTOR_STEAL_DEQUE_CAP
+    #define EXECUTOR_STEAL_DEQUE_CAP 64
+#endif // EXECUTOR_STEAL_DEQUE_CAP
+
+struct executor_steal_pool;
+
+/**
+ * @struct executor_steal_deque
+ * @brief Task deque of one worker of an executor_steal_pool
+ *
+ * The owner pushes and pops at the bottom, newest first while its data is still in cache, the other
+ * threads steal at the top, oldest first.
+ */
+struct executor_steal_deque {
+    pthread_mutex_t lock;                                 ///< Guards tasks, top and count
+    struct executor_task tasks[EXECUTOR_STEAL_DEQUE_CAP]; ///< Ring buffer of tasks
+    size_t top;                                           ///< Index of the oldest task
+    size_t count;                                         ///< Tasks in the deque
+    struct executor_steal_pool *pool;                     ///< Pool the deque belongs to
+    size_t index;                                         ///< Index of the deque in the pool
+};
+
+/**
+ * @struct executor_steal_pool
+ * @brief Fixed size pthread pool with one task deque per worker and work stealing
+ *
+ * A task submitted from a worker goes to the bottom of that worker's deque, one submitted from
+ * another thread goes round robin to the deques. An idle worker pops its own deque first and then
+ * steals from the top of the others, so tasks that spawn tasks stay local and uneven chunks even
+ * out. Each deque has its own lock, the pool lock only guards the counters and the sleeping.
+ *
+ * Usage is the same as executor_thread_pool:
+ * @code
+ * #define EXECUTOR_PTHREAD
+ * #include "executor.h"
+ * struct executor_steal_pool pool;
+ * if (executor_steal_pool_init(&pool, 3) == 0) {
+ *     struct Executor executor = executor_get_steal_pool(&pool);
+ *     // ... use executor, pool must outlive it ...
+ *     executor_steal_pool_deinit(&pool);
+ * }
+ * @endcode
+ *
+ * @warning Same as executor_thread_pool, wait() waits for every task of the pool and must not be
+ *          called from inside a task, submitting from inside a task is fine
+ */
+struct executor_steal_pool {
+    pthread_mutex_t lock;                                             ///< Guards the counters and stop
+    pthread_cond_t has_work;                                          ///< Signaled on submit and on shutdown
+    pthread_cond_t done;                                              ///< Signaled when pending drops to zero
+    pthread_key_t self_key;                                           ///< Deque of the calling worker or NULL
+    pthread_t threads[EXECUTOR_PTHREAD_MAX_THREADS];                  ///< Worker threads
+    struct executor_steal_deque deques[EXECUTOR_PTHREAD_MAX_THREADS]; ///< One deque per asked worker
+    size_t nthreads;                                                  ///< How many workers were started
+    size_t ndeques;                                                   ///< Deques in use, at least one
+    size_t queued;                                                    ///< Tasks in the deques
+    size_t pending;                                                   ///< Queued plus running tasks
+    size_t next;                                                      ///< Round robin deque for outside submits
+    bool stop;                                                        ///< Set by deinit, workers exit
+};
+
+/**
+ * @private
+ * @brief Pushes a task at the bottom of a deque, false if it is full
+ */
+static inline bool executor_steal_deque_push(struct executor_steal_deque *deque, struct executor_task task) {
+    pthread_mutex_lock(&deque->lock);
+    bool pushed = deque->count < EXECUTOR_STEAL_DEQUE_CAP;
+    if (pushed) {
+        deque->tasks[(deque->top + deque->count) % EXECUTOR_STEAL_DEQUE_CAP] = task;
+        deque->count++;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return pushed;
+}
+
+/**
+ * @private
+ * @brief Takes a task from the bottom (the owner) or from the top (a thief) of a deque, false if empty
+ */
+static inline bool executor_steal_deque_take(
+    struct executor_steal_deque *deque,
+    bool bottom,
+    struct executor_task *task
+) {
+    pthread_mutex_lock(&deque->lock);
+    bool taken = deque->count > 0;
+    if (taken) {
+        if (bottom) {
+            *task = deque->tasks[(deque->top + deque->count - 1) % EXECUTOR_STEAL_DEQUE_CAP];
+        } else {
+            *task = deque->tasks[deque->top];
+            deque->top = (deque->top + 1) % EXECUTOR_STEAL_DEQUE_CAP;
+        }
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+/**
+ * @private
+ * @brief Finds a task, from the bottom of own if given, then from the top of the other deques
+ */
+static inline bool executor_steal_pool_find(
+    struct executor_steal_pool *pool,
+    struct executor_steal_deque *own,
+    struct executor_task *task
+) {
+    size_t start = 0;
+    if (own != NULL) {
+        if (executor_steal_deque_take(own, true, task)) {
+            return true;
+        }
+        start = own->index + 1;
+    }
+    for (size_t k = 0; k < pool->ndeques; ++k) {
+        struct executor_steal_deque *victim = &pool->deques[(start + k) % pool->ndeques];
+        if (victim != own && executor_steal_deque_take(victim, false, task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @private
+ * @brief Takes one task and runs it without the lock, the pool lock must be held and is held again
+ *        on return
+ */
+static inline void executor_steal_pool_help(struct executor_steal_pool *pool, struct executor_steal_deque *own) {
+    struct executor_task task;
+    pthread_mutex_unlock(&pool->lock);
+    bool found = executor_steal_pool_find(pool, own, &task);
+    pthread_mutex_lock(&pool->lock);
+    // Not found means a submit counted its task and has not pushed it yet, the caller retries
+    if (!found) {
+        return;
+    }
+    pool->queued--;
+    pthread_mutex_unlock(&pool->lock);
+    task.fn(task.arg);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+        pthread_cond_broadcast(&pool->done);
+    }
+}
+
+/**
+ * @private
+ * @brief Worker loop, runs tasks until deinit sets stop and the deques are empty
+ */
+static inline void *executor_steal_pool_worker(void *arg) {
+    struct executor_steal_deque *own = (struct executor_steal_deque *)arg;
+    struct executor_steal_pool *pool = own->pool;
+    pthread_setspecific(pool->self_key, own);
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->queued == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        }
+        if (pool->queued == 0) {
+            break;
+        }
+        executor_steal_pool_help(pool, own);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * @brief Work-stealing pool submit, queues the task on the deque of the calling worker, or round robin
+ *        from other threads, unless every deque is full
+ */
+static inline bool executor_steal_pool_submit(void (*task)(void *arg), void *arg, void *ctx) {
+    struct executor_steal_pool *pool = (struct executor_steal_pool *)ctx;
+    struct executor_steal_deque *own = (struct executor_steal_deque *)pthread_getspecific(pool->self_key);
+    pthread_mutex_lock(&pool->lock);
+    if (pool->stop) {
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    size_t first = own != NULL ? own->index : pool->next++ % pool->ndeques;
+    // Counted before the push, a worker taking it right away must not see the counters at zero
+    pool->queued++;
+    pool->pending++;
+    pthread_mutex_unlock(&pool->lock);
+
+    bool pushed = false;
+    for (size_t k = 0; k < pool->ndeques && !pushed; ++k) {
+        struct executor_steal_deque *deque = &pool->deques[(first + k) % pool->ndeques];
+        pushed = executor_steal_deque_push(deque, (struct executor_task) { task, arg });
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pushed) {
+        pthread_cond_signal(&pool->has_work);
+    } else {
+        pool->queued--;
+        if (--pool->pending == 0) {
+            pthread_cond_broadcast(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return pushed;
+}
+
+/**
+ * @brief Work-stealing pool wait, steals queued tasks and then sleeps until the running ones finish
+ */
+static inline void executor_steal_pool_wait(void *ctx) {
+    struct executor_steal_pool *pool = (struct executor_steal_pool *)ctx;
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        if (pool->queued > 0) {
+            executor_steal_pool_help(pool, NULL);
+        } else {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @private
+ * @brief Destroys the synchronization primitives of the pool and of its first ndeques deques
+ */
+static inline void executor_steal_pool_destroy(struct executor_steal_pool *pool, size_t ndeques) {
+    for (size_t i = 0; i < ndeques; ++i) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_key_delete(pool->self_key);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/**
+ * @brief Starts a work-stealing pool with nthreads workers (clamped to EXECUTOR_PTHREAD_MAX_THREADS)
+ *
+ * @return 0 on success, -1 if the synchronization primitives or the first thread could not be
+ *         created, the pool is then unusable and must not be deinitialized
+ *
+ * @note Zero workers is valid, every task then runs on the thread that calls wait()
+ */
+static inline int executor_steal_pool_init(struct executor_steal_pool *pool, size_t nthreads) {
+    if (nthreads > EXECUTOR_PTHREAD_MAX_THREADS) {
+        nthreads = EXECUTOR_PTHREAD_MAX_THREADS;
+    }
+    pool->nthreads = 0;
+    pool->ndeques = nthreads > 0 ? nthreads : 1;
+    pool->queued = 0;
+    pool->pending = 0;
+    pool->next = 0;
+    pool->stop = false;
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&pool->has_work, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    if (pthread_cond_init(&pool->done, NULL) != 0) {
+        pthread_cond_destroy(&pool->has_work);
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    if (pthread_key_create(&pool->self_key, NULL) != 0) {
+        pthread_cond_destroy(&pool->done);
+        pthread_cond_destroy(&pool->has_work);
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    for (size_t i = 0; i < pool->ndeques; ++i) {
+        struct executor_steal_deque *deque = &pool->deques[i];
+        if (pthread_mutex_init(&deque->lock, NULL) != 0) {
+            executor_steal_pool_destroy(pool, i);
+            return -1;
+        }
+        deque->top = 0;
+        deque->count = 0;
+        deque->pool = pool;
+        deque->index = i;
+    }
+    // The deques of workers that failed to start are still drained by stealing
+    while (pool->nthreads < nthreads) {
+        struct executor_steal_deque *own = &pool->deques[pool->nthreads];
+        if (pthread_create(&pool->threads[pool->nthreads], NULL, executor_steal_pool_worker, own) != 0) {
+            break;
+        }
+        pool->nthreads++;
+    }
+    if (nthreads > 0 && pool->nthreads == 0) {
+        executor_steal_pool_destroy(pool, pool->ndeques);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs the tasks still queued, joins every worker and destroys the pool
+ */
+static inline void executor_steal_pool_deinit(struct executor_steal_pool *pool) {
+    executor_steal_pool_wait(pool);
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->nthreads; ++i) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    executor_steal_pool_destroy(pool, pool->ndeques);
+    pool->nthreads = 0;
+}
+
+/**
+ * @brief function that returns an executor backed by the given work-stealing pool
+ *
+ * @return An Executor whose ctx is pool, it must outlive the executor
+ */
+static inline struct Executor executor_get_steal_pool(struct executor_steal_pool *pool) {
+    return (struct Executor) {
+        .submit = executor_steal_pool_submit,
+        .wait = executor_steal_pool_wait,
+        .ctx = pool,
+    };
+}
+#endif // EXECUTOR_PTHREAD
+
+#endif // EXECUTOR_H
@@ -0,0 +1,1180 @@
+/**
+ * @file hashmap.h
+ * @author Jean Rehr <jeanrehr@gmail.com>
+ * @brief Generic and typesafe open addressing hash map using macros
+ *
+ * This header provides an unordered key to value map, in the same TYPE/DECL/IMPL macro style as
+ * arraylist.h and avltree.h. Exact key lookups cost one hash and, most of the time, one key
+ * comparison, instead of the O(log n) comparator calls and pointer hops of the avltree.
+ *
+ * @details
+ * The table is a SwissTable: the entries live in one flat array next to an array of control bytes,
+ * one per slot. A control byte says if its slot is empty, deleted, or full, and for a full slot it
+ * also holds 7 bits of the hash of the key (h2). A lookup reads a whole group of control bytes at
+ * once (16 with SSE2, 8 with NEON or the portable 64-bit version), compares h2 against all of them
+ * in a few instructions and only calls eq_fn on the slots that match. Groups are probed in
+ * triangular steps until one of them has an empty slot.
+ *
+ * Entries are stored as struct pair_##name from pair.h, "first" is the key and "second" the value.
+ *
+ * Growth is incremental: once the table is 7/8 full a table of twice the size is allocated, but the
+ * entries are not moved all at once. Every following insert, emplace or remove moves at most
+ * HASHMAP_MIGRATE_STEP slots of the old table to the new one, and lookups search both tables until
+ * the old one is empty and freed. No single call pays for rehashing the whole map, reserve() is the
+ * only function that moves everything at once, as it is called up front on purpose.
+ *
+ * Regarding memory management:
+ * - The map owns its entries, insert and emplace take the ownership of the key and of the value, a key
+ *   equal to one already in the map is never taken, it stays with the caller
+ * - Entries removed, replaced or still in the map at clear() and deinit() go through dtor_k and dtor_v
+ * - Every table is a single allocation from the struct Allocator, entries first and then the control bytes
+ * - Pointers to entries are invalidated by any insert, emplace or remove, as those may move entries
+ *
+ * Usage example:
+ * @code
+ * HASHMAP(int, double, prices, hashmap_hash_scalar, hashmap_eq_scalar, hashmap_noop_deinit, hashmap_noop_deinit)
+ * struct hashmap_prices map = prices_init(allocator_get_default());
+ * prices_insert(&map, 42, 9.99);   // insert, or replace the value of an existing key
+ * prices_try_insert(&map, 42, 1.0); // HASHMAP_ERR_DUPLICATE, the map is left unchanged
+ * double *price = prices_get(&map, 42);
+ * struct pair_prices *entry;
+ * for (size_t it = 0; (entry = prices_next(&map, &it)) != NULL;) {
+ *     printf("%d %f\n", entry->first, entry->second);
+ * }
+ * prices_deinit(&map);
+ * @endcode
+ *
+ * Regarding the hash and equality functions:
+ * Both are given at compile-time to HASHMAP_IMPL, like the destructors, and may be macros:
+ * - uint64_t hash_fn(K *key);
+ * - bool eq_fn(K *a, K *b);
+ * Keys that are equal must have the same hash. The map mixes the hash again, so a plain cast of an
+ * integer key works, but hashmap_hash_u64(), hashmap_hash_bytes() and hashmap_hash_string() are
+ * provided for keys that need a real hash.
+ *
+ * Thread safety:
+ * - Maps are not thread-safe, concurrent access to the same map requires external synchronization
+ * - Concurrent lookups alone are fine, they never write to the map
+ *
+ * Error handling:
+ * When HASHMAP_USE_ASSERT=1 (default 0):
+ * - Invalid operations trigger assert() and abort
+ * When HASHMAP_USE_ASSERT=0:
+ * - Functions return error codes or NULL
+ * A duplicate key on try_insert() or emplace(), a failing construct_fn or a missing key on remove() is not
+ * an invalid operation, HASHMAP_ERR_DUPLICATE, HASHMAP_ERR_CONSTRUCT and HASHMAP_ERR_NOT_FOUND are always
+ * returned.
+ *
+ * @warning Always call deinit() when done with the map
+ * @warning HASHMAP_TYPE defines struct pair_##name, do not define a PAIR with the same name
+ */
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdbool.h> // For bool, true, false
+#include <stddef.h>  // For size_t
+#include <stdint.h>  // For SIZE_MAX, uint8_t, uint64_t
+#include <string.h>  // For memset(), memcpy(), strlen()
+
+#include "allocator.h" // For a custom Allocator interface
+#include "pair.h"      // For PAIR_TYPE, the entries are pairs
+
+/**
+ * @def HASHMAP_SIMD_SSE2
+ * @def HASHMAP_SIMD_NEON
+ * @brief Instruction set used to match a group of control bytes, at most one of them gets defined
+ *
+ * Detected from the compiler flags, SSE2 is always there on x86-64. Without any of them a portable
+ * version works on 8 control bytes at a time inside a uint64_t. Define HASHMAP_NO_SIMD before
+ * including the header to force the portable version.
+ */
+#if !defined(HASHMAP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #include <emmintrin.h> // For the SSE2 intrinsics of the group match
+    #define HASHMAP_SIMD_SSE2
+#elif !defined(HASHMAP_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h> // For the NEON intrinsics of the group match
+    #define HASHMAP_SIMD_NEON
+#endif // SIMD detection
+
+#ifdef __cplusplus
+extern "C" {
+#endif // extern "C"
+
+/**
+ * @def __has_c_attribute
+ * @brief Fallback macros for C compilers that do not support the testing for features
+ */
+#ifndef __has_c_attribute
+    #define __has_c_attribute(x) 0
+#endif // __has_c_attribute
+
+/**
+ * @def __has_cpp_attribute
+ * @brief Fallback macros for C++ compilers that do not support the testing for features
+ */
+#ifndef __has_cpp_attribute
+    #define __has_cpp_attribute(x) 0
+#endif // __has_cpp_attribute
+
+/**
+ * @def HASHMAP_USE_BRACKET_ATTR
+ * @brief This checks for the Standard [[]] support (C23+ or C++11+)
+ * @details Mainly used because, if compiling with pedantic or Wall, then warnings will be issued if syntax [[]]
+ *          attribute is supported on pre C23 but still used, [[]] will be considered compiler extension and
+ *          not Standard C compliant.
+ */
+#if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 202311L) || (defined(__cplusplus) && __cplusplus >= 201103L)
+    #define HASHMAP_USE_BRACKET_ATTR 1
+#else
+    #define HASHMAP_USE_BRACKET_ATTR 0
+#endif // HASHMAP_USE_BRACKET_ATTR
+
+/**
+ * @def hashmap_noop_deinit
+ * @brief Defines a no-op destructor macro for usage in scalar types or types
+ *        that does not need a destructor
+ */
+#ifndef hashmap_noop_deinit
+    #define hashmap_noop_deinit(ptr, alloc) ((void)0)
+#endif // hashmap_noop_deinit
+
+/**
+ * @def HASHMAP_LINKAGE
+ * @brief Defines a macro to switch between static inline or another type of linkage before
+ *        including the header, works the same way as ARRAYLIST_LINKAGE
+ */
+#ifndef HASHMAP_LINKAGE
+    #define HASHMAP_LINKAGE static inline
+#endif // HASHMAP_LINKAGE
+
+/**
+ * @def HASHMAP_UNUSED
+ * @brief Defines a macro to supress the warning for unused function because of static inline
+ */
+#if HASHMAP_USE_BRACKET_ATTR && (__has_c_attribute(maybe_unused) || __has_cpp_attribute(maybe_unused))
+    // C23+ or C++17+
+    #define HASHMAP_UNUSED [[maybe_unused]]
+#elif defined(__GNUC__) || defined(__clang__)
+    // Legacy GCC or Clang compilers
+    #define HASHMAP_UNUSED __attribute__((unused))
+#else
+    #define HASHMAP_UNUSED
+#endif // HASHMAP_UNUSED definition
+
+/**
+ * @def HASHMAP_HINT_UNLIKELY
+ * @def HASHMAP_NOT_EXPECT
+ * @brief Branch prediction hint, used in the HASHMAP_ENSURE macro, as it usually
+ *        just always passes
+ */
+#if HASHMAP_USE_BRACKET_ATTR && (__has_c_attribute(unlikely) || __has_cpp_attribute(unlikely))
+    // C23+ or C++17+
+    #define HASHMAP_HINT_UNLIKELY [[unlikely]]
+    #define HASHMAP_NOT_EXPECT(x) (x)
+#elif defined(__GNUC__) || defined(__clang__)
+    // Legacy GCC or Clang compilers
+    #define HASHMAP_HINT_UNLIKELY
+    #define HASHMAP_NOT_EXPECT(x) __builtin_expect(!!(x), 0)
+#else
+    #define HASHMAP_HINT_UNLIKELY
+    #define HASHMAP_NOT_EXPECT(x) (x)
+#endif // HASHMAP_NOT_EXPECT definition
+
+/**
+ * @def HASHMAP_USE_ASSERT
+ * @brief Defines if the hash map will use asserts or return error codes
+ * @details If HASHMAP_USE_ASSERT is 1, then the lib will assert and fail early, otherwise,
+ *          defensive programming and returning error codes will be used
+ */
+#ifndef HASHMAP_USE_ASSERT
+    #define HASHMAP_USE_ASSERT 0
+#endif // HASHMAP_USE_ASSERT
+
+#if HASHMAP_USE_ASSERT
+    #include <assert.h> // For assert()
+    #include <stdlib.h> // For abort()
+    #define HASHMAP_ENSURE(cond, ret, msg)                                                                             \
+        do {                                                                                                           \
+            if (HASHMAP_NOT_EXPECT(!(cond))) HASHMAP_HINT_UNLIKELY {                                                   \
+                assert(0 && (msg));                                                                                    \
+                abort();                                                                                               \
+            }                                                                                                          \
+        } while (0)
+#else
+    #define HASHMAP_ENSURE(cond, ret, msg)                                                                             \
+        do {                                                                                                           \
+            if (HASHMAP_NOT_EXPECT(!(cond))) HASHMAP_HINT_UNLIKELY {                                                   \
+                return (ret);                                                                                          \
+            }                                                                                                          \
+        } while (0)
+#endif // HASHMAP_USE_ASSERT if directive
+
+/**
+ * @def HASHMAP_CAST
+ * @brief Defines a macro that either casts type T to T* or does nothing
+ * @details
+ * If __cplusplus is defined (compiled with a c++ compiler) then it will cast the results of malloc,
+ * if compiled with a C compiler, then it does nothing
+ */
+#ifdef __cplusplus
+    #define HASHMAP_CAST(T) (T *)
+#else
+    #define HASHMAP_CAST(T)
+#endif // HASHMAP_CAST(T)
+
+/**
+ * @def HASHMAP_MIGRATE_STEP
+ * @brief How many slots of the old table each insert, emplace or remove moves while the map grows
+ * @details Must be at least 4, so the old table is always empty before the new one fills up. Bigger
+ *          steps finish the growth sooner, smaller ones keep the worst case of a single call lower.
+ */
+#ifndef HASHMAP_MIGRATE_STEP
+    #define HASHMAP_MIGRATE_STEP 32
+#endif // HASHMAP_MIGRATE_STEP
+
+#if HASHMAP_MIGRATE_STEP < 4
+    #error "HASHMAP_MIGRATE_STEP must be at least 4"
+#endif // HASHMAP_MIGRATE_STEP check
+
+/**
+ * @enum hashmap_error
+ * @brief Error codes for the hash map
+ */
+enum hashmap_error {
+    HASHMAP_OK = 0,             ///< No error
+    HASHMAP_ERR_NULL = -1,      ///< Null pointer
+    HASHMAP_ERR_DUPLICATE = -2, ///< The key is already in the map
+    HASHMAP_ERR_ALLOC = -3,     ///< Allocation failure
+    HASHMAP_ERR_NOT_FOUND = -4, ///< The key is not in the map
+    HASHMAP_ERR_CAPACITY = -5,  ///< The requested size does not fit in size_t
+    HASHMAP_ERR_CONSTRUCT = -6, ///< The construct_fn given to emplace failed
+};
+
+/**
+ * @def HASHMAP_CTRL_EMPTY
+ * @def HASHMAP_CTRL_DELETED
+ * @brief Control bytes of the slots that hold no entry, full slots hold h2, 0 to 127
+ *
+ * Both have the high bit set, so "empty or deleted" is a sign test. EMPTY has bit 1 clear and
+ * DELETED has it set, which is what the portable group version uses to tell them apart.
+ */
+#define HASHMAP_CTRL_EMPTY ((uint8_t)0x80)
+#define HASHMAP_CTRL_DELETED ((uint8_t)0xFE)
+
+/**
+ * @def HASHMAP_GROUP_WIDTH
+ * @def HASHMAP_GROUP_SHIFT
+ * @brief Control bytes matched at once, and the shift from a bit of a match mask to a slot
+ *
+ * SSE2 masks have one bit per slot, the NEON and portable masks have the high bit of one byte per slot.
+ */
+#ifdef HASHMAP_SIMD_SSE2
+    #define HASHMAP_GROUP_WIDTH 16
+    #define HASHMAP_GROUP_SHIFT 0
+#else
+    #define HASHMAP_GROUP_WIDTH 8
+    #define HASHMAP_GROUP_SHIFT 3
+#endif // HASHMAP_GROUP_WIDTH
+
+/**
+ * @private
+ * @brief hashmap_ctz: Count of trailing zero bits of a non-zero mask
+ */
+static inline size_t hashmap_ctz(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctzll(mask);
+#else
+    size_t count = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        count++;
+    }
+    return count;
+#endif // count trailing zeros
+}
+
+/**
+ * @private
+ * @brief hashmap_clz: Count of leading zero bits of a non-zero mask
+ */
+static inline size_t hashmap_clz(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_clzll(mask);
+#else
+    size_t count = 0;
+    while ((mask & ((uint64_t)1 << 63)) == 0) {
+        mask <<= 1;
+        count++;
+    }
+    return count;
+#endif // count leading zeros
+}
+
+#if !defined(HASHMAP_SIMD_SSE2) && !defined(HASHMAP_SIMD_NEON)
+/**
+ * @private
+ * @brief hashmap_group_load: The 8 control bytes at ctrl, the first one in the low byte
+ */
+static inline uint64_t hashmap_group_load(const uint8_t *ctrl) {
+    uint64_t group;
+    memcpy(&group, ctrl, sizeof(group));
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+    #endif // big endian
+    return group;
+}
+#endif // portable group
+
+/**
+ * @brief hashmap_group_match: Mask of the slots of the group at ctrl whose control byte is h2
+ *
+ * @note The portable version may also flag a slot right after a real match, eq_fn sorts that out
+ */
+static inline uint64_t hashmap_group_match(const uint8_t *ctrl, uint8_t h2) {
+#if defined(HASHMAP_SIMD_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i *)(const void *)ctrl);
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+#elif defined(HASHMAP_SIMD_NEON)
+    uint8x8_t eq = vceq_u8(vld1_u8(ctrl), vdup_n_u8(h2));
+    return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & UINT64_C(0x8080808080808080);
+#else
+    uint64_t x = hashmap_group_load(ctrl) ^ (UINT64_C(0x0101010101010101) * h2);
+    return (x - UINT64_C(0x0101010101010101)) & ~x & UINT64_C(0x8080808080808080);
+#endif // group match
+}
+
+/**
+ * @brief hashmap_group_match_empty: Mask of the empty slots of the group at ctrl
+ */
+static inline uint64_t hashmap_group_match_empty(const uint8_t *ctrl) {
+#if defined(HASHMAP_SIMD_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i *)(const void *)ctrl);
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)HASHMAP_CTRL_EMPTY)));
+#elif defined(HASHMAP_SIMD_NEON)
+    uint8x8_t eq = vceq_u8(vld1_u8(ctrl), vdup_n_u8(HASHMAP_CTRL_EMPTY));
+    return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & UINT64_C(0x8080808080808080);
+#else
+    uint64_t group = hashmap_group_load(ctrl);
+    return group & ~(group << 6) & UINT64_C(0x8080808080808080);
+#endif // group match empty
+}
+
+/**
+ * @brief hashmap_group_match_free: Mask of the empty or deleted slots of the group at ctrl
+ */
+static inline uint64_t hashmap_group_match_free(const uint8_t *ctrl) {
+#if defined(HASHMAP_SIMD_SSE2)
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(const void *)ctrl));
+#elif defined(HASHMAP_SIMD_NEON)
+    return vget_lane_u64(vreinterpret_u64_u8(vld1_u8(ctrl)), 0) & UINT64_C(0x8080808080808080);
+#else
+    return hashmap_group_load(ctrl) & UINT64_C(0x8080808080808080);
+#endif // group match free
+}
+
+/**
+ * @private
+ * @brief hashmap_set_ctrl: Sets the control byte of a slot and its clone past the end
+ *
+ * The GROUP_WIDTH bytes after the last slot repeat the first ones, so a group can be read at any
+ * slot without wrapping around. For slots past the first group both writes go to the same byte.
+ */
+static inline void hashmap_set_ctrl(uint8_t *ctrl, size_t mask, size_t index, uint8_t value) {
+    ctrl[index] = value;
+    ctrl[((index - HASHMAP_GROUP_WIDTH) & mask) + HASHMAP_GROUP_WIDTH] = value;
+}
+
+/**
+ * @private
+ * @brief hashmap_erased_ctrl: Control byte a slot gets when its entry is removed
+ *
+ * EMPTY when no probe can have gone past the slot, that is, when the run of non empty slots
+ * around it is shorter than a group, DELETED otherwise so the probes of other keys keep going.
+ */
+static inline uint8_t hashmap_erased_ctrl(const uint8_t *ctrl, size_t mask, size_t index) {
+    uint64_t after = hashmap_group_match_empty(ctrl + index);
+    uint64_t before = hashmap_group_match_empty(ctrl + ((index - HASHMAP_GROUP_WIDTH) & mask));
+    if (after == 0 || before == 0) {
+        return HASHMAP_CTRL_DELETED;
+    }
+    size_t run_after = hashmap_ctz(after) >> HASHMAP_GROUP_SHIFT;
+    /* The masks of SSE2 sit in the low 16 bits, the byte masks fill all 64 */
+    size_t unused_bits = 64 - (HASHMAP_GROUP_WIDTH << HASHMAP_GROUP_SHIFT);
+    size_t run_before = (hashmap_clz(before) - unused_bits) >> HASHMAP_GROUP_SHIFT;
+    return run_after + run_before < HASHMAP_GROUP_WIDTH ? HASHMAP_CTRL_EMPTY : HASHMAP_CTRL_DELETED;
+}
+
+/**
+ * @private
+ * @brief hashmap_mix: Spreads the bits of a user hash, h2 comes from the low 7 bits and the probe
+ *        start from the others, so both must depend on the whole key
+ */
+static inline uint64_t hashmap_mix(uint64_t hash) {
+    hash *= UINT64_C(0x9E3779B97F4A7C15);
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * @brief hashmap_hash_u64: Hashes an integer, the finalizer of splitmix64
+ */
+static inline uint64_t hashmap_hash_u64(uint64_t x) {
+    x ^= x >> 30;
+    x *= UINT64_C(0xBF58476D1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94D049BB133111EB);
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief hashmap_hash_bytes: Hashes len bytes, 8 at a time
+ */
+static inline uint64_t hashmap_hash_bytes(const void *data, size_t len) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = UINT64_C(0x243F6A8885A308D3) ^ (uint64_t)len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ hashmap_hash_u64(word)) * UINT64_C(0x9E3779B97F4A7C15);
+    }
+    uint64_t tail = 0;
+    for (size_t shift = 0; i < len; ++i, shift += 8) {
+        tail |= (uint64_t)bytes[i] << shift;
+    }
+    return hashmap_hash_u64(hash ^ tail);
+}
+
+/**
+ * @brief hashmap_hash_string: Hashes a null terminated string, without the terminator
+ */
+static inline uint64_t hashmap_hash_string(const char *str) {
+    return hashmap_hash_bytes(str, strlen(str));
+}
+
+/**
+ * @def hashmap_hash_scalar
+ * @def hashmap_eq_scalar
+ * @brief hash_fn and eq_fn for integer keys, they get a pointer to the key
+ */
+#define hashmap_hash_scalar(key_ptr) hashmap_hash_u64((uint64_t)*(key_ptr))
+#define hashmap_eq_scalar(a, b) (*(a) == *(b))
+
+/**
+ * @def hashmap_hash_cstring
+ * @def hashmap_eq_cstring
+ * @brief hash_fn and eq_fn for null terminated string keys, K is char * or const char *
+ */
+#define hashmap_hash_cstring(key_ptr) hashmap_hash_string(*(key_ptr))
+#define hashmap_eq_cstring(a, b) (strcmp(*(a), *(b)) == 0)
+
+// clang-format off
+
+/**
+ * @def HASHMAP_USE_PREFIX
+ * @brief Defines at compile-time if the functions will use the hashmap_* prefix
+ * @details Same as ARRAYLIST_USE_PREFIX, generates hashmap_##name##_function() instead of
+ *          name##_function()
+ *
+ * @warning The @c HASHMAP_FN macro is for intenal use only
+ */
+#ifdef HASHMAP_USE_PREFIX
+    #define HASHMAP_FN(name, func) hashmap_##name##_##func
+#else
+    #define HASHMAP_FN(name, func) name##_##func
+#endif
+
+/**
+ * @def HASHMAP_TYPE(K, V, name)
+ * @brief Defines the entry and the hash map structures for a specific key K and value V
+ * @param K The type of the keys
+ * @param V The type of the values
+ * @param name The name suffix for the hash map type
+ *
+ * This macro defines the entry "pair_##name" with PAIR_TYPE(K, V, name), "first" is the key and
+ * "second" the value, and a struct named "hashmap_##name" with the following fields:
+ * - "entries": The slots of the current table, NULL until the first insert
+ * - "ctrl": The control bytes of the current table, one per slot plus HASHMAP_GROUP_WIDTH clones
+ * - "mask": Capacity of the current table - 1, the capacity is a power of two
+ * - "size": Number of entries, counting the ones still in the old table
+ * - "growth_left": Empty slots of the current table that can still be filled before it grows
+ * - "old_entries": The table being emptied into the current one while the map grows, or NULL
+ * - "old_ctrl": The control bytes of the old table
+ * - "old_mask": Capacity of the old table - 1
+ * - "migrated": Slots of the old table already moved, they are moved in order
+ * - "alloc": Allocator of the tables
+ */
+#define HASHMAP_TYPE(K, V, name)                                                                                       \
+PAIR_TYPE(K, V, name)                                                                                                  \
+struct hashmap_##name {                                                                                                \
+    struct pair_##name *entries;                                                                                       \
+    uint8_t *ctrl;                                                                                                     \
+    size_t mask;                                                                                                       \
+    size_t size;                                                                                                       \
+    size_t growth_left;                                                                                                \
+    struct pair_##name *old_entries;                                                                                   \
+    uint8_t *old_ctrl;                                                                                                 \
+    size_t old_mask;                                                                                                   \
+    size_t migrated;                                                                                                   \
+    struct Allocator alloc;                                                                                            \
+};
+
+/**
+ * @def HASHMAP_DECL(K, V, name)
+ * @brief Declares all functions for a hash map type
+ * @param K The type of the keys
+ * @param V The type of the values
+ * @param name The name suffix for the hash map type
+ *
+ * @details
+ * The following functions are declared:
+ * Construction / Destruction
+ * - struct hashmap_##name HASHMAP_FN(name, init)(const struct Allocator alloc);
+ * - enum hashmap_error HASHMAP_FN(name, reserve)(struct hashmap_##name *self, const size_t n);
+ * - void HASHMAP_FN(name, clear)(struct hashmap_##name *self);
+ * - void HASHMAP_FN(name, deinit)(struct hashmap_##name *self);
+ *
+ * Modifiers
+ * - enum hashmap_error HASHMAP_FN(name, insert)(struct hashmap_##name *self, K key, V value);
+ * - enum hashmap_error HASHMAP_FN(name, try_insert)(struct hashmap_##name *self, K key, V value);
+ * - enum hashmap_error HASHMAP_FN(name, emplace)(struct hashmap_##name *self, K key, int (*construct_fn)(V *location, void *args, struct Allocator *alloc), void *args, V **out);
+ *
+ * Ownership of the key: insert, try_insert and emplace only take the key when it becomes the key of a new
+ * entry. When the key is already in the map the one in the map is kept and the given key stays with the
+ * caller, on insert too, which still takes the value and destroys the old one.
+ * - enum hashmap_error HASHMAP_FN(name, remove)(struct hashmap_##name *self, K key);
+ *
+ * Lookup
+ * - struct pair_##name *HASHMAP_FN(name, find)(const struct hashmap_##name *self, K key);
+ * - V *HASHMAP_FN(name, get)(const struct hashmap_##name *self, K key);
+ * - bool HASHMAP_FN(name, contains)(const struct hashmap_##name *self, K key);
+ * - struct pair_##name *HASHMAP_FN(name, next)(const struct hashmap_##name *self, size_t *cursor);
+ *
+ * Capacity
+ * - size_t HASHMAP_FN(name, size)(const struct hashmap_##name *self);
+ * - bool HASHMAP_FN(name, is_empty)(const struct hashmap_##name *self);
+ * - size_t HASHMAP_FN(name, capacity)(const struct hashmap_##name *self);
+ */
+#define HASHMAP_DECL(K, V, name)                                                                                       \
+/**                                                                                                                    \
+ * @brief init: Creates an empty hash map                                                                              \
+ * @param alloc Custom allocator instance                                                                              \
+ * @return A zero initialized hash map using alloc                                                                     \
+ *                                                                                                                     \
+ * @note It does not allocate, the first table is allocated by the first insert or reserve                             \
+ * @warning Call name##_deinit() when done.                                                                            \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE struct hashmap_##name HASHMAP_FN(name, init)(const struct Allocator alloc);             \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief reserve: Makes room for n entries, so inserting up to n keys never grows the table                           \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param n Number of entries the map must hold                                                                        \
+ * @return HASHMAP_OK, HASHMAP_ERR_NULL, HASHMAP_ERR_CAPACITY if n is too big or HASHMAP_ERR_ALLOC,                    \
+ *         the map is unchanged on failure                                                                             \
+ *                                                                                                                     \
+ * @note Unlike the growth of insert, every entry is moved at once, an unfinished growth included                      \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, reserve)(                                           \
+    struct hashmap_##name *self,                                                                                       \
+    const size_t n                                                                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief clear: Destroys every entry, the current table is kept for reuse                                             \
+ * @param self Pointer to the hash map                                                                                 \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE void HASHMAP_FN(name, clear)(struct hashmap_##name *self);                              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief deinit: Destroys every entry and frees the tables                                                            \
+ * @param self Pointer to the hash map to deinit                                                                       \
+ *                                                                                                                     \
+ * Safe to call on NULL or already deinitialized maps, returns early                                                   \
+ *                                                                                                                     \
+ * @note The self parameter will be left zeroed out, to reuse it init() it again                                       \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE void HASHMAP_FN(name, deinit)(struct hashmap_##name *self);                             \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief insert: Inserts key with value, or replaces the value if key is already there                                \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key, owned by the map afterwards if it was not there yet                                             \
+ * @param value The value, owned by the map afterwards                                                                 \
+ * @return HASHMAP_OK, HASHMAP_ERR_NULL or HASHMAP_ERR_ALLOC, on failure nothing is taken                              \
+ *                                                                                                                     \
+ * @note On a replace, the old value goes through dtor_v and the key already in the map is kept, the                   \
+ *       given key is not taken, the caller still owns it                                                              \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, insert)(                                            \
+    struct hashmap_##name *self,                                                                                       \
+    K key,                                                                                                             \
+    V value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief try_insert: Inserts key with value only if key is not there yet                                              \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key, owned by the map afterwards on success                                                          \
+ * @param value The value, owned by the map afterwards on success                                                      \
+ * @return HASHMAP_OK, HASHMAP_ERR_DUPLICATE if key is already there, HASHMAP_ERR_NULL or                              \
+ *         HASHMAP_ERR_ALLOC, on failure nothing is taken and the map is unchanged                                     \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, try_insert)(                                        \
+    struct hashmap_##name *self,                                                                                       \
+    K key,                                                                                                             \
+    V value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief emplace: Constructs the value of a new key in-place                                                          \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key, owned by the map afterwards on success                                                          \
+ * @param construct_fn Function that knows how to construct type V                                                     \
+ *                     Must have the following prototype:                                                              \
+ *                     int (*construct_fn)(V *location, void *args, struct Allocator *alloc);                          \
+ *                     It must return 0 for success, < 0 or > 0 is treated as a failure.                               \
+ * @param args Pointer to the arguments used in the constructor function                                               \
+ * @param out Set to the constructed value in the map on HASHMAP_OK, left as it is otherwise, may be null              \
+ * @return HASHMAP_OK, HASHMAP_ERR_NULL if self or construct_fn is null, HASHMAP_ERR_DUPLICATE if key is               \
+ *         already there, HASHMAP_ERR_ALLOC or HASHMAP_ERR_CONSTRUCT if construct_fn failed, on failure                \
+ *         the key is not taken and the map is unchanged                                                               \
+ *                                                                                                                     \
+ * @note Same contract as the emplace of the avltree, the allocator given is the map allocator                         \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, emplace)(                                           \
+    struct hashmap_##name *self,                                                                                       \
+    K key,                                                                                                             \
+    int (*construct_fn)(V *location, void *args, struct Allocator *alloc),                                             \
+    void *args,                                                                                                        \
+    V **out                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief remove: Removes key and destroys its entry with dtor_k and dtor_v                                            \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key to look for, it is not destroyed                                                                 \
+ * @return HASHMAP_OK, HASHMAP_ERR_NOT_FOUND or HASHMAP_ERR_NULL                                                       \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, remove)(struct hashmap_##name *self, K key);        \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief find: Finds the entry of key                                                                                 \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key to look for                                                                                      \
+ * @return Pointer to the entry, or NULL if key is not there or self is null                                           \
+ *                                                                                                                     \
+ * @warning The key of the entry must not be modified, and the pointer is invalidated by the next                      \
+ *          insert, emplace or remove                                                                                  \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE struct pair_##name *HASHMAP_FN(name, find)(const struct hashmap_##name *self, K key);   \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief get: Finds the value of key                                                                                  \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key to look for                                                                                      \
+ * @return Pointer to the value, or NULL if key is not there or self is null                                           \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE V *HASHMAP_FN(name, get)(const struct hashmap_##name *self, K key);                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief contains: Checks if key is in the map                                                                        \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param key The key to look for                                                                                      \
+ * @return True if found, false if not found or self is null                                                           \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE bool HASHMAP_FN(name, contains)(const struct hashmap_##name *self, K key);              \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief next: Iterates over the entries, in no particular order                                                      \
+ * @param self Pointer to the hash map                                                                                 \
+ * @param cursor Position of the iteration, must be 0 for the first call                                               \
+ * @return The next entry, or NULL once every entry was visited or if self or cursor is null                           \
+ *                                                                                                                     \
+ * @code                                                                                                               \
+ * struct pair_name *entry;                                                                                            \
+ * for (size_t it = 0; (entry = name_next(&map, &it)) != NULL;) { ... }                                                \
+ * @endcode                                                                                                            \
+ *                                                                                                                     \
+ * @warning Any insert, emplace or remove during the iteration invalidates the cursor                                  \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE struct pair_##name *HASHMAP_FN(name, next)(                                             \
+    const struct hashmap_##name *self,                                                                                 \
+    size_t *cursor                                                                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief size: Number of entries in the map                                                                           \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE size_t HASHMAP_FN(name, size)(const struct hashmap_##name *self);                       \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief is_empty: Checks if the map has no entry, false if self is null                                              \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE bool HASHMAP_FN(name, is_empty)(const struct hashmap_##name *self);                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief capacity: Number of slots of the current table, 0 before the first one is allocated                          \
+ *                                                                                                                     \
+ * @note The map grows once 7/8 of the slots are used                                                                  \
+ */                                                                                                                    \
+HASHMAP_UNUSED HASHMAP_LINKAGE size_t HASHMAP_FN(name, capacity)(const struct hashmap_##name *self);
+
+/**
+ * @def HASHMAP_IMPL(K, V, name, hash_fn, eq_fn, dtor_k, dtor_v)
+ * @brief Implements all functions for a hash map type
+ * @param K The type of the keys
+ * @param V The type of the values
+ * @param name The name suffix for the hash map type
+ * @param hash_fn Hash of a key (may be a macro or a normal function) with the prototype:
+ *                uint64_t hash_fn(K *key);
+ * @param eq_fn Key equality (may be a macro or a normal function) with the prototype:
+ *              bool eq_fn(K *a, K *b);
+ * @param dtor_k Destructor of the keys, hashmap_noop_deinit if there is nothing to free:
+ *               void dtor_k(K *key, struct Allocator *alloc);
+ * @param dtor_v Destructor of the values, same as dtor_k:
+ *               void dtor_v(V *value, struct Allocator *alloc);
+ *
+ * @details
+ * Same trick as the compile-time deinit_fn of the arraylist, the four functions are expanded
+ * inside the probe loops, so a macro or a function small enough to inline costs no call.
+ *
+ * @note This macro should be used in a .c file, not in a header
+ */
+#define HASHMAP_IMPL(K, V, name, hash_fn, eq_fn, dtor_k, dtor_v)                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief table_bytes: Size of the single allocation of a table with capacity slots                                    \
+ */                                                                                                                    \
+HASHMAP_LINKAGE size_t HASHMAP_FN(name, table_bytes)(size_t capacity) {                                                \
+    return capacity * sizeof(struct pair_##name) + capacity + HASHMAP_GROUP_WIDTH;                                     \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief table_free: Frees a table, the entries must already be destroyed or moved                                    \
+ */                                                                                                                    \
+HASHMAP_LINKAGE void HASHMAP_FN(name, table_free)(                                                                     \
+    struct hashmap_##name *self,                                                                                       \
+    struct pair_##name *entries,                                                                                       \
+    size_t mask                                                                                                        \
+) {                                                                                                                    \
+    if (entries != NULL) {                                                                                             \
+        self->alloc.free(entries, HASHMAP_FN(name, table_bytes)(mask + 1), self->alloc.ctx);                           \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief probe: Index of the slot holding key in a table, SIZE_MAX if it is not there                                 \
+ */                                                                                                                    \
+HASHMAP_LINKAGE size_t HASHMAP_FN(name, probe)(                                                                        \
+    struct pair_##name *entries,                                                                                       \
+    const uint8_t *ctrl,                                                                                               \
+    size_t mask,                                                                                                       \
+    K *key,                                                                                                            \
+    uint64_t hash                                                                                                      \
+) {                                                                                                                    \
+    if (entries == NULL) {                                                                                             \
+        return SIZE_MAX;                                                                                               \
+    }                                                                                                                  \
+    uint8_t h2 = (uint8_t)(hash & 0x7F);                                                                               \
+    size_t pos = (size_t)(hash >> 7) & mask;                                                                           \
+    for (size_t step = HASHMAP_GROUP_WIDTH;; step += HASHMAP_GROUP_WIDTH) {                                            \
+        uint64_t match = hashmap_group_match(ctrl + pos, h2);                                                          \
+        while (match != 0) {                                                                                           \
+            size_t index = (pos + (hashmap_ctz(match) >> HASHMAP_GROUP_SHIFT)) & mask;                                 \
+            if (eq_fn(&entries[index].first, key)) {                                                                   \
+                return index;                                                                                          \
+            }                                                                                                          \
+            match &= match - 1;                                                                                        \
+        }                                                                                                              \
+        if (hashmap_group_match_empty(ctrl + pos) != 0) {                                                              \
+            return SIZE_MAX;                                                                                           \
+        }                                                                                                              \
+        pos = (pos + step) & mask;                                                                                     \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief lookup: Entry holding key in either table, NULL if it is not there                                           \
+ * @param hash The mixed hash of key, hashmap_mix(hash_fn(key))                                                        \
+ */                                                                                                                    \
+HASHMAP_LINKAGE struct pair_##name *HASHMAP_FN(name, lookup)(                                                          \
+    const struct hashmap_##name *self,                                                                                 \
+    K *key,                                                                                                            \
+    uint64_t hash                                                                                                      \
+) {                                                                                                                    \
+    size_t index = HASHMAP_FN(name, probe)(self->entries, self->ctrl, self->mask, key, hash);                          \
+    if (index != SIZE_MAX) {                                                                                           \
+        return &self->entries[index];                                                                                  \
+    }                                                                                                                  \
+    index = HASHMAP_FN(name, probe)(self->old_entries, self->old_ctrl, self->old_mask, key, hash);                     \
+    return index != SIZE_MAX ? &self->old_entries[index] : NULL;                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief find_free: First empty or deleted slot on the probe sequence of hash in the current table                    \
+ *                                                                                                                     \
+ * There always is one, growth_left never lets every slot fill up.                                                     \
+ */                                                                                                                    \
+HASHMAP_LINKAGE size_t HASHMAP_FN(name, find_free)(const struct hashmap_##name *self, uint64_t hash) {                 \
+    size_t pos = (size_t)(hash >> 7) & self->mask;                                                                     \
+    for (size_t step = HASHMAP_GROUP_WIDTH;; step += HASHMAP_GROUP_WIDTH) {                                            \
+        uint64_t match = hashmap_group_match_free(self->ctrl + pos);                                                   \
+        if (match != 0) {                                                                                              \
+            return (pos + (hashmap_ctz(match) >> HASHMAP_GROUP_SHIFT)) & self->mask;                                   \
+        }                                                                                                              \
+        pos = (pos + step) & self->mask;                                                                               \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief occupy: Marks a free slot of the current table as holding an entry of hash                                   \
+ */                                                                                                                    \
+HASHMAP_LINKAGE void HASHMAP_FN(name, occupy)(struct hashmap_##name *self, size_t index, uint64_t hash) {              \
+    if (self->ctrl[index] == HASHMAP_CTRL_EMPTY) {                                                                     \
+        self->growth_left--;                                                                                           \
+    }                                                                                                                  \
+    hashmap_set_ctrl(self->ctrl, self->mask, index, (uint8_t)(hash & 0x7F));                                           \
+    self->size++;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief migrate: Moves up to steps slots of the old table into the current one, and frees the old                    \
+ *        table once every slot was moved                                                                              \
+ */                                                                                                                    \
+HASHMAP_LINKAGE void HASHMAP_FN(name, migrate)(struct hashmap_##name *self, size_t steps) {                            \
+    if (self->old_entries == NULL) {                                                                                   \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    size_t old_capacity = self->old_mask + 1;                                                                          \
+    size_t end = old_capacity - self->migrated < steps ? old_capacity : self->migrated + steps;                        \
+    for (size_t i = self->migrated; i < end; ++i) {                                                                    \
+        if (self->old_ctrl[i] & 0x80) {                                                                                \
+            continue;                                                                                                  \
+        }                                                                                                              \
+        /* Slots of the old table are marked deleted, lookups of the keys not moved yet keep probing */                \
+        uint64_t hash = hashmap_mix(hash_fn(&self->old_entries[i].first));                                             \
+        size_t index = HASHMAP_FN(name, find_free)(self, hash);                                                        \
+        memcpy(&self->entries[index], &self->old_entries[i], sizeof(struct pair_##name));                              \
+        hashmap_set_ctrl(self->old_ctrl, self->old_mask, i, HASHMAP_CTRL_DELETED);                                     \
+        HASHMAP_FN(name, occupy)(self, index, hash);                                                                   \
+        self->size--;                                                                                                  \
+    }                                                                                                                  \
+    self->migrated = end;                                                                                              \
+    if (end == old_capacity) {                                                                                         \
+        HASHMAP_FN(name, table_free)(self, self->old_entries, self->old_mask);                                         \
+        self->old_entries = NULL;                                                                                      \
+        self->old_ctrl = NULL;                                                                                         \
+        self->old_mask = 0;                                                                                            \
+        self->migrated = 0;                                                                                            \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief resize: Makes a new table of capacity slots the current one, the entries of the previous one                 \
+ *        are moved later by migrate()                                                                                 \
+ * @return HASHMAP_OK or HASHMAP_ERR_ALLOC, then the map is unchanged                                                  \
+ *                                                                                                                     \
+ * The capacity must fit every entry. An unfinished migration moves its entries straight into the                      \
+ * new table, there is only one old table at a time.                                                                   \
+ */                                                                                                                    \
+HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, resize)(struct hashmap_##name *self, size_t capacity) {            \
+    struct pair_##name *entries = HASHMAP_CAST(struct pair_##name)self->alloc.malloc(                                  \
+        HASHMAP_FN(name, table_bytes)(capacity), self->alloc.ctx                                                       \
+    );                                                                                                                 \
+    if (entries == NULL) {                                                                                             \
+        return HASHMAP_ERR_ALLOC;                                                                                      \
+    }                                                                                                                  \
+    struct pair_##name *previous = self->entries;                                                                      \
+    uint8_t *previous_ctrl = self->ctrl;                                                                               \
+    size_t previous_mask = self->mask;                                                                                 \
+    self->entries = entries;                                                                                           \
+    self->ctrl = (uint8_t *)(void *)(entries + capacity);                                                              \
+    self->mask = capacity - 1;                                                                                         \
+    self->growth_left = capacity - capacity / 8;                                                                       \
+    memset(self->ctrl, HASHMAP_CTRL_EMPTY, capacity + HASHMAP_GROUP_WIDTH);                                            \
+    HASHMAP_FN(name, migrate)(self, SIZE_MAX);                                                                         \
+    if (previous != NULL && self->size > 0) {                                                                          \
+        self->old_entries = previous;                                                                                  \
+        self->old_ctrl = previous_ctrl;                                                                                \
+        self->old_mask = previous_mask;                                                                                \
+        self->migrated = 0;                                                                                            \
+    } else {                                                                                                           \
+        HASHMAP_FN(name, table_free)(self, previous, previous_mask);                                                   \
+    }                                                                                                                  \
+    return HASHMAP_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @private                                                                                                            \
+ * @brief prepare_insert: Slot of the current table for a key of hash known not to be in the map,                      \
+ *        growing the map if needed                                                                                    \
+ * @return The slot index, or SIZE_MAX on allocation failure                                                           \
+ *                                                                                                                     \
+ * A deleted slot is reused without growing. Otherwise, when no empty slot may be used anymore, the                    \
+ * capacity doubles, or stays the same if most of the used slots only hold deleted markers.                            \
+ */                                                                                                                    \
+HASHMAP_LINKAGE size_t HASHMAP_FN(name, prepare_insert)(struct hashmap_##name *self, uint64_t hash) {                  \
+    if (self->entries != NULL) {                                                                                       \
+        size_t index = HASHMAP_FN(name, find_free)(self, hash);                                                        \
+        if (self->growth_left > 0 || self->ctrl[index] == HASHMAP_CTRL_DELETED) {                                      \
+            return index;                                                                                              \
+        }                                                                                                              \
+    }                                                                                                                  \
+    size_t capacity = self->entries != NULL ? self->mask + 1 : HASHMAP_GROUP_WIDTH;                                    \
+    if (self->entries != NULL && self->size > (capacity - capacity / 8) / 2) {                                         \
+        if (capacity > SIZE_MAX / 2 / (sizeof(struct pair_##name) + 1)) {                                              \
+            return SIZE_MAX;                                                                                           \
+        }                                                                                                              \
+        capacity *= 2;                                                                                                 \
+    }                                                                                                                  \
+    if (HASHMAP_FN(name, resize)(self, capacity) != HASHMAP_OK) {                                                      \
+        return SIZE_MAX;                                                                                               \
+    }                                                                                                                  \
+    return HASHMAP_FN(name, find_free)(self, hash);                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE struct hashmap_##name HASHMAP_FN(name, init)(const struct Allocator alloc) {                           \
+    struct hashmap_##name map;                                                                                         \
+    memset(&map, 0, sizeof(map));                                                                                      \
+    map.alloc = alloc;                                                                                                 \
+    return map;                                                                                                        \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, reserve)(struct hashmap_##name *self, const size_t n) {            \
+    HASHMAP_ENSURE(self != NULL, HASHMAP_ERR_NULL, "reserve(): hash map is null.");                                    \
+    if (self->old_entries == NULL && (n == 0 || (self->entries != NULL && n <= self->size + self->growth_left))) {     \
+        return HASHMAP_OK;                                                                                             \
+    }                                                                                                                  \
+    size_t capacity = HASHMAP_GROUP_WIDTH;                                                                             \
+    while (capacity - capacity / 8 < n) {                                                                              \
+        HASHMAP_ENSURE(capacity <= SIZE_MAX / 2 / (sizeof(struct pair_##name) + 1), HASHMAP_ERR_CAPACITY,              \
+                       "reserve(): n is too big.");                                                                    \
+        capacity *= 2;                                                                                                 \
+    }                                                                                                                  \
+    if (self->entries != NULL && capacity < self->mask + 1) {                                                          \
+        capacity = self->mask + 1;                                                                                     \
+    }                                                                                                                  \
+    enum hashmap_error err = HASHMAP_FN(name, resize)(self, capacity);                                                 \
+    HASHMAP_ENSURE(err == HASHMAP_OK, err, "reserve(): error during allocation.");                                     \
+    HASHMAP_FN(name, migrate)(self, SIZE_MAX);                                                                         \
+    return HASHMAP_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE void HASHMAP_FN(name, clear)(struct hashmap_##name *self) {                                            \
+    if (!self || !self->entries) {                                                                                     \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    for (size_t i = 0; self->old_entries != NULL && i <= self->old_mask; ++i) {                                        \
+        if ((self->old_ctrl[i] & 0x80) == 0) {                                                                         \
+            dtor_k(&self->old_entries[i].first, &self->alloc);                                                         \
+            dtor_v(&self->old_entries[i].second, &self->alloc);                                                        \
+        }                                                                                                              \
+    }                                                                                                                  \
+    HASHMAP_FN(name, table_free)(self, self->old_entries, self->old_mask);                                             \
+    self->old_entries = NULL;                                                                                          \
+    self->old_ctrl = NULL;                                                                                             \
+    self->old_mask = 0;                                                                                                \
+    self->migrated = 0;                                                                                                \
+    for (size_t i = 0; i <= self->mask; ++i) {                                                                         \
+        if ((self->ctrl[i] & 0x80) == 0) {                                                                             \
+            dtor_k(&self->entries[i].first, &self->alloc);                                                             \
+            dtor_v(&self->entries[i].second, &self->alloc);                                                            \
+        }                                                                                                              \
+    }                                                                                                                  \
+    memset(self->ctrl, HASHMAP_CTRL_EMPTY, self->mask + 1 + HASHMAP_GROUP_WIDTH);                                      \
+    self->size = 0;                                                                                                    \
+    self->growth_left = self->mask + 1 - (self->mask + 1) / 8;                                                         \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE void HASHMAP_FN(name, deinit)(struct hashmap_##name *self) {                                           \
+    if (!self || !self->entries) {                                                                                     \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    HASHMAP_FN(name, clear)(self);                                                                                     \
+    HASHMAP_FN(name, table_free)(self, self->entries, self->mask);                                                     \
+    memset(self, 0, sizeof(*self));                                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, insert)(struct hashmap_##name *self, K key, V value) {             \
+    HASHMAP_ENSURE(self != NULL, HASHMAP_ERR_NULL, "insert(): hash map is null.");                                     \
+    HASHMAP_FN(name, migrate)(self, HASHMAP_MIGRATE_STEP);                                                             \
+    uint64_t hash = hashmap_mix(hash_fn(&key));                                                                        \
+    struct pair_##name *entry = HASHMAP_FN(name, lookup)(self, &key, hash);                                            \
+    if (entry != NULL) {                                                                                               \
+        dtor_v(&entry->second, &self->alloc);                                                                          \
+        entry->second = value;                                                                                         \
+        return HASHMAP_OK;                                                                                             \
+    }                                                                                                                  \
+    size_t index = HASHMAP_FN(name, prepare_insert)(self, hash);                                                       \
+    HASHMAP_ENSURE(index != SIZE_MAX, HASHMAP_ERR_ALLOC, "insert(): error during allocation.");                        \
+    self->entries[index].first = key;                                                                                  \
+    self->entries[index].second = value;                                                                               \
+    HASHMAP_FN(name, occupy)(self, index, hash);                                                                       \
+    return HASHMAP_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, try_insert)(                                                       \
+    struct hashmap_##name *self,                                                                                       \
+    K key,                                                                                                             \
+    V value                                                                                                            \
+) {                                                                                                                    \
+    HASHMAP_ENSURE(self != NULL, HASHMAP_ERR_NULL, "try_insert(): hash map is null.");                                 \
+    HASHMAP_FN(name, migrate)(self, HASHMAP_MIGRATE_STEP);                                                             \
+    uint64_t hash = hashmap_mix(hash_fn(&key));                                                                        \
+    if (HASHMAP_FN(name, lookup)(self, &key, hash) != NULL) {                                                          \
+        return HASHMAP_ERR_DUPLICATE;                                                                                  \
+    }                                                                                                                  \
+    size_t index = HASHMAP_FN(name, prepare_insert)(self, hash);                                                       \
+    HASHMAP_ENSURE(index != SIZE_MAX, HASHMAP_ERR_ALLOC, "try_insert(): error during allocation.");                    \
+    self->entries[index].first = key;                                                                                  \
+    self->entries[index].second = value;                                                                               \
+    HASHMAP_FN(name, occupy)(self, index, hash);                                                                       \
+    return HASHMAP_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, emplace)(                                                          \
+    struct hashmap_##name *self,                                                                                       \
+    K key,                                                                                                             \
+    int (*construct_fn)(V *location, void *args, struct Allocator *alloc),                                             \
+    void *args,                                                                                                        \
+    V **out                                                                                                            \
+) {                                                                                                                    \
+    HASHMAP_ENSURE(self != NULL, HASHMAP_ERR_NULL, "emplace(): hash map is null.");                                    \
+    HASHMAP_ENSURE(construct_fn != NULL, HASHMAP_ERR_NULL, "emplace(): construct_fn is null.");                        \
+    HASHMAP_FN(name, migrate)(self, HASHMAP_MIGRATE_STEP);                                                             \
+    uint64_t hash = hashmap_mix(hash_fn(&key));                                                                        \
+    if (HASHMAP_FN(name, lookup)(self, &key, hash) != NULL) {                                                          \
+        return HASHMAP_ERR_DUPLICATE;                                                                                  \
+    }                                                                                                                  \
+    size_t index = HASHMAP_FN(name, prepare_insert)(self, hash);                                                       \
+    HASHMAP_ENSURE(index != SIZE_MAX, HASHMAP_ERR_ALLOC, "emplace(): error during allocation.");                       \
+    /* The slot only counts as used once the value is constructed, a failure leaves it free */                         \
+    if (construct_fn(&self->entries[index].second, args, &self->alloc) != 0) {                                         \
+        return HASHMAP_ERR_CONSTRUCT;                                                                                  \
+    }                                                                                                                  \
+    self->entries[index].first = key;                                                                                  \
+    HASHMAP_FN(name, occupy)(self, index, hash);                                                                       \
+    if (out != NULL) {                                                                                                 \
+        *out = &self->entries[index].second;                                                                           \
+    }                                                                                                                  \
+    return HASHMAP_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE enum hashmap_error HASHMAP_FN(name, remove)(struct hashmap_##name *self, K key) {                      \
+    HASHMAP_ENSURE(self != NULL, HASHMAP_ERR_NULL, "remove(): hash map is null.");                                     \
+    HASHMAP_FN(name, migrate)(self, HASHMAP_MIGRATE_STEP);                                                             \
+    uint64_t hash = hashmap_mix(hash_fn(&key));                                                                        \
+    struct pair_##name *entries = self->entries;                                                                       \
+    uint8_t *ctrl = self->ctrl;                                                                                        \
+    size_t mask = self->mask;                                                                                          \
+    size_t index = HASHMAP_FN(name, probe)(entries, ctrl, mask, &key, hash);                                           \
+    if (index == SIZE_MAX) {                                                                                           \
+        entries = self->old_entries;                                                                                   \
+        ctrl = self->old_ctrl;                                                                                         \
+        mask = self->old_mask;                                                                                         \
+        index = HASHMAP_FN(name, probe)(entries, ctrl, mask, &key, hash);                                              \
+        if (index == SIZE_MAX) {                                                                                       \
+            return HASHMAP_ERR_NOT_FOUND;                                                                              \
+        }                                                                                                              \
+    }                                                                                                                  \
+    dtor_k(&entries[index].first, &self->alloc);                                                                       \
+    dtor_v(&entries[index].second, &self->alloc);                                                                      \
+    if (entries == self->entries) {                                                                                    \
+        uint8_t erased = hashmap_erased_ctrl(ctrl, mask, index);                                                       \
+        if (erased == HASHMAP_CTRL_EMPTY) {                                                                            \
+            self->growth_left++;                                                                                       \
+        }                                                                                                              \
+        hashmap_set_ctrl(ctrl, mask, index, erased);                                                                   \
+    } else {                                                                                                           \
+        /* The old table only serves lookups now, a deleted marker is always right there */                            \
+        hashmap_set_ctrl(ctrl, mask, index, HASHMAP_CTRL_DELETED);                                                     \
+    }                                                                                                                  \
+    self->size--;                                                                                                      \
+    return HASHMAP_OK;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE struct pair_##name *HASHMAP_FN(name, find)(const struct hashmap_##name *self, K key) {                 \
+    HASHMAP_ENSURE(self != NULL, NULL, "find(): hash map is null.");                                                   \
+    return HASHMAP_FN(name, lookup)(self, &key, hashmap_mix(hash_fn(&key)));                                           \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE V *HASHMAP_FN(name, get)(const struct hashmap_##name *self, K key) {                                   \
+    HASHMAP_ENSURE(self != NULL, NULL, "get(): hash map is null.");                                                    \
+    struct pair_##name *entry = HASHMAP_FN(name, lookup)(self, &key, hashmap_mix(hash_fn(&key)));                      \
+    return entry != NULL ? &entry->second : NULL;                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE bool HASHMAP_FN(name, contains)(const struct hashmap_##name *self, K key) {                            \
+    HASHMAP_ENSURE(self != NULL, false, "contains(): hash map is null.");                                              \
+    return HASHMAP_FN(name, lookup)(self, &key, hashmap_mix(hash_fn(&key))) != NULL;                                   \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE struct pair_##name *HASHMAP_FN(name, next)(                                                            \
+    const struct hashmap_##name *self,                                                                                 \
+    size_t *cursor                                                                                                     \
+) {                                                                                                                    \
+    HASHMAP_ENSURE(self != NULL && cursor != NULL, NULL, "next(): hash map or cursor is null.");                       \
+    /* The cursor goes over the slots of the old table first, then over the current one */                             \
+    size_t old_capacity = self->old_entries != NULL ? self->old_mask + 1 : 0;                                          \
+    size_t capacity = self->entries != NULL ? self->mask + 1 : 0;                                                      \
+    while (*cursor < old_capacity) {                                                                                   \
+        size_t i = (*cursor)++;                                                                                        \
+        if ((self->old_ctrl[i] & 0x80) == 0) {                                                                         \
+            return &self->old_entries[i];                                                                              \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (*cursor < old_capacity + capacity) {                                                                        \
+        size_t i = (*cursor)++ - old_capacity;                                                                         \
+        if ((self->ctrl[i] & 0x80) == 0) {                                                                             \
+            return &self->entries[i];                                                                                  \
+        }                                                                                                              \
+    }                                                                                                                  \
+    return NULL;                                                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE size_t HASHMAP_FN(name, size)(const struct hashmap_##name *self) {                                     \
+    HASHMAP_ENSURE(self != NULL, 0, "size(): hash map is null.");                                                      \
+    return self->size;                                                                                                 \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE bool HASHMAP_FN(name, is_empty)(const struct hashmap_##name *self) {                                   \
+    HASHMAP_ENSURE(self != NULL, false, "is_empty(): hash map is null.");                                              \
+    return self->size == 0;                                                                                            \
+}                                                                                                                      \
+                                                                                                                       \
+HASHMAP_LINKAGE size_t HASHMAP_FN(name, capacity)(const struct hashmap_##name *self) {                                 \
+    HASHMAP_ENSURE(self != NULL, 0, "capacity(): hash map is null.");                                                  \
+    return self->entries != NULL ? self->mask + 1 : 0;                                                                 \
+}
+
+/**
+ * @def HASHMAP(K, V, name, hash_fn, eq_fn, dtor_k, dtor_v)
+ * @brief Helper macro to define the structs, the declarations and the implementations of a hash
+ *        map type
+ * @param K The type of the keys
+ * @param V The type of the values
+ * @param name The name suffix for the hash map type
+ * @param hash_fn Hash of a key, see HASHMAP_IMPL
+ * @param eq_fn Key equality, see HASHMAP_IMPL
+ * @param dtor_k Destructor of the keys, hashmap_noop_deinit if there is nothing to free
+ * @param dtor_v Destructor of the values, hashmap_noop_deinit if there is nothing to free
+ */
+#define HASHMAP(K, V, name, hash_fn, eq_fn, dtor_k, dtor_v)                                                            \
+HASHMAP_TYPE(K, V, name)                                                                                               \
+HASHMAP_DECL(K, V, name)                                                                                               \
+HASHMAP_IMPL(K, V, name, hash_fn, eq_fn, dtor_k, dtor_v)
+
+// clang-format on
+
+#ifdef __cplusplus
+}
+#endif // extern "C"
+
+#endif // HASHMAP_H
@@ -143,6 +143,7 @@
 #define PAIR_H
 
 #include <stdbool.h> // For bool, true, false
+#include <stdint.h>  // For uint32_t, uint64_t
 #include <string.h>  // For memset()
 
 #include "allocator.h" // For a custom Allocator interface
@@ -620,20 +621,11 @@ PAIR_LINKAGE enum pair_cmp_result PAIR_FN(name, cmp)(
     PAIR_ENSURE(cmp_first != NULL, PAIR_CMP_ERR, "cmp(): cmp_first function is null.");                                \
     PAIR_ENSURE(cmp_second != NULL, PAIR_CMP_ERR, "cmp(): cmp_second function is null.");                              \
     int res = cmp_first(&a->first, &b->first);                                                                         \
-    if (res < 0) {                                                                                                     \
-        return PAIR_CMP_LESS;                                                                                          \
+    if (res == 0) {                                                                                                    \
+        res = cmp_second(&a->second, &b->second);                                                                      \
     }                                                                                                                  \
-    if (res > 0) {                                                                                                     \
-        return PAIR_CMP_GREATER;                                                                                       \
-    }                                                                                                                  \
-    res = cmp_second(&a->second, &b->second);                                                                          \
-    if (res < 0) {                                                                                                     \
-        return PAIR_CMP_LESS;                                                                                          \
-    }                                                                                                                  \
-    if (res > 0) {                                                                                                     \
-        return PAIR_CMP_GREATER;                                                                                       \
-    }                                                                                                                  \
-    return PAIR_CMP_EQUAL;                                                                                             \
+    /* sign without branches, -1, 0 or 1 are PAIR_CMP_LESS, PAIR_CMP_EQUAL and PAIR_CMP_GREATER */                     \
+    return (enum pair_cmp_result)((res > 0) - (res < 0));                                                              \
 }                                                                                                                      \
                                                                                                                        \
 PAIR_LINKAGE enum pair_error PAIR_FN(name, swap)(struct pair_##name *self, struct pair_##name *other) {                \
@@ -659,6 +651,125 @@ PAIR_TYPE(K, V, name)
 PAIR_DECL(K, V, name)                                                                                                  \
 PAIR_IMPL(K, V, name, dtor_first, dtor_second)
 
+
+/**
+ * @def PAIR_IS_SIGNED(T)
+ * @brief If the integer type T is signed, a constant expression
+ */
+#define PAIR_IS_SIGNED(T) ((T)0 > (T)-1)
+
+/**
+ * @def PAIR_DECL_PACKED(K, V, name)
+ * @brief Declares the packed key fast path for a pair type whose K and V are integers of up to 32 bits
+ * @param K The first type pair will hold
+ * @param V The second type pair will hold
+ * @param name The name suffix for the pair type
+ *
+ * @details
+ * Only declares, after the DECL macro of the type:
+ * - uint64_t PAIR_FN(name, pack)(const struct pair_##name *self);
+ * - int PAIR_FN(name, cmp_packed)(struct pair_##name *a, struct pair_##name *b);
+ * - bool PAIR_FN(name, eq)(struct pair_##name *a, struct pair_##name *b);
+ * - uint64_t PAIR_FN(name, hash)(struct pair_##name *self);
+ */
+#define PAIR_DECL_PACKED(K, V, name)                                                                                   \
+/**                                                                                                                    \
+ * @brief pack: Packs the pair into one 64-bit key whose unsigned order is the lexicographic order of the pair         \
+ * @param self Pointer to the pair                                                                                     \
+ * @return first in the high 32 bits and second in the low ones, the sign bit of signed types flipped                  \
+ */                                                                                                                    \
+PAIR_UNUSED PAIR_LINKAGE uint64_t PAIR_FN(name, pack)(const struct pair_##name *self);                                 \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief cmp_packed: Lexicographically compares two pairs through their packed keys, without branches                 \
+ * @param a Pointer to the first pair                                                                                  \
+ * @param b Pointer to the second pair                                                                                 \
+ * @return < 0, 0 or > 0, the same sign cmp gives with the natural order of K and V                                    \
+ *                                                                                                                     \
+ * @note Has the prototype of a comparator_fn, so it can be given to an avltree of pairs or expanded by                \
+ *       ARRAYLIST_IMPL_CMP, no null check is made                                                                     \
+ */                                                                                                                    \
+PAIR_UNUSED PAIR_LINKAGE int PAIR_FN(name, cmp_packed)(struct pair_##name *a, struct pair_##name *b);                  \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief eq: Checks if both members of the pairs are equal, one compare of the packed keys                            \
+ * @param a Pointer to the first pair                                                                                  \
+ * @param b Pointer to the second pair                                                                                 \
+ * @return True if a->first == b->first and a->second == b->second                                                     \
+ *                                                                                                                     \
+ * @note Has the prototype of the eq_fn of hashmap.h                                                                   \
+ */                                                                                                                    \
+PAIR_UNUSED PAIR_LINKAGE bool PAIR_FN(name, eq)(struct pair_##name *a, struct pair_##name *b);                         \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief hash: Hashes the packed key of the pair, equal pairs get the same hash                                       \
+ * @param self Pointer to the pair                                                                                     \
+ * @return The splitmix64 finalizer of the packed key, every bit of both members reaches every bit of it               \
+ *                                                                                                                     \
+ * @note Has the prototype of the hash_fn of hashmap.h                                                                 \
+ */                                                                                                                    \
+PAIR_UNUSED PAIR_LINKAGE uint64_t PAIR_FN(name, hash)(struct pair_##name *self);
+
+/**
+ * @def PAIR_IMPL_PACKED(K, V, name)
+ * @brief Implements pack, cmp_packed, eq and hash for a pair of integers of up to 32 bits each
+ * @param K The first type pair will hold
+ * @param V The second type pair will hold
+ * @param name The name suffix for the pair type
+ *
+ * @details
+ * cmp goes through two comparator calls and branches on each result, which mispredict on every other
+ * element when sorting or descending a tree of pairs. Here both members are packed into one 64-bit
+ * key, so a comparison is a single unsigned compare computed without branches. Only adds functions,
+ * so it goes after the IMPL macro of the type. Using it with a floating point K or V, or with one of
+ * more than 32 bits, does not compile.
+ *
+ * @code
+ * PAIR(int, unsigned short, edge, pair_noop_deinit, pair_noop_deinit)
+ * PAIR_DECL_PACKED(int, unsigned short, edge)
+ * PAIR_IMPL_PACKED(int, unsigned short, edge)
+ * // ...
+ * AVLTREE_TYPE(struct pair_edge, edges)
+ * AVLTREE_DECL(struct pair_edge, edges)
+ * AVLTREE_IMPL(struct pair_edge, edges, avltree_noop_deinit)
+ * struct avltree_edges tree = edges_init(allocator_get_default(), edge_cmp_packed);
+ * @endcode
+ *
+ * @note This macro should be used in a .c file, not in a header
+ */
+#define PAIR_IMPL_PACKED(K, V, name)                                                                                   \
+/* A negative array size stops the build for a float or a member of more than 32 bits */                               \
+typedef char PAIR_FN(name, packed_members_are_small_integers)[                                                         \
+    ((K)0.5 == (K)0 && (V)0.5 == (V)0 && sizeof(K) <= 4 && sizeof(V) <= 4) ? 1 : -1                                    \
+];                                                                                                                     \
+                                                                                                                       \
+PAIR_LINKAGE uint64_t PAIR_FN(name, pack)(const struct pair_##name *self) {                                            \
+    /* sign extended to 32 bits, flipping the sign bit then maps the signed order onto the unsigned one */             \
+    uint32_t first = (uint32_t)(int64_t)self->first ^ (PAIR_IS_SIGNED(K) ? UINT32_C(0x80000000) : 0);                  \
+    uint32_t second = (uint32_t)(int64_t)self->second ^ (PAIR_IS_SIGNED(V) ? UINT32_C(0x80000000) : 0);                \
+    return ((uint64_t)first << 32) | second;                                                                           \
+}                                                                                                                      \
+                                                                                                                       \
+PAIR_LINKAGE int PAIR_FN(name, cmp_packed)(struct pair_##name *a, struct pair_##name *b) {                             \
+    uint64_t x = PAIR_FN(name, pack)(a);                                                                               \
+    uint64_t y = PAIR_FN(name, pack)(b);                                                                               \
+    return (x > y) - (x < y);                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+PAIR_LINKAGE bool PAIR_FN(name, eq)(struct pair_##name *a, struct pair_##name *b) {                                    \
+    return PAIR_FN(name, pack)(a) == PAIR_FN(name, pack)(b);                                                           \
+}                                                                                                                      \
+                                                                                                                       \
+PAIR_LINKAGE uint64_t PAIR_FN(name, hash)(struct pair_##name *self) {                                                  \
+    uint64_t x = PAIR_FN(name, pack)(self);                                                                            \
+    x ^= x >> 30;                                                                                                      \
+    x *= UINT64_C(0xBF58476D1CE4E5B9);                                                                                 \
+    x ^= x >> 27;                                                                                                      \
+    x *= UINT64_C(0x94D049BB133111EB);                                                                                 \
+    x ^= x >> 31;                                                                                                      \
+    return x;                                                                                                          \
+}
+
 // clang-format on
 
 #ifdef __cplusplus
@@ -0,0 +1,1036 @@
+/**
+ * @file ringbuffer.h
+ * @author Jean Rehr <jeanrehr@gmail.com>
+ * @brief Generic and typesafe lock-free ring buffers using macros
+ *
+ * This header provides bounded FIFO queues to hand elements between threads, in the same
+ * TYPE/DECL/IMPL macro style as arraylist.h. The capacity is a power of two fixed at init(), the
+ * storage is one block from the struct Allocator and nothing allocates afterwards.
+ *
+ * @details
+ * The implementation provides two versions:
+ * 1. RINGBUFFER: Single producer and single consumer (SPSC), wait-free, two atomic counters
+ * 2. RINGBUFFER_MPMC: Multiple producers and multiple consumers, lock-free, a sequence number per
+ *    slot (the bounded queue of Dmitry Vyukov)
+ *
+ * Both have batch versions of push and pop, which claim a whole range of slots with one atomic
+ * operation, so moving n elements costs about as much synchronization as moving one.
+ *
+ * Regarding memory management:
+ * - The ring buffer owns its slots, elements are copied in by push and moved out by pop
+ * - Elements still queued at deinit() or clear() are given to deinit_fn
+ * - The producer and the consumer counters live on different cache lines, see RINGBUFFER_CACHE_LINE
+ *
+ * Usage example:
+ * @code
+ * RINGBUFFER(struct job, jobs, ringbuffer_noop_deinit)
+ * struct ringbuffer_jobs queue;
+ * if (jobs_init(&queue, allocator_get_default(), 1024) != RINGBUFFER_OK) { ... }
+ * // producer thread
+ * while (jobs_try_push(&queue, job) == RINGBUFFER_ERR_FULL) { ... back off ... }
+ * // consumer thread
+ * struct job out;
+ * if (jobs_try_pop(&queue, &out) == RINGBUFFER_OK) { ... }
+ * // once both threads are done
+ * jobs_deinit(&queue);
+ *
+ * RINGBUFFER_MPMC(int, tickets, ringbuffer_noop_deinit) // functions are named mpmc_tickets_*
+ * @endcode
+ *
+ * Atomics:
+ * C11 <stdatomic.h> is used when the compiler has it (C11 or newer and no __STDC_NO_ATOMICS__),
+ * otherwise the GCC/Clang __atomic builtins, which is also the path for C99 and C++ builds. At least
+ * one of them is required, see RINGBUFFER_ATOMICS_C11 and RINGBUFFER_ATOMICS_GNU.
+ *
+ * Thread safety:
+ * - RINGBUFFER: one thread may push while another pops, never two pushers or two poppers
+ * - RINGBUFFER_MPMC: any number of threads may push and pop at the same time
+ * - init(), clear() and deinit() must not run concurrently with anything else on the same buffer
+ * - size() and is_empty() are snapshots, they may be stale by the time they return
+ *
+ * Error handling:
+ * When RINGBUFFER_USE_ASSERT=1 (default 0):
+ * - Invalid operations trigger assert() and abort
+ * When RINGBUFFER_USE_ASSERT=0:
+ * - Functions return error codes
+ * A full or empty buffer is not an invalid operation, RINGBUFFER_ERR_FULL and RINGBUFFER_ERR_EMPTY
+ * are always returned.
+ *
+ * @warning Always call deinit() when done with the ring buffer
+ * @warning The struct must not be copied or moved while it is in use, threads hold its address
+ */
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <stdbool.h> // For bool, true, false
+#include <stddef.h>  // For size_t
+#include <stdint.h>  // For SIZE_MAX
+#include <string.h>  // For memset(), memcpy()
+
+#include "allocator.h" // For a custom Allocator interface
+
+/**
+ * @def RINGBUFFER_ATOMICS_C11
+ * @def RINGBUFFER_ATOMICS_GNU
+ * @brief Which atomics the lock-free code is built on, exactly one of them gets defined
+ *
+ * Define RINGBUFFER_ATOMICS_GNU before including the header to skip <stdatomic.h> on a C11 compiler.
+ */
+#if !defined(RINGBUFFER_ATOMICS_GNU) && !defined(__cplusplus) && defined(__STDC_VERSION__)                             \
+    && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+    #include <stdatomic.h> // For atomic_load_explicit(), atomic_store_explicit()...
+    #define RINGBUFFER_ATOMICS_C11
+#elif defined(__GNUC__) || defined(__clang__)
+    #ifndef RINGBUFFER_ATOMICS_GNU
+        #define RINGBUFFER_ATOMICS_GNU
+    #endif // RINGBUFFER_ATOMICS_GNU
+#else
+    #error "ringbuffer.h needs C11 atomics or the GCC/Clang __atomic builtins"
+#endif // atomics detection
+
+#ifdef __cplusplus
+extern "C" {
+#endif // extern "C"
+
+/**
+ * @def RINGBUFFER_ATOMIC
+ * @def RINGBUFFER_LOAD
+ * @def RINGBUFFER_STORE
+ * @def RINGBUFFER_CAS_WEAK
+ * @brief Atomic counter type and the few operations the ring buffers need
+ *
+ * RINGBUFFER_CAS_WEAK(ptr, expected_ptr, desired) is relaxed and may fail spuriously, the slots are
+ * published with the acquire and release orders of the loads and stores.
+ */
+#ifdef RINGBUFFER_ATOMICS_C11
+    #define RINGBUFFER_ATOMIC(T) _Atomic(T)
+    #define RINGBUFFER_RELAXED memory_order_relaxed
+    #define RINGBUFFER_ACQUIRE memory_order_acquire
+    #define RINGBUFFER_RELEASE memory_order_release
+    #define RINGBUFFER_LOAD(ptr, order) atomic_load_explicit((ptr), (order))
+    #define RINGBUFFER_STORE(ptr, value, order) atomic_store_explicit((ptr), (value), (order))
+    #define RINGBUFFER_CAS_WEAK(ptr, expected_ptr, desired)                                                            \
+        atomic_compare_exchange_weak_explicit((ptr), (expected_ptr), (desired), memory_order_relaxed,                  \
+                                              memory_order_relaxed)
+#else
+    #define RINGBUFFER_ATOMIC(T) T
+    #define RINGBUFFER_RELAXED __ATOMIC_RELAXED
+    #define RINGBUFFER_ACQUIRE __ATOMIC_ACQUIRE
+    #define RINGBUFFER_RELEASE __ATOMIC_RELEASE
+    #define RINGBUFFER_LOAD(ptr, order) __atomic_load_n((ptr), (order))
+    #define RINGBUFFER_STORE(ptr, value, order) __atomic_store_n((ptr), (value), (order))
+    #define RINGBUFFER_CAS_WEAK(ptr, expected_ptr, desired)                                                            \
+        __atomic_compare_exchange_n((ptr), (expected_ptr), (desired), true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#endif // RINGBUFFER_ATOMICS_C11
+
+/**
+ * @def __has_c_attribute
+ * @brief Fallback macros for C compilers that do not support the testing for features
+ */
+#ifndef __has_c_attribute
+    #define __has_c_attribute(x) 0
+#endif // __has_c_attribute
+
+/**
+ * @def __has_cpp_attribute
+ * @brief Fallback macros for C++ compilers that do not support the testing for features
+ */
+#ifndef __has_cpp_attribute
+    #define __has_cpp_attribute(x) 0
+#endif // __has_cpp_attribute
+
+/**
+ * @def RINGBUFFER_USE_BRACKET_ATTR
+ * @brief This checks for the Standard [[]] support (C23+ or C++11+)
+ * @details Mainly used because, if compiling with pedantic or Wall, then warnings will be issued if syntax [[]]
+ *          attribute is supported on pre C23 but still used, [[]] will be considered compiler extension and
+ *          not Standard C compliant.
+ */
+#if (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 202311L) || (defined(__cplusplus) && __cplusplus >= 201103L)
+    #define RINGBUFFER_USE_BRACKET_ATTR 1
+#else
+    #define RINGBUFFER_USE_BRACKET_ATTR 0
+#endif // RINGBUFFER_USE_BRACKET_ATTR
+
+/**
+ * @def ringbuffer_noop_deinit
+ * @brief Defines a no-op destructor macro for usage in scalar types or types
+ *        that does not need a destructor
+ */
+#ifndef ringbuffer_noop_deinit
+    #define ringbuffer_noop_deinit(ptr, alloc) ((void)0)
+#endif // ringbuffer_noop_deinit
+
+/**
+ * @def RINGBUFFER_LINKAGE
+ * @brief Defines a macro to switch between static inline or another type of linkage before
+ *        including the header, works the same way as ARRAYLIST_LINKAGE
+ */
+#ifndef RINGBUFFER_LINKAGE
+    #define RINGBUFFER_LINKAGE static inline
+#endif // RINGBUFFER_LINKAGE
+
+/**
+ * @def RINGBUFFER_UNUSED
+ * @brief Defines a macro to supress the warning for unused function because of static inline
+ */
+#if RINGBUFFER_USE_BRACKET_ATTR && (__has_c_attribute(maybe_unused) || __has_cpp_attribute(maybe_unused))
+    // C23+ or C++17+
+    #define RINGBUFFER_UNUSED [[maybe_unused]]
+#elif defined(__GNUC__) || defined(__clang__)
+    // Legacy GCC or Clang compilers
+    #define RINGBUFFER_UNUSED __attribute__((unused))
+#else
+    #define RINGBUFFER_UNUSED
+#endif // RINGBUFFER_UNUSED definition
+
+/**
+ * @def RINGBUFFER_HINT_UNLIKELY
+ * @def RINGBUFFER_NOT_EXPECT
+ * @brief Branch prediction hint, used in the RINGBUFFER_ENSURE macro, as it usually
+ *        just always passes
+ */
+#if RINGBUFFER_USE_BRACKET_ATTR && (__has_c_attribute(unlikely) || __has_cpp_attribute(unlikely))
+    // C23+ or C++17+
+    #define RINGBUFFER_HINT_UNLIKELY [[unlikely]]
+    #define RINGBUFFER_NOT_EXPECT(x) (x)
+#elif defined(__GNUC__) || defined(__clang__)
+    // Legacy GCC or Clang compilers
+    #define RINGBUFFER_HINT_UNLIKELY
+    #define RINGBUFFER_NOT_EXPECT(x) __builtin_expect(!!(x), 0)
+#else
+    #define RINGBUFFER_HINT_UNLIKELY
+    #define RINGBUFFER_NOT_EXPECT(x) (x)
+#endif // RINGBUFFER_NOT_EXPECT definition
+
+/**
+ * @def RINGBUFFER_USE_ASSERT
+ * @brief Defines if the ring buffer will use asserts or return error codes
+ * @details If RINGBUFFER_USE_ASSERT is 1, then the lib will assert and fail early, otherwise,
+ *          defensive programming and returning error codes will be used
+ */
+#ifndef RINGBUFFER_USE_ASSERT
+    #define RINGBUFFER_USE_ASSERT 0
+#endif // RINGBUFFER_USE_ASSERT
+
+#if RINGBUFFER_USE_ASSERT
+    #include <assert.h> // For assert()
+    #include <stdlib.h> // For abort()
+    #define RINGBUFFER_ENSURE(cond, ret, msg)                                                                          \
+        do {                                                                                                           \
+            if (RINGBUFFER_NOT_EXPECT(!(cond))) RINGBUFFER_HINT_UNLIKELY {                                             \
+                assert(0 && (msg));                                                                                    \
+                abort();                                                                                               \
+            }                                                                                                          \
+        } while (0)
+#else
+    #define RINGBUFFER_ENSURE(cond, ret, msg)                                                                          \
+        do {                                                                                                           \
+            if (RINGBUFFER_NOT_EXPECT(!(cond))) RINGBUFFER_HINT_UNLIKELY {                                             \
+                return (ret);                                                                                          \
+            }                                                                                                          \
+        } while (0)
+#endif // RINGBUFFER_USE_ASSERT if directive
+
+/**
+ * @def RINGBUFFER_CAST
+ * @brief Defines a macro that either casts type T to T* or does nothing
+ * @details
+ * If __cplusplus is defined (compiled with a c++ compiler) then it will cast the results of malloc,
+ * if compiled with a C compiler, then it does nothing
+ */
+#ifdef __cplusplus
+    #define RINGBUFFER_CAST(T) (T *)
+#else
+    #define RINGBUFFER_CAST(T)
+#endif // RINGBUFFER_CAST(T)
+
+/**
+ * @def RINGBUFFER_CACHE_LINE
+ * @brief Size of the padding put between the producer and the consumer counters
+ * @details Whole lines of padding go around each group instead of aligning the struct, so the
+ *          counters never share a line no matter where the struct is placed. 128 suits the CPUs
+ *          that prefetch lines in pairs.
+ */
+#ifndef RINGBUFFER_CACHE_LINE
+    #define RINGBUFFER_CACHE_LINE 64
+#endif // RINGBUFFER_CACHE_LINE
+
+/**
+ * @enum ringbuffer_error
+ * @brief Error codes for the ring buffers
+ */
+enum ringbuffer_error {
+    RINGBUFFER_OK = 0,            ///< No error
+    RINGBUFFER_ERR_NULL = -1,     ///< Null pointer
+    RINGBUFFER_ERR_CAPACITY = -2, ///< Capacity is not a power of two of at least 2, or too big
+    RINGBUFFER_ERR_ALLOC = -3,    ///< Allocation failure
+    RINGBUFFER_ERR_FULL = -4,     ///< No free slot to push into
+    RINGBUFFER_ERR_EMPTY = -5,    ///< No element to pop
+};
+
+/**
+ * @brief Checks a capacity given to init(), a power of two of at least 2 whose slots fit in size_t
+ */
+static inline bool ringbuffer_valid_capacity(size_t capacity, size_t slot_size) {
+    return capacity >= 2 && (capacity & (capacity - 1)) == 0 && capacity <= SIZE_MAX / slot_size;
+}
+
+// clang-format off
+
+/* ====== RINGBUFFER Single producer single consumer version START ====== */
+
+/**
+ * @def RINGBUFFER_USE_PREFIX
+ * @brief Defines at compile-time if the functions will use the ringbuffer_* prefix
+ * @details Same as ARRAYLIST_USE_PREFIX, generates ringbuffer_##name##_function() and
+ *          ringbuffer_mpmc_##name##_function() instead of name##_function() and
+ *          mpmc_##name##_function()
+ *
+ * @warning The @c RINGBUFFER_FN and @c RINGBUFFER_FN_MPMC macros are for intenal use only
+ */
+#ifdef RINGBUFFER_USE_PREFIX
+    #define RINGBUFFER_FN(name, func) ringbuffer_##name##_##func
+    #define RINGBUFFER_FN_MPMC(name, func) ringbuffer_mpmc_##name##_##func
+#else
+    #define RINGBUFFER_FN(name, func) name##_##func
+    #define RINGBUFFER_FN_MPMC(name, func) mpmc_##name##_##func
+#endif
+
+/**
+ * @def RINGBUFFER_TYPE(T, name)
+ * @brief Defines a single producer single consumer ring buffer structure for a specific type T
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ *
+ * This macro defines a struct named "ringbuffer_##name" with the following fields:
+ * - "data": Pointer to the capacity slots
+ * - "mask": capacity - 1, positions are reduced to slots with it
+ * - "alloc": Allocator of the slots
+ * - "head": Position of the next element to pop, written by the consumer
+ * - "cached_tail": Last tail seen by the consumer, saves loads of the producer line
+ * - "tail": Position of the next free slot, written by the producer
+ * - "cached_head": Last head seen by the producer
+ *
+ * Positions only grow, the element count is tail - head, which stays right when they wrap around.
+ */
+#define RINGBUFFER_TYPE(T, name)                                                                                       \
+struct ringbuffer_##name {                                                                                             \
+    T *data;                                                                                                           \
+    size_t mask;                                                                                                       \
+    struct Allocator alloc;                                                                                            \
+    char pad_shared[RINGBUFFER_CACHE_LINE];                                                                            \
+    RINGBUFFER_ATOMIC(size_t) head;                                                                                    \
+    size_t cached_tail;                                                                                                \
+    char pad_head[RINGBUFFER_CACHE_LINE];                                                                              \
+    RINGBUFFER_ATOMIC(size_t) tail;                                                                                    \
+    size_t cached_head;                                                                                                \
+    char pad_tail[RINGBUFFER_CACHE_LINE];                                                                              \
+};
+
+/**
+ * @def RINGBUFFER_DECL(T, name)
+ * @brief Declares all functions for a single producer single consumer ring buffer type
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ *
+ * @details
+ * The following functions are declared:
+ * Construction / Destruction
+ * - enum ringbuffer_error RINGBUFFER_FN(name, init)(struct ringbuffer_##name *self, const struct Allocator alloc, const size_t capacity);
+ * - void RINGBUFFER_FN(name, clear)(struct ringbuffer_##name *self);
+ * - void RINGBUFFER_FN(name, deinit)(struct ringbuffer_##name *self);
+ *
+ * Producer
+ * - enum ringbuffer_error RINGBUFFER_FN(name, try_push)(struct ringbuffer_##name *self, T value);
+ * - size_t RINGBUFFER_FN(name, push_n)(struct ringbuffer_##name *self, const T *src, const size_t n);
+ *
+ * Consumer
+ * - enum ringbuffer_error RINGBUFFER_FN(name, try_pop)(struct ringbuffer_##name *self, T *out);
+ * - size_t RINGBUFFER_FN(name, pop_n)(struct ringbuffer_##name *self, T *dst, const size_t n);
+ *
+ * Capacity
+ * - size_t RINGBUFFER_FN(name, size)(const struct ringbuffer_##name *self);
+ * - bool RINGBUFFER_FN(name, is_empty)(const struct ringbuffer_##name *self);
+ * - size_t RINGBUFFER_FN(name, capacity)(const struct ringbuffer_##name *self);
+ */
+#define RINGBUFFER_DECL(T, name)                                                                                       \
+/**                                                                                                                    \
+ * @brief init: Allocates the slots of a ring buffer                                                                   \
+ * @param self Pointer to the ring buffer, its previous content is overwritten                                         \
+ * @param alloc Custom allocator instance                                                                              \
+ * @param capacity Number of slots, a power of two of at least 2                                                       \
+ * @return RINGBUFFER_OK, RINGBUFFER_ERR_NULL if self is null, RINGBUFFER_ERR_CAPACITY on a bad                        \
+ *         capacity or RINGBUFFER_ERR_ALLOC, self is then zeroed out                                                   \
+ *                                                                                                                     \
+ * @warning Call name##_deinit() when done.                                                                            \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN(name, init)(                                  \
+    struct ringbuffer_##name *self,                                                                                    \
+    const struct Allocator alloc,                                                                                      \
+    const size_t capacity                                                                                              \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief try_push: Copies value into the next free slot, producer only                                                \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param value The value to push                                                                                      \
+ * @return RINGBUFFER_OK, RINGBUFFER_ERR_FULL if there is no free slot, or RINGBUFFER_ERR_NULL                         \
+ *                                                                                                                     \
+ * @note On RINGBUFFER_ERR_FULL the value is not taken, the caller still owns it                                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN(name, try_push)(                              \
+    struct ringbuffer_##name *self,                                                                                    \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief push_n: Copies as many of the n elements of src as there are free slots, producer only                       \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param src Elements to push, in order                                                                               \
+ * @param n Number of elements in src                                                                                  \
+ * @return How many elements were pushed, the first ones of src, 0 if self or src is null                              \
+ *                                                                                                                     \
+ * @note The consumer sees the whole batch at once, with a single release store                                        \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, push_n)(                                               \
+    struct ringbuffer_##name *self,                                                                                    \
+    const T *src,                                                                                                      \
+    const size_t n                                                                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief try_pop: Moves the oldest element into out, consumer only                                                    \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param out Where the element is moved to, the caller owns it afterwards                                             \
+ * @return RINGBUFFER_OK, RINGBUFFER_ERR_EMPTY if there is nothing queued, or RINGBUFFER_ERR_NULL                      \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN(name, try_pop)(                               \
+    struct ringbuffer_##name *self,                                                                                    \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief pop_n: Moves up to n of the oldest elements into dst, consumer only                                          \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param dst Room for n elements                                                                                      \
+ * @param n Maximum number of elements to pop                                                                          \
+ * @return How many elements were popped, 0 if self or dst is null                                                     \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, pop_n)(                                                \
+    struct ringbuffer_##name *self,                                                                                    \
+    T *dst,                                                                                                            \
+    const size_t n                                                                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief size: Gets the number of queued elements                                                                     \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @return The size or 0 if self is null                                                                               \
+ *                                                                                                                     \
+ * @note Exact for the producer and the consumer themselves, a snapshot for any other thread                           \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, size)(const struct ringbuffer_##name *self);           \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief is_empty: Checks if the ring buffer is empty                                                                 \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @return True if size == 0, false if self is null or there are queued elements                                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE bool RINGBUFFER_FN(name, is_empty)(const struct ringbuffer_##name *self);         \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief capacity: Gets the number of slots                                                                           \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @return The capacity or 0 if self is null                                                                           \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, capacity)(const struct ringbuffer_##name *self);       \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief clear: Destroys every queued element, the slots are kept                                                     \
+ * @param self Pointer to the ring buffer                                                                              \
+ *                                                                                                                     \
+ * @warning Neither the producer nor the consumer may be running                                                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE void RINGBUFFER_FN(name, clear)(struct ringbuffer_##name *self);                  \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief deinit: Destroys the queued elements and frees the slots                                                     \
+ * @param self Pointer to the ring buffer to deinit                                                                    \
+ *                                                                                                                     \
+ * Safe to call on NULL or already deinitialized ring buffers, returns early                                           \
+ *                                                                                                                     \
+ * @note The self parameter will be left zeroed out, to reuse it init() it again                                       \
+ * @warning Neither the producer nor the consumer may be running                                                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE void RINGBUFFER_FN(name, deinit)(struct ringbuffer_##name *self);
+
+/**
+ * @def RINGBUFFER_IMPL(T, name, deinit_fn)
+ * @brief Implements all functions for a single producer single consumer ring buffer type
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ * @param deinit_fn Destructor (may be a macro or a normal function) for the elements still queued
+ *                  at clear() and deinit(), with the prototype:
+ *                  void deinit_fn(T *elem, struct Allocator *alloc);
+ *
+ * @details
+ * The producer only writes tail and the consumer only writes head, each of them keeps a cached
+ * copy of the other counter and only reloads it when the cached value says full or empty, so most
+ * operations touch no cache line that the other side writes.
+ *
+ * @note This macro should be used in a .c file, not in a header
+ */
+#define RINGBUFFER_IMPL(T, name, deinit_fn)                                                                            \
+RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN(name, init)(                                                    \
+    struct ringbuffer_##name *self,                                                                                    \
+    const struct Allocator alloc,                                                                                      \
+    const size_t capacity                                                                                              \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL, RINGBUFFER_ERR_NULL, "init(): ring buffer is null.");                              \
+    memset(self, 0, sizeof(*self));                                                                                    \
+    RINGBUFFER_ENSURE(ringbuffer_valid_capacity(capacity, sizeof(T)), RINGBUFFER_ERR_CAPACITY,                         \
+                      "init(): capacity must be a power of two of at least 2.");                                       \
+    T *data = RINGBUFFER_CAST(T)alloc.malloc(capacity * sizeof(T), alloc.ctx);                                         \
+    RINGBUFFER_ENSURE(data != NULL, RINGBUFFER_ERR_ALLOC, "init(): error during allocation.");                         \
+    self->data = data;                                                                                                 \
+    self->mask = capacity - 1;                                                                                         \
+    self->alloc = alloc;                                                                                               \
+    RINGBUFFER_STORE(&self->head, (size_t)0, RINGBUFFER_RELAXED);                                                      \
+    RINGBUFFER_STORE(&self->tail, (size_t)0, RINGBUFFER_RELAXED);                                                      \
+    return RINGBUFFER_OK;                                                                                              \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN(name, try_push)(struct ringbuffer_##name *self, T value) {      \
+    RINGBUFFER_ENSURE(self != NULL, RINGBUFFER_ERR_NULL, "try_push(): ring buffer is null.");                          \
+    size_t tail = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_RELAXED);                                                    \
+    if (tail - self->cached_head > self->mask) {                                                                       \
+        self->cached_head = RINGBUFFER_LOAD(&self->head, RINGBUFFER_ACQUIRE);                                          \
+        if (tail - self->cached_head > self->mask) {                                                                   \
+            return RINGBUFFER_ERR_FULL;                                                                                \
+        }                                                                                                              \
+    }                                                                                                                  \
+    self->data[tail & self->mask] = value;                                                                             \
+    RINGBUFFER_STORE(&self->tail, tail + 1, RINGBUFFER_RELEASE);                                                       \
+    return RINGBUFFER_OK;                                                                                              \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, push_n)(                                                                 \
+    struct ringbuffer_##name *self,                                                                                    \
+    const T *src,                                                                                                      \
+    const size_t n                                                                                                     \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL && src != NULL, 0, "push_n(): ring buffer or src is null.");                        \
+    size_t tail = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_RELAXED);                                                    \
+    size_t free_slots = self->mask + 1 - (tail - self->cached_head);                                                   \
+    if (free_slots < n) {                                                                                              \
+        self->cached_head = RINGBUFFER_LOAD(&self->head, RINGBUFFER_ACQUIRE);                                          \
+        free_slots = self->mask + 1 - (tail - self->cached_head);                                                      \
+    }                                                                                                                  \
+    size_t count = n < free_slots ? n : free_slots;                                                                    \
+    for (size_t i = 0; i < count; ++i) {                                                                               \
+        memcpy(&self->data[(tail + i) & self->mask], &src[i], sizeof(T));                                              \
+    }                                                                                                                  \
+    if (count > 0) {                                                                                                   \
+        RINGBUFFER_STORE(&self->tail, tail + count, RINGBUFFER_RELEASE);                                               \
+    }                                                                                                                  \
+    return count;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN(name, try_pop)(struct ringbuffer_##name *self, T *out) {        \
+    RINGBUFFER_ENSURE(self != NULL && out != NULL, RINGBUFFER_ERR_NULL, "try_pop(): ring buffer or out is null.");     \
+    size_t head = RINGBUFFER_LOAD(&self->head, RINGBUFFER_RELAXED);                                                    \
+    if (head == self->cached_tail) {                                                                                   \
+        self->cached_tail = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_ACQUIRE);                                          \
+        if (head == self->cached_tail) {                                                                               \
+            return RINGBUFFER_ERR_EMPTY;                                                                               \
+        }                                                                                                              \
+    }                                                                                                                  \
+    *out = self->data[head & self->mask];                                                                              \
+    RINGBUFFER_STORE(&self->head, head + 1, RINGBUFFER_RELEASE);                                                       \
+    return RINGBUFFER_OK;                                                                                              \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, pop_n)(struct ringbuffer_##name *self, T *dst, const size_t n) {         \
+    RINGBUFFER_ENSURE(self != NULL && dst != NULL, 0, "pop_n(): ring buffer or dst is null.");                         \
+    size_t head = RINGBUFFER_LOAD(&self->head, RINGBUFFER_RELAXED);                                                    \
+    size_t queued = self->cached_tail - head;                                                                          \
+    if (queued < n) {                                                                                                  \
+        self->cached_tail = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_ACQUIRE);                                          \
+        queued = self->cached_tail - head;                                                                             \
+    }                                                                                                                  \
+    size_t count = n < queued ? n : queued;                                                                            \
+    for (size_t i = 0; i < count; ++i) {                                                                               \
+        dst[i] = self->data[(head + i) & self->mask];                                                                  \
+    }                                                                                                                  \
+    if (count > 0) {                                                                                                   \
+        RINGBUFFER_STORE(&self->head, head + count, RINGBUFFER_RELEASE);                                               \
+    }                                                                                                                  \
+    return count;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, size)(const struct ringbuffer_##name *self) {                            \
+    RINGBUFFER_ENSURE(self != NULL, 0, "size(): ring buffer is null.");                                                \
+    /* The casts drop the const, C11 atomic loads of const objects are not allowed before C17 */                       \
+    size_t head = RINGBUFFER_LOAD((RINGBUFFER_ATOMIC(size_t) *)&self->head, RINGBUFFER_ACQUIRE);                       \
+    size_t tail = RINGBUFFER_LOAD((RINGBUFFER_ATOMIC(size_t) *)&self->tail, RINGBUFFER_ACQUIRE);                       \
+    size_t size = tail - head;                                                                                         \
+    /* head read first, a pop in between can only make the difference smaller than the truth */                        \
+    return size > self->mask + 1 ? self->mask + 1 : size;                                                              \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE bool RINGBUFFER_FN(name, is_empty)(const struct ringbuffer_##name *self) {                          \
+    RINGBUFFER_ENSURE(self != NULL, false, "is_empty(): ring buffer is null.");                                        \
+    return RINGBUFFER_FN(name, size)(self) == 0;                                                                       \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN(name, capacity)(const struct ringbuffer_##name *self) {                        \
+    RINGBUFFER_ENSURE(self != NULL, 0, "capacity(): ring buffer is null.");                                            \
+    return self->data != NULL ? self->mask + 1 : 0;                                                                    \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE void RINGBUFFER_FN(name, clear)(struct ringbuffer_##name *self) {                                   \
+    if (!self || !self->data) {                                                                                        \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    size_t head = RINGBUFFER_LOAD(&self->head, RINGBUFFER_ACQUIRE);                                                    \
+    size_t tail = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_ACQUIRE);                                                    \
+    for (size_t i = head; i != tail; ++i) {                                                                            \
+        deinit_fn(&self->data[i & self->mask], &self->alloc);                                                          \
+    }                                                                                                                  \
+    RINGBUFFER_STORE(&self->head, tail, RINGBUFFER_RELAXED);                                                           \
+    self->cached_tail = tail;                                                                                          \
+    self->cached_head = tail;                                                                                          \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE void RINGBUFFER_FN(name, deinit)(struct ringbuffer_##name *self) {                                  \
+    if (!self || !self->data) {                                                                                        \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    RINGBUFFER_FN(name, clear)(self);                                                                                  \
+    self->alloc.free(self->data, (self->mask + 1) * sizeof(T), self->alloc.ctx);                                       \
+    memset(self, 0, sizeof(*self));                                                                                    \
+}
+
+/**
+ * @def RINGBUFFER(T, name, deinit_fn)
+ * @brief Helper macro to define the struct, the declarations and the implementations of a single
+ *        producer single consumer ring buffer type
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ * @param deinit_fn Destructor of the elements, ringbuffer_noop_deinit if there is nothing to free
+ */
+#define RINGBUFFER(T, name, deinit_fn)                                                                                 \
+RINGBUFFER_TYPE(T, name)                                                                                               \
+RINGBUFFER_DECL(T, name)                                                                                               \
+RINGBUFFER_IMPL(T, name, deinit_fn)
+
+/* ====== RINGBUFFER_MPMC Multiple producers multiple consumers version START ====== */
+
+/**
+ * @def RINGBUFFER_TYPE_MPMC(T, name)
+ * @brief Defines a multiple producers multiple consumers ring buffer structure for a specific type T
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ *
+ * This macro defines a struct named "ringbuffer_mpmc_slot_##name" with the following fields:
+ * - "seq": position + 1 once the slot holds the element of position, position during the lap it
+ *          is free for
+ * - "value": The element
+ *
+ * And a struct named "ringbuffer_mpmc_##name" with the following fields:
+ * - "slots": Pointer to the capacity slots
+ * - "mask": capacity - 1
+ * - "alloc": Allocator of the slots
+ * - "tail": Next position to push to, claimed by the producers with a compare and swap
+ * - "head": Next position to pop from, claimed by the consumers with a compare and swap
+ */
+#define RINGBUFFER_TYPE_MPMC(T, name)                                                                                  \
+struct ringbuffer_mpmc_slot_##name {                                                                                   \
+    RINGBUFFER_ATOMIC(size_t) seq;                                                                                     \
+    T value;                                                                                                           \
+};                                                                                                                     \
+                                                                                                                       \
+struct ringbuffer_mpmc_##name {                                                                                        \
+    struct ringbuffer_mpmc_slot_##name *slots;                                                                         \
+    size_t mask;                                                                                                       \
+    struct Allocator alloc;                                                                                            \
+    char pad_shared[RINGBUFFER_CACHE_LINE];                                                                            \
+    RINGBUFFER_ATOMIC(size_t) tail;                                                                                    \
+    char pad_tail[RINGBUFFER_CACHE_LINE];                                                                              \
+    RINGBUFFER_ATOMIC(size_t) head;                                                                                    \
+    char pad_head[RINGBUFFER_CACHE_LINE];                                                                              \
+};
+
+/**
+ * @def RINGBUFFER_DECL_MPMC(T, name)
+ * @brief Declares all functions for a multiple producers multiple consumers ring buffer type
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ *
+ * @details
+ * The same functions as RINGBUFFER_DECL, named with RINGBUFFER_FN_MPMC and taking a
+ * struct ringbuffer_mpmc_##name, every thread may push and pop:
+ * - enum ringbuffer_error RINGBUFFER_FN_MPMC(name, init)(struct ringbuffer_mpmc_##name *self, const struct Allocator alloc, const size_t capacity);
+ * - void RINGBUFFER_FN_MPMC(name, clear)(struct ringbuffer_mpmc_##name *self);
+ * - void RINGBUFFER_FN_MPMC(name, deinit)(struct ringbuffer_mpmc_##name *self);
+ * - enum ringbuffer_error RINGBUFFER_FN_MPMC(name, try_push)(struct ringbuffer_mpmc_##name *self, T value);
+ * - size_t RINGBUFFER_FN_MPMC(name, push_n)(struct ringbuffer_mpmc_##name *self, const T *src, const size_t n);
+ * - enum ringbuffer_error RINGBUFFER_FN_MPMC(name, try_pop)(struct ringbuffer_mpmc_##name *self, T *out);
+ * - size_t RINGBUFFER_FN_MPMC(name, pop_n)(struct ringbuffer_mpmc_##name *self, T *dst, const size_t n);
+ * - size_t RINGBUFFER_FN_MPMC(name, size)(const struct ringbuffer_mpmc_##name *self);
+ * - bool RINGBUFFER_FN_MPMC(name, is_empty)(const struct ringbuffer_mpmc_##name *self);
+ * - size_t RINGBUFFER_FN_MPMC(name, capacity)(const struct ringbuffer_mpmc_##name *self);
+ */
+#define RINGBUFFER_DECL_MPMC(T, name)                                                                                  \
+/**                                                                                                                    \
+ * @brief init: Allocates the slots of a ring buffer                                                                   \
+ * @param self Pointer to the ring buffer, its previous content is overwritten                                         \
+ * @param alloc Custom allocator instance                                                                              \
+ * @param capacity Number of slots, a power of two of at least 2                                                       \
+ * @return RINGBUFFER_OK, RINGBUFFER_ERR_NULL if self is null, RINGBUFFER_ERR_CAPACITY on a bad                        \
+ *         capacity or RINGBUFFER_ERR_ALLOC, self is then zeroed out                                                   \
+ *                                                                                                                     \
+ * @warning Call mpmc_##name##_deinit() when done.                                                                     \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN_MPMC(name, init)(                             \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    const struct Allocator alloc,                                                                                      \
+    const size_t capacity                                                                                              \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief try_push: Copies value into the next free slot                                                               \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param value The value to push                                                                                      \
+ * @return RINGBUFFER_OK, RINGBUFFER_ERR_FULL if there is no free slot, or RINGBUFFER_ERR_NULL                         \
+ *                                                                                                                     \
+ * @note On RINGBUFFER_ERR_FULL the value is not taken, the caller still owns it. A slot whose                         \
+ *       consumer claimed it but did not finish reading yet also counts as full                                        \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN_MPMC(name, try_push)(                         \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    T value                                                                                                            \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief push_n: Copies as many of the n elements of src as there are free slots                                      \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param src Elements to push, in order                                                                               \
+ * @param n Number of elements in src                                                                                  \
+ * @return How many elements were pushed, the first ones of src, 0 if self or src is null                              \
+ *                                                                                                                     \
+ * @note The slots are claimed with a single compare and swap, so a batch is never interleaved                         \
+ *       with the elements of other producers                                                                          \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, push_n)(                                          \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    const T *src,                                                                                                      \
+    const size_t n                                                                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief try_pop: Moves the oldest element into out                                                                   \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param out Where the element is moved to, the caller owns it afterwards                                             \
+ * @return RINGBUFFER_OK, RINGBUFFER_ERR_EMPTY if there is nothing to pop, or RINGBUFFER_ERR_NULL                      \
+ *                                                                                                                     \
+ * @note A slot whose producer claimed it but did not finish writing yet also counts as empty                          \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN_MPMC(name, try_pop)(                          \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    T *out                                                                                                             \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief pop_n: Moves up to n of the oldest elements into dst                                                         \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @param dst Room for n elements                                                                                      \
+ * @param n Maximum number of elements to pop                                                                          \
+ * @return How many elements were popped, 0 if self or dst is null                                                     \
+ *                                                                                                                     \
+ * @note The slots are claimed with a single compare and swap, the batch is consecutive elements                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, pop_n)(                                           \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    T *dst,                                                                                                            \
+    const size_t n                                                                                                     \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief size: Gets the number of claimed and not yet popped positions                                                \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @return A snapshot of the size clamped to [0, capacity], or 0 if self is null                                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, size)(const struct ringbuffer_mpmc_##name *self); \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief is_empty: Checks if the ring buffer is empty                                                                 \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @return True if size == 0, false if self is null or there are queued elements                                       \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE bool RINGBUFFER_FN_MPMC(name, is_empty)(                                          \
+    const struct ringbuffer_mpmc_##name *self                                                                          \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief capacity: Gets the number of slots                                                                           \
+ * @param self Pointer to the ring buffer                                                                              \
+ * @return The capacity or 0 if self is null                                                                           \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, capacity)(                                        \
+    const struct ringbuffer_mpmc_##name *self                                                                          \
+);                                                                                                                     \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief clear: Destroys every queued element, the slots are kept                                                     \
+ * @param self Pointer to the ring buffer                                                                              \
+ *                                                                                                                     \
+ * @warning No other thread may be using the ring buffer                                                               \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE void RINGBUFFER_FN_MPMC(name, clear)(struct ringbuffer_mpmc_##name *self);        \
+                                                                                                                       \
+/**                                                                                                                    \
+ * @brief deinit: Destroys the queued elements and frees the slots                                                     \
+ * @param self Pointer to the ring buffer to deinit                                                                    \
+ *                                                                                                                     \
+ * Safe to call on NULL or already deinitialized ring buffers, returns early                                           \
+ *                                                                                                                     \
+ * @note The self parameter will be left zeroed out, to reuse it init() it again                                       \
+ * @warning No other thread may be using the ring buffer                                                               \
+ */                                                                                                                    \
+RINGBUFFER_UNUSED RINGBUFFER_LINKAGE void RINGBUFFER_FN_MPMC(name, deinit)(struct ringbuffer_mpmc_##name *self);
+
+/**
+ * @def RINGBUFFER_IMPL_MPMC(T, name, deinit_fn)
+ * @brief Implements all functions for a multiple producers multiple consumers ring buffer type
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ * @param deinit_fn Destructor (may be a macro or a normal function) for the elements still queued
+ *                  at clear() and deinit(), with the prototype:
+ *                  void deinit_fn(T *elem, struct Allocator *alloc);
+ *
+ * @details
+ * A producer claims position p by moving tail from p to p + 1 with a compare and swap, but only
+ * once the seq of its slot says the slot is free for the lap of p (seq == p). It then writes the
+ * value and publishes it with seq = p + 1. A consumer does the mirror image, it waits for
+ * seq == p + 1, moves head and hands the slot to the next lap with seq = p + capacity.
+ * The batch versions check the seq of every slot of the range before the compare and swap, the
+ * range is claimed whole or shortened to the slots that are ready.
+ *
+ * @note This macro should be used in a .c file, not in a header
+ */
+#define RINGBUFFER_IMPL_MPMC(T, name, deinit_fn)                                                                       \
+RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN_MPMC(name, init)(                                               \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    const struct Allocator alloc,                                                                                      \
+    const size_t capacity                                                                                              \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL, RINGBUFFER_ERR_NULL, "init(): ring buffer is null.");                              \
+    memset(self, 0, sizeof(*self));                                                                                    \
+    RINGBUFFER_ENSURE(ringbuffer_valid_capacity(capacity, sizeof(struct ringbuffer_mpmc_slot_##name)),                 \
+                      RINGBUFFER_ERR_CAPACITY, "init(): capacity must be a power of two of at least 2.");              \
+    struct ringbuffer_mpmc_slot_##name *slots = RINGBUFFER_CAST(struct ringbuffer_mpmc_slot_##name)alloc.malloc(       \
+        capacity * sizeof(struct ringbuffer_mpmc_slot_##name), alloc.ctx                                               \
+    );                                                                                                                 \
+    RINGBUFFER_ENSURE(slots != NULL, RINGBUFFER_ERR_ALLOC, "init(): error during allocation.");                        \
+    for (size_t i = 0; i < capacity; ++i) {                                                                            \
+        RINGBUFFER_STORE(&slots[i].seq, i, RINGBUFFER_RELAXED);                                                        \
+    }                                                                                                                  \
+    self->slots = slots;                                                                                               \
+    self->mask = capacity - 1;                                                                                         \
+    self->alloc = alloc;                                                                                               \
+    RINGBUFFER_STORE(&self->tail, (size_t)0, RINGBUFFER_RELAXED);                                                      \
+    RINGBUFFER_STORE(&self->head, (size_t)0, RINGBUFFER_RELAXED);                                                      \
+    return RINGBUFFER_OK;                                                                                              \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN_MPMC(name, try_push)(                                           \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    T value                                                                                                            \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL, RINGBUFFER_ERR_NULL, "try_push(): ring buffer is null.");                          \
+    size_t pos = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_RELAXED);                                                     \
+    for (;;) {                                                                                                         \
+        struct ringbuffer_mpmc_slot_##name *slot = &self->slots[pos & self->mask];                                     \
+        size_t seq = RINGBUFFER_LOAD(&slot->seq, RINGBUFFER_ACQUIRE);                                                  \
+        if (seq == pos) {                                                                                              \
+            /* On failure pos is reloaded with the tail another producer moved */                                      \
+            if (RINGBUFFER_CAS_WEAK(&self->tail, &pos, pos + 1)) {                                                     \
+                slot->value = value;                                                                                   \
+                RINGBUFFER_STORE(&slot->seq, pos + 1, RINGBUFFER_RELEASE);                                             \
+                return RINGBUFFER_OK;                                                                                  \
+            }                                                                                                          \
+        } else if ((ptrdiff_t)(seq - pos) < 0) {                                                                       \
+            return RINGBUFFER_ERR_FULL;                                                                                \
+        } else {                                                                                                       \
+            pos = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_RELAXED);                                                    \
+        }                                                                                                              \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, push_n)(                                                            \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    const T *src,                                                                                                      \
+    const size_t n                                                                                                     \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL && src != NULL, 0, "push_n(): ring buffer or src is null.");                        \
+    size_t limit = n < self->mask + 1 ? n : self->mask + 1;                                                            \
+    if (limit == 0) {                                                                                                  \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    size_t pos = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_RELAXED);                                                     \
+    size_t count;                                                                                                      \
+    for (;;) {                                                                                                         \
+        count = 0;                                                                                                     \
+        while (count < limit) {                                                                                        \
+            size_t seq = RINGBUFFER_LOAD(&self->slots[(pos + count) & self->mask].seq, RINGBUFFER_ACQUIRE);            \
+            if (seq != pos + count) {                                                                                  \
+                break;                                                                                                 \
+            }                                                                                                          \
+            count++;                                                                                                   \
+        }                                                                                                              \
+        if (count == 0) {                                                                                              \
+            size_t seq = RINGBUFFER_LOAD(&self->slots[pos & self->mask].seq, RINGBUFFER_ACQUIRE);                      \
+            if ((ptrdiff_t)(seq - pos) < 0) {                                                                          \
+                return 0;                                                                                              \
+            }                                                                                                          \
+            pos = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_RELAXED);                                                    \
+        } else if (RINGBUFFER_CAS_WEAK(&self->tail, &pos, pos + count)) {                                              \
+            break;                                                                                                     \
+        }                                                                                                              \
+    }                                                                                                                  \
+    for (size_t i = 0; i < count; ++i) {                                                                               \
+        struct ringbuffer_mpmc_slot_##name *slot = &self->slots[(pos + i) & self->mask];                               \
+        memcpy(&slot->value, &src[i], sizeof(T));                                                                      \
+        RINGBUFFER_STORE(&slot->seq, pos + i + 1, RINGBUFFER_RELEASE);                                                 \
+    }                                                                                                                  \
+    return count;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE enum ringbuffer_error RINGBUFFER_FN_MPMC(name, try_pop)(                                            \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    T *out                                                                                                             \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL && out != NULL, RINGBUFFER_ERR_NULL, "try_pop(): ring buffer or out is null.");     \
+    size_t pos = RINGBUFFER_LOAD(&self->head, RINGBUFFER_RELAXED);                                                     \
+    for (;;) {                                                                                                         \
+        struct ringbuffer_mpmc_slot_##name *slot = &self->slots[pos & self->mask];                                     \
+        size_t seq = RINGBUFFER_LOAD(&slot->seq, RINGBUFFER_ACQUIRE);                                                  \
+        if (seq == pos + 1) {                                                                                          \
+            if (RINGBUFFER_CAS_WEAK(&self->head, &pos, pos + 1)) {                                                     \
+                *out = slot->value;                                                                                    \
+                RINGBUFFER_STORE(&slot->seq, pos + self->mask + 1, RINGBUFFER_RELEASE);                                \
+                return RINGBUFFER_OK;                                                                                  \
+            }                                                                                                          \
+        } else if ((ptrdiff_t)(seq - (pos + 1)) < 0) {                                                                 \
+            return RINGBUFFER_ERR_EMPTY;                                                                               \
+        } else {                                                                                                       \
+            pos = RINGBUFFER_LOAD(&self->head, RINGBUFFER_RELAXED);                                                    \
+        }                                                                                                              \
+    }                                                                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, pop_n)(                                                             \
+    struct ringbuffer_mpmc_##name *self,                                                                               \
+    T *dst,                                                                                                            \
+    const size_t n                                                                                                     \
+) {                                                                                                                    \
+    RINGBUFFER_ENSURE(self != NULL && dst != NULL, 0, "pop_n(): ring buffer or dst is null.");                         \
+    size_t limit = n < self->mask + 1 ? n : self->mask + 1;                                                            \
+    if (limit == 0) {                                                                                                  \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    size_t pos = RINGBUFFER_LOAD(&self->head, RINGBUFFER_RELAXED);                                                     \
+    size_t count;                                                                                                      \
+    for (;;) {                                                                                                         \
+        count = 0;                                                                                                     \
+        while (count < limit) {                                                                                        \
+            size_t seq = RINGBUFFER_LOAD(&self->slots[(pos + count) & self->mask].seq, RINGBUFFER_ACQUIRE);            \
+            if (seq != pos + count + 1) {                                                                              \
+                break;                                                                                                 \
+            }                                                                                                          \
+            count++;                                                                                                   \
+        }                                                                                                              \
+        if (count == 0) {                                                                                              \
+            size_t seq = RINGBUFFER_LOAD(&self->slots[pos & self->mask].seq, RINGBUFFER_ACQUIRE);                      \
+            if ((ptrdiff_t)(seq - (pos + 1)) < 0) {                                                                    \
+                return 0;                                                                                              \
+            }                                                                                                          \
+            pos = RINGBUFFER_LOAD(&self->head, RINGBUFFER_RELAXED);                                                    \
+        } else if (RINGBUFFER_CAS_WEAK(&self->head, &pos, pos + count)) {                                              \
+            break;                                                                                                     \
+        }                                                                                                              \
+    }                                                                                                                  \
+    for (size_t i = 0; i < count; ++i) {                                                                               \
+        struct ringbuffer_mpmc_slot_##name *slot = &self->slots[(pos + i) & self->mask];                               \
+        dst[i] = slot->value;                                                                                          \
+        RINGBUFFER_STORE(&slot->seq, pos + i + self->mask + 1, RINGBUFFER_RELEASE);                                    \
+    }                                                                                                                  \
+    return count;                                                                                                      \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, size)(const struct ringbuffer_mpmc_##name *self) {                  \
+    RINGBUFFER_ENSURE(self != NULL, 0, "size(): ring buffer is null.");                                                \
+    size_t head = RINGBUFFER_LOAD((RINGBUFFER_ATOMIC(size_t) *)&self->head, RINGBUFFER_ACQUIRE);                       \
+    size_t tail = RINGBUFFER_LOAD((RINGBUFFER_ATOMIC(size_t) *)&self->tail, RINGBUFFER_ACQUIRE);                       \
+    /* Both can move between the loads, the difference may be off by the ones in flight */                             \
+    if ((ptrdiff_t)(tail - head) < 0) {                                                                                \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    return tail - head > self->mask + 1 ? self->mask + 1 : tail - head;                                                \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE bool RINGBUFFER_FN_MPMC(name, is_empty)(const struct ringbuffer_mpmc_##name *self) {                \
+    RINGBUFFER_ENSURE(self != NULL, false, "is_empty(): ring buffer is null.");                                        \
+    return RINGBUFFER_FN_MPMC(name, size)(self) == 0;                                                                  \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE size_t RINGBUFFER_FN_MPMC(name, capacity)(const struct ringbuffer_mpmc_##name *self) {              \
+    RINGBUFFER_ENSURE(self != NULL, 0, "capacity(): ring buffer is null.");                                            \
+    return self->slots != NULL ? self->mask + 1 : 0;                                                                   \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE void RINGBUFFER_FN_MPMC(name, clear)(struct ringbuffer_mpmc_##name *self) {                         \
+    if (!self || !self->slots) {                                                                                       \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    size_t head = RINGBUFFER_LOAD(&self->head, RINGBUFFER_ACQUIRE);                                                    \
+    size_t tail = RINGBUFFER_LOAD(&self->tail, RINGBUFFER_ACQUIRE);                                                    \
+    for (size_t pos = head; pos != tail; ++pos) {                                                                      \
+        struct ringbuffer_mpmc_slot_##name *slot = &self->slots[pos & self->mask];                                     \
+        deinit_fn(&slot->value, &self->alloc);                                                                         \
+        RINGBUFFER_STORE(&slot->seq, pos + self->mask + 1, RINGBUFFER_RELAXED);                                        \
+    }                                                                                                                  \
+    RINGBUFFER_STORE(&self->head, tail, RINGBUFFER_RELAXED);                                                           \
+}                                                                                                                      \
+                                                                                                                       \
+RINGBUFFER_LINKAGE void RINGBUFFER_FN_MPMC(name, deinit)(struct ringbuffer_mpmc_##name *self) {                        \
+    if (!self || !self->slots) {                                                                                       \
+        return;                                                                                                        \
+    }                                                                                                                  \
+    RINGBUFFER_FN_MPMC(name, clear)(self);                                                                             \
+    self->alloc.free(self->slots, (self->mask + 1) * sizeof(struct ringbuffer_mpmc_slot_##name), self->alloc.ctx);     \
+    memset(self, 0, sizeof(*self));                                                                                    \
+}
+
+/**
+ * @def RINGBUFFER_MPMC(T, name, deinit_fn)
+ * @brief Helper macro to define the structs, the declarations and the implementations of a
+ *        multiple producers multiple consumers ring buffer type
+ * @param T The type ring buffer will hold
+ * @param name The name suffix for the ring buffer type
+ * @param deinit_fn Destructor of the elements, ringbuffer_noop_deinit if there is nothing to free
+ */
+#define RINGBUFFER_MPMC(T, name, deinit_fn)                                                                            \
+RINGBUFFER_TYPE_MPMC(T, name)                                                                                          \
+RINGBUFFER_DECL_MPMC(T, name)                                                                                          \
+RINGBUFFER_IMPL_MPMC(T, name, deinit_fn)
+
+// clang-format on
+
+#ifdef __cplusplus
+}
+#endif // extern "C"
+
+#endif // RINGBUFFER_H
@@ -3,6 +3,7 @@
  * @brief Unit tests for the pair.h file
  */
 #include <assert.h>
+#include <limits.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -68,6 +69,63 @@ void test_int_pair_cmp(void) {
     puts("test_int_pair_cmp passed");
 }
 
+// == PACKED KEY ==
+
+PAIR_DECL_PACKED(int, int, int_pair)
+PAIR_IMPL_PACKED(int, int, int_pair)
+
+PAIR(unsigned short, signed char, small_pair, pair_noop_deinit, pair_noop_deinit)
+PAIR_DECL_PACKED(unsigned short, signed char, small_pair)
+PAIR_IMPL_PACKED(unsigned short, signed char, small_pair)
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+static int exact_int_cmp(int *a, int *b) {
+    return (*a > *b) - (*a < *b);
+}
+
+void test_int_pair_packed(void) {
+    // Extremes and signs, where a subtraction or a plain cast would get the order wrong
+    int values[] = { INT_MIN, INT_MIN + 1, -70000, -1, 0, 1, 65536, INT_MAX - 1, INT_MAX };
+    size_t n = sizeof(values) / sizeof(values[0]);
+    for (size_t i = 0; i < n * n; ++i) {
+        for (size_t j = 0; j < n * n; ++j) {
+            struct pair_int_pair a = int_pair_init(values[i / n], values[i % n]);
+            struct pair_int_pair b = int_pair_init(values[j / n], values[j % n]);
+            int expected = (int)int_pair_cmp(&a, &b, exact_int_cmp, exact_int_cmp);
+            assert(sign(int_pair_cmp_packed(&a, &b)) == expected);
+            assert(int_pair_eq(&a, &b) == (i == j));
+            assert((int_pair_hash(&a) == int_pair_hash(&b)) == (i == j));
+        }
+    }
+
+    // Unsigned first and signed second of different widths
+    struct pair_small_pair lo = small_pair_init(0, 127);
+    struct pair_small_pair mid = small_pair_init(1, -128);
+    struct pair_small_pair hi = small_pair_init(65535, -1);
+    struct pair_small_pair hi2 = small_pair_init(65535, 0);
+    assert(small_pair_cmp_packed(&lo, &mid) < 0);
+    assert(small_pair_cmp_packed(&mid, &hi) < 0);
+    assert(small_pair_cmp_packed(&hi, &hi2) < 0);
+    assert(small_pair_cmp_packed(&hi2, &hi2) == 0);
+    assert(small_pair_cmp_packed(&hi2, &lo) > 0);
+    assert(small_pair_pack(&hi2) == ((uint64_t)65535 << 32 | UINT32_C(0x80000000)));
+
+    // The hash spreads consecutive keys over the low bits a table would index with
+    size_t seen = 0;
+    bool bucket[64] = { false };
+    for (int i = 0; i < 64; ++i) {
+        struct pair_int_pair p = int_pair_init(7, i);
+        size_t slot = (size_t)(int_pair_hash(&p) & 63);
+        seen += !bucket[slot];
+        bucket[slot] = true;
+    }
+    assert(seen > 32);
+    puts("test_int_pair_packed passed");
+}
+
 void test_int_pair_swap(void) {
     struct pair_int_pair a = int_pair_init(10, 20);
     struct pair_int_pair b = int_pair_init(30, 40);
@@ -578,6 +636,7 @@ void test_resource_ptr_pair_deinit(void) {
 int main(void) {
     test_int_pair_init();
     test_int_pair_cmp();
+    test_int_pair_packed();
     test_int_pair_swap();
     test_int_pair_deep_clone();
     test_int_pair_shallow_copy();
@@ -0,0 +1,394 @@
+/**
+ * @file test.c
+ * @brief Unit tests for the ringbuffer.h file, single threaded and, when the build defines
+ *        EXECUTOR_PTHREAD, with producers and consumers on the pthread pool of executor.h
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "executor.h"
+#include "ringbuffer.h"
+
+static size_t global_destructor_counter = 0;
+
+static void intptr_deinit(int **ptr, struct Allocator *alloc) {
+    alloc->free(*ptr, sizeof(int), alloc->ctx);
+    global_destructor_counter++;
+}
+
+RINGBUFFER(int, ints, ringbuffer_noop_deinit)
+RINGBUFFER(int *, intptrs, intptr_deinit)
+RINGBUFFER_MPMC(int, ints, ringbuffer_noop_deinit)
+RINGBUFFER_MPMC(int *, intptrs, intptr_deinit)
+
+static void *failing_malloc(size_t size, void *ctx) {
+    (void)size;
+    (void)ctx;
+    return NULL;
+}
+
+static int *new_int(struct Allocator *alloc, int value) {
+    int *ptr = (int *)alloc->malloc(sizeof(int), alloc->ctx);
+    *ptr = value;
+    return ptr;
+}
+
+void test_ringbuffer_init(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct ringbuffer_ints rb;
+    enum ringbuffer_error err = ints_init(NULL, gpa, 8);
+    assert(err == RINGBUFFER_ERR_NULL);
+    (void)err;
+    err = ints_init(&rb, gpa, 0);
+    assert(err == RINGBUFFER_ERR_CAPACITY);
+    err = ints_init(&rb, gpa, 1);
+    assert(err == RINGBUFFER_ERR_CAPACITY);
+    err = ints_init(&rb, gpa, 12);
+    assert(err == RINGBUFFER_ERR_CAPACITY);
+    err = ints_init(&rb, gpa, SIZE_MAX / 2 + 1);
+    assert(err == RINGBUFFER_ERR_CAPACITY);
+    assert(ints_capacity(&rb) == 0);
+    ints_deinit(&rb);
+
+    struct Allocator failing = gpa;
+    failing.malloc = failing_malloc;
+    err = ints_init(&rb, failing, 8);
+    assert(err == RINGBUFFER_ERR_ALLOC);
+    assert(rb.data == NULL);
+
+    struct ringbuffer_mpmc_ints mpmc;
+    err = mpmc_ints_init(&mpmc, gpa, 6);
+    assert(err == RINGBUFFER_ERR_CAPACITY);
+    err = mpmc_ints_init(&mpmc, failing, 8);
+    assert(err == RINGBUFFER_ERR_ALLOC);
+    err = mpmc_ints_init(&mpmc, gpa, 2);
+    assert(err == RINGBUFFER_OK);
+    assert(mpmc_ints_capacity(&mpmc) == 2);
+    mpmc_ints_deinit(&mpmc);
+    mpmc_ints_deinit(&mpmc);
+    assert(mpmc_ints_capacity(NULL) == 0);
+    printf("test ringbuffer init passed\n");
+}
+
+void test_ringbuffer_spsc_scalar_type(void) {
+    struct ringbuffer_ints rb;
+    enum ringbuffer_error err = ints_init(&rb, allocator_get_default(), 8);
+    assert(err == RINGBUFFER_OK);
+    (void)err;
+    assert(ints_capacity(&rb) == 8 && ints_size(&rb) == 0 && ints_is_empty(&rb));
+
+    int out = -1;
+    assert(ints_try_pop(&rb, &out) == RINGBUFFER_ERR_EMPTY && out == -1);
+    for (int i = 0; i < 8; ++i) {
+        assert(ints_try_push(&rb, i) == RINGBUFFER_OK);
+    }
+    assert(ints_try_push(&rb, 8) == RINGBUFFER_ERR_FULL);
+    assert(ints_size(&rb) == 8 && !ints_is_empty(&rb));
+    for (int i = 0; i < 8; ++i) {
+        assert(ints_try_pop(&rb, &out) == RINGBUFFER_OK && out == i);
+    }
+    assert(ints_try_pop(&rb, &out) == RINGBUFFER_ERR_EMPTY);
+
+    // Many laps with a varying fill level, the positions wrap around the slots
+    int next_in = 0;
+    int next_out = 0;
+    for (int round = 0; round < 1000; ++round) {
+        int burst = round % 9;
+        for (int i = 0; i < burst; ++i) {
+            if (ints_try_push(&rb, next_in) == RINGBUFFER_OK) {
+                next_in++;
+            }
+        }
+        while (ints_size(&rb) > (size_t)(round % 3)) {
+            assert(ints_try_pop(&rb, &out) == RINGBUFFER_OK && out == next_out);
+            next_out++;
+        }
+    }
+
+    // Batches are cut to the free slots and to the queued elements
+    ints_clear(&rb);
+    assert(ints_is_empty(&rb));
+    int src[12];
+    int dst[12];
+    for (int i = 0; i < 12; ++i) {
+        src[i] = 100 + i;
+    }
+    assert(ints_push_n(&rb, src, 5) == 5);
+    assert(ints_push_n(&rb, src + 5, 7) == 3);
+    assert(ints_push_n(&rb, src, 1) == 0);
+    assert(ints_pop_n(&rb, dst, 6) == 6);
+    assert(ints_push_n(&rb, src + 8, 4) == 4);
+    assert(ints_pop_n(&rb, dst + 6, 12) == 6);
+    for (int i = 0; i < 12; ++i) {
+        assert(dst[i] == 100 + i);
+    }
+    assert(ints_pop_n(&rb, dst, 12) == 0);
+
+    assert(ints_try_push(NULL, 1) == RINGBUFFER_ERR_NULL);
+    assert(ints_try_pop(&rb, NULL) == RINGBUFFER_ERR_NULL);
+    assert(ints_push_n(&rb, NULL, 3) == 0);
+    assert(ints_pop_n(NULL, dst, 3) == 0);
+    assert(ints_size(NULL) == 0 && !ints_is_empty(NULL));
+    ints_deinit(&rb);
+    assert(rb.data == NULL);
+    printf("test ringbuffer spsc scalar type passed\n");
+}
+
+void test_ringbuffer_mpmc_scalar_type(void) {
+    struct ringbuffer_mpmc_ints rb;
+    enum ringbuffer_error err = mpmc_ints_init(&rb, allocator_get_default(), 4);
+    assert(err == RINGBUFFER_OK);
+    (void)err;
+    int out = -1;
+    assert(mpmc_ints_try_pop(&rb, &out) == RINGBUFFER_ERR_EMPTY);
+    for (int i = 0; i < 4; ++i) {
+        assert(mpmc_ints_try_push(&rb, i) == RINGBUFFER_OK);
+    }
+    assert(mpmc_ints_try_push(&rb, 4) == RINGBUFFER_ERR_FULL);
+    assert(mpmc_ints_size(&rb) == 4);
+    assert(mpmc_ints_try_pop(&rb, &out) == RINGBUFFER_OK && out == 0);
+    assert(mpmc_ints_try_push(&rb, 4) == RINGBUFFER_OK);
+    for (int i = 1; i < 5; ++i) {
+        assert(mpmc_ints_try_pop(&rb, &out) == RINGBUFFER_OK && out == i);
+    }
+    assert(mpmc_ints_is_empty(&rb));
+
+    // Every slot goes through many laps, the sequence numbers must keep up
+    int src[7];
+    int dst[7];
+    int next_in = 0;
+    int next_out = 0;
+    for (int round = 0; round < 500; ++round) {
+        size_t want = (size_t)(round % 7) + 1;
+        for (size_t i = 0; i < want; ++i) {
+            src[i] = next_in + (int)i;
+        }
+        size_t pushed = mpmc_ints_push_n(&rb, src, want);
+        assert(pushed <= want && pushed <= 4);
+        next_in += (int)pushed;
+        size_t popped = mpmc_ints_pop_n(&rb, dst, (size_t)(round % 3) + 1);
+        for (size_t i = 0; i < popped; ++i) {
+            assert(dst[i] == next_out++);
+        }
+    }
+    while (mpmc_ints_try_pop(&rb, &out) == RINGBUFFER_OK) {
+        assert(out == next_out++);
+    }
+    assert(next_out == next_in);
+    assert(mpmc_ints_push_n(&rb, src, 0) == 0);
+    assert(mpmc_ints_pop_n(&rb, dst, 0) == 0);
+    assert(mpmc_ints_try_push(NULL, 1) == RINGBUFFER_ERR_NULL);
+    assert(mpmc_ints_pop_n(&rb, NULL, 1) == 0);
+    mpmc_ints_deinit(&rb);
+    printf("test ringbuffer mpmc scalar type passed\n");
+}
+
+void test_ringbuffer_ptr(void) {
+    struct Allocator gpa = allocator_get_default();
+    struct ringbuffer_intptrs rb;
+    global_destructor_counter = 0;
+    enum ringbuffer_error err = intptrs_init(&rb, gpa, 16);
+    assert(err == RINGBUFFER_OK);
+    (void)err;
+    for (int i = 0; i < 16; ++i) {
+        assert(intptrs_try_push(&rb, new_int(&gpa, i)) == RINGBUFFER_OK);
+    }
+    // Popped elements belong to the caller, the destructor is not called on them
+    int *out = NULL;
+    assert(intptrs_try_pop(&rb, &out) == RINGBUFFER_OK && *out == 0);
+    gpa.free(out, sizeof(int), gpa.ctx);
+    assert(global_destructor_counter == 0);
+    intptrs_clear(&rb);
+    assert(global_destructor_counter == 15 && intptrs_is_empty(&rb));
+    for (int i = 0; i < 5; ++i) {
+        assert(intptrs_try_push(&rb, new_int(&gpa, i)) == RINGBUFFER_OK);
+    }
+    intptrs_deinit(&rb);
+    assert(global_destructor_counter == 20);
+
+    struct ringbuffer_mpmc_intptrs mpmc;
+    err = mpmc_intptrs_init(&mpmc, gpa, 8);
+    assert(err == RINGBUFFER_OK);
+    for (int i = 0; i < 8; ++i) {
+        assert(mpmc_intptrs_try_push(&mpmc, new_int(&gpa, i)) == RINGBUFFER_OK);
+    }
+    assert(mpmc_intptrs_try_pop(&mpmc, &out) == RINGBUFFER_OK && *out == 0);
+    gpa.free(out, sizeof(int), gpa.ctx);
+    mpmc_intptrs_clear(&mpmc);
+    assert(global_destructor_counter == 27);
+    // The slots handed back by clear are free for the next lap
+    for (int i = 0; i < 8; ++i) {
+        assert(mpmc_intptrs_try_push(&mpmc, new_int(&gpa, i)) == RINGBUFFER_OK);
+    }
+    mpmc_intptrs_deinit(&mpmc);
+    assert(global_destructor_counter == 35);
+    printf("test ringbuffer ptr passed\n");
+}
+
+#ifdef EXECUTOR_PTHREAD
+#include <sched.h>
+
+#define THREADED_ITEMS 100000
+#define THREADED_PRODUCERS 2
+#define THREADED_CONSUMERS 2
+
+struct spsc_job {
+    struct ringbuffer_ints *rb;
+    bool in_order;
+};
+
+static void spsc_producer(void *arg) {
+    struct spsc_job *job = (struct spsc_job *)arg;
+    int batch[32];
+    int next = 0;
+    while (next < THREADED_ITEMS) {
+        if (next % 3 == 0) {
+            if (ints_try_push(job->rb, next) == RINGBUFFER_OK) {
+                next++;
+            } else {
+                sched_yield();
+            }
+            continue;
+        }
+        int count = THREADED_ITEMS - next < 32 ? THREADED_ITEMS - next : 32;
+        for (int i = 0; i < count; ++i) {
+            batch[i] = next + i;
+        }
+        size_t pushed = ints_push_n(job->rb, batch, (size_t)count);
+        if (pushed == 0) {
+            // Single core machines would otherwise spin a whole time slice
+            sched_yield();
+        }
+        next += (int)pushed;
+    }
+}
+
+static void spsc_consumer(void *arg) {
+    struct spsc_job *job = (struct spsc_job *)arg;
+    int batch[17];
+    int expected = 0;
+    while (expected < THREADED_ITEMS) {
+        size_t popped = ints_pop_n(job->rb, batch, 17);
+        if (popped == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < popped; ++i) {
+            job->in_order = job->in_order && batch[i] == expected;
+            expected++;
+        }
+    }
+}
+
+struct mpmc_job {
+    struct ringbuffer_mpmc_ints *rb;
+    int producer;                    // Producer index, or -1 for a consumer
+    int *remaining;                  // Elements still to pop, shared by the consumers
+    long long sum;                   // Sum of the popped elements
+    int last[THREADED_PRODUCERS];    // Last element seen of each producer
+    bool in_order;                   // Elements of each producer came in the order they were pushed
+};
+
+static void mpmc_producer(void *arg) {
+    struct mpmc_job *job = (struct mpmc_job *)arg;
+    // Elements are producer + k * THREADED_PRODUCERS, so the consumers can tell them apart
+    int batch[8];
+    int k = 0;
+    while (k < THREADED_ITEMS) {
+        int count = THREADED_ITEMS - k < 8 ? THREADED_ITEMS - k : 8;
+        if (k % 2 == 0) {
+            count = 1;
+        }
+        for (int i = 0; i < count; ++i) {
+            batch[i] = job->producer + (k + i) * THREADED_PRODUCERS;
+        }
+        size_t pushed = count == 1 ? (mpmc_ints_try_push(job->rb, batch[0]) == RINGBUFFER_OK)
+                                   : mpmc_ints_push_n(job->rb, batch, (size_t)count);
+        if (pushed == 0) {
+            sched_yield();
+        }
+        k += (int)pushed;
+    }
+}
+
+static void mpmc_consumer(void *arg) {
+    struct mpmc_job *job = (struct mpmc_job *)arg;
+    int batch[5];
+    while (__atomic_load_n(job->remaining, __ATOMIC_RELAXED) > 0) {
+        size_t popped = mpmc_ints_pop_n(job->rb, batch, 5);
+        if (popped == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < popped; ++i) {
+            int producer = batch[i] % THREADED_PRODUCERS;
+            job->in_order = job->in_order && batch[i] > job->last[producer];
+            job->last[producer] = batch[i];
+            job->sum += batch[i];
+        }
+        __atomic_fetch_sub(job->remaining, (int)popped, __ATOMIC_RELAXED);
+    }
+}
+
+void test_ringbuffer_threads(void) {
+    struct executor_thread_pool pool;
+    // Every task spins until the others make progress, so all of them need a thread
+    int started = executor_thread_pool_init(&pool, THREADED_PRODUCERS + THREADED_CONSUMERS - 1);
+    assert(started == 0);
+    (void)started;
+    assert(pool.nthreads == THREADED_PRODUCERS + THREADED_CONSUMERS - 1);
+    struct Executor executor = executor_get_thread_pool(&pool);
+
+    struct ringbuffer_ints spsc;
+    enum ringbuffer_error err = ints_init(&spsc, allocator_get_default(), 64);
+    assert(err == RINGBUFFER_OK);
+    (void)err;
+    struct spsc_job job = { .rb = &spsc, .in_order = true };
+    assert(executor.submit(spsc_consumer, &job, executor.ctx));
+    assert(executor.submit(spsc_producer, &job, executor.ctx));
+    executor.wait(executor.ctx);
+    assert(job.in_order && ints_is_empty(&spsc));
+    ints_deinit(&spsc);
+
+    struct ringbuffer_mpmc_ints mpmc;
+    err = mpmc_ints_init(&mpmc, allocator_get_default(), 128);
+    assert(err == RINGBUFFER_OK);
+    int remaining = THREADED_PRODUCERS * THREADED_ITEMS;
+    struct mpmc_job jobs[THREADED_PRODUCERS + THREADED_CONSUMERS];
+    for (int j = 0; j < THREADED_PRODUCERS + THREADED_CONSUMERS; ++j) {
+        jobs[j].rb = &mpmc;
+        jobs[j].producer = j < THREADED_PRODUCERS ? j : -1;
+        jobs[j].remaining = &remaining;
+        jobs[j].sum = 0;
+        jobs[j].in_order = true;
+        for (int p = 0; p < THREADED_PRODUCERS; ++p) {
+            jobs[j].last[p] = -1;
+        }
+        assert(executor.submit(j < THREADED_PRODUCERS ? mpmc_producer : mpmc_consumer, &jobs[j], executor.ctx));
+    }
+    executor.wait(executor.ctx);
+    long long n = (long long)THREADED_PRODUCERS * THREADED_ITEMS;
+    long long sum = 0;
+    for (int j = THREADED_PRODUCERS; j < THREADED_PRODUCERS + THREADED_CONSUMERS; ++j) {
+        assert(jobs[j].in_order);
+        sum += jobs[j].sum;
+    }
+    // Every element 0..n-1 popped exactly once
+    assert(remaining == 0 && sum == n * (n - 1) / 2);
+    assert(mpmc_ints_is_empty(&mpmc));
+    mpmc_ints_deinit(&mpmc);
+    executor_thread_pool_deinit(&pool);
+    printf("test ringbuffer threads passed\n");
+}
+#endif // EXECUTOR_PTHREAD
+
+int main(void) {
+    test_ringbuffer_init();
+    test_ringbuffer_spsc_scalar_type();
+    test_ringbuffer_mpmc_scalar_type();
+    test_ringbuffer_ptr();
+#ifdef EXECUTOR_PTHREAD
+    test_ringbuffer_threads();
+#endif // EXECUTOR_PTHREAD
+    return 0;
+}